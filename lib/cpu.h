@@ -0,0 +1,139 @@
+/*
+    cpu - runtime detection of CPU features
+    Header File for include
+    Copyright (C) 2015, Yann Collet.
+
+    BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+    You can contact the author at :
+    - zstd source repository : https://github.com/Cyan4973/zstd
+    - ztsd public forum : https://groups.google.com/forum/#!forum/lz4c
+*/
+#ifndef ZSTD_CPU_H_MODULE
+#define ZSTD_CPU_H_MODULE
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* *************************************
+*  Includes
+***************************************/
+#include "mem.h"
+
+
+/* *************************************
+*  Dynamic dispatch
+***************************************/
+/* ZSTD_DYNAMIC_DISPATCH : compile some kernels a second time for newer x86 instruction sets,
+*  and select them at runtime, so that a single binary built for baseline x86-64 can use them.
+*  Requires gcc >= 4.9 or clang; can be disabled with -DZSTD_DYNAMIC_DISPATCH=0.
+*  Instruction sets enabled at compile time (-mavx2, -mbmi2) are used directly. */
+#ifndef ZSTD_DYNAMIC_DISPATCH
+#  if (defined(__x86_64__) || defined(__i386__)) \
+      && ((defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))) || defined(__clang__))
+#    define ZSTD_DYNAMIC_DISPATCH 1
+#  else
+#    define ZSTD_DYNAMIC_DISPATCH 0
+#  endif
+#endif
+
+#if ZSTD_DYNAMIC_DISPATCH
+#  include <cpuid.h>
+#  define ZSTD_TARGET(target) __attribute__((__target__(target)))
+#else
+#  define ZSTD_TARGET(target)   /* nothing : target features come from compiler flags */
+#endif
+
+
+/* *************************************
+*  Feature detection
+***************************************/
+typedef struct {
+    U32 f1c;    /* cpuid leaf 1, ecx */
+    U32 f7b;    /* cpuid leaf 7, ebx */
+    U32 ymm;    /* OS saves ymm registers */
+} ZSTD_cpuid_t;
+
+MEM_STATIC ZSTD_cpuid_t ZSTD_cpuid(void)
+{
+    ZSTD_cpuid_t cpu = { 0, 0, 0 };
+#if ZSTD_DYNAMIC_DISPATCH
+    U32 a, b, c, d;
+    const U32 maxLeaf = __get_cpuid_max(0, NULL);
+    if (maxLeaf >= 1)
+    {
+        __cpuid(1, a, b, c, d);
+        cpu.f1c = c;
+        if (c & (1U << 27))   /* OSXSAVE */
+        {
+            U32 xcr0, xcr0h;
+            __asm__ ("xgetbv" : "=a" (xcr0), "=d" (xcr0h) : "c" (0));
+            cpu.ymm = ((xcr0 & 6) == 6);   /* xmm & ymm state */
+        }
+    }
+    if (maxLeaf >= 7)
+    {
+        __cpuid_count(7, 0, a, b, c, d);
+        cpu.f7b = b;
+    }
+#endif
+    return cpu;
+}
+
+MEM_STATIC int ZSTD_cpuid_bmi2(ZSTD_cpuid_t cpu) { return (cpu.f7b >> 8) & 1; }
+MEM_STATIC int ZSTD_cpuid_avx2(ZSTD_cpuid_t cpu) { return ((cpu.f7b >> 5) & 1) && ((cpu.f1c >> 28) & 1) /* AVX */ && cpu.ymm; }
+
+/* ZSTD_cpuFeatures() : ZSTD_cpuFeature_* flags of the running cpu.
+*  cpuid is slow : result is cached. First calls may come from several threads at once :
+*  they detect the same flags, and share them through relaxed atomics, so no lock is needed. */
+#define ZSTD_cpuFeature_detected  1
+#define ZSTD_cpuFeature_bmi2      2
+#define ZSTD_cpuFeature_avx2      4
+
+MEM_STATIC U32 ZSTD_cpuFeatures(void)
+{
+#if ZSTD_DYNAMIC_DISPATCH
+    static U32 g_features = 0;   /* 0 : not detected yet */
+    U32 features = __atomic_load_n(&g_features, __ATOMIC_RELAXED);
+    if (!features)
+    {
+        const ZSTD_cpuid_t cpu = ZSTD_cpuid();
+        features = ZSTD_cpuFeature_detected
+                 | (ZSTD_cpuid_bmi2(cpu) ? ZSTD_cpuFeature_bmi2 : 0)
+                 | (ZSTD_cpuid_avx2(cpu) ? ZSTD_cpuFeature_avx2 : 0);
+        __atomic_store_n(&g_features, features, __ATOMIC_RELAXED);
+    }
+    return features;
+#else
+    return ZSTD_cpuFeature_detected;
+#endif
+}
+
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif  /* ZSTD_CPU_H_MODULE */
@@ -0,0 +1,307 @@
+/*
+    dictBuilder - dictionary trainer for zstd
+    Copyright (C) 2015, Yann Collet.
+
+    BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+    You can contact the author at :
+    - zstd source repository : https://github.com/Cyan4973/zstd
+*/
+
+/* *************************************
+*  Includes
+***************************************/
+#include <stdlib.h>   /* malloc, free */
+#include <string.h>   /* memset, memcpy */
+#include "mem.h"
+#include "error.h"
+#include "zstd_static.h"
+#include "zstdhc_static.h"
+#include "dictBuilder.h"
+
+
+/* *************************************
+*  Constants
+***************************************/
+#define DiB_DMERSIZE_DEFAULT 8
+#define DiB_DMERSIZE_MIN 4
+#define DiB_DMERSIZE_MAX 8
+#define DiB_HASHLOG_MIN 16
+#define DiB_HASHLOG_MAX 22
+#define DiB_CLEVEL_DEFAULT 5
+#define DiB_EVAL_MAXSAMPLES 512
+#define DiB_DICTSIZE_MIN 256
+
+#define MIN(a,b) ((a)<(b) ? (a) : (b))
+#define MAX(a,b) ((a)>(b) ? (a) : (b))
+
+static const U64 prime8bytes = 0xCF1BBCDCB7A56463ULL;
+
+
+/* *************************************
+*  Pattern counting
+***************************************/
+static U32 DiB_highbit(U32 val)
+{
+    U32 nbBits = 0;
+    while (val >>= 1) nbBits++;
+    return nbBits;
+}
+
+/* only the first dmerSize bytes at p participate; 8 bytes must be readable at p */
+static U32 DiB_hashDmer(const BYTE* p, U32 dmerSize, U32 hashLog)
+{
+    const U64 dmer = MEM_readLE64(p) << (64 - 8*dmerSize);
+    return (U32)((dmer * prime8bytes) >> (64-hashLog));
+}
+
+/* freqs[h] : nb of samples containing a pattern hashed into h */
+static void DiB_countDmers(U32* freqs, U32* lastSample, U32 hashLog,
+                           const BYTE* samples, size_t totalSize, const size_t* samplesSizes, unsigned nbSamples,
+                           U32 dmerSize)
+{
+    size_t start = 0;
+    unsigned n;
+
+    memset(freqs, 0, sizeof(U32) << hashLog);
+    memset(lastSample, 0, sizeof(U32) << hashLog);
+    for (n=0; n<nbSamples; n++)
+    {
+        const size_t end = start + samplesSizes[n];
+        const size_t limit = MIN(end + 1, totalSize - 7);   /* pattern must fit into sample, 8 bytes must be readable */
+        size_t pos;
+        for (pos=start; pos + dmerSize <= end && pos < limit; pos++)
+        {
+            const U32 h = DiB_hashDmer(samples + pos, dmerSize, hashLog);
+            if (lastSample[h] == n+1) continue;   /* count each pattern once per sample */
+            lastSample[h] = n+1;
+            freqs[h]++;
+        }
+        start = end;
+    }
+}
+
+
+/* *************************************
+*  Segment selection
+***************************************/
+/* selects, within [begin, end[, the segment of segmentSize bytes with highest frequency score.
+   Zero-frequency patterns are trimmed from its borders, then its patterns are removed from freqs[],
+   so that they do not contribute to following selections.
+   @return : size of selected segment (0 if nothing useful remains) */
+static size_t DiB_selectSegment(size_t* segmentStartPtr, U32* freqs, U32 hashLog,
+                                const BYTE* samples, size_t totalSize,
+                                size_t begin, size_t end, U32 segmentSize, U32 dmerSize)
+{
+    const size_t nbDmers = segmentSize - dmerSize + 1;
+    const size_t dmerEnd = MIN(end, totalSize - 7);
+    size_t bestStart = begin;
+    U64 bestScore = 0;
+    U64 score = 0;
+    size_t pos, segmentEnd;
+
+    if (dmerEnd <= begin) return 0;
+    for (pos=begin; pos<dmerEnd; pos++)
+    {
+        score += freqs[DiB_hashDmer(samples + pos, dmerSize, hashLog)];
+        if (pos >= begin + nbDmers) score -= freqs[DiB_hashDmer(samples + pos - nbDmers, dmerSize, hashLog)];
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestStart = (pos + 1 >= begin + nbDmers) ? pos + 1 - nbDmers : begin;
+        }
+    }
+    if (bestScore <= 1) return 0;   /* patterns present in a single sample are useless */
+
+    /* trim borders */
+    segmentEnd = MIN(bestStart + nbDmers, dmerEnd);   /* dmer positions : [bestStart, segmentEnd[ */
+    while ((bestStart < segmentEnd) && (freqs[DiB_hashDmer(samples + bestStart, dmerSize, hashLog)] == 0)) bestStart++;
+    while ((segmentEnd > bestStart) && (freqs[DiB_hashDmer(samples + segmentEnd - 1, dmerSize, hashLog)] == 0)) segmentEnd--;
+
+    /* selected patterns no longer count */
+    for (pos=bestStart; pos<segmentEnd; pos++)
+        freqs[DiB_hashDmer(samples + pos, dmerSize, hashLog)] = 0;
+
+    *segmentStartPtr = bestStart;
+    return (segmentEnd - bestStart) + dmerSize - 1;
+}
+
+/* fills dict from its end, one segment per epoch, round-robin, until full or no useful segment remains.
+   @return : dictionary size, written at the beginning of dict */
+static size_t DiB_buildDictionary(BYTE* dict, size_t dictCapacity, U32* freqs, U32 hashLog,
+                                  const BYTE* samples, size_t totalSize, U32 segmentSize, U32 dmerSize)
+{
+    U32 nbEpochs = MAX(1, (U32)(dictCapacity / segmentSize / 4));
+    size_t epochSize;
+    size_t tail = dictCapacity;
+    U32 epoch = 0, zeroScoreRun = 0;
+
+    if (totalSize / nbEpochs < segmentSize) nbEpochs = MAX(1, (U32)(totalSize / segmentSize));
+    epochSize = totalSize / nbEpochs;
+
+    while (tail > 0)
+    {
+        const size_t begin = epoch * epochSize;
+        const size_t end = (epoch == nbEpochs-1) ? totalSize : begin + epochSize;
+        size_t segmentStart = 0;
+        size_t segSize = DiB_selectSegment(&segmentStart, freqs, hashLog, samples, totalSize, begin, end, segmentSize, dmerSize);
+        epoch = (epoch+1) % nbEpochs;
+        if (segSize == 0)
+        {
+            if (++zeroScoreRun >= nbEpochs) break;
+            continue;
+        }
+        zeroScoreRun = 0;
+        if (segSize > tail) { segmentStart += segSize - tail; segSize = tail; }   /* keep segment's end, closest to following segments */
+        tail -= segSize;
+        memcpy(dict + tail, samples + segmentStart, segSize);
+    }
+
+    memmove(dict, dict + tail, dictCapacity - tail);
+    return dictCapacity - tail;
+}
+
+
+/* *************************************
+*  Dictionary evaluation
+***************************************/
+size_t DiB_evaluateDictionary(const void* dict, size_t dictSize,
+                        const void* samplesBuffer, const size_t* samplesSizes, unsigned nbSamples,
+                              int compressionLevel)
+{
+    const BYTE* const samples = (const BYTE*)samplesBuffer;
+    const unsigned step = nbSamples / DiB_EVAL_MAXSAMPLES + 1;
+    size_t maxSampleSize = 0;
+    size_t totalCSize = 0;
+    size_t start = 0;
+    void* dst = NULL;
+    ZSTD_CCtx* cctx = NULL;
+    ZSTD_CDict* cdict = NULL;
+    ZSTD_HC_CCtx* hcctx = NULL;
+    ZSTD_HC_CDict* hcCDict = NULL;
+    unsigned n;
+
+    if (compressionLevel <= 0) compressionLevel = DiB_CLEVEL_DEFAULT;
+    for (n=0; n<nbSamples; n+=step) maxSampleSize = MAX(maxSampleSize, samplesSizes[n]);
+    dst = malloc(ZSTD_compressBound(maxSampleSize));
+    if (compressionLevel == 1)
+    {
+        cctx = ZSTD_createCCtx();
+        cdict = ZSTD_createCDict(dict, dictSize);
+        if (!cctx || !cdict) totalCSize = ERROR(memory_allocation);
+    }
+    else
+    {
+        hcctx = ZSTD_HC_createCCtx();
+        hcCDict = ZSTD_HC_createCDict(dict, dictSize, compressionLevel);
+        if (!hcctx || !hcCDict) totalCSize = ERROR(memory_allocation);
+    }
+    if (dst == NULL) totalCSize = ERROR(memory_allocation);
+
+    for (n=0; (n<nbSamples) && !ZSTD_isError(totalCSize); n++)
+    {
+        if ((n % step) == 0)
+        {
+            size_t cSize;
+            if (cdict) cSize = ZSTD_compress_usingCDict(cctx, dst, ZSTD_compressBound(samplesSizes[n]), samples + start, samplesSizes[n], cdict);
+            else cSize = ZSTD_HC_compress_usingCDict(hcctx, dst, ZSTD_compressBound(samplesSizes[n]), samples + start, samplesSizes[n], hcCDict);
+            if (ZSTD_isError(cSize)) totalCSize = cSize;
+            else totalCSize += cSize;
+        }
+        start += samplesSizes[n];
+    }
+
+    free(dst);
+    ZSTD_freeCCtx(cctx);
+    ZSTD_freeCDict(cdict);
+    if (hcctx) ZSTD_HC_freeCCtx(hcctx);
+    ZSTD_HC_freeCDict(hcCDict);
+    return totalCSize;
+}
+
+
+/* *************************************
+*  Dictionary training
+***************************************/
+size_t DiB_trainFromBuffer(void* dictBuffer, size_t dictBufferCapacity,
+                     const void* samplesBuffer, const size_t* samplesSizes, unsigned nbSamples,
+                           DiB_params params)
+{
+    const BYTE* const samples = (const BYTE*)samplesBuffer;
+    const U32 dmerSize = (params.dmerSize == 0) ? DiB_DMERSIZE_DEFAULT :
+                         MAX(DiB_DMERSIZE_MIN, MIN(DiB_DMERSIZE_MAX, params.dmerSize));
+    size_t totalSize = 0;
+    U32 hashLog;
+    U32* freqs;
+    U32* lastSample;
+    size_t result;
+    unsigned n;
+
+    /* checks */
+    for (n=0; n<nbSamples; n++) totalSize += samplesSizes[n];
+    if ((nbSamples < 2) || (totalSize < 8)) return ERROR(srcSize_wrong);
+    if ((U64)totalSize > ((U64)1 << 32) - 1) return ERROR(srcSize_wrong);   /* keep scores within 32-bits ranges */
+    if (dictBufferCapacity < DiB_DICTSIZE_MIN) return ERROR(dstSize_tooSmall);
+
+    /* count patterns across samples */
+    hashLog = MAX(DiB_HASHLOG_MIN, MIN(DiB_HASHLOG_MAX, DiB_highbit((U32)totalSize) + 1));
+    freqs = (U32*)malloc(sizeof(U32) << hashLog);
+    lastSample = (U32*)malloc(sizeof(U32) << hashLog);
+    if (!freqs || !lastSample) { free(freqs); free(lastSample); return ERROR(memory_allocation); }
+    DiB_countDmers(freqs, lastSample, hashLog, samples, totalSize, samplesSizes, nbSamples, dmerSize);
+
+    if (params.segmentSize)
+    {
+        const U32 segmentSize = MAX(params.segmentSize, dmerSize);
+        result = DiB_buildDictionary((BYTE*)dictBuffer, dictBufferCapacity, freqs, hashLog, samples, totalSize, segmentSize, dmerSize);
+    }
+    else
+    {
+        /* try all segment sizes, keep the one compressing samples best; lastSample[] is recycled as a copy of freqs[] */
+        BYTE* const candidate = (BYTE*)malloc(dictBufferCapacity);
+        size_t bestCSize = (size_t)-1;
+        result = 0;
+        if (candidate == NULL) result = ERROR(memory_allocation);
+        for (n=0; (n<DiB_NB_SEGMENTSIZES) && !ZSTD_isError(result); n++)
+        {
+            size_t dictSize, cSize;
+            if (DiB_segmentSizes[n] < dmerSize) continue;
+            memcpy(lastSample, freqs, sizeof(U32) << hashLog);
+            dictSize = DiB_buildDictionary(candidate, dictBufferCapacity, lastSample, hashLog, samples, totalSize, DiB_segmentSizes[n], dmerSize);
+            cSize = DiB_evaluateDictionary(candidate, dictSize, samples, samplesSizes, nbSamples, params.compressionLevel);
+            if (ZSTD_isError(cSize)) { result = cSize; break; }
+            if (cSize < bestCSize)
+            {
+                bestCSize = cSize;
+                memcpy(dictBuffer, candidate, dictSize);
+                result = dictSize;
+            }
+        }
+        free(candidate);
+    }
+
+    free(freqs);
+    free(lastSample);
+    return result;
+}
@@ -0,0 +1,92 @@
+/*
+    dictBuilder - dictionary trainer for zstd
+    Header File
+    Copyright (C) 2015, Yann Collet.
+
+    BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+    You can contact the author at :
+    - zstd source repository : https://github.com/Cyan4973/zstd
+*/
+#pragma once
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* *************************************
+*  Includes
+***************************************/
+#include <stddef.h>   /* size_t */
+
+
+/* *************************************
+*  Parameters
+***************************************/
+typedef struct
+{
+    unsigned segmentSize;    /* size of segments selected into dictionary; 0 : try all DiB_segmentSizes[], keep the best */
+    unsigned dmerSize;       /* length of patterns counted across samples [4-8]; 0 : default (8) */
+    int compressionLevel;    /* level used to compare candidate dictionaries; 0 : default (5) */
+} DiB_params;
+
+#define DiB_NB_SEGMENTSIZES 6
+static const unsigned DiB_segmentSizes[DiB_NB_SEGMENTSIZES] = { 64, 128, 256, 512, 1024, 2048 };
+
+
+/* *************************************
+*  Dictionary builder
+***************************************/
+size_t DiB_trainFromBuffer(void* dictBuffer, size_t dictBufferCapacity,
+                     const void* samplesBuffer, const size_t* samplesSizes, unsigned nbSamples,
+                           DiB_params params);
+/**
+DiB_trainFromBuffer() :
+    Builds a dictionary of at most dictBufferCapacity bytes from a set of samples.
+    Samples are stored one after another into samplesBuffer; samplesSizes[] gives their sizes.
+    Patterns present in many different samples are counted, then segments covering the most frequent ones
+    are selected, one per region of samplesBuffer, until dictionary is full.
+    Best segments are placed at the end of dictionary, closest to compressed data.
+    When params.segmentSize == 0, one dictionary is built for each value of DiB_segmentSizes[],
+    and the one giving best compression (see DiB_evaluateDictionary()) is kept.
+    The result is raw content, usable with ZSTD_compress_usingDict() and ZSTD_decompress_usingDict().
+    @result : size of dictionary written into dictBuffer,
+              or an error code, which can be tested using ZSTD_isError()
+*/
+
+size_t DiB_evaluateDictionary(const void* dict, size_t dictSize,
+                        const void* samplesBuffer, const size_t* samplesSizes, unsigned nbSamples,
+                              int compressionLevel);
+/**
+DiB_evaluateDictionary() :
+    Compresses samples using dictionary, at compressionLevel (0 means default).
+    At most 512 samples, evenly spread, are compressed, so that evaluation remains fast on large sets.
+    @result : total compressed size of evaluated samples (lower is better),
+              or an error code, which can be tested using ZSTD_isError()
+*/
+
+
+#if defined (__cplusplus)
+}
+#endif
@@ -72,6 +72,9 @@ extern "C" {
         ITEM(PREFIX(dstSize_tooSmall)) ITEM(PREFIX(srcSize_wrong)) \
         ITEM(PREFIX(prefix_unknown)) ITEM(PREFIX(corruption_detected)) \
         ITEM(PREFIX(tableLog_tooLarge)) ITEM(PREFIX(maxSymbolValue_tooLarge)) ITEM(PREFIX(maxSymbolValue_tooSmall)) \
+        ITEM(PREFIX(stage_wrong)) \
+        ITEM(PREFIX(frameParameter_unsupported)) ITEM(PREFIX(checksum_wrong)) \
+        ITEM(PREFIX(stats_unsupported)) \
         ITEM(PREFIX(maxCode))
 
 #define ERROR_GENERATE_ENUM(ENUM) ENUM,
@@ -334,17 +334,29 @@ size_t FSE_FUNCTION_NAME(FSE_buildCTable, FSE_FUNCTION_EXTENSION)
 
 #define FSE_DECODE_TYPE FSE_TYPE_NAME(FSE_decode_t, FSE_FUNCTION_EXTENSION)
 
+FSE_DTable* FSE_FUNCTION_NAME(FSE_createDTable_advanced, FSE_FUNCTION_EXTENSION) (unsigned tableLog, FSE_allocFunction customAlloc, void* opaque)
+{
+    const size_t size = FSE_DTABLE_SIZE_U32(tableLog > FSE_TABLELOG_ABSOLUTE_MAX ? FSE_TABLELOG_ABSOLUTE_MAX : tableLog) * sizeof (U32);
+    if (customAlloc) return (FSE_DTable*)customAlloc(opaque, size);
+    return (FSE_DTable*)malloc(size);
+}
+
 FSE_DTable* FSE_FUNCTION_NAME(FSE_createDTable, FSE_FUNCTION_EXTENSION) (unsigned tableLog)
 {
-    if (tableLog > FSE_TABLELOG_ABSOLUTE_MAX) tableLog = FSE_TABLELOG_ABSOLUTE_MAX;
-    return (FSE_DTable*)malloc( FSE_DTABLE_SIZE_U32(tableLog) * sizeof (U32) );
+    return FSE_FUNCTION_NAME(FSE_createDTable_advanced, FSE_FUNCTION_EXTENSION) (tableLog, NULL, NULL);
 }
 
-void FSE_FUNCTION_NAME(FSE_freeDTable, FSE_FUNCTION_EXTENSION) (FSE_DTable* dt)
+void FSE_FUNCTION_NAME(FSE_freeDTable_advanced, FSE_FUNCTION_EXTENSION) (FSE_DTable* dt, FSE_freeFunction customFree, void* opaque)
 {
+    if (customFree) { if (dt) customFree(opaque, dt); return; }
     free(dt);
 }
 
+void FSE_FUNCTION_NAME(FSE_freeDTable, FSE_FUNCTION_EXTENSION) (FSE_DTable* dt)
+{
+    FSE_FUNCTION_NAME(FSE_freeDTable_advanced, FSE_FUNCTION_EXTENSION) (dt, NULL, NULL);
+}
+
 size_t FSE_FUNCTION_NAME(FSE_buildDTable, FSE_FUNCTION_EXTENSION)
 (FSE_DTable* dt, const short* normalizedCounter, unsigned maxSymbolValue, unsigned tableLog)
 {
@@ -677,19 +689,31 @@ size_t FSE_sizeof_CTable (unsigned maxSymbolValue, unsigned tableLog)
     return size;
 }
 
-FSE_CTable* FSE_createCTable (unsigned maxSymbolValue, unsigned tableLog)
+FSE_CTable* FSE_createCTable_advanced (unsigned maxSymbolValue, unsigned tableLog, FSE_allocFunction customAlloc, void* opaque)
 {
     size_t size;
     if (tableLog > FSE_TABLELOG_ABSOLUTE_MAX) tableLog = FSE_TABLELOG_ABSOLUTE_MAX;
     size = FSE_CTABLE_SIZE_U32 (tableLog, maxSymbolValue) * sizeof(U32);
+    if (customAlloc) return (FSE_CTable*)customAlloc(opaque, size);
     return (FSE_CTable*)malloc(size);
 }
 
-void  FSE_freeCTable (FSE_CTable* ct)
+FSE_CTable* FSE_createCTable (unsigned maxSymbolValue, unsigned tableLog)
+{
+    return FSE_createCTable_advanced(maxSymbolValue, tableLog, NULL, NULL);
+}
+
+void  FSE_freeCTable_advanced (FSE_CTable* ct, FSE_freeFunction customFree, void* opaque)
 {
+    if (customFree) { if (ct) customFree(opaque, ct); return; }
     free(ct);
 }
 
+void  FSE_freeCTable (FSE_CTable* ct)
+{
+    FSE_freeCTable_advanced(ct, NULL, NULL);
+}
+
 
 /* provides the minimum logSize to safely represent a distribution */
 static unsigned FSE_minTableLog(size_t srcSize, unsigned maxSymbolValue)
@@ -78,6 +78,16 @@ size_t FSE_buildDTable_raw (FSE_DTable* dt, unsigned nbBits);
 size_t FSE_buildDTable_rle (FSE_DTable* dt, unsigned char symbolValue);
 /* build a fake FSE_DTable, designed to always generate the same symbolValue */
 
+typedef void* (*FSE_allocFunction) (void* opaque, size_t size);
+typedef void  (*FSE_freeFunction) (void* opaque, void* address);
+FSE_CTable* FSE_createCTable_advanced (unsigned maxSymbolValue, unsigned tableLog, FSE_allocFunction customAlloc, void* opaque);
+void        FSE_freeCTable_advanced (FSE_CTable* ct, FSE_freeFunction customFree, void* opaque);
+FSE_DTable* FSE_createDTable_advanced (unsigned tableLog, FSE_allocFunction customAlloc, void* opaque);
+void        FSE_freeDTable_advanced (FSE_DTable* dt, FSE_freeFunction customFree, void* opaque);
+/* same as FSE_create?Table() and FSE_free?Table(), but memory is provided by customAlloc() and released by customFree(),
+   which receive 'opaque' as first argument. A NULL function pointer means default malloc() / free().
+   A table created with FSE_create?Table_advanced() must be released with a compatible customFree(). */
+
 
 /******************************************
 *  FSE symbol compression API
@@ -66,15 +66,13 @@
 #include "huff0_static.h"
 #include "bitstream.h"
 #include "fse.h"        /* header compression */
+#include "cpu.h"        /* ZSTD_cpuFeatures */
 
 
 /****************************************************************
 *  Constants
 ****************************************************************/
-#define HUF_ABSOLUTEMAX_TABLELOG  16   /* absolute limit of HUF_MAX_TABLELOG. Beyond that value, code does not work */
-#define HUF_MAX_TABLELOG  12           /* max configured tableLog (for static allocation); can be modified up to HUF_ABSOLUTEMAX_TABLELOG */
 #define HUF_DEFAULT_TABLELOG  HUF_MAX_TABLELOG   /* tableLog by default, when not specified */
-#define HUF_MAX_SYMBOL_VALUE 255
 #if (HUF_MAX_TABLELOG > HUF_ABSOLUTEMAX_TABLELOG)
 #  error "HUF_MAX_TABLELOG is too large !"
 #endif
@@ -93,6 +91,21 @@ unsigned HUF_isError(size_t code) { return ERR_isError(code); }
 
 const char* HUF_getErrorName(size_t code) { return ERR_getErrorName(code); }
 
+/* 4-streams decoders are also compiled for BMI2 (shifts by variable amounts, used by bitstream),
+*  selected at runtime, unless already enabled at compile time */
+#if ZSTD_DYNAMIC_DISPATCH && !defined(__BMI2__)
+#  define HUF_DYNAMIC_BMI2 1
+#else
+#  define HUF_DYNAMIC_BMI2 0
+#endif
+
+#if HUF_DYNAMIC_BMI2
+static int HUF_bmi2(void)
+{
+    return (ZSTD_cpuFeatures() & ZSTD_cpuFeature_bmi2) != 0;
+}
+#endif
+
 
 /*********************************************************
 *  Huff0 : Huffman block compression
@@ -480,9 +493,28 @@ static size_t HUF_compress_into4Segments(void* dst, size_t dstSize, const void*
 }
 
 
-size_t HUF_compress2 (void* dst, size_t dstSize,
-                const void* src, size_t srcSize,
-                unsigned maxSymbolValue, unsigned huffLog)
+static size_t HUF_estimateCompressedSize(const HUF_CElt* CTable, const U32* count, U32 maxSymbolValue)
+{
+    size_t nbBits = 0;
+    U32 s;
+    for (s=0; s<=maxSymbolValue; s++) nbBits += CTable[s].nbBits * count[s];
+    return nbBits >> 3;
+}
+
+static int HUF_validCTable(const HUF_CElt* CTable, const U32* count, U32 maxSymbolValue)
+{
+    int bad = 0;
+    U32 s;
+    for (s=0; s<=maxSymbolValue; s++) bad |= (count[s] != 0) & (CTable[s].nbBits == 0);
+    return !bad;
+}
+
+/* HUF_compress_internal() :
+   prevTable, repeat : optional (can be NULL) : see HUF_compress4X_repeat() */
+static size_t HUF_compress_internal (void* dst, size_t dstSize,
+                               const void* src, size_t srcSize,
+                                     unsigned maxSymbolValue, unsigned huffLog,
+                                     HUF_CElt* prevTable, unsigned* repeat)
 {
     BYTE* const ostart = (BYTE*)dst;
     BYTE* op = ostart;
@@ -514,6 +546,18 @@ size_t HUF_compress2 (void* dst, size_t dstSize,
     /* Write table description header */
     errorCode = HUF_writeCTable (op, dstSize, CTable, maxSymbolValue, huffLog);
     if (HUF_isError(errorCode)) return errorCode;
+
+    /* Re-use previous table, if it is cheaper than the new one and its description */
+    if ((repeat != NULL) && (*repeat)
+        && HUF_validCTable(prevTable, count, maxSymbolValue)
+        && (HUF_estimateCompressedSize(prevTable, count, maxSymbolValue) <= HUF_estimateCompressedSize(CTable, count, maxSymbolValue) + errorCode))
+    {
+        errorCode = HUF_compress_into4Segments(ostart, dstSize, src, srcSize, prevTable);
+        if (HUF_isError(errorCode)) return errorCode;
+        if ((errorCode==0) || (errorCode >= srcSize-1)) return 0;
+        return errorCode;
+    }
+
     if (errorCode + 12 >= srcSize) return 0;   /* not useful to try compression */
     op += errorCode;
 
@@ -528,9 +572,33 @@ size_t HUF_compress2 (void* dst, size_t dstSize,
     if ((size_t)(op-ostart) >= srcSize-1)
         return 0;
 
+    /* save new table, for next blocks */
+    if (repeat != NULL)
+    {
+        memcpy(prevTable, CTable, (maxSymbolValue+1) * sizeof(HUF_CElt));
+        memset(prevTable + maxSymbolValue+1, 0, (HUF_MAX_SYMBOL_VALUE - maxSymbolValue) * sizeof(HUF_CElt));
+        *repeat = 0;
+    }
+
     return op-ostart;
 }
 
+size_t HUF_compress2 (void* dst, size_t dstSize,
+                const void* src, size_t srcSize,
+                unsigned maxSymbolValue, unsigned huffLog)
+{
+    return HUF_compress_internal(dst, dstSize, src, srcSize, maxSymbolValue, huffLog, NULL, NULL);
+}
+
+size_t HUF_compress4X_repeat (void* dst, size_t dstSize,
+                        const void* src, size_t srcSize,
+                              unsigned maxSymbolValue, unsigned huffLog,
+                              HUF_CElt* CTable, unsigned* repeat)
+{
+    HUF_STATIC_ASSERT(sizeof(HUF_CElt) == sizeof(U32));   /* CTable is allocated as an array of U32 */
+    return HUF_compress_internal(dst, dstSize, src, srcSize, maxSymbolValue, huffLog, CTable, repeat);
+}
+
 size_t HUF_compress (void* dst, size_t maxDstSize, const void* src, size_t srcSize)
 {
     return HUF_compress2(dst, maxDstSize, src, (U32)srcSize, 255, HUF_DEFAULT_TABLELOG);
@@ -678,7 +746,7 @@ size_t HUF_readDTableX2 (U16* DTable, const void* src, size_t srcSize)
     return iSize;
 }
 
-static BYTE HUF_decodeSymbolX2(BIT_DStream_t* Dstream, const HUF_DEltX2* dt, const U32 dtLog)
+FORCE_INLINE BYTE HUF_decodeSymbolX2(BIT_DStream_t* Dstream, const HUF_DEltX2* dt, const U32 dtLog)
 {
         const size_t val = BIT_lookBitsFast(Dstream, dtLog); /* note : dtLog >= 1 */
         const BYTE c = dt[val].byte;
@@ -759,7 +827,7 @@ size_t HUF_decompress1X2 (void* dst, size_t dstSize, const void* cSrc, size_t cS
 }
 
 
-size_t HUF_decompress4X2_usingDTable(
+FORCE_INLINE size_t HUF_decompress4X2_usingDTable_body(
           void* dst,  size_t dstSize,
     const void* cSrc, size_t cSrcSize,
     const U16* DTable)
@@ -854,6 +922,29 @@ size_t HUF_decompress4X2_usingDTable(
     }
 }
 
+static size_t HUF_decompress4X2_usingDTable_default(void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize, const U16* DTable)
+{
+    return HUF_decompress4X2_usingDTable_body(dst, dstSize, cSrc, cSrcSize, DTable);
+}
+
+#if HUF_DYNAMIC_BMI2
+ZSTD_TARGET("bmi2") static size_t HUF_decompress4X2_usingDTable_bmi2(void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize, const U16* DTable)
+{
+    return HUF_decompress4X2_usingDTable_body(dst, dstSize, cSrc, cSrcSize, DTable);
+}
+#endif
+
+size_t HUF_decompress4X2_usingDTable(
+          void* dst,  size_t dstSize,
+    const void* cSrc, size_t cSrcSize,
+    const U16* DTable)
+{
+#if HUF_DYNAMIC_BMI2
+    if (HUF_bmi2()) return HUF_decompress4X2_usingDTable_bmi2(dst, dstSize, cSrc, cSrcSize, DTable);
+#endif
+    return HUF_decompress4X2_usingDTable_default(dst, dstSize, cSrc, cSrcSize, DTable);
+}
+
 
 size_t HUF_decompress4X2 (void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize)
 {
@@ -1053,7 +1144,7 @@ size_t HUF_readDTableX4 (U32* DTable, const void* src, size_t srcSize)
 }
 
 
-static U32 HUF_decodeSymbolX4(void* op, BIT_DStream_t* DStream, const HUF_DEltX4* dt, const U32 dtLog)
+FORCE_INLINE U32 HUF_decodeSymbolX4(void* op, BIT_DStream_t* DStream, const HUF_DEltX4* dt, const U32 dtLog)
 {
     const size_t val = BIT_lookBitsFast(DStream, dtLog);   /* note : dtLog >= 1 */
     memcpy(op, dt+val, 2);
@@ -1159,7 +1250,7 @@ size_t HUF_decompress1X4 (void* dst, size_t dstSize, const void* cSrc, size_t cS
     return HUF_decompress1X4_usingDTable (dst, dstSize, ip, cSrcSize, DTable);
 }
 
-size_t HUF_decompress4X4_usingDTable(
+FORCE_INLINE size_t HUF_decompress4X4_usingDTable_body(
           void* dst,  size_t dstSize,
     const void* cSrc, size_t cSrcSize,
     const U32* DTable)
@@ -1254,6 +1345,29 @@ size_t HUF_decompress4X4_usingDTable(
     }
 }
 
+static size_t HUF_decompress4X4_usingDTable_default(void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize, const U32* DTable)
+{
+    return HUF_decompress4X4_usingDTable_body(dst, dstSize, cSrc, cSrcSize, DTable);
+}
+
+#if HUF_DYNAMIC_BMI2
+ZSTD_TARGET("bmi2") static size_t HUF_decompress4X4_usingDTable_bmi2(void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize, const U32* DTable)
+{
+    return HUF_decompress4X4_usingDTable_body(dst, dstSize, cSrc, cSrcSize, DTable);
+}
+#endif
+
+size_t HUF_decompress4X4_usingDTable(
+          void* dst,  size_t dstSize,
+    const void* cSrc, size_t cSrcSize,
+    const U32* DTable)
+{
+#if HUF_DYNAMIC_BMI2
+    if (HUF_bmi2()) return HUF_decompress4X4_usingDTable_bmi2(dst, dstSize, cSrc, cSrcSize, DTable);
+#endif
+    return HUF_decompress4X4_usingDTable_default(dst, dstSize, cSrc, cSrcSize, DTable);
+}
+
 
 size_t HUF_decompress4X4 (void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize)
 {
@@ -1435,7 +1549,7 @@ size_t HUF_readDTableX6 (U32* DTable, const void* src, size_t srcSize)
 }
 
 
-static U32 HUF_decodeSymbolX6(void* op, BIT_DStream_t* DStream, const HUF_DDescX6* dd, const HUF_DSeqX6* ds, const U32 dtLog)
+FORCE_INLINE U32 HUF_decodeSymbolX6(void* op, BIT_DStream_t* DStream, const HUF_DDescX6* dd, const HUF_DSeqX6* ds, const U32 dtLog)
 {
     const size_t val = BIT_lookBitsFast(DStream, dtLog);   /* note : dtLog >= 1 */
     memcpy(op, ds+val, sizeof(HUF_DSeqX6));
@@ -1547,7 +1661,7 @@ size_t HUF_decompress1X6 (void* dst, size_t dstSize, const void* cSrc, size_t cS
 }
 
 
-size_t HUF_decompress4X6_usingDTable(
+FORCE_INLINE size_t HUF_decompress4X6_usingDTable_body(
           void* dst,  size_t dstSize,
     const void* cSrc, size_t cSrcSize,
     const U32* DTable)
@@ -1643,6 +1757,29 @@ size_t HUF_decompress4X6_usingDTable(
     }
 }
 
+static size_t HUF_decompress4X6_usingDTable_default(void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize, const U32* DTable)
+{
+    return HUF_decompress4X6_usingDTable_body(dst, dstSize, cSrc, cSrcSize, DTable);
+}
+
+#if HUF_DYNAMIC_BMI2
+ZSTD_TARGET("bmi2") static size_t HUF_decompress4X6_usingDTable_bmi2(void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize, const U32* DTable)
+{
+    return HUF_decompress4X6_usingDTable_body(dst, dstSize, cSrc, cSrcSize, DTable);
+}
+#endif
+
+size_t HUF_decompress4X6_usingDTable(
+          void* dst,  size_t dstSize,
+    const void* cSrc, size_t cSrcSize,
+    const U32* DTable)
+{
+#if HUF_DYNAMIC_BMI2
+    if (HUF_bmi2()) return HUF_decompress4X6_usingDTable_bmi2(dst, dstSize, cSrc, cSrcSize, DTable);
+#endif
+    return HUF_decompress4X6_usingDTable_default(dst, dstSize, cSrc, cSrcSize, DTable);
+}
+
 
 size_t HUF_decompress4X6 (void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize)
 {
@@ -1663,8 +1800,7 @@ size_t HUF_decompress4X6 (void* dst, size_t dstSize, const void* cSrc, size_t cS
 /* Generic decompression selector */
 /**********************************/
 
-typedef struct { U32 tableTime; U32 decode256Time; } algo_time_t;
-static const algo_time_t algoTime[16 /* Quantization */][3 /* single, double, quad */] =
+static const HUF_algoTime_t algoTime_default[16 /* Quantization */][3 /* single, double, quad */] =
 {
     /* single, double, quad */
     {{0,0}, {1,1}, {2,2}},  /* Q==0 : impossible */
@@ -1685,37 +1821,85 @@ static const algo_time_t algoTime[16 /* Quantization */][3 /* single, double, qu
     {{ 722,128}, {1891,145}, {1936,146}},   /* Q ==15 : 93-99% */
 };
 
-typedef size_t (*decompressionAlgo)(void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize);
+static const HUF_algoTime_t* g_algoTime = &algoTime_default[0][0];
 
-size_t HUF_decompress (void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize)
+void HUF_setDecoderTimes(const HUF_algoTime_t* algoTime)
 {
-    static const decompressionAlgo decompress[3] = { HUF_decompress4X2, HUF_decompress4X4, HUF_decompress4X6 };
-    /* estimate decompression time */
-    U32 Q;
+    g_algoTime = algoTime ? algoTime : &algoTime_default[0][0];
+}
+
+unsigned HUF_selectDecoder (size_t dstSize, size_t cSrcSize)
+{
+    /* decoder timing evaluation */
+    const U32 Q = (U32)(cSrcSize * 16 / dstSize);   /* Q < 16 since dstSize > cSrcSize */
     const U32 D256 = (U32)(dstSize >> 8);
     U32 Dtime[3];
     U32 algoNb = 0;
     int n;
 
-    /* validation checks */
-    if (dstSize == 0) return ERROR(dstSize_tooSmall);
-    if (cSrcSize > dstSize) return ERROR(corruption_detected);   /* invalid */
-    if (cSrcSize == dstSize) { memcpy(dst, cSrc, dstSize); return dstSize; }   /* not compressed */
-    if (cSrcSize == 1) { memset(dst, *(const BYTE*)cSrc, dstSize); return dstSize; }   /* RLE */
-
-    /* decoder timing evaluation */
-    Q = (U32)(cSrcSize * 16 / dstSize);   /* Q < 16 since dstSize > cSrcSize */
     for (n=0; n<3; n++)
-        Dtime[n] = algoTime[Q][n].tableTime + (algoTime[Q][n].decode256Time * D256);
+        Dtime[n] = g_algoTime[Q*3+n].tableTime + (g_algoTime[Q*3+n].decode256Time * D256);
 
     Dtime[1] += Dtime[1] >> 4; Dtime[2] += Dtime[2] >> 3; /* advantage to algorithms using less memory, for cache eviction */
 
     if (Dtime[1] < Dtime[0]) algoNb = 1;
     if (Dtime[2] < Dtime[algoNb]) algoNb = 2;
 
-    return decompress[algoNb](dst, dstSize, cSrc, cSrcSize);
+    return algoNb;
+}
+
+typedef size_t (*decompressionAlgo)(void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize);
+
+size_t HUF_decompress (void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize)
+{
+    static const decompressionAlgo decompress[3] = { HUF_decompress4X2, HUF_decompress4X4, HUF_decompress4X6 };
+
+    /* validation checks */
+    if (dstSize == 0) return ERROR(dstSize_tooSmall);
+    if (cSrcSize > dstSize) return ERROR(corruption_detected);   /* invalid */
+    if (cSrcSize == dstSize) { memcpy(dst, cSrc, dstSize); return dstSize; }   /* not compressed */
+    if (cSrcSize == 1) { memset(dst, *(const BYTE*)cSrc, dstSize); return dstSize; }   /* RLE */
+
+    return decompress[HUF_selectDecoder(dstSize, cSrcSize)](dst, dstSize, cSrc, cSrcSize);
 
     //return HUF_decompress4X2(dst, dstSize, cSrc, cSrcSize);   /* multi-streams single-symbol decoding */
     //return HUF_decompress4X4(dst, dstSize, cSrc, cSrcSize);   /* multi-streams double-symbols decoding */
     //return HUF_decompress4X6(dst, dstSize, cSrc, cSrcSize);   /* multi-streams quad-symbols decoding */
 }
+
+size_t HUF_decompress4X_usingDTable (void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize,
+                                     const unsigned* DTable, unsigned algoNb)
+{
+    switch(algoNb)
+    {
+    case 0 : return HUF_decompress4X2_usingDTable(dst, dstSize, cSrc, cSrcSize, (const U16*)DTable);
+    case 1 : return HUF_decompress4X4_usingDTable(dst, dstSize, cSrc, cSrcSize, DTable);
+    case 2 : return HUF_decompress4X6_usingDTable(dst, dstSize, cSrc, cSrcSize, DTable);
+    default: return ERROR(GENERIC);
+    }
+}
+
+size_t HUF_decompress4X_hufOnly (unsigned* DTable, unsigned* algoNbPtr,
+                                 void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize)
+{
+    U32 algoNb;
+    size_t hSize;
+
+    /* validation checks */
+    if (dstSize == 0) return ERROR(dstSize_tooSmall);
+    if ((cSrcSize >= dstSize) || (cSrcSize <= 1)) return ERROR(corruption_detected);   /* raw and RLE are not Huffman */
+
+    /* build table; DTable[0] must provide the allocated tableLog */
+    algoNb = (U32)HUF_selectDecoder(dstSize, cSrcSize);
+    switch(algoNb)
+    {
+    case 0 : ((U16*)DTable)[0] = HUF_MAX_TABLELOG; hSize = HUF_readDTableX2((U16*)DTable, cSrc, cSrcSize); break;
+    case 1 : DTable[0] = HUF_MAX_TABLELOG; hSize = HUF_readDTableX4(DTable, cSrc, cSrcSize); break;
+    default: DTable[0] = HUF_MAX_TABLELOG; hSize = HUF_readDTableX6(DTable, cSrc, cSrcSize); break;
+    }
+    if (HUF_isError(hSize)) return hSize;
+    if (hSize >= cSrcSize) return ERROR(srcSize_wrong);
+    *algoNbPtr = algoNb;
+
+    return HUF_decompress4X_usingDTable(dst, dstSize, (const BYTE*)cSrc + hSize, cSrcSize - hSize, DTable, algoNb);
+}
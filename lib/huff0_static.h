@@ -46,6 +46,14 @@ extern "C" {
 #include "huff0.h"
 
 
+/******************************************
+*  Constants
+******************************************/
+#define HUF_ABSOLUTEMAX_TABLELOG  16   /* absolute limit of HUF_MAX_TABLELOG. Beyond that value, code does not work */
+#define HUF_MAX_TABLELOG  12           /* max configured tableLog (for static allocation); can be modified up to HUF_ABSOLUTEMAX_TABLELOG */
+#define HUF_MAX_SYMBOL_VALUE 255
+
+
 /******************************************
 *  Static allocation macros
 ******************************************/
@@ -62,6 +70,11 @@ extern "C" {
         unsigned int DTable[HUF_DTABLE_SIZE(maxTableLog)] = { maxTableLog }
 #define HUF_CREATE_STATIC_DTABLEX6(DTable, maxTableLog) \
         unsigned int DTable[HUF_DTABLE_SIZE(maxTableLog) * 3 / 2] = { maxTableLog }
+#define HUF_DTABLE_SIZE_U32(maxTableLog) (HUF_DTABLE_SIZE(maxTableLog) * 3 / 2)   /* large enough for any 4X decoder */
+
+/* static allocation of Huff0's CTable */
+typedef struct HUF_CElt_s HUF_CElt;   /* incomplete type */
+#define HUF_CTABLE_SIZE_U32(maxSymbolValue) ((maxSymbolValue)+1)   /* one 4-bytes cell per symbol; use unsigned int for alignment */
 
 
 /******************************************
@@ -71,6 +84,63 @@ size_t HUF_decompress4X2 (void* dst, size_t dstSize, const void* cSrc, size_t cS
 size_t HUF_decompress4X4 (void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize);   /* double-symbols decoder */
 size_t HUF_decompress4X6 (void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize);   /* quad-symbols decoder */
 
+size_t HUF_readDTableX2 (unsigned short* DTable, const void* src, size_t srcSize);
+size_t HUF_readDTableX4 (unsigned* DTable, const void* src, size_t srcSize);
+size_t HUF_readDTableX6 (unsigned* DTable, const void* src, size_t srcSize);
+
+size_t HUF_decompress4X2_usingDTable(void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize, const unsigned short* DTable);
+size_t HUF_decompress4X4_usingDTable(void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize, const unsigned* DTable);
+size_t HUF_decompress4X6_usingDTable(void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize, const unsigned* DTable);
+
+
+/******************************************
+*  Table re-use across blocks
+******************************************/
+size_t HUF_compress4X_repeat (void* dst, size_t dstSize, const void* src, size_t srcSize,
+                              unsigned maxSymbolValue, unsigned tableLog,
+                              HUF_CElt* CTable, unsigned* repeat);
+/*
+HUF_compress4X_repeat() :
+    Same as HUF_compress2(), but can re-use the table of a previous block.
+    CTable must be sized with HUF_CTABLE_SIZE_U32(HUF_MAX_SYMBOL_VALUE).
+    *repeat : on input, 1 if CTable holds a table already known to the decoder, 0 otherwise.
+    When result > 1 : *repeat==1 means CTable was re-used, and dst contains no table description;
+                      *repeat==0 means dst starts with a new table description, which is now stored into CTable.
+    When result <= 1 (not compressible, or RLE), CTable and *repeat are unmodified.
+    Note : if caller discards a result written with a new table, CTable no longer matches the decoder's table,
+           and *repeat must be reset to 0 for next block.
+*/
+
+unsigned HUF_selectDecoder (size_t dstSize, size_t cSrcSize);
+size_t HUF_decompress4X_hufOnly (unsigned* DTable, unsigned* algoNbPtr,
+                                 void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize);
+size_t HUF_decompress4X_usingDTable (void* dst, size_t dstSize, const void* cSrc, size_t cSrcSize,
+                                     const unsigned* DTable, unsigned algoNb);
+/*
+HUF_selectDecoder() :
+    Tells which 4-streams decoder is expected to be the fastest : 0 = X2, 1 = X4, 2 = X6.
+    requires : cSrcSize < dstSize.
+HUF_decompress4X_hufOnly() :
+    Huffman-only decoding : cSrc must start with a table description (no raw nor RLE shortcut).
+    Selects a decoder, builds DTable and decodes cSrc.
+    DTable must be sized with HUF_DTABLE_SIZE_U32(HUF_MAX_TABLELOG).
+    On success, DTable and *algoNbPtr can be fed to HUF_decompress4X_usingDTable(), to decode next blocks using the same table.
+HUF_decompress4X_usingDTable() :
+    Decodes cSrc, which contains no table description, using a DTable previously built by HUF_decompress4X_hufOnly().
+*/
+
+typedef struct { unsigned tableTime; unsigned decode256Time; } HUF_algoTime_t;
+void HUF_setDecoderTimes (const HUF_algoTime_t* algoTime);
+/*
+HUF_setDecoderTimes() :
+    Replaces the decoder timings used by HUF_selectDecoder(), to tune decoder selection for a specific CPU.
+    algoTime : 16 x 3 cells, indexed [Q][algoNb], for Q = cSrcSize*16/dstSize.
+               tableTime : cost of building the table; decode256Time : cost of decoding 256 bytes.
+               Timings can be measured with fullbench (-b41 to -b46).
+               NULL restores default timings.
+    Note : must not be called while decompressions are running.
+*/
+
 
 #if defined (__cplusplus)
 }
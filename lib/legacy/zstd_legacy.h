@@ -45,12 +45,16 @@ extern "C" {
 #include "zstd_v01.h"
 #include "zstd_v02.h"
 
+/** ZSTD_isLegacy() :
+    @return : legacy format version of a frame starting with magicNumberLE (1 or 2), or 0 if not a legacy frame.
+    v0.2 blocks only differ from current ones by their initial repcodes : zstd.c decodes them with its own kernels.
+    v0.1 frames (interleaved Huffman streams) still require zstd_v01.c */
 MEM_STATIC unsigned ZSTD_isLegacy (U32 magicNumberLE)
 {
 	switch(magicNumberLE)
 	{
-		case ZSTDv01_magicNumberLE :
-		case ZSTDv02_magicNumber : return 1;
+		case ZSTDv01_magicNumberLE : return 1;
+		case ZSTDv02_magicNumber : return 2;
 		default : return 0;
 	}
 }
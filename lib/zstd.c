@@ -70,7 +70,8 @@
 #include "zstd_static.h"
 #include "zstd_internal.h"
 #include "fse_static.h"
-#include "huff0.h"
+#include "huff0_static.h"
+#include "cpu.h"         /* ZSTD_cpuFeatures, ZSTD_TARGET */
 
 #if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
 #  include "zstd_legacy.h"
@@ -80,8 +81,9 @@
 /* *******************************************************
 *  Compiler specifics
 *********************************************************/
-#ifdef __AVX2__
+#if defined(__AVX2__) || ZSTD_DYNAMIC_DISPATCH
 #  include <immintrin.h>   /* AVX2 intrinsics */
+#  define ZSTD_AVX2 1
 #endif
 
 #ifdef _MSC_VER    /* Visual Studio */
@@ -102,9 +104,8 @@
 /* *******************************************************
 *  Constants
 *********************************************************/
-#define HASH_LOG (ZSTD_MEMORY_USAGE - 2)
-#define HASH_TABLESIZE (1 << HASH_LOG)
-#define HASH_MASK (HASH_TABLESIZE - 1)
+#define HASH_LOG (ZSTD_MEMORY_USAGE - 2)   /* default hashLog */
+#define SEARCHLENGTH_DEFAULT 7
 
 #define KNUTH 2654435761
 
@@ -119,9 +120,10 @@
 #define MB *(1 <<20)
 #define GB *(1U<<30)
 
-#define BLOCKSIZE (128 KB)                 /* define, for static allocation */
+#define BLOCKSIZE ZSTD_BLOCKSIZE_MAX       /* define, for static allocation */
 #define IS_RAW BIT0
 #define IS_RLE BIT1
+#define IS_PCH (BIT0+BIT1)   /* compressed with previous Huffman table */
 
 static const U32 g_maxDistance = 4 * BLOCKSIZE;
 static const U32 g_maxLimit = 1 GB;
@@ -135,11 +137,49 @@ static const U32 g_maxLimit = 1 GB;
 #define MAX(a,b) ((a)<(b)?(b):(a))
 #define MaxSeq MAX(MaxLL, MaxML)
 
+/* sequence table type 3 : table without header, described by one byte after all table headers */
+#define bt_ext bt_end
+#define EXT_PREDEFINED_LL 4   /* set : predefined distribution; not set : repeat previous table */
+#define EXT_PREDEFINED_OFF 2
+#define EXT_PREDEFINED_ML 1
+
+/* decoder : sequence DTable states */
+#define ZSTD_SEQTABLE_NONE 0         /* not built within current frame */
+#define ZSTD_SEQTABLE_VALID 1
+#define ZSTD_SEQTABLE_PREDEFINED 2   /* valid, and contains predefined distribution */
+
+/* predefined distributions, from statistics of various text and binary files */
+#define LL_DEFAULTNORMLOG 8
+static const S16 LL_defaultNorm[MaxLL+1] =
+{ 106, 42, 21, 10,  7,  5,  4,  3,  2,  2,  1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+
+#define ML_DEFAULTNORMLOG 9
+static const S16 ML_defaultNorm[MaxML+1] =
+{   5, 27, 23, 37, 26, 18, 18, 18, 13, 11, 16, 27, 21, 12, 17,  8,
+    6,  5,  7,  7,  4,  4,  2,  2,  2,  3,  3,  3,  2,  3,  5,  6,
+    5,  5,  5,  7, 11,  5,  2,  1,  1,  1,  1,  1,  1,  2,  2,  2,
+    2,  1,  2,  1,  1,  1,  1,  1,  1,  1,  1,  1,  2,  3,  2,  2,
+    2,  2,  2,  2,  1,  2,  2,  2,  2,  1,  1,  1,  1,  1,  1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  5 };
+
+#define OF_DEFAULTNORMLOG 7
+static const S16 OF_defaultNorm[MaxOff+1] =
+{  17, -1, -1, -1, -1,  3,  4, 10,  6,  6,  6,  7,  7,  6, 10,  8,
+    8, 12,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+
 #define LITERAL_NOENTROPY 63
 #define COMMAND_NOENTROPY 7   /* to remove */
 
 static const size_t ZSTD_blockHeaderSize = 3;
-static const size_t ZSTD_frameHeaderSize = 4;
+static const size_t ZSTD_frameHeaderSize = 4;   /* regular frame : magic number only */
+static const BYTE ZSTD_contentSizeFieldSize[4] = { 0, 2, 4, 8 };
+#define ZSTD_WINDOWLOG_ABSOLUTEMIN 10
+#define ZSTD_WINDOWLOG_ABSOLUTEMAX 31
 
 
 /* *******************************************************
@@ -158,26 +198,39 @@ void ZSTD_resetSeqStore(seqStore_t* ssPtr)
     ssPtr->litLength = ssPtr->litLengthStart;
     ssPtr->matchLength = ssPtr->matchLengthStart;
     ssPtr->dumps = ssPtr->dumpsStart;
+#if ZSTD_STATS
+    ssPtr->statsTick = ZSTD_ticks();   /* a block starts : match finding */
+#endif
 }
 
 struct ZSTD_CCtx_s
 {
-    const BYTE* base;
+    const BYTE* base;       /* All regular indexes relative to this position */
+    const BYTE* dictBase;   /* extDict indexes relative to this position */
+    U32 dictLimit;          /* below that point, need extDict */
+    U32 lowLimit;           /* below that point, no more data */
+    U32 loadedDictEnd;      /* end of loaded dictionary, which can be referenced by next segment */
     U32 current;
     U32 nextUpdate;
+    size_t staticSize;      /* 0 : allocated by ZSTD_createCCtx() */
+    ZSTD_customMem customMem;
+    size_t blockSize;       /* 0 : default (BLOCKSIZE) */
+    U32 checksumFlag;       /* 1 : frames end with a checksum of content */
+    XXH64_state_t checksumState;
+    U64 pledgedSrcSizePlusOne;   /* 0 : unknown; only for next frame */
+    U64 frameContentSizePlusOne;   /* 0 : unknown; pledged size of current frame, checked by ZSTD_compressEnd() */
+    U64 consumedSrcSize;    /* input of current frame */
+    ZSTD_parameters params;
+    void* workSpace;        /* hash table */
+    size_t workSpaceSize;
+    U32* hashTable;         /* NULL until first ZSTD_compressBegin() */
     seqStore_t seqStore;
-#ifdef __AVX2__
-    __m256i hashTable[HASH_TABLESIZE>>3];
-#else
-    U32 hashTable[HASH_TABLESIZE];
-#endif
     BYTE buffer[WORKPLACESIZE];
 };
 
 
-void ZSTD_resetCCtx(ZSTD_CCtx* ctx)
+static void ZSTD_initSeqStore(ZSTD_CCtx* ctx)
 {
-    ctx->base = NULL;
     ctx->seqStore.buffer = ctx->buffer;
     ctx->seqStore.offsetStart = (U32*) (ctx->seqStore.buffer);
     ctx->seqStore.offCodeStart = (BYTE*) (ctx->seqStore.offsetStart + (BLOCKSIZE>>2));
@@ -185,21 +238,177 @@ void ZSTD_resetCCtx(ZSTD_CCtx* ctx)
     ctx->seqStore.litLengthStart =  ctx->seqStore.litStart + BLOCKSIZE;
     ctx->seqStore.matchLengthStart = ctx->seqStore.litLengthStart + (BLOCKSIZE>>2);
     ctx->seqStore.dumpsStart = ctx->seqStore.matchLengthStart + (BLOCKSIZE>>2);
-    memset(ctx->hashTable, 0, sizeof(ctx->hashTable));
+    ZSTD_resetSeqTables(&ctx->seqStore);
 }
 
-ZSTD_CCtx* ZSTD_createCCtx(void)
+/** ZSTD_resetCCtx
+    start a new segment. Its indexes continue beyond previous segment's ones,
+    so that hash table entries below lowLimit are invalid, without clearing the table.
+    Table is only cleared when first used (current==0), or before indexes grow too large */
+static void ZSTD_resetCCtx(ZSTD_CCtx* ctx)
 {
-    ZSTD_CCtx* ctx = (ZSTD_CCtx*) malloc( sizeof(ZSTD_CCtx) );
-    if (ctx==NULL) return NULL;
+    U32 startIndex = ctx->current;
+    if ((startIndex==0) || (startIndex > g_maxLimit))
+    {
+        memset(ctx->hashTable, 0, ((size_t)1 << ctx->params.hashLog) * sizeof(U32));
+        startIndex = 1;   /* index 0 is the value of cleared entries */
+    }
+    ctx->base = NULL;
+    ctx->dictBase = NULL;
+    ctx->dictLimit = startIndex;
+    ctx->lowLimit = startIndex;
+    ctx->loadedDictEnd = 0;
+    ctx->current = startIndex;
+    ZSTD_initSeqStore(ctx);
+}
+
+/** ZSTD_validateParams
+    correct params value to remain within authorized range ; 0 selects default value */
+void ZSTD_validateParams(ZSTD_parameters* params)
+{
+    if (params->hashLog == 0) params->hashLog = HASH_LOG;
+    if (params->hashLog > ZSTD_HASHLOG_MAX) params->hashLog = ZSTD_HASHLOG_MAX;
+    if (params->hashLog < ZSTD_HASHLOG_MIN) params->hashLog = ZSTD_HASHLOG_MIN;
+    if (params->searchLength == 0) params->searchLength = SEARCHLENGTH_DEFAULT;
+    if (params->searchLength > ZSTD_SEARCHLENGTH_MAX) params->searchLength = ZSTD_SEARCHLENGTH_MAX;
+    if (params->searchLength < ZSTD_SEARCHLENGTH_MIN) params->searchLength = ZSTD_SEARCHLENGTH_MIN;
+    if (params->acceleration > ZSTD_ACCELERATION_MAX) params->acceleration = ZSTD_ACCELERATION_MAX;
+    if (params->acceleration < ZSTD_ACCELERATION_MIN) params->acceleration = ZSTD_ACCELERATION_MIN;
+}
+
+ZSTD_parameters ZSTD_getParams(int compressionLevel)
+{
+    ZSTD_parameters params = { 0, 0, 0 };
+    if (compressionLevel < 0) params.acceleration = (U32)(1 - compressionLevel);
+    ZSTD_validateParams(&params);
+    return params;
+}
+
+/** ZSTD_resetCCtx_advanced
+    select params, reserve table memory, and reset ctx state */
+static size_t ZSTD_resetCCtx_advanced(ZSTD_CCtx* ctx, ZSTD_parameters params)
+{
+    const size_t tableSpace = ((size_t)1 << params.hashLog) * sizeof(U32);
+    if (ctx->workSpaceSize < tableSpace)
+    {
+        if (ctx->staticSize) return ERROR(memory_allocation);   /* static CCtx : workspace cannot grow */
+        ZSTD_free(ctx->workSpace, ctx->customMem);
+        ctx->workSpace = ZSTD_malloc(tableSpace, ctx->customMem);
+        ctx->workSpaceSize = ctx->workSpace ? tableSpace : 0;
+        if (ctx->workSpace == NULL) { ctx->hashTable = NULL; return ERROR(memory_allocation); }
+    }
+    if ((ctx->hashTable == NULL) || (params.hashLog != ctx->params.hashLog))
+        ctx->current = 0;   /* table content is undefined : clear it */
+    ctx->params = params;
+    ctx->hashTable = (U32*)ctx->workSpace;
     ZSTD_resetCCtx(ctx);
+    return 0;
+}
+
+void* ZSTD_malloc(size_t size, ZSTD_customMem customMem)
+{
+    if (customMem.customAlloc) return customMem.customAlloc(customMem.opaque, size);
+    return malloc(size);
+}
+
+void ZSTD_free(void* ptr, ZSTD_customMem customMem)
+{
+    if (ptr==NULL) return;
+    if (customMem.customFree) { customMem.customFree(customMem.opaque, ptr); return; }
+    free(ptr);
+}
+
+ZSTD_CCtx* ZSTD_createCCtx_advanced(ZSTD_customMem customMem)
+{
+    ZSTD_CCtx* ctx;
+    if (!customMem.customAlloc != !customMem.customFree) return NULL;   /* both or none */
+    ctx = (ZSTD_CCtx*) ZSTD_malloc( sizeof(ZSTD_CCtx), customMem );
+    if (ctx==NULL) return NULL;
+    memset(ctx, 0, sizeof(ZSTD_CCtx) - WORKPLACESIZE);
+    ctx->customMem = customMem;
     return ctx;
 }
 
+ZSTD_CCtx* ZSTD_createCCtx(void)
+{
+    const ZSTD_customMem defaultMem = { NULL, NULL, NULL };
+    return ZSTD_createCCtx_advanced(defaultMem);
+}
+
 size_t ZSTD_freeCCtx(ZSTD_CCtx* ctx)
 {
-    free(ctx);
+    if (ctx==NULL) return 0;
+    if (ctx->staticSize) return ERROR(memory_allocation);   /* not compatible with static CCtx */
+    ZSTD_free(ctx->workSpace, ctx->customMem);
+    ZSTD_free(ctx, ctx->customMem);
+    return 0;
+}
+
+size_t ZSTD_estimateCCtxSize_advanced(ZSTD_parameters params)
+{
+    ZSTD_validateParams(&params);
+    return sizeof(ZSTD_CCtx) + ((size_t)1 << params.hashLog) * sizeof(U32);
+}
+
+size_t ZSTD_estimateCCtxSize(void)
+{
+    const ZSTD_parameters defaultParams = { 0, 0, 0 };
+    return ZSTD_estimateCCtxSize_advanced(defaultParams);
+}
+
+size_t ZSTD_setBlockSize(ZSTD_CCtx* ctx, size_t blockSize)
+{
+    if ((blockSize > ZSTD_BLOCKSIZE_MAX) || ((blockSize) && (blockSize < ZSTD_BLOCKSIZE_MIN))) return ERROR(srcSize_wrong);
+    ctx->blockSize = blockSize;
+    return 0;
+}
+
+size_t ZSTD_setContentChecksum(ZSTD_CCtx* ctx, unsigned checksumFlag)
+{
+    ctx->checksumFlag = (checksumFlag!=0);
+    return 0;
+}
+
+size_t ZSTD_setPledgedSrcSize(ZSTD_CCtx* ctx, unsigned long long pledgedSrcSize)
+{
+    if (pledgedSrcSize == ZSTD_CONTENTSIZE_UNKNOWN) return ERROR(srcSize_wrong);
+    ctx->pledgedSrcSizePlusOne = pledgedSrcSize+1;
+    return 0;
+}
+
+ZSTD_CCtx* ZSTD_initStaticCCtx(void* workspace, size_t workspaceSize)
+{
+    ZSTD_CCtx* const ctx = (ZSTD_CCtx*)workspace;
+    const size_t minTableSpace = ((size_t)1 << ZSTD_HASHLOG_MIN) * sizeof(U32);
+    if (workspaceSize < sizeof(ZSTD_CCtx) + minTableSpace) return NULL;
+    if ((size_t)workspace & 7) return NULL;   /* 8-bytes aligned */
+    memset(ctx, 0, sizeof(ZSTD_CCtx) - WORKPLACESIZE);
+    ctx->staticSize = workspaceSize;
+    ctx->workSpace = (void*)(ctx+1);
+    ctx->workSpaceSize = workspaceSize - sizeof(ZSTD_CCtx);
+    return ctx;
+}
+
+size_t ZSTD_getCCtxStats(const ZSTD_CCtx* cctx, ZSTD_stats* stats)
+{
+#if ZSTD_STATS
+    *stats = cctx->seqStore.stats;
+    return 0;
+#else
+    (void)cctx; (void)stats;
+    return ERROR(stats_unsupported);
+#endif
+}
+
+size_t ZSTD_resetCCtxStats(ZSTD_CCtx* cctx)
+{
+#if ZSTD_STATS
+    memset(&cctx->seqStore.stats, 0, sizeof(cctx->seqStore.stats));
     return 0;
+#else
+    (void)cctx;
+    return ERROR(stats_unsupported);
+#endif
 }
 
 
@@ -226,7 +435,69 @@ unsigned ZSTD_versionNumber (void) { return ZSTD_VERSION_NUMBER; }
 *********************************************************/
 size_t ZSTD_compressBound(size_t srcSize)   /* maximum compressed size */
 {
-    return FSE_compressBound(srcSize) + 12;
+    return FSE_compressBound(srcSize) + 12 + (ZSTD_FRAMEHEADERSIZE_MAX-4) + ZSTD_frameChecksumSize;   /* + frame parameters and checksum */
+}
+
+
+size_t ZSTD_writeFrameHeader(void* dst, size_t maxDstSize, const ZSTD_frameParams* fparams, XXH64_state_t* checksumState)
+{
+    BYTE* const ostart = (BYTE*)dst;
+    BYTE* op = ostart;
+    const U64 contentSize = fparams->contentSize;
+    const U32 csFlag = (contentSize == ZSTD_CONTENTSIZE_UNKNOWN) ? 0 : (contentSize <= 0xFFFF) ? 1 : (contentSize <= 0xFFFFFFFFU) ? 2 : 3;
+
+    if ((!csFlag) && (!fparams->checksumFlag) && (fparams->windowLog <= ZSTD_WINDOWLOG_REGULAR))   /* regular frame */
+    {
+        if (maxDstSize < ZSTD_frameHeaderSize) return ERROR(dstSize_tooSmall);
+        MEM_writeLE32(op, ZSTD_magicNumber);
+        return ZSTD_frameHeaderSize;
+    }
+
+    if (maxDstSize < ZSTD_frameHeaderSize + 2 + ZSTD_contentSizeFieldSize[csFlag]) return ERROR(dstSize_tooSmall);
+    MEM_writeLE32(op, ZSTD_magicNumberExt);
+    op += ZSTD_frameHeaderSize;
+    *op++ = (BYTE)(csFlag | (fparams->checksumFlag ? ZSTD_frameDescriptor_checksum : 0) | ZSTD_frameDescriptor_window);
+    *op++ = (BYTE)MAX(fparams->windowLog, ZSTD_WINDOWLOG_ABSOLUTEMIN);   /* a larger window is always safe */
+    switch(csFlag)
+    {
+    case 1: MEM_writeLE16(op, (U16)contentSize); break;
+    case 2: MEM_writeLE32(op, (U32)contentSize); break;
+    case 3: MEM_writeLE64(op, contentSize); break;
+    default: break;
+    }
+    op += ZSTD_contentSizeFieldSize[csFlag];
+    if (fparams->checksumFlag) XXH64_reset(checksumState, 0);
+    return op-ostart;
+}
+
+size_t ZSTD_writeFrameEnd(void* dst, size_t maxDstSize, const XXH64_state_t* checksumState)
+{
+    BYTE* const op = (BYTE*)dst;
+    const size_t endSize = ZSTD_blockHeaderSize + (checksumState ? ZSTD_frameChecksumSize : 0);
+    if (maxDstSize < endSize) return ERROR(dstSize_tooSmall);
+
+    /* End of frame */
+    op[0] = (BYTE)(bt_end << 6);
+    op[1] = 0;
+    op[2] = 0;
+    if (checksumState)
+        MEM_writeLE64(op+ZSTD_blockHeaderSize, XXH64_digest(checksumState));
+
+    return endSize;
+}
+
+
+size_t ZSTD_writeSkippableFrame(void* dst, size_t maxDstSize, const void* src, size_t srcSize, unsigned magicVariant)
+{
+    BYTE* const op = (BYTE*)dst;
+    if (magicVariant > ~ZSTD_skippableMagicNumberMask) return ERROR(GENERIC);
+    if ((U64)srcSize > 0xFFFFFFFFU) return ERROR(srcSize_wrong);
+    if (maxDstSize < ZSTD_skippableHeaderSize) return ERROR(dstSize_tooSmall);
+    if (srcSize > maxDstSize - ZSTD_skippableHeaderSize) return ERROR(dstSize_tooSmall);   /* no overflow */
+    MEM_writeLE32(op, ZSTD_skippableMagicNumberMin + magicVariant);
+    MEM_writeLE32(op+ZSTD_frameHeaderSize, (U32)srcSize);
+    if (srcSize) memmove(op+ZSTD_skippableHeaderSize, src, srcSize);   /* src may be NULL when empty */
+    return srcSize + ZSTD_skippableHeaderSize;
 }
 
 
@@ -246,6 +517,133 @@ size_t ZSTD_noCompressBlock (void* dst, size_t maxDstSize, const void* src, size
     return ZSTD_blockHeaderSize+srcSize;
 }
 
+/** ZSTD_rleCompressBlock
+    stores src as a single byte repeated srcSize times, when src is made of a single byte value
+    @return : size written into dst (block header included),
+              0 if src is not a run of a single byte, or an error code */
+size_t ZSTD_rleCompressBlock (void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+{
+    const BYTE* const istart = (const BYTE*)src;
+    BYTE* const ostart = (BYTE*)dst;
+    const U64 pattern = istart[0] * 0x0101010101010101ULL;
+    size_t u = 0;
+
+    /* check src, stopping at first difference */
+    if (srcSize < 2) return 0;
+    for ( ; u+8 <= srcSize; u+=8)
+        if (MEM_read64(istart+u) != pattern) return 0;
+    for ( ; u < srcSize; u++)
+        if (istart[u] != istart[0]) return 0;
+
+    if (ZSTD_blockHeaderSize+1 > maxDstSize) return ERROR(dstSize_tooSmall);
+
+    /* Build header : block size field holds the regenerated size */
+    ostart[0]  = (BYTE)(srcSize>>16);
+    ostart[1]  = (BYTE)(srcSize>>8);
+    ostart[2]  = (BYTE) srcSize;
+    ostart[0] += (BYTE)(bt_rle<<6);
+    ostart[3]  = istart[0];
+
+    return ZSTD_blockHeaderSize+1;
+}
+
+#define ZSTD_PROBE_CHUNKSIZE 512
+#define ZSTD_PROBE_MINSIZE  (8*ZSTD_PROBE_CHUNKSIZE)
+#define ZSTD_PROBE_HASHLOG   9
+#define ZSTD_PROBE_TABLESTEP 32   /* previous blocks : 1 position indexed every ZSTD_PROBE_TABLESTEP bytes */
+
+static U32 ZSTD_probeHash(const BYTE* p) { return (U32)((MEM_read64(p) * 0xCF1BBCDCB7A56463ULL) >> (64-ZSTD_PROBE_TABLELOG)); }
+
+/** ZSTD_probe
+    looks at a few chunks spread across src :
+    byte entropy is measured with FSE_count(), 4-bytes repetitions with a small hash table,
+    and 8-bytes repetitions of previous blocks with ssPtr->probeTable.
+    probeLog : each increment halves the nb of chunks examined (1/4 of src at probeLog==0)
+    @return : 1 if src is very unlikely to be compressed below ZSTD_minGain(), 0 otherwise */
+static U32 ZSTD_probe(seqStore_t* ssPtr, const BYTE* istart, size_t srcSize, U32 probeLog,
+                      const BYTE* base, const BYTE* dictBase, U32 dictLimit, U32 lowLimit)
+{
+    U32 hashTable[1<<ZSTD_PROBE_HASHLOG];
+    unsigned count[256];
+    U64 total[256];
+    size_t nbChunks, stride, n, s, nbSamples;
+    U64 sumSquares = 0;
+    U32 hits = 0;
+
+    nbChunks = (srcSize / ZSTD_PROBE_CHUNKSIZE) >> (2+probeLog);
+    if (nbChunks < 4) nbChunks = 4;
+    stride = srcSize / nbChunks;
+    nbSamples = nbChunks * ZSTD_PROBE_CHUNKSIZE;
+    memset(total, 0, sizeof(total));
+    memset(hashTable, 0, sizeof(hashTable));
+
+    for (n=0; n<nbChunks; n++)
+    {
+        const BYTE* const chunk = istart + n*stride;
+        const BYTE* ip;
+        unsigned maxSymbolValue = 255;
+        size_t errorCode = FSE_count(count, &maxSymbolValue, chunk, ZSTD_PROBE_CHUNKSIZE);
+        if (FSE_isError(errorCode)) return 0;
+        for (s=0; s<=maxSymbolValue; s++) total[s] += count[s];
+
+        for (ip=chunk; ip < chunk + ZSTD_PROBE_CHUNKSIZE - 7; ip++)
+        {
+            const U32 sequence = MEM_read32(ip);
+            const U32 h = (sequence * 2654435761U) >> (32-ZSTD_PROBE_HASHLOG);
+            const U32 idx = ssPtr->probeTable[ZSTD_probeHash(ip)];
+            const U32 ipIdx = (U32)(ip - base);
+            hits += (hashTable[h] == sequence);
+            hashTable[h] = sequence;
+            if (idx < lowLimit) continue;
+            if ( ((idx >= dictLimit) && (idx + 8 <= ipIdx) && (MEM_read64(base + idx) == MEM_read64(ip)))
+              || ((idx < dictLimit) && (idx + 8 <= dictLimit) && (MEM_read64(dictBase + idx) == MEM_read64(ip))) )
+                hits += ZSTD_PROBE_TABLESTEP;   /* only 1 position every ZSTD_PROBE_TABLESTEP is indexed */
+        }
+
+        /* repetitions : more than 1 position in 64 starts a 4-bytes match */
+        if ((size_t)hits * 64 > nbSamples) return 0;
+    }
+
+    /* entropy : collision entropy (a lower bound of Shannon entropy) must be > ~7.9 bits per byte,
+       i.e. sum(count^2) (minus its sampling bias) < n^2 / 256 * 17/16 */
+    for (s=0; s<256; s++) sumSquares += total[s] * total[s];
+    return ((sumSquares - nbSamples) * 256 * 16 < (U64)nbSamples * nbSamples * 17);
+}
+
+/** ZSTD_indexRawBlock
+    src is stored raw : index it into ssPtr->probeTable, so that next blocks repeating it are not declared incompressible */
+void ZSTD_indexRawBlock(seqStore_t* ssPtr, const void* src, size_t srcSize, const BYTE* base)
+{
+    const BYTE* ip;
+    for (ip=(const BYTE*)src; ip + 8 <= (const BYTE*)src + srcSize; ip += ZSTD_PROBE_TABLESTEP)
+        ssPtr->probeTable[ZSTD_probeHash(ip)] = (U32)(ip - base);
+}
+
+/** ZSTD_isIncompressible
+    cheap pre-pass, deciding if src can be stored raw without match search.
+    Only blocks following a raw block are probed : compressible data never pays for it.
+    A sparse probe comes first ; blocks it finds incompressible are probed more densely, less and less along a run of raw blocks.
+    Probed blocks are indexed into ssPtr->probeTable, so that next blocks repeating them are not declared incompressible.
+    @return : 1 if src is very unlikely to be compressed below ZSTD_minGain(), 0 otherwise */
+U32 ZSTD_isIncompressible(seqStore_t* ssPtr, const void* src, size_t srcSize,
+                          const BYTE* base, const BYTE* dictBase, U32 dictLimit, U32 lowLimit)
+{
+    const BYTE* const istart = (const BYTE*)src;
+    U32 result = 0;
+
+    if (ssPtr->rawRun == 0) return 0;   /* previous block was compressed, or none : let the match finder try */
+    if (srcSize >= ZSTD_PROBE_MINSIZE)
+    {
+        const U32 probeLog = ZSTD_probeLog(ssPtr);
+        result = ZSTD_probe(ssPtr, istart, srcSize, ZSTD_PROBELOG_MAX, base, dictBase, dictLimit, lowLimit);
+        if (result && (probeLog < ZSTD_PROBELOG_MAX))
+            result = ZSTD_probe(ssPtr, istart, srcSize, probeLog, base, dictBase, dictLimit, lowLimit);
+    }
+    ZSTD_indexRawBlock(ssPtr, istart, srcSize, base);
+
+    return result;
+}
+
 
 static size_t ZSTD_compressRawLiteralsBlock (void* dst, size_t maxDstSize, const void* src, size_t srcSize)
 {
@@ -270,24 +668,35 @@ static size_t ZSTD_compressRleLiteralsBlock (void* dst, size_t maxDstSize, const
 
 size_t ZSTD_minGain(size_t srcSize) { return (srcSize >> 6) + 1; }
 
+/** ZSTD_compressLiterals
+    re-uses previous Huffman table when it is cheaper than sending a new one.
+    *newTablePtr is set when a new table was written : it is known to the decoder only once this block is emitted */
 static size_t ZSTD_compressLiterals (void* dst, size_t maxDstSize,
-                               const void* src, size_t srcSize)
+                               const void* src, size_t srcSize,
+                                     seqStore_t* seqStorePtr, U32* newTablePtr)
 {
     const size_t minGain = ZSTD_minGain(srcSize);
     BYTE* const ostart = (BYTE*)dst;
     size_t hsize;
+    U32 repeat = seqStorePtr->litRepeat;
     static const size_t litHeaderSize = 5;
 
+    *newTablePtr = 0;
     if (maxDstSize < litHeaderSize+1) return ERROR(dstSize_tooSmall);   /* not enough space for compression */
 
-    hsize = HUF_compress(ostart+litHeaderSize, maxDstSize-litHeaderSize, src, srcSize);
+    hsize = HUF_compress4X_repeat(ostart+litHeaderSize, maxDstSize-litHeaderSize, src, srcSize, 255, 0,
+                                  (HUF_CElt*)seqStorePtr->litCTable, &repeat);
+    if (!HUF_isError(hsize) && (hsize > 1) && (!repeat))
+        seqStorePtr->litRepeat = 0;   /* litCTable has been overwritten */
 
     if ((hsize==0) || (hsize >= srcSize - minGain)) return ZSTD_compressRawLiteralsBlock(dst, maxDstSize, src, srcSize);
     if (hsize==1) return ZSTD_compressRleLiteralsBlock(dst, maxDstSize, src, srcSize);
+    *newTablePtr = !repeat;   /* new table is only known to the decoder when written : not on raw or rle fallback */
 
     /* Build header */
     {
         ostart[0]  = (BYTE)(srcSize << 2); /* is a block, is compressed */
+        ostart[0] += (BYTE)(repeat ? IS_PCH : 0);
         ostart[1]  = (BYTE)(srcSize >> 6);
         ostart[2]  = (BYTE)(srcSize >>14);
         ostart[2] += (BYTE)(hsize << 5);
@@ -299,19 +708,128 @@ static size_t ZSTD_compressLiterals (void* dst, size_t maxDstSize,
 }
 
 
-size_t ZSTD_compressSequences(BYTE* dst, size_t maxDstSize,
-                        const seqStore_t* seqStorePtr,
-                              size_t srcSize)
+/** ZSTD_log2_8
+    @return : log2(val), with 8 bits of fractional part (linearly interpolated) */
+static U32 ZSTD_log2_8(U32 val)
+{
+    const U32 hb = ZSTD_highbit(val);
+    return (hb << 8) + ((val << 8) >> hb) - 256;
+}
+
+/** ZSTD_fseCost
+    @return : estimated nb of bits to encode symbols distributed as count[], using norm[],
+              or (size_t)-1 if some symbol cannot be encoded with norm[] */
+static size_t ZSTD_fseCost(const U32* count, U32 max, const S16* norm, U32 normMax, U32 tableLog)
+{
+    size_t cost = 0;
+    U32 s;
+    if (max > normMax) return (size_t)-1;
+    for (s=0; s<=max; s++)
+    {
+        if (count[s] == 0) continue;
+        if (norm[s] == 0) return (size_t)-1;
+        cost += count[s] * ((tableLog << 8) - ZSTD_log2_8(norm[s] == -1 ? 1 : norm[s]));
+    }
+    return cost >> 8;
+}
+
+/** ZSTD_buildSeqTable
+    selects the cheapest table for one sequence symbol type : rle, raw, repeat previous, predefined or compressed.
+    writes its header into op, and builds CTable.
+    next : receives the table state, to be saved once the block is emitted.
+    @return : size written into op, or an error code */
+static size_t ZSTD_buildSeqTable(void* CTable, U32* typePtr, U32* predefinedPtr, seqTable_t* next,
+                                 BYTE* op, size_t opCapacity,
+                                 const BYTE* codeTable, size_t nbSeq, U32 maxSymbolValue, U32 rawBits, U32 maxLog,
+                                 const seqTable_t* prev, const S16* defaultNorm, U32 defaultLog)
 {
     U32 count[MaxSeq+1];
-    S16 norm[MaxSeq+1];
-    size_t mostFrequent;
-    U32 max = 255;
-    U32 tableLog = 11;
+    U32 max = maxSymbolValue;
+    const size_t mostFrequent = FSE_countFast(count, &max, codeTable, nbSeq);
+    size_t bestCost, cost;
+
+    *predefinedPtr = 0;
+    if ((mostFrequent == nbSeq) && (nbSeq > 2))
+    {
+        if (opCapacity < 1) return ERROR(dstSize_tooSmall);
+        *op = codeTable[0];
+        FSE_buildCTable_rle(CTable, (BYTE)max);
+        *typePtr = bt_rle;
+        next->repeat = 0;
+        return 1;
+    }
+
+    /* raw */
+    bestCost = nbSeq * rawBits;
+    *typePtr = bt_raw;
+
+    /* repeat previous table : preferred when equal, since it keeps the table for next blocks */
+    if (prev->repeat)
+    {
+        cost = ZSTD_fseCost(count, max, prev->norm, prev->max, prev->tableLog);
+        if (cost <= bestCost) { bestCost = cost; *typePtr = bt_ext; }
+    }
+
+    /* predefined distribution */
+    cost = ZSTD_fseCost(count, max, defaultNorm, maxSymbolValue, defaultLog);
+    if (cost < bestCost) { bestCost = cost; *typePtr = bt_ext; *predefinedPtr = 1; }
+
+    /* new distribution, described in header */
+    if (nbSeq >= 64)
+    {
+        S16 norm[MaxSeq+1];
+        const U32 tableLog = FSE_optimalTableLog(maxLog, nbSeq, max);
+        size_t NCountSize;
+        FSE_normalizeCount(norm, tableLog, count, nbSeq, max);
+        NCountSize = FSE_writeNCount(op, opCapacity, norm, max, tableLog);   /* overflow protected */
+        if (FSE_isError(NCountSize)) return ERROR(GENERIC);
+        cost = ZSTD_fseCost(count, max, norm, max, tableLog);
+        if (NCountSize*8 + cost < bestCost)
+        {
+            FSE_buildCTable(CTable, norm, max, tableLog);
+            *typePtr = bt_compressed;
+            memcpy(next->norm, norm, (max+1) * sizeof(S16));
+            next->max = max;
+            next->tableLog = tableLog;
+            next->repeat = 1;
+            return NCountSize;
+        }
+    }
+
+    switch(*typePtr)
+    {
+    case bt_raw :
+        FSE_buildCTable_raw(CTable, rawBits);
+        next->repeat = 0;
+        break;
+    default :   /* bt_ext */
+        if (*predefinedPtr)
+        {
+            memcpy(next->norm, defaultNorm, (maxSymbolValue+1) * sizeof(S16));
+            next->max = maxSymbolValue;
+            next->tableLog = defaultLog;
+            next->repeat = 1;
+        }
+        else *next = *prev;
+        FSE_buildCTable(CTable, next->norm, next->max, next->tableLog);
+    }
+    return 0;
+}
+
+
+/** ZSTD_compressSequences_generic
+    acceleration > 1 : literals are entropy coded only if they represent
+    more than (acceleration-1)/acceleration of the block, since Huffman gain is otherwise small */
+static size_t ZSTD_compressSequences_generic(BYTE* dst, size_t maxDstSize,
+                                             seqStore_t* seqStorePtr,
+                                             size_t srcSize, U32 acceleration)
+{
     U32 CTable_LitLength  [FSE_CTABLE_SIZE_U32(LLFSELog, MaxLL )];
     U32 CTable_OffsetBits [FSE_CTABLE_SIZE_U32(OffFSELog,MaxOff)];
     U32 CTable_MatchLength[FSE_CTABLE_SIZE_U32(MLFSELog, MaxML )];
-    U32 LLtype, Offtype, MLtype;   /* compressed, raw or rle */
+    U32 LLtype, Offtype, MLtype;   /* compressed, raw, rle or ext */
+    U32 LLpredef, Offpredef, MLpredef;
+    seqTable_t nextLL, nextOff, nextML;
     const BYTE* const op_lit_start = seqStorePtr->litStart;
     const BYTE* const llTable = seqStorePtr->litLengthStart;
     const BYTE* const llPtr = seqStorePtr->litLength;
@@ -323,20 +841,26 @@ size_t ZSTD_compressSequences(BYTE* dst, size_t maxDstSize,
     const size_t nbSeq = llPtr - llTable;
     const size_t minGain = ZSTD_minGain(srcSize);
     const size_t maxCSize = srcSize - minGain;
+    U32 newLitTable = 0;
     BYTE* seqHead;
 
+    ZSTD_STATS_CYCLES(seqStorePtr->stats, ZSTD_stage_matchFinding, seqStorePtr->statsTick);
+    ZSTD_STATS_ADD(seqStorePtr->stats.nbSequences, nbSeq);
 
     /* Compress literals */
     {
         size_t cSize;
         size_t litSize = seqStorePtr->lit - op_lit_start;
 
-        if (litSize <= LITERAL_NOENTROPY)
+        if ( (litSize <= LITERAL_NOENTROPY)
+          || ((acceleration > 1) && (litSize * acceleration < srcSize * (acceleration-1))) )
             cSize = ZSTD_compressRawLiteralsBlock(op, maxDstSize, op_lit_start, litSize);
         else
-            cSize = ZSTD_compressLiterals(op, maxDstSize, op_lit_start, litSize);
+            cSize = ZSTD_compressLiterals(op, maxDstSize, op_lit_start, litSize, seqStorePtr, &newLitTable);
         if (ZSTD_isError(cSize)) return cSize;
         op += cSize;
+        ZSTD_STATS_ADD(seqStorePtr->stats.litBytes, litSize);
+        ZSTD_STATS_CYCLES(seqStorePtr->stats, ZSTD_stage_literals, seqStorePtr->statsTick);
     }
 
     /* Sequences Header */
@@ -367,90 +891,44 @@ size_t ZSTD_compressSequences(BYTE* dst, size_t maxDstSize,
     }
 
     /* CTable for Literal Lengths */
-    max = MaxLL;
-    mostFrequent = FSE_countFast(count, &max, seqStorePtr->litLengthStart, nbSeq);
-    if ((mostFrequent == nbSeq) && (nbSeq > 2))
-    {
-        *op++ = *(seqStorePtr->litLengthStart);
-        FSE_buildCTable_rle(CTable_LitLength, (BYTE)max);
-        LLtype = bt_rle;
-    }
-    else if ((nbSeq < 64) || (mostFrequent < (nbSeq >> (LLbits-1))))
-    {
-        FSE_buildCTable_raw(CTable_LitLength, LLbits);
-        LLtype = bt_raw;
-    }
-    else
     {
-        size_t NCountSize;
-        tableLog = FSE_optimalTableLog(LLFSELog, nbSeq, max);
-        FSE_normalizeCount(norm, tableLog, count, nbSeq, max);
-        NCountSize = FSE_writeNCount(op, oend-op, norm, max, tableLog);   /* overflow protected */
-        if (FSE_isError(NCountSize)) return ERROR(GENERIC);
-        op += NCountSize;
-        FSE_buildCTable(CTable_LitLength, norm, max, tableLog);
-        LLtype = bt_compressed;
+        size_t hSize = ZSTD_buildSeqTable(CTable_LitLength, &LLtype, &LLpredef, &nextLL, op, oend-op,
+                                          llTable, nbSeq, MaxLL, LLbits, LLFSELog,
+                                          &seqStorePtr->llTable, LL_defaultNorm, LL_DEFAULTNORMLOG);
+        if (ZSTD_isError(hSize)) return hSize;
+        op += hSize;
     }
 
     /* CTable for Offsets codes */
     {
         /* create Offset codes */
-        size_t i;
-        max = MaxOff;
+        size_t i, hSize;
         for (i=0; i<nbSeq; i++)
         {
             offCodeTable[i] = (BYTE)ZSTD_highbit(offsetTable[i]) + 1;
             if (offsetTable[i]==0) offCodeTable[i]=0;
         }
-        mostFrequent = FSE_countFast(count, &max, offCodeTable, nbSeq);
-    }
-    if ((mostFrequent == nbSeq) && (nbSeq > 2))
-    {
-        *op++ = *offCodeTable;
-        FSE_buildCTable_rle(CTable_OffsetBits, (BYTE)max);
-        Offtype = bt_rle;
-    }
-    else if ((nbSeq < 64) || (mostFrequent < (nbSeq >> (Offbits-1))))
-    {
-        FSE_buildCTable_raw(CTable_OffsetBits, Offbits);
-        Offtype = bt_raw;
-    }
-    else
-    {
-        size_t NCountSize;
-        tableLog = FSE_optimalTableLog(OffFSELog, nbSeq, max);
-        FSE_normalizeCount(norm, tableLog, count, nbSeq, max);
-        NCountSize = FSE_writeNCount(op, oend-op, norm, max, tableLog);   /* overflow protected */
-        if (FSE_isError(NCountSize)) return ERROR(GENERIC);
-        op += NCountSize;
-        FSE_buildCTable(CTable_OffsetBits, norm, max, tableLog);
-        Offtype = bt_compressed;
+        hSize = ZSTD_buildSeqTable(CTable_OffsetBits, &Offtype, &Offpredef, &nextOff, op, oend-op,
+                                   offCodeTable, nbSeq, MaxOff, Offbits, OffFSELog,
+                                   &seqStorePtr->offTable, OF_defaultNorm, OF_DEFAULTNORMLOG);
+        if (ZSTD_isError(hSize)) return hSize;
+        op += hSize;
     }
 
     /* CTable for MatchLengths */
-    max = MaxML;
-    mostFrequent = FSE_countFast(count, &max, seqStorePtr->matchLengthStart, nbSeq);
-    if ((mostFrequent == nbSeq) && (nbSeq > 2))
-    {
-        *op++ = *seqStorePtr->matchLengthStart;
-        FSE_buildCTable_rle(CTable_MatchLength, (BYTE)max);
-        MLtype = bt_rle;
-    }
-    else if ((nbSeq < 64) || (mostFrequent < (nbSeq >> (MLbits-1))))
     {
-        FSE_buildCTable_raw(CTable_MatchLength, MLbits);
-        MLtype = bt_raw;
+        size_t hSize = ZSTD_buildSeqTable(CTable_MatchLength, &MLtype, &MLpredef, &nextML, op, oend-op,
+                                          mlTable, nbSeq, MaxML, MLbits, MLFSELog,
+                                          &seqStorePtr->mlTable, ML_defaultNorm, ML_DEFAULTNORMLOG);
+        if (ZSTD_isError(hSize)) return hSize;
+        op += hSize;
     }
-    else
+
+    /* tables without header */
+    if ((LLtype==bt_ext) || (Offtype==bt_ext) || (MLtype==bt_ext))
     {
-        size_t NCountSize;
-        tableLog = FSE_optimalTableLog(MLFSELog, nbSeq, max);
-        FSE_normalizeCount(norm, tableLog, count, nbSeq, max);
-        NCountSize = FSE_writeNCount(op, oend-op, norm, max, tableLog);   /* overflow protected */
-        if (FSE_isError(NCountSize)) return ERROR(GENERIC);
-        op += NCountSize;
-        FSE_buildCTable(CTable_MatchLength, norm, max, tableLog);
-        MLtype = bt_compressed;
+        if (op >= oend) return ERROR(dstSize_tooSmall);
+        *op++ = (BYTE)( (LLpredef ? EXT_PREDEFINED_LL : 0) + (Offpredef ? EXT_PREDEFINED_OFF : 0) + (MLpredef ? EXT_PREDEFINED_ML : 0) );
     }
 
     seqHead[0] += (BYTE)((LLtype<<6) + (Offtype<<4) + (MLtype<<2));
@@ -479,6 +957,13 @@ size_t ZSTD_compressSequences(BYTE* dst, size_t maxDstSize,
             BYTE litLength = llTable[i];                                    /* (7)*/  /* (7)*/
             FSE_encodeSymbol(&blockStream, &stateMatchLength, matchLength); /* 17 */  /* 17 */
             if (MEM_32bits()) BIT_flushBits(&blockStream);                 /*  7 */
+            if (nbBits > LongOffBits)   /* long distance offset : low bits first, they are read last */
+            {
+                BIT_addBits(&blockStream, offset, LongOffBits);             /* 32 */  /* 42 */
+                BIT_flushBits(&blockStream);                                /*  7 */  /*  7 */
+                offset >>= LongOffBits;
+                nbBits -= LongOffBits;
+            }
             BIT_addBits(&blockStream, offset, nbBits);                      /* 32 */  /* 42 */
             if (MEM_32bits()) BIT_flushBits(&blockStream);                 /*  7 */
             FSE_encodeSymbol(&blockStream, &stateOffsetBits, offCode);      /* 16 */  /* 51 */
@@ -495,56 +980,70 @@ size_t ZSTD_compressSequences(BYTE* dst, size_t maxDstSize,
         op += streamSize;
     }
 
+    ZSTD_STATS_CYCLES(seqStorePtr->stats, ZSTD_stage_sequences, seqStorePtr->statsTick);
+
     /* check compressibility */
     if ((size_t)(op-dst) >= maxCSize) return 0;
 
+    /* block is emitted : decoder will know the new tables */
+    if (newLitTable) seqStorePtr->litRepeat = 1;
+    seqStorePtr->llTable = nextLL;
+    seqStorePtr->offTable = nextOff;
+    seqStorePtr->mlTable = nextML;
+
     return op - dst;
 }
 
+size_t ZSTD_compressSequences(BYTE* dst, size_t maxDstSize,
+                              seqStore_t* seqStorePtr,
+                              size_t srcSize)
+{
+    return ZSTD_compressSequences_generic(dst, maxDstSize, seqStorePtr, srcSize, 1);
+}
 
-//static const U32 hashMask = (1<<HASH_LOG)-1;
-
-//static U32   ZSTD_hashPtr(const void* p) { return (U32) _bextr_u64(*(U64*)p * prime7bytes, (56-HASH_LOG), HASH_LOG); }
-//static U32   ZSTD_hashPtr(const void* p) { return ( (*(U64*)p * prime7bytes) << 8 >> (64-HASH_LOG)); }
-//static U32   ZSTD_hashPtr(const void* p) { return ( (*(U64*)p * prime7bytes) >> (56-HASH_LOG)) & ((1<<HASH_LOG)-1); }
-//static U32   ZSTD_hashPtr(const void* p) { return ( ((*(U64*)p & 0xFFFFFFFFFFFFFF) * prime7bytes) >> (64-HASH_LOG)); }
-
-//static const U64 prime8bytes = 14923729446516375013ULL;
-//static U32   ZSTD_hashPtr(const void* p) { return ( (*(U64*)p * prime8bytes) >> (64-HASH_LOG)); }
-
-static const U64 prime7bytes =    58295818150454627ULL;
-static U32   ZSTD_hashPtr(const void* p) { return ( (MEM_read64(p) * prime7bytes) >> (56-HASH_LOG)) & HASH_MASK; }
 
-//static const U64 prime6bytes =      227718039650203ULL;
-//static U32   ZSTD_hashPtr(const void* p) { return ( (MEM_read64(p) * prime6bytes) >> (48-HASH_LOG)) & HASH_MASK; }
+static const U32 prime4bytes = 2654435761U;
+static U32 ZSTD_hash4(U32 u, U32 h) { return (u * prime4bytes) >> (32-h) ; }
+static size_t ZSTD_hash4Ptr(const void* ptr, U32 h) { return ZSTD_hash4(MEM_read32(ptr), h); }
 
-//static const U64 prime5bytes =         889523592379ULL;
-//static U32   ZSTD_hashPtr(const void* p) { return ( (*(U64*)p * prime5bytes) >> (40-HASH_LOG)) & HASH_MASK; }
+static const U64 prime5bytes = 889523592379ULL;
+static size_t ZSTD_hash5(U64 u, U32 h) { return (size_t)((u * prime5bytes) << (64-40) >> (64-h)) ; }
+static size_t ZSTD_hash5Ptr(const void* p, U32 h) { return ZSTD_hash5(MEM_read64(p), h); }
 
-//static U32   ZSTD_hashPtr(const void* p) { return ( (*(U32*)p * KNUTH) >> (32-HASH_LOG)); }
+static const U64 prime6bytes = 227718039650203ULL;
+static size_t ZSTD_hash6(U64 u, U32 h) { return (size_t)((u * prime6bytes) << (64-48) >> (64-h)) ; }
+static size_t ZSTD_hash6Ptr(const void* p, U32 h) { return ZSTD_hash6(MEM_read64(p), h); }
 
-static const BYTE* ZSTD_updateMatch(U32* table, const BYTE* p, const BYTE* start)
-{
-    U32 h = ZSTD_hashPtr(p);
-    const BYTE* r;
-    r = table[h] + start;
-    table[h] = (U32)(p-start);
-    return r;
-}
+static const U64 prime7bytes =    58295818150454627ULL;
+static size_t ZSTD_hash7(U64 u, U32 h) { return (size_t)((u * prime7bytes) << (64-56) >> (64-h)) ; }
+static size_t ZSTD_hash7Ptr(const void* p, U32 h) { return ZSTD_hash7(MEM_read64(p), h); }
 
-static int ZSTD_checkMatch(const BYTE* match, const BYTE* ip)
+static size_t ZSTD_hashPtr(const void* p, U32 hBits, U32 mls)
 {
-    return MEM_read32(match) == MEM_read32(ip);
+    switch(mls)
+    {
+    default:
+    case 4: return ZSTD_hash4Ptr(p, hBits);
+    case 5: return ZSTD_hash5Ptr(p, hBits);
+    case 6: return ZSTD_hash6Ptr(p, hBits);
+    case 7: return ZSTD_hash7Ptr(p, hBits);
+    }
 }
 
-static void  ZSTD_addPtr(U32* table, const BYTE* p, const BYTE* start) { table[ZSTD_hashPtr(p)] = (U32)(p-start); }
-
 
-static size_t ZSTD_compressBlock(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+FORCE_INLINE
+size_t ZSTD_compressBlock_generic(ZSTD_CCtx* ctx,
+                                  void* dst, size_t maxDstSize,
+                            const void* src, size_t srcSize,
+                            const U32 mls)
 {
-    U32*  HashTable = (U32*)(ctx->hashTable);
+    U32* const hashTable = ctx->hashTable;
+    const U32 hBits = ctx->params.hashLog;
+    const U32 acceleration = ctx->params.acceleration;
     seqStore_t* seqStorePtr = &(ctx->seqStore);
     const BYTE* const base = ctx->base;
+    const U32 lowIndex = ctx->lowLimit;   /* entries below belong to previous segments */
+    const BYTE* const lowest = base + lowIndex;
 
     const BYTE* const istart = (const BYTE*)src;
     const BYTE* ip = istart + 1;
@@ -556,24 +1055,28 @@ static size_t ZSTD_compressBlock(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, c
 
 
     /* init */
-    if (ip-base < 4)
+    if (ip-lowest < 4)
     {
-        ZSTD_addPtr(HashTable, ip+0, base);
-        ZSTD_addPtr(HashTable, ip+1, base);
-        ZSTD_addPtr(HashTable, ip+2, base);
-        ZSTD_addPtr(HashTable, ip+3, base);
+        hashTable[ZSTD_hashPtr(ip+0, hBits, mls)] = (U32)(ip+0-base);
+        hashTable[ZSTD_hashPtr(ip+1, hBits, mls)] = (U32)(ip+1-base);
+        hashTable[ZSTD_hashPtr(ip+2, hBits, mls)] = (U32)(ip+2-base);
+        hashTable[ZSTD_hashPtr(ip+3, hBits, mls)] = (U32)(ip+3-base);
         ip += 4;
     }
     ZSTD_resetSeqStore(seqStorePtr);
 
     /* Main Search Loop */
-    while (ip < ilimit)  /* < instead of <=, because unconditionnal ZSTD_addPtr(ip+1) */
+    while (ip < ilimit)  /* < instead of <=, because unconditionnal hashTable update of ip+1 */
     {
-        const BYTE* match = ZSTD_updateMatch(HashTable, ip, base);
+        const size_t h = ZSTD_hashPtr(ip, hBits, mls);
+        const U32 matchIndex = hashTable[h];
+        const BYTE* match = base + matchIndex;
+        hashTable[h] = (U32)(ip-base);
 
-        if (ZSTD_checkMatch(ip-offset_2,ip)) match = ip-offset_2;
-        if (!ZSTD_checkMatch(match,ip)) { ip += ((ip-anchor) >> g_searchStrength) + 1; offset_2 = offset_1; continue; }
-        while ((ip>anchor) && (match>base) && (ip[-1] == match[-1])) { ip--; match--; }  /* catch up */
+        if (MEM_read32(ip-offset_2) == MEM_read32(ip)) match = ip-offset_2;
+        else if ((matchIndex < lowIndex) || (MEM_read32(match) != MEM_read32(ip)))
+        { ip += ((ip-anchor) >> g_searchStrength) + acceleration; offset_2 = offset_1; continue; }
+        while ((ip>anchor) && (match>lowest) && (ip[-1] == match[-1])) { ip--; match--; }  /* catch up */
 
         {
             size_t litLength = ip-anchor;
@@ -585,11 +1088,11 @@ static size_t ZSTD_compressBlock(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, c
             ZSTD_storeSeq(seqStorePtr, litLength, anchor, offsetCode, matchLength);
 
             /* Fill Table */
-            ZSTD_addPtr(HashTable, ip+1, base);
+            hashTable[ZSTD_hashPtr(ip+1, hBits, mls)] = (U32)(ip+1-base);
             ip += matchLength + MINMATCH;
             anchor = ip;
             if (ip < ilimit) /* same test as loop, for speed */
-                ZSTD_addPtr(HashTable, ip-2, base);
+                hashTable[ZSTD_hashPtr(ip-2, hBits, mls)] = (U32)(ip-2-base);
         }
     }
 
@@ -601,57 +1104,294 @@ static size_t ZSTD_compressBlock(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, c
     }
 
     /* Finale compression stage */
-    return ZSTD_compressSequences((BYTE*)dst, maxDstSize,
-                                  seqStorePtr, srcSize);
+    return ZSTD_compressSequences_generic((BYTE*)dst, maxDstSize,
+                                          seqStorePtr, srcSize, acceleration);
 }
 
 
-size_t ZSTD_compressBegin(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize)
+static size_t ZSTD_compressBlock(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
 {
-    /* Sanity check */
-    if (maxDstSize < ZSTD_frameHeaderSize) return ERROR(dstSize_tooSmall);
-
-    /* Init */
-    ZSTD_resetCCtx(ctx);
-
-    /* Write Header */
-    MEM_writeLE32(dst, ZSTD_magicNumber);
-
-    return ZSTD_frameHeaderSize;
+    const U32 mls = ctx->params.searchLength;
+    switch(mls)
+    {
+    default:
+    case 4 :
+        return ZSTD_compressBlock_generic(ctx, dst, maxDstSize, src, srcSize, 4);
+    case 5 :
+        return ZSTD_compressBlock_generic(ctx, dst, maxDstSize, src, srcSize, 5);
+    case 6 :
+        return ZSTD_compressBlock_generic(ctx, dst, maxDstSize, src, srcSize, 6);
+    case 7 :
+        return ZSTD_compressBlock_generic(ctx, dst, maxDstSize, src, srcSize, 7);
+    }
 }
 
 
-static void ZSTD_scaleDownCtx(ZSTD_CCtx* ctx, const U32 limit)
+/** ZSTD_compressBlock_extDict_generic
+    same as ZSTD_compressBlock_generic(), but matches can also be found into a previous segment (dictionary),
+    within indexes [lowLimit, dictLimit[, relative to dictBase */
+FORCE_INLINE
+size_t ZSTD_compressBlock_extDict_generic(ZSTD_CCtx* ctx,
+                                          void* dst, size_t maxDstSize,
+                                    const void* src, size_t srcSize,
+                                    const U32 mls)
 {
-    int i;
+    U32* const hashTable = ctx->hashTable;
+    const U32 hBits = ctx->params.hashLog;
+    const U32 acceleration = ctx->params.acceleration;
+    seqStore_t* seqStorePtr = &(ctx->seqStore);
+    const BYTE* const base = ctx->base;
+    const BYTE* const dictBase = ctx->dictBase;
+    const U32 lowLimit = ctx->lowLimit;
+    const U32 dictLimit = ctx->dictLimit;
+    const BYTE* const dictStart = dictBase + lowLimit;
+    const BYTE* const dictEnd = dictBase + dictLimit;
+    const BYTE* const prefixStart = base + dictLimit;
 
-#if defined(__AVX2__)
-    /* AVX2 version */
-    __m256i* h = ctx->hashTable;
-    const __m256i limit8 = _mm256_set1_epi32(limit);
-    for (i=0; i<(HASH_TABLESIZE>>3); i++)
-    {
-        __m256i src =_mm256_loadu_si256((const __m256i*)(h+i));
-  const __m256i dec = _mm256_min_epu32(src, limit8);
-                src = _mm256_sub_epi32(src, dec);
-        _mm256_storeu_si256((__m256i*)(h+i), src);
-    }
-#else
-    /* this should be auto-vectorized by compiler */
-    U32* h = ctx->hashTable;
-    for (i=0; i<HASH_TABLESIZE; ++i)
-    {
-        U32 dec;
-        if (h[i] > limit) dec = limit; else dec = h[i];
-        h[i] -= dec;
-    }
-#endif
-}
+    const BYTE* const istart = (const BYTE*)src;
+    const BYTE* ip = istart + 1;
+    const BYTE* anchor = istart;
+    const BYTE* const iend = istart + srcSize;
+    const BYTE* const ilimit = iend - 8;
 
+    U32 offset_2=REPCODE_STARTVALUE, offset_1=REPCODE_STARTVALUE;
 
-static void ZSTD_limitCtx(ZSTD_CCtx* ctx, const U32 limit)
-{
-    int i;
+
+    /* init */
+    ZSTD_resetSeqStore(seqStorePtr);
+    hashTable[ZSTD_hashPtr(istart, hBits, mls)] = (U32)(istart-base);
+
+    /* Main Search Loop */
+    while (ip < ilimit)  /* < instead of <=, because unconditionnal hashTable update of ip+1 */
+    {
+        const size_t h = ZSTD_hashPtr(ip, hBits, mls);
+        const U32 current = (U32)(ip-base);
+        const U32 repIndex = current - offset_2;
+        U32 matchIndex = hashTable[h];
+        const BYTE* match = (matchIndex < dictLimit ? dictBase : base) + matchIndex;
+        hashTable[h] = current;   /* update hash table */
+
+        if ( ((U32)((dictLimit-1) - repIndex) >= 3)   /* intentional underflow : 4 bytes must not straddle dictionary end */
+            && (repIndex >= lowLimit) )
+        {
+            const BYTE* const repMatch = (repIndex < dictLimit ? dictBase : base) + repIndex;
+            if (MEM_read32(repMatch) == MEM_read32(ip)) match = repMatch, matchIndex = repIndex;
+        }
+        if ( (matchIndex < lowLimit) || ((U32)((dictLimit-1) - matchIndex) < 3)
+            || (MEM_read32(match) != MEM_read32(ip)) )
+        { ip += ((ip-anchor) >> g_searchStrength) + acceleration; offset_2 = offset_1; continue; }
+
+        {
+            const BYTE* const matchEnd = matchIndex < dictLimit ? dictEnd : iend;
+            const BYTE* const lowMatchPtr = matchIndex < dictLimit ? dictStart : prefixStart;
+            const U32 offset = current - matchIndex;
+            size_t litLength, matchLength, offsetCode;
+            while ((ip>anchor) && (match>lowMatchPtr) && (ip[-1] == match[-1])) { ip--; match--; }  /* catch up */
+            litLength = ip-anchor;
+            matchLength = ZSTD_count_2segments(ip+MINMATCH, match+MINMATCH, iend, matchEnd, prefixStart);
+            offsetCode = offset;
+            if (offset == offset_2) offsetCode = 0;
+            offset_2 = offset_1;
+            offset_1 = offset;
+            ZSTD_storeSeq(seqStorePtr, litLength, anchor, offsetCode, matchLength);
+
+            /* Fill Table */
+            hashTable[ZSTD_hashPtr(ip+1, hBits, mls)] = (U32)(ip+1-base);
+            ip += matchLength + MINMATCH;
+            anchor = ip;
+            if (ip < ilimit) /* same test as loop, for speed */
+                hashTable[ZSTD_hashPtr(ip-2, hBits, mls)] = (U32)(ip-2-base);
+        }
+    }
+
+    /* Last Literals */
+    {
+        size_t lastLLSize = iend - anchor;
+        memcpy(seqStorePtr->lit, anchor, lastLLSize);
+        seqStorePtr->lit += lastLLSize;
+    }
+
+    /* Finale compression stage */
+    return ZSTD_compressSequences_generic((BYTE*)dst, maxDstSize,
+                                          seqStorePtr, srcSize, acceleration);
+}
+
+
+static size_t ZSTD_compressBlock_extDict(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+{
+    const U32 mls = ctx->params.searchLength;
+    switch(mls)
+    {
+    default:
+    case 4 :
+        return ZSTD_compressBlock_extDict_generic(ctx, dst, maxDstSize, src, srcSize, 4);
+    case 5 :
+        return ZSTD_compressBlock_extDict_generic(ctx, dst, maxDstSize, src, srcSize, 5);
+    case 6 :
+        return ZSTD_compressBlock_extDict_generic(ctx, dst, maxDstSize, src, srcSize, 6);
+    case 7 :
+        return ZSTD_compressBlock_extDict_generic(ctx, dst, maxDstSize, src, srcSize, 7);
+    }
+}
+
+
+size_t ZSTD_compressBegin_advanced(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, ZSTD_parameters params)
+{
+    size_t errorCode;
+
+    ZSTD_frameParams fparams;
+
+    /* Sanity check */
+    if (maxDstSize < ZSTD_frameHeaderSize) return ERROR(dstSize_tooSmall);
+
+    /* Init */
+    ZSTD_validateParams(&params);
+    errorCode = ZSTD_resetCCtx_advanced(ctx, params);
+    if (ZSTD_isError(errorCode)) return errorCode;
+
+    /* Write Header */
+    fparams.contentSize = ctx->pledgedSrcSizePlusOne ? ctx->pledgedSrcSizePlusOne-1 : ZSTD_CONTENTSIZE_UNKNOWN;
+    fparams.windowLog = ZSTD_highbit(g_maxDistance);
+    fparams.checksumFlag = ctx->checksumFlag;
+    ctx->frameContentSizePlusOne = ctx->pledgedSrcSizePlusOne;
+    ctx->consumedSrcSize = 0;
+    ctx->pledgedSrcSizePlusOne = 0;   /* only for this frame */
+    return ZSTD_writeFrameHeader(dst, maxDstSize, &fparams, &ctx->checksumState);
+}
+
+size_t ZSTD_compressBegin(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize)
+{
+    const ZSTD_parameters defaultParams = { 0, 0, 0 };
+    return ZSTD_compressBegin_advanced(ctx, dst, maxDstSize, defaultParams);
+}
+
+
+size_t ZSTD_compress_insertDictionary(ZSTD_CCtx* ctx, const void* dict, size_t dictSize)
+{
+    U32* const hashTable = ctx->hashTable;
+    const U32 hBits = ctx->params.hashLog;
+    const U32 mls = ctx->params.searchLength;
+    const BYTE* ip = (const BYTE*)dict;
+    const BYTE* const iend = ip + dictSize;
+
+    /* Sanity check */
+    if (hashTable == NULL) return ERROR(stage_wrong);   /* ZSTD_compressBegin() not called yet */
+    if (ctx->base != NULL) return ERROR(stage_wrong);   /* must be loaded before first ZSTD_compressContinue() */
+    if (dictSize < 8) return 0;   /* too small to be useful : ignored */
+    if (dictSize > g_maxDistance) ip = iend - g_maxDistance;   /* only last part is within reach */
+
+    /* dictionary becomes current prefix */
+    ctx->base = ip - ctx->current;
+    ctx->nextUpdate = ctx->current + g_maxDistance;
+    ctx->current += (U32)(iend - ip);
+    ctx->loadedDictEnd = ctx->current;
+
+    /* fill table */
+    for ( ; ip <= iend-8; ip++)
+        hashTable[ZSTD_hashPtr(ip, hBits, mls)] = (U32)(ip - ctx->base);
+
+    return 0;
+}
+
+
+/** ZSTD_fillHashTable
+    indexes current prefix from index start, up to ip, into hash table.
+    Positions are sampled so that about 1<<hashLog of them are inserted : later ones do not evict all earlier ones */
+static void ZSTD_fillHashTable(ZSTD_CCtx* ctx, const BYTE* ip, U32 start)
+{
+    U32* const hashTable = ctx->hashTable;
+    const U32 hBits = ctx->params.hashLog;
+    const U32 mls = ctx->params.searchLength;
+    const BYTE* const base = ctx->base;
+    const U32 current = (U32)(ip - base);
+    size_t step;
+    const BYTE* p;
+
+    if (start < ctx->dictLimit) start = ctx->dictLimit;
+    if (start + g_maxDistance < current) start = current - g_maxDistance;
+    if (start >= current) return;
+    step = ((current - start) >> hBits) + 1;
+    for (p = base + start; p < ip; p += step)
+        hashTable[ZSTD_hashPtr(p, hBits, mls)] = (U32)(p - base);
+}
+
+
+/* hash table rescaling : AVX2 kernels are selected at runtime when not enabled at compile time */
+static void ZSTD_scaleDownTable_scalar(U32* h, int tableSize, const U32 limit)
+{
+    /* this should be auto-vectorized by compiler */
+    int i;
+    for (i=0; i<tableSize; ++i)
+    {
+        U32 dec;
+        if (h[i] > limit) dec = limit; else dec = h[i];
+        h[i] -= dec;
+    }
+}
+
+static void ZSTD_limitTable_scalar(U32* h, int tableSize, const U32 limit)
+{
+    /* this should be auto-vectorized by compiler */
+    int i;
+    for (i=0; i<tableSize; ++i)
+    {
+        if (h[i] < limit) h[i] = limit;
+    }
+}
+
+#ifdef ZSTD_AVX2
+ZSTD_TARGET("avx2") static void ZSTD_scaleDownTable_avx2(U32* table, int tableSize, const U32 limit)
+{
+    __m256i* h = (__m256i*)table;
+    const __m256i limit8 = _mm256_set1_epi32(limit);
+    int i;
+    for (i=0; i<(tableSize>>3); i++)
+    {
+        __m256i src =_mm256_loadu_si256((const __m256i*)(h+i));
+        const __m256i dec = _mm256_min_epu32(src, limit8);
+                src = _mm256_sub_epi32(src, dec);
+        _mm256_storeu_si256((__m256i*)(h+i), src);
+    }
+}
+
+ZSTD_TARGET("avx2") static void ZSTD_limitTable_avx2(U32* table, int tableSize, const U32 limit)
+{
+    __m256i* h = (__m256i*)table;
+    const __m256i limit8 = _mm256_set1_epi32(limit);
+    int i;
+    for (i=0; i<(tableSize>>3); i++)
+    {
+        __m256i src =_mm256_loadu_si256((const __m256i*)(h+i));   // Unfortunately, clang doesn't guarantee 32-bytes alignment
+                src = _mm256_max_epu32(src, limit8);
+        _mm256_storeu_si256((__m256i*)(h+i), src);
+    }
+}
+#endif
+
+static int ZSTD_avx2(void)
+{
+#if defined(__AVX2__)
+    return 1;
+#elif defined(ZSTD_AVX2)
+    return (ZSTD_cpuFeatures() & ZSTD_cpuFeature_avx2) != 0;
+#else
+    return 0;
+#endif
+}
+
+static void ZSTD_scaleDownCtx(ZSTD_CCtx* ctx, const U32 limit)
+{
+    const int tableSize = 1 << ctx->params.hashLog;
+#ifdef ZSTD_AVX2
+    if (ZSTD_avx2()) { ZSTD_scaleDownTable_avx2(ctx->hashTable, tableSize, limit); return; }
+#endif
+    ZSTD_scaleDownTable_scalar(ctx->hashTable, tableSize, limit);
+}
+
+
+static void ZSTD_limitCtx(ZSTD_CCtx* ctx, const U32 limit)
+{
+    const int tableSize = 1 << ctx->params.hashLog;
 
     if (limit > g_maxLimit)
     {
@@ -659,32 +1399,18 @@ static void ZSTD_limitCtx(ZSTD_CCtx* ctx, const U32 limit)
         ctx->base += limit;
         ctx->current -= limit;
         ctx->nextUpdate -= limit;
+        ctx->dictBase += limit;
+        ctx->dictLimit = ctx->dictLimit > limit ? ctx->dictLimit - limit : 0;
+        ctx->lowLimit = ctx->lowLimit > limit ? ctx->lowLimit - limit : 0;
+        ctx->loadedDictEnd = 0;
+        ctx->seqStore.rawEnd = 0;   /* skipped raw blocks : indexes no longer valid */
         return;
     }
 
-#if defined(__AVX2__)
-    /* AVX2 version */
-    {
-        __m256i* h = ctx->hashTable;
-        const __m256i limit8 = _mm256_set1_epi32(limit);
-        //printf("Address h : %0X\n", (U32)h);    // address test
-        for (i=0; i<(HASH_TABLESIZE>>3); i++)
-        {
-            __m256i src =_mm256_loadu_si256((const __m256i*)(h+i));   // Unfortunately, clang doesn't guarantee 32-bytes alignment
-                    src = _mm256_max_epu32(src, limit8);
-            _mm256_storeu_si256((__m256i*)(h+i), src);
-        }
-    }
-#else
-    /* this should be auto-vectorized by compiler */
-    {
-        U32* h = (U32*)(ctx->hashTable);
-        for (i=0; i<HASH_TABLESIZE; ++i)
-        {
-            if (h[i] < limit) h[i] = limit;
-        }
-    }
+#ifdef ZSTD_AVX2
+    if (ZSTD_avx2()) { ZSTD_limitTable_avx2(ctx->hashTable, tableSize, limit); return; }
 #endif
+    ZSTD_limitTable_scalar(ctx->hashTable, tableSize, limit);
 }
 
 
@@ -697,31 +1423,53 @@ size_t ZSTD_compressContinue(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, const
     const U32 updateRate = 2 * BLOCKSIZE;
 
     /*  Init */
+    if (ctx->hashTable==NULL) return ERROR(stage_wrong);   /* ZSTD_compressBegin() not called yet */
     if (ctx->base==NULL)
-        ctx->base = (const BYTE*)src, ctx->current=0, ctx->nextUpdate = g_maxDistance;
+        ctx->base = (const BYTE*)src - ctx->current, ctx->nextUpdate = ctx->current + g_maxDistance;
     if (src != ctx->base + ctx->current)   /* not contiguous */
     {
-        ZSTD_resetCCtx(ctx);
-        ctx->base = (const BYTE*)src;
-        ctx->current = 0;
+        if ((ctx->loadedDictEnd) && (ctx->current == ctx->loadedDictEnd))
+        {
+            /* loaded dictionary becomes extDict : indexes continue into new segment */
+            ctx->dictBase = ctx->base;
+            ctx->dictLimit = ctx->current;
+            ctx->base = (const BYTE*)src - ctx->current;
+        }
+        else
+        {
+            ZSTD_resetCCtx(ctx);
+            ctx->base = (const BYTE*)src - ctx->current;
+            ctx->nextUpdate = ctx->current + g_maxDistance;
+        }
     }
     ctx->current += (U32)srcSize;
+    ctx->consumedSrcSize += srcSize;
+
+    /* if input and dictionary overlap : reduce dictionary (presumed modified by input) */
+    if ((ip+srcSize > ctx->dictBase + ctx->lowLimit) && (ip < ctx->dictBase + ctx->dictLimit))
+    {
+        ctx->lowLimit = (U32)(ip + srcSize - ctx->dictBase);
+        if (ctx->lowLimit > ctx->dictLimit) ctx->lowLimit = ctx->dictLimit;
+    }
 
     while (srcSize)
     {
         size_t cSize;
-        size_t blockSize = BLOCKSIZE;
+        size_t blockSize = ctx->blockSize ? ctx->blockSize : BLOCKSIZE;
         if (blockSize > srcSize) blockSize = srcSize;
 
         if (maxDstSize < 2*ZSTD_blockHeaderSize+1)  /* one RLE block + endMark */
             return ERROR(dstSize_tooSmall);
 
+        /* content checksum : block is hashed while it's being loaded for compression */
+        if (ctx->checksumFlag) XXH64_update(&ctx->checksumState, ip, blockSize);
+
         /* update hash table */
         if (g_maxDistance <= BLOCKSIZE)   /* static test ; yes == blocks are independent */
         {
             ZSTD_resetCCtx(ctx);
-            ctx->base = ip;
-            ctx->current=0;
+            ctx->base = ip - ctx->current;
+            ctx->current += (U32)srcSize;
         }
         else if (ip >= ctx->base + ctx->nextUpdate)
         {
@@ -729,12 +1477,44 @@ size_t ZSTD_compressContinue(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, const
             ZSTD_limitCtx(ctx, ctx->nextUpdate - g_maxDistance);
         }
 
+        /* single byte run, or incompressible data : no need for match search */
+        cSize = ZSTD_rleCompressBlock(op, maxDstSize, ip, blockSize);
+        if (ZSTD_isError(cSize)) return cSize;
+        if (cSize == 0)
+        {
+            const U32 current = (U32)(ip - ctx->base);
+            const U32 lowest = (ctx->lowLimit + g_maxDistance >= current) ? ctx->lowLimit : current - g_maxDistance;
+            if (ZSTD_isIncompressible(&ctx->seqStore, ip, blockSize, ctx->base, ctx->dictBase, ctx->dictLimit, lowest))
+            {
+                cSize = ZSTD_noCompressBlock(op, maxDstSize, ip, blockSize);
+                if (ZSTD_isError(cSize)) return cSize;
+                ZSTD_skipRawBlock(&ctx->seqStore, current, current + (U32)blockSize);
+            }
+        }
+        if (cSize)
+        {
+            ZSTD_updateRawRun(&ctx->seqStore, op);
+            op += cSize;
+            maxDstSize -= cSize;
+            ip += blockSize;
+            srcSize -= blockSize;
+            continue;
+        }
+
+        /* skipped raw blocks : index them, this block may repeat them */
+        if (ZSTD_endRawSkip(&ctx->seqStore))
+            ZSTD_fillHashTable(ctx, ip, ctx->seqStore.rawStart);
+
         /* compress */
-        cSize = ZSTD_compressBlock(ctx, op+ZSTD_blockHeaderSize, maxDstSize-ZSTD_blockHeaderSize, ip, blockSize);
+        if (ctx->lowLimit < ctx->dictLimit)   /* a previous segment can be referenced */
+            cSize = ZSTD_compressBlock_extDict(ctx, op+ZSTD_blockHeaderSize, maxDstSize-ZSTD_blockHeaderSize, ip, blockSize);
+        else
+            cSize = ZSTD_compressBlock(ctx, op+ZSTD_blockHeaderSize, maxDstSize-ZSTD_blockHeaderSize, ip, blockSize);
         if (cSize == 0)
         {
             cSize = ZSTD_noCompressBlock(op, maxDstSize, ip, blockSize);   /* block is not compressible */
             if (ZSTD_isError(cSize)) return cSize;
+            ZSTD_indexRawBlock(&ctx->seqStore, ip, blockSize, ctx->base);
         }
         else
         {
@@ -745,6 +1525,7 @@ size_t ZSTD_compressContinue(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, const
             op[0] += (BYTE)(bt_compressed << 6); /* is a compressed block */
             cSize += 3;
         }
+        ZSTD_updateRawRun(&ctx->seqStore, op);
         op += cSize;
         maxDstSize -= cSize;
         ip += blockSize;
@@ -757,29 +1538,23 @@ size_t ZSTD_compressContinue(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, const
 
 size_t ZSTD_compressEnd(ZSTD_CCtx*  ctx, void* dst, size_t maxDstSize)
 {
-    BYTE* op = (BYTE*)dst;
-
-    /* Sanity check */
-    (void)ctx;
-    if (maxDstSize < ZSTD_blockHeaderSize) return ERROR(dstSize_tooSmall);
-
-    /* End of frame */
-    op[0] = (BYTE)(bt_end << 6);
-    op[1] = 0;
-    op[2] = 0;
-
-    return 3;
+    if ((ctx->frameContentSizePlusOne) && (ctx->consumedSrcSize != ctx->frameContentSizePlusOne-1))
+        return ERROR(srcSize_wrong);   /* frame header announces another content size */
+    return ZSTD_writeFrameEnd(dst, maxDstSize, ctx->checksumFlag ? &ctx->checksumState : NULL);
 }
 
 
-size_t ZSTD_compressCCtx(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+size_t ZSTD_compress_advanced(ZSTD_CCtx* ctx,
+                              void* dst, size_t maxDstSize,
+                        const void* src, size_t srcSize,
+                              ZSTD_parameters params)
 {
     BYTE* const ostart = (BYTE* const)dst;
     BYTE* op = ostart;
     size_t oSize;
 
     /* Header */
-    oSize = ZSTD_compressBegin(ctx, dst, maxDstSize);
+    oSize = ZSTD_compressBegin_advanced(ctx, dst, maxDstSize, params);
     if(ZSTD_isError(oSize)) return oSize;
     op += oSize;
     maxDstSize -= oSize;
@@ -798,8 +1573,28 @@ size_t ZSTD_compressCCtx(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, const voi
     return (op - ostart);
 }
 
+size_t ZSTD_compressCCtx(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+{
+    const ZSTD_parameters defaultParams = { 0, 0, 0 };
+    return ZSTD_compress_advanced(ctx, dst, maxDstSize, src, srcSize, defaultParams);
+}
 
-size_t ZSTD_compress(void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+size_t ZSTD_compressBatch(ZSTD_CCtx* ctx, ZSTD_batchItem* items, size_t nbItems, ZSTD_parameters params)
+{
+    size_t firstError = 0;
+    size_t n;
+
+    ZSTD_validateParams(&params);   /* once for all items : table is kept from one item to the next */
+    for (n=0; n<nbItems; n++)
+    {
+        items[n].cSize = ZSTD_compress_advanced(ctx, items[n].dst, items[n].dstCapacity, items[n].src, items[n].srcSize, params);
+        if (ZSTD_isError(items[n].cSize) && !firstError) firstError = items[n].cSize;
+    }
+    return firstError;
+}
+
+
+size_t ZSTD_compressLevel(void* dst, size_t maxDstSize, const void* src, size_t srcSize, int compressionLevel)
 {
     size_t r;
 #if defined(ZSTD_HEAPMODE) && (ZSTD_HEAPMODE==1)
@@ -809,17 +1604,186 @@ size_t ZSTD_compress(void* dst, size_t maxDstSize, const void* src, size_t srcSi
 # else
     ZSTD_CCtx ctxBody;
     ZSTD_CCtx* const ctx = &ctxBody;
+    memset(&ctxBody, 0, sizeof(ZSTD_CCtx) - WORKPLACESIZE);
 # endif
 
-    r = ZSTD_compressCCtx(ctx, dst, maxDstSize, src, srcSize);
+    r = ZSTD_compress_advanced(ctx, dst, maxDstSize, src, srcSize, ZSTD_getParams(compressionLevel));
 
 #if defined(ZSTD_HEAPMODE) && (ZSTD_HEAPMODE==1)
     ZSTD_freeCCtx(ctx);
+#else
+    ZSTD_free(ctxBody.workSpace, ctxBody.customMem);   /* hash table */
 #endif
 
     return r;
 }
 
+size_t ZSTD_compress(void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+{
+    return ZSTD_compressLevel(dst, maxDstSize, src, srcSize, 1);
+}
+
+
+/* *************************************************************
+*   Dictionary compression
+***************************************************************/
+size_t ZSTD_duplicateCCtx(ZSTD_CCtx* dstCCtx, const ZSTD_CCtx* srcCCtx)
+{
+    if ((srcCCtx->base != NULL) && (srcCCtx->current != srcCCtx->loadedDictEnd)) return ERROR(stage_wrong);   /* srcCCtx must be at the beginning of a frame */
+    if (srcCCtx->hashTable == NULL) return ERROR(stage_wrong);
+
+    {
+        size_t errorCode = ZSTD_resetCCtx_advanced(dstCCtx, srcCCtx->params);
+        if (ZSTD_isError(errorCode)) return errorCode;
+    }
+    memcpy(dstCCtx->hashTable, srcCCtx->hashTable, ((size_t)1 << srcCCtx->params.hashLog) * sizeof(U32));
+    dstCCtx->base = srcCCtx->base;
+    dstCCtx->dictBase = srcCCtx->dictBase;
+    dstCCtx->dictLimit = srcCCtx->dictLimit;
+    dstCCtx->lowLimit = srcCCtx->lowLimit;
+    dstCCtx->loadedDictEnd = srcCCtx->loadedDictEnd;
+    dstCCtx->current = srcCCtx->current;
+    dstCCtx->nextUpdate = srcCCtx->nextUpdate;
+    ZSTD_initSeqStore(dstCCtx);
+    return 0;
+}
+
+
+size_t ZSTD_compress_usingPreparedCCtx(ZSTD_CCtx* ctx, const ZSTD_CCtx* preparedCCtx,
+                                       void* dst, size_t maxDstSize,
+                                 const void* src, size_t srcSize)
+{
+    BYTE* const ostart = (BYTE* const)dst;
+    BYTE* op = ostart;
+    size_t oSize;
+
+    /* Header */
+    oSize = ZSTD_compressBegin_advanced(ctx, dst, maxDstSize, preparedCCtx->params);
+    if(ZSTD_isError(oSize)) return oSize;
+    op += oSize;
+    maxDstSize -= oSize;
+
+    /* Dictionary */
+    oSize = ZSTD_duplicateCCtx(ctx, preparedCCtx);
+    if(ZSTD_isError(oSize)) return oSize;
+
+    /* Compression */
+    oSize = ZSTD_compressContinue(ctx, op, maxDstSize, src, srcSize);
+    if (ZSTD_isError(oSize)) return oSize;
+    op += oSize;
+    maxDstSize -= oSize;
+
+    /* Close frame */
+    oSize = ZSTD_compressEnd(ctx, op, maxDstSize);
+    if(ZSTD_isError(oSize)) return oSize;
+    op += oSize;
+
+    return (op - ostart);
+}
+
+
+size_t ZSTD_compress_usingDict(ZSTD_CCtx* ctx,
+                               void* dst, size_t maxDstSize,
+                         const void* src, size_t srcSize,
+                         const void* dict, size_t dictSize)
+{
+    BYTE* const ostart = (BYTE* const)dst;
+    BYTE* op = ostart;
+    size_t oSize;
+
+    /* Header */
+    oSize = ZSTD_compressBegin(ctx, dst, maxDstSize);
+    if(ZSTD_isError(oSize)) return oSize;
+    op += oSize;
+    maxDstSize -= oSize;
+
+    /* Dictionary */
+    oSize = ZSTD_compress_insertDictionary(ctx, dict, dictSize);
+    if(ZSTD_isError(oSize)) return oSize;
+
+    /* Compression */
+    oSize = ZSTD_compressContinue(ctx, op, maxDstSize, src, srcSize);
+    if (ZSTD_isError(oSize)) return oSize;
+    op += oSize;
+    maxDstSize -= oSize;
+
+    /* Close frame */
+    oSize = ZSTD_compressEnd(ctx, op, maxDstSize);
+    if(ZSTD_isError(oSize)) return oSize;
+    op += oSize;
+
+    return (op - ostart);
+}
+
+
+/* *************************************************************
+*   Digested dictionary : ZSTD_CDict
+***************************************************************/
+struct ZSTD_CDict_s
+{
+    void* dictContent;
+    size_t dictContentSize;
+    ZSTD_CCtx* refContext;   /* dictionary loaded, at the beginning of a frame : read-only after creation */
+    ZSTD_customMem customMem;
+};
+
+ZSTD_CDict* ZSTD_createCDict_advanced(const void* dict, size_t dictSize, ZSTD_parameters params, ZSTD_customMem customMem)
+{
+    ZSTD_CDict* cdict;
+    void* dictContent;
+    ZSTD_CCtx* cctx;
+    BYTE header[ZSTD_FRAMEHEADERSIZE_MAX];
+    size_t errorCode;
+
+    if (!customMem.customAlloc != !customMem.customFree) return NULL;
+    cdict = (ZSTD_CDict*)ZSTD_malloc(sizeof(ZSTD_CDict), customMem);
+    dictContent = ZSTD_malloc(dictSize+1, customMem);   /* +1 : malloc(0) may return NULL */
+    cctx = ZSTD_createCCtx_advanced(customMem);
+    if (!cdict || !dictContent || !cctx)
+    {
+        ZSTD_free(cdict, customMem); ZSTD_free(dictContent, customMem); ZSTD_freeCCtx(cctx);
+        return NULL;
+    }
+    memcpy(dictContent, dict, dictSize);
+    errorCode = ZSTD_compressBegin_advanced(cctx, header, sizeof(header), params);
+    if (!ZSTD_isError(errorCode)) errorCode = ZSTD_compress_insertDictionary(cctx, dictContent, dictSize);
+    if (ZSTD_isError(errorCode))
+    {
+        ZSTD_free(cdict, customMem); ZSTD_free(dictContent, customMem); ZSTD_freeCCtx(cctx);
+        return NULL;
+    }
+
+    cdict->dictContent = dictContent;
+    cdict->dictContentSize = dictSize;
+    cdict->refContext = cctx;
+    cdict->customMem = customMem;
+    return cdict;
+}
+
+ZSTD_CDict* ZSTD_createCDict(const void* dict, size_t dictSize)
+{
+    const ZSTD_parameters defaultParams = { 0, 0, 0 };
+    const ZSTD_customMem defaultMem = { NULL, NULL, NULL };
+    return ZSTD_createCDict_advanced(dict, dictSize, defaultParams, defaultMem);
+}
+
+size_t ZSTD_freeCDict(ZSTD_CDict* cdict)
+{
+    if (cdict==NULL) return 0;
+    ZSTD_freeCCtx(cdict->refContext);
+    ZSTD_free(cdict->dictContent, cdict->customMem);
+    ZSTD_free(cdict, cdict->customMem);
+    return 0;
+}
+
+size_t ZSTD_compress_usingCDict(ZSTD_CCtx* ctx,
+                                void* dst, size_t maxDstSize,
+                          const void* src, size_t srcSize,
+                          const ZSTD_CDict* cdict)
+{
+    return ZSTD_compress_usingPreparedCCtx(ctx, cdict->refContext, dst, maxDstSize, src, srcSize);
+}
+
 
 /* *************************************************************
 *   Decompression section
@@ -829,14 +1793,35 @@ struct ZSTD_DCtx_s
     U32 LLTable[FSE_DTABLE_SIZE_U32(LLFSELog)];
     U32 OffTable[FSE_DTABLE_SIZE_U32(OffFSELog)];
     U32 MLTable[FSE_DTABLE_SIZE_U32(MLFSELog)];
-    void* previousDstEnd;
-    void* base;
+    U32 seqTableStates[3];   /* LL, Off, ML */
+    const void* previousDstEnd;
+    const void* base;
+    const void* vBase;      /* virtual start of previous segment (dictionary), relative to base */
+    const void* dictEnd;    /* end of previous segment (dictionary) */
     size_t expected;
     blockType_t bType;
+    size_t rleSize;      /* regenerated size of current bt_rle block */
     U32 phase;
     const BYTE* litPtr;
     size_t litBufSize;
     size_t litSize;
+    size_t staticSize;   /* 0 : allocated by ZSTD_createDCtx() */
+    ZSTD_customMem customMem;
+    U32 litEntropy;      /* 1 : hufTable is valid, and can be re-used by IS_PCH literals */
+    U32 hufAlgo;         /* decoder which built hufTable */
+    ZSTD_frameParams fParams;   /* parameters of current frame */
+    U64 frameDecodedSize;
+    XXH64_state_t checksumState;
+    size_t headerSize;
+    BYTE headerBuffer[ZSTD_FRAMEHEADERSIZE_MAX];
+    U32 legacyVersion;   /* 0 : current format ; 2 : v0.2 frame, decoded by current kernels ; 1 : v0.1 frame, delegated to legacyContext */
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+    ZSTDv01_Dctx* legacyContext;   /* created on first v0.1 frame */
+#endif
+#if ZSTD_STATS
+    ZSTD_stats stats;    /* never reset by frames */
+#endif
+    U32 hufTable[HUF_DTABLE_SIZE_U32(HUF_MAX_TABLELOG)];
     BYTE litBuffer[BLOCKSIZE + 8 /* margin for wildcopy */];
 };   /* typedef'd to ZSTD_Dctx within "zstd_static.h" */
 
@@ -857,6 +1842,7 @@ size_t ZSTD_getcBlockSize(const void* src, size_t srcSize, blockProperties_t* bp
 
     if (bpPtr->blockType == bt_end) return 0;
     if (bpPtr->blockType == bt_rle) return 1;
+    if (cSize == 0) return ERROR(corruption_detected);   /* only end mark can be empty */
     return cSize;
 }
 
@@ -867,21 +1853,41 @@ static size_t ZSTD_copyUncompressedBlock(void* dst, size_t maxDstSize, const voi
     return srcSize;
 }
 
+static size_t ZSTD_generateRleBlock(void* dst, size_t maxDstSize, BYTE b, size_t regenSize)
+{
+    if (regenSize > maxDstSize) return ERROR(dstSize_tooSmall);
+    memset(dst, b, regenSize);
+    return regenSize;
+}
+
 
 /** ZSTD_decompressLiterals
     @return : nb of bytes read from src, or an error code*/
-static size_t ZSTD_decompressLiterals(void* dst, size_t* maxDstSizePtr,
+static size_t ZSTD_decompressLiterals(ZSTD_DCtx* dctx, void* dst, size_t* maxDstSizePtr,
                                 const void* src, size_t srcSize)
 {
     const BYTE* ip = (const BYTE*)src;
 
     const size_t litSize = (MEM_readLE32(src) & 0x1FFFFF) >> 2;   /* no buffer issue : srcSize >= MIN_CBLOCK_SIZE */
     const size_t litCSize = (MEM_readLE32(ip+2) & 0xFFFFFF) >> 5;   /* no buffer issue : srcSize >= MIN_CBLOCK_SIZE */
+    size_t errorCode;
 
     if (litSize > *maxDstSizePtr) return ERROR(corruption_detected);
     if (litCSize + 5 > srcSize) return ERROR(corruption_detected);
 
-    if (HUF_isError(HUF_decompress(dst, litSize, ip+5, litCSize))) return ERROR(corruption_detected);
+    if ((*ip & 3) == IS_PCH)
+    {
+        if (!dctx->litEntropy) return ERROR(corruption_detected);   /* no previous table */
+        if ((litCSize >= litSize) || (litSize == 0)) return ERROR(corruption_detected);
+        errorCode = HUF_decompress4X_usingDTable(dst, litSize, ip+5, litCSize, dctx->hufTable, dctx->hufAlgo);
+    }
+    else
+    {
+        dctx->litEntropy = 0;   /* hufTable is overwritten */
+        errorCode = HUF_decompress4X_hufOnly(dctx->hufTable, &dctx->hufAlgo, dst, litSize, ip+5, litCSize);
+        if (!HUF_isError(errorCode)) dctx->litEntropy = 1;
+    }
+    if (HUF_isError(errorCode)) return ERROR(corruption_detected);
 
     *maxDstSizePtr = litSize;
     return litCSize + 5;
@@ -903,9 +1909,10 @@ size_t ZSTD_decodeLiteralsBlock(void* ctx,
     {
     /* compressed */
     case 0:
+    case IS_PCH:
         {
             size_t litSize = BLOCKSIZE;
-            const size_t readSize = ZSTD_decompressLiterals(dctx->litBuffer, &litSize, src, srcSize);
+            const size_t readSize = ZSTD_decompressLiterals(dctx, dctx->litBuffer, &litSize, src, srcSize);
             dctx->litPtr = dctx->litBuffer;
             dctx->litBufSize = BLOCKSIZE+8;
             dctx->litSize = litSize;
@@ -939,20 +1946,74 @@ size_t ZSTD_decodeLiteralsBlock(void* ctx,
             return 4;
         }
     default:
-        return ERROR(corruption_detected);   /* forbidden nominal case */
+        return ERROR(corruption_detected);   /* impossible */
+    }
+}
+
+
+/** ZSTD_buildSeqDTable
+    builds DTable for tables with a header (compressed, raw, rle); bt_ext tables are built later.
+    @return : nb of bytes read from ip, or an error code */
+static size_t ZSTD_buildSeqDTable(FSE_DTable* DTable, U32* statePtr, U32 type,
+                                  U32 maxSymbolValue, U32 rawBits, U32 maxLog,
+                                  const BYTE* ip, const BYTE* iend)
+{
+    switch(type)
+    {
+    case bt_rle :
+        if (ip > iend-2) return ERROR(srcSize_wrong);   /* min : "raw", hence no header, but at least xxLog bits */
+        FSE_buildDTable_rle(DTable, *ip & maxSymbolValue);   /* if *ip > maxSymbolValue, data is corrupted */
+        *statePtr = ZSTD_SEQTABLE_VALID;
+        return 1;
+    case bt_raw :
+        FSE_buildDTable_raw(DTable, rawBits);
+        *statePtr = ZSTD_SEQTABLE_VALID;
+        return 0;
+    case bt_ext :
+        return 0;
+    default :   /* bt_compressed */
+        {
+            S16 norm[MaxSeq+1];
+            U32 max = maxSymbolValue;
+            U32 tableLog;
+            const size_t headerSize = FSE_readNCount(norm, &max, &tableLog, ip, iend-ip);
+            if (FSE_isError(headerSize)) return ERROR(GENERIC);
+            if (tableLog > maxLog) return ERROR(corruption_detected);
+            *statePtr = ZSTD_SEQTABLE_NONE;
+            if (FSE_isError(FSE_buildDTable(DTable, norm, max, tableLog))) return ERROR(corruption_detected);
+            *statePtr = ZSTD_SEQTABLE_VALID;
+            return headerSize;
+        }
     }
 }
 
+/** ZSTD_buildSeqDTable_ext
+    selects the predefined distribution (built only once), or checks previous table can be repeated */
+static size_t ZSTD_buildSeqDTable_ext(FSE_DTable* DTable, U32* statePtr, U32 predefined,
+                                      const S16* defaultNorm, U32 maxSymbolValue, U32 defaultLog)
+{
+    if (predefined)
+    {
+        if (*statePtr == ZSTD_SEQTABLE_PREDEFINED) return 0;   /* already built */
+        FSE_buildDTable(DTable, defaultNorm, maxSymbolValue, defaultLog);
+        *statePtr = ZSTD_SEQTABLE_PREDEFINED;
+        return 0;
+    }
+    if (*statePtr == ZSTD_SEQTABLE_NONE) return ERROR(corruption_detected);   /* no table to repeat */
+    return 0;
+}
 
+/** ZSTD_decodeSeqHeaders
+    tableStates : LL, Off and ML tables states (ZSTD_SEQTABLE_*), updated.
+    DTables are kept across blocks, and only rebuilt when needed */
 size_t ZSTD_decodeSeqHeaders(int* nbSeq, const BYTE** dumpsPtr, size_t* dumpsLengthPtr,
-                         FSE_DTable* DTableLL, FSE_DTable* DTableML, FSE_DTable* DTableOffb,
+                         FSE_DTable* DTableLL, FSE_DTable* DTableML, FSE_DTable* DTableOffb, U32* tableStates,
                          const void* src, size_t srcSize)
 {
     const BYTE* const istart = (const BYTE* const)src;
     const BYTE* ip = istart;
     const BYTE* const iend = istart + srcSize;
     U32 LLtype, Offtype, MLtype;
-    U32 LLlog, Offlog, MLlog;
     size_t dumpsLength;
 
     /* check */
@@ -982,67 +2043,41 @@ size_t ZSTD_decodeSeqHeaders(int* nbSeq, const BYTE** dumpsPtr, size_t* dumpsLen
     /* check */
     if (ip > iend-3) return ERROR(srcSize_wrong); /* min : all 3 are "raw", hence no header, but at least xxLog bits per type */
 
-    /* sequences */
+    /* Build DTables */
     {
-        S16 norm[MaxML+1];    /* assumption : MaxML >= MaxLL and MaxOff */
-        size_t headerSize;
-
-        /* Build DTables */
-        switch(LLtype)
-        {
-        U32 max;
-        case bt_rle :
-            LLlog = 0;
-            FSE_buildDTable_rle(DTableLL, *ip++); break;
-        case bt_raw :
-            LLlog = LLbits;
-            FSE_buildDTable_raw(DTableLL, LLbits); break;
-        default :
-            max = MaxLL;
-            headerSize = FSE_readNCount(norm, &max, &LLlog, ip, iend-ip);
-            if (FSE_isError(headerSize)) return ERROR(GENERIC);
-            if (LLlog > LLFSELog) return ERROR(corruption_detected);
-            ip += headerSize;
-            FSE_buildDTable(DTableLL, norm, max, LLlog);
-        }
+        size_t hSize;
+        hSize = ZSTD_buildSeqDTable(DTableLL, tableStates+0, LLtype, MaxLL, LLbits, LLFSELog, ip, iend);
+        if (ZSTD_isError(hSize)) return hSize;
+        ip += hSize;
+        hSize = ZSTD_buildSeqDTable(DTableOffb, tableStates+1, Offtype, MaxOff, Offbits, OffFSELog, ip, iend);
+        if (ZSTD_isError(hSize)) return hSize;
+        ip += hSize;
+        hSize = ZSTD_buildSeqDTable(DTableML, tableStates+2, MLtype, MaxML, MLbits, MLFSELog, ip, iend);
+        if (ZSTD_isError(hSize)) return hSize;
+        ip += hSize;
+    }
 
-        switch(Offtype)
+    /* tables without header */
+    if ((LLtype==bt_ext) || (Offtype==bt_ext) || (MLtype==bt_ext))
+    {
+        U32 ext;
+        size_t errorCode;
+        if (ip > iend-2) return ERROR(srcSize_wrong);   /* ext byte, and at least 1 byte of bitstream */
+        ext = *ip++;
+        if (LLtype==bt_ext)
         {
-        U32 max;
-        case bt_rle :
-            Offlog = 0;
-            if (ip > iend-2) return ERROR(srcSize_wrong);   /* min : "raw", hence no header, but at least xxLog bits */
-            FSE_buildDTable_rle(DTableOffb, *ip++ & MaxOff); /* if *ip > MaxOff, data is corrupted */
-            break;
-        case bt_raw :
-            Offlog = Offbits;
-            FSE_buildDTable_raw(DTableOffb, Offbits); break;
-        default :
-            max = MaxOff;
-            headerSize = FSE_readNCount(norm, &max, &Offlog, ip, iend-ip);
-            if (FSE_isError(headerSize)) return ERROR(GENERIC);
-            if (Offlog > OffFSELog) return ERROR(corruption_detected);
-            ip += headerSize;
-            FSE_buildDTable(DTableOffb, norm, max, Offlog);
+            errorCode = ZSTD_buildSeqDTable_ext(DTableLL, tableStates+0, ext & EXT_PREDEFINED_LL, LL_defaultNorm, MaxLL, LL_DEFAULTNORMLOG);
+            if (ZSTD_isError(errorCode)) return errorCode;
         }
-
-        switch(MLtype)
+        if (Offtype==bt_ext)
         {
-        U32 max;
-        case bt_rle :
-            MLlog = 0;
-            if (ip > iend-2) return ERROR(srcSize_wrong); /* min : "raw", hence no header, but at least xxLog bits */
-            FSE_buildDTable_rle(DTableML, *ip++); break;
-        case bt_raw :
-            MLlog = MLbits;
-            FSE_buildDTable_raw(DTableML, MLbits); break;
-        default :
-            max = MaxML;
-            headerSize = FSE_readNCount(norm, &max, &MLlog, ip, iend-ip);
-            if (FSE_isError(headerSize)) return ERROR(GENERIC);
-            if (MLlog > MLFSELog) return ERROR(corruption_detected);
-            ip += headerSize;
-            FSE_buildDTable(DTableML, norm, max, MLlog);
+            errorCode = ZSTD_buildSeqDTable_ext(DTableOffb, tableStates+1, ext & EXT_PREDEFINED_OFF, OF_defaultNorm, MaxOff, OF_DEFAULTNORMLOG);
+            if (ZSTD_isError(errorCode)) return errorCode;
+        }
+        if (MLtype==bt_ext)
+        {
+            errorCode = ZSTD_buildSeqDTable_ext(DTableML, tableStates+2, ext & EXT_PREDEFINED_ML, ML_defaultNorm, MaxML, ML_DEFAULTNORMLOG);
+            if (ZSTD_isError(errorCode)) return errorCode;
         }
     }
 
@@ -1061,13 +2096,17 @@ typedef struct {
     FSE_DState_t stateLL;
     FSE_DState_t stateOffb;
     FSE_DState_t stateML;
+    size_t lastOffset;
     size_t prevOffset;
     const BYTE* dumps;
     const BYTE* dumpsEnd;
+#if ZSTD_STATS
+    ZSTD_stats* stats;
+#endif
 } seqState_t;
 
 
-static void ZSTD_decodeSequence(seq_t* seq, seqState_t* seqState)
+FORCE_INLINE void ZSTD_decodeSequence(seq_t* seq, seqState_t* seqState)
 {
     size_t litLength;
     size_t prevOffset;
@@ -1078,8 +2117,8 @@ static void ZSTD_decodeSequence(seq_t* seq, seqState_t* seqState)
 
     /* Literal length */
     litLength = FSE_decodeSymbol(&(seqState->stateLL), &(seqState->DStream));
-    prevOffset = litLength ? seq->offset : seqState->prevOffset;
-    seqState->prevOffset = seq->offset;
+    prevOffset = litLength ? seqState->lastOffset : seqState->prevOffset;
+    seqState->prevOffset = seqState->lastOffset;
     if (litLength == MaxLL)
     {
         U32 add = *dumps++;
@@ -1097,13 +2136,21 @@ static void ZSTD_decodeSequence(seq_t* seq, seqState_t* seqState)
         static const U32 offsetPrefix[MaxOff+1] = {
                 1 /*fake*/, 1, 2, 4, 8, 16, 32, 64, 128, 256,
                 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536, 131072, 262144,
-                524288, 1048576, 2097152, 4194304, 8388608, 16777216, 33554432, /*fake*/ 1, 1, 1, 1, 1 };
+                524288, 1048576, 2097152, 4194304, 8388608, 16777216, 33554432,
+                67108864, 134217728, 268435456, 536870912, 1073741824 };   /* long distance offsets */
         U32 offsetCode, nbBits;
         offsetCode = FSE_decodeSymbol(&(seqState->stateOffb), &(seqState->DStream));   /* <= maxOff, by table construction */
         if (MEM_32bits()) BIT_reloadDStream(&(seqState->DStream));
         nbBits = offsetCode - 1;
         if (offsetCode==0) nbBits = 0;   /* cmove */
-        offset = offsetPrefix[offsetCode] + BIT_readBits(&(seqState->DStream), nbBits);
+        offset = offsetPrefix[offsetCode];
+        if (nbBits > LongOffBits)   /* high bits first */
+        {
+            offset += BIT_readBits(&(seqState->DStream), nbBits - LongOffBits) << LongOffBits;
+            BIT_reloadDStream(&(seqState->DStream));
+            nbBits = LongOffBits;
+        }
+        offset += BIT_readBits(&(seqState->DStream), nbBits);
         if (MEM_32bits()) BIT_reloadDStream(&(seqState->DStream));
         if (offsetCode==0) offset = prevOffset;   /* cmove */
     }
@@ -1122,19 +2169,22 @@ static void ZSTD_decodeSequence(seq_t* seq, seqState_t* seqState)
         if (dumps >= de) dumps = de-1;   /* late correction, to avoid read overflow (data is now corrupted anyway) */
     }
     matchLength += MINMATCH;
+    ZSTD_STATS_ADD(seqState->stats->matchLengthHistogram[ZSTD_highbit((U32)matchLength)], 1);
 
     /* save result */
     seq->litLength = litLength;
     seq->offset = offset;
     seq->matchLength = matchLength;
+    seqState->lastOffset = offset;
     seqState->dumps = dumps;
 }
 
 
-static size_t ZSTD_execSequence(BYTE* op,
+FORCE_INLINE size_t ZSTD_execSequence(BYTE* op,
                                 seq_t sequence,
                                 const BYTE** litPtr, const BYTE* const litLimit_8,
-                                BYTE* const base, BYTE* const oend)
+                                const BYTE* const base, const BYTE* const vBase, const BYTE* const dictEnd,
+                                BYTE* const oend)
 {
     static const int dec32table[] = {0, 1, 2, 1, 4, 4, 4, 4};   /* added */
     static const int dec64table[] = {8, 8, 8, 7, 8, 9,10,11};   /* substracted */
@@ -1150,7 +2200,7 @@ static size_t ZSTD_execSequence(BYTE* op,
     if (litEnd > litLimit_8) return ERROR(corruption_detected);   /* risk read beyond lit buffer */
 
     /* copy Literals */
-    ZSTD_wildcopy(op, *litPtr, sequence.litLength);   /* note : oLitEnd <= oend-8 : no risk of overwrite beyond oend */
+    ZSTD_wildcopy16(op, *litPtr, sequence.litLength);   /* note : oLitEnd <= oend-8 : no risk of overwrite beyond oend */
     op = oLitEnd;
     *litPtr = litEnd;   /* update for next sequence */
 
@@ -1161,7 +2211,30 @@ static size_t ZSTD_execSequence(BYTE* op,
         /* check */
         //if (match > op) return ERROR(corruption_detected);   /* address space overflow test (is clang optimizer removing this test ?) */
         if (sequence.offset > (size_t)op) return ERROR(corruption_detected);   /* address space overflow test (this test seems kept by clang optimizer) */
-        if (match < base) return ERROR(corruption_detected);
+        if (sequence.offset > (size_t)(op - base))
+        {
+            /* offset beyond prefix : match starts into dictionary */
+            if (sequence.offset > (size_t)(op - vBase)) return ERROR(corruption_detected);
+            match = dictEnd - (base - match);
+            if (match + sequence.matchLength <= dictEnd)
+            {
+                memmove(op, match, sequence.matchLength);
+                return oMatchEnd - ostart;
+            }
+            /* match spans dictionary & current prefix segment */
+            {
+                const size_t length1 = dictEnd - match;
+                memmove(op, match, length1);
+                op += length1;
+                sequence.matchLength -= length1;
+                match = base;
+                if (op > oend_8)   /* no room left for fast copy */
+                {
+                    while (op < oMatchEnd) *op++ = *match++;
+                    return oMatchEnd - ostart;
+                }
+            }
+        }
 
         /* close range match, overlap */
         if (sequence.offset < 8)
@@ -1193,13 +2266,46 @@ static size_t ZSTD_execSequence(BYTE* op,
         }
         else
         {
-            ZSTD_wildcopy(op, match, sequence.matchLength-8);   /* works even if matchLength < 8 */
+            if (sequence.offset >= 16)
+                ZSTD_wildcopy16(op, match, sequence.matchLength-8);   /* no overlap within a 16-bytes step */
+            else
+                ZSTD_wildcopy(op, match, sequence.matchLength-8);   /* works even if matchLength < 8 */
         }
     }
 
     return oMatchEnd - ostart;
 }
 
+#define ZSTD_SEQ_AHEAD 4              /* nb of sequences decoded in advance; power of 2 */
+#define ZSTD_FAR_OFFSET_CODE 23        /* offsets >= 4 MB : likely beyond cache */
+#define ZSTD_FAR_OFFSET_SHARE_MIN 16   /* in 1/256th of offset codes : minimum share to prefetch matches in advance */
+
+/** ZSTD_farOffsetShare
+    @return : share of far offset codes within offset decoding table, in 1/256th */
+static U32 ZSTD_farOffsetShare(const FSE_DTable* DTableOffb)
+{
+    const U32 tableLog = ((const FSE_DTableHeader*)DTableOffb)->tableLog;
+    const FSE_decode_t* const table = (const FSE_decode_t*)(DTableOffb+1);
+    const U32 tableSize = 1 << tableLog;
+    U32 i, far = 0;
+    for (i=0; i<tableSize; i++)
+        far += (table[i].symbol >= ZSTD_FAR_OFFSET_CODE);
+    return (far << 8) >> tableLog;
+}
+
+/** ZSTD_prefetchMatch
+    pos : position of sequence within current segment, relative to base
+    @return : position of next sequence */
+static size_t ZSTD_prefetchMatch(size_t pos, seq_t sequence, const BYTE* const base, const BYTE* const dictEnd)
+{
+    const size_t litEndPos = pos + sequence.litLength;
+    const BYTE* const match = (sequence.offset <= litEndPos) ? base + (litEndPos - sequence.offset)
+                                                             : dictEnd - (sequence.offset - litEndPos);   /* match starts into dictionary */
+    ZSTD_PREFETCH(match);
+    ZSTD_PREFETCH(match + 63);   /* matches rarely start on a cache line boundary */
+    return litEndPos + sequence.matchLength;
+}
+
 static size_t ZSTD_decompressSequences(
                                void* ctx,
                                void* dst, size_t maxDstSize,
@@ -1220,39 +2326,90 @@ static size_t ZSTD_decompressSequences(
     U32* DTableLL = dctx->LLTable;
     U32* DTableML = dctx->MLTable;
     U32* DTableOffb = dctx->OffTable;
-    BYTE* const base = (BYTE*) (dctx->base);
+    const BYTE* const base = (const BYTE*) (dctx->base);
+    const BYTE* const vBase = (const BYTE*) (dctx->vBase);
+    const BYTE* const dictEnd = (const BYTE*) (dctx->dictEnd);
+    ZSTD_STATS_TICK(tick)
 
     /* Build Decoding Tables */
     errorCode = ZSTD_decodeSeqHeaders(&nbSeq, &dumps, &dumpsLength,
-                                      DTableLL, DTableML, DTableOffb,
+                                      DTableLL, DTableML, DTableOffb, dctx->seqTableStates,
                                       ip, iend-ip);
     if (ZSTD_isError(errorCode)) return errorCode;
     ip += errorCode;
+    ZSTD_STATS_CYCLES(dctx->stats, ZSTD_stage_decodeSeqHeaders, tick);
+    ZSTD_STATS_ADD(dctx->stats.nbSequences, nbSeq);
 
     /* Regen sequences */
     {
-        seq_t sequence;
         seqState_t seqState;
 
-        memset(&sequence, 0, sizeof(sequence));
-        sequence.offset = 4;
         seqState.dumps = dumps;
         seqState.dumpsEnd = dumps + dumpsLength;
-        seqState.prevOffset = 4;
+        seqState.lastOffset = dctx->legacyVersion ? 0 : 4;   /* v0.2 : repcodes start at 0 and 1 */
+        seqState.prevOffset = dctx->legacyVersion ? 1 : 4;
+#if ZSTD_STATS
+        seqState.stats = &dctx->stats;
+#endif
         errorCode = BIT_initDStream(&(seqState.DStream), ip, iend-ip);
         if (ERR_isError(errorCode)) return ERROR(corruption_detected);
         FSE_initDState(&(seqState.stateLL), &(seqState.DStream), DTableLL);
         FSE_initDState(&(seqState.stateOffb), &(seqState.DStream), DTableOffb);
         FSE_initDState(&(seqState.stateML), &(seqState.DStream), DTableML);
 
-        for ( ; (BIT_reloadDStream(&(seqState.DStream)) <= BIT_DStream_completed) && (nbSeq>0) ; )
+        if (ZSTD_farOffsetShare(DTableOffb) < ZSTD_FAR_OFFSET_SHARE_MIN)
+        {
+            for ( ; (BIT_reloadDStream(&(seqState.DStream)) <= BIT_DStream_completed) && (nbSeq>0) ; )
+            {
+                seq_t sequence;
+                size_t oneSeqSize;
+                nbSeq--;
+                ZSTD_decodeSequence(&sequence, &seqState);
+                oneSeqSize = ZSTD_execSequence(op, sequence, &litPtr, litLimit_8, base, vBase, dictEnd, oend);
+                if (ZSTD_isError(oneSeqSize)) return oneSeqSize;
+                op += oneSeqSize;
+            }
+        }
+        else
         {
-            size_t oneSeqSize;
-            nbSeq--;
-            ZSTD_decodeSequence(&sequence, &seqState);
-            oneSeqSize = ZSTD_execSequence(op, sequence, &litPtr, litLimit_8, base, oend);
-            if (ZSTD_isError(oneSeqSize)) return oneSeqSize;
-            op += oneSeqSize;
+            /* far matches are likely cache misses : sequences are decoded ZSTD_SEQ_AHEAD in advance of their execution,
+               so that their match can be prefetched, and their decoding overlaps previous copies */
+            seq_t sequences[ZSTD_SEQ_AHEAD];
+            size_t prefetchPos = op - base;
+            int seqNb;
+            const int seqAdvance = MIN(nbSeq, ZSTD_SEQ_AHEAD);
+
+            /* prepare in advance */
+            for (seqNb=0 ; (BIT_reloadDStream(&(seqState.DStream)) <= BIT_DStream_completed) && (seqNb<seqAdvance) ; seqNb++)
+            {
+                ZSTD_decodeSequence(sequences+seqNb, &seqState);
+                prefetchPos = ZSTD_prefetchMatch(prefetchPos, sequences[seqNb], base, dictEnd);
+            }
+
+            /* decode and execute */
+            for ( ; (BIT_reloadDStream(&(seqState.DStream)) <= BIT_DStream_completed) && (seqNb<nbSeq) ; seqNb++)
+            {
+                seq_t* const slot = sequences + (seqNb & (ZSTD_SEQ_AHEAD-1));
+                const seq_t toExecute = *slot;   /* decoded ZSTD_SEQ_AHEAD sequences ago */
+                size_t oneSeqSize;
+                ZSTD_decodeSequence(slot, &seqState);
+                prefetchPos = ZSTD_prefetchMatch(prefetchPos, *slot, base, dictEnd);
+                oneSeqSize = ZSTD_execSequence(op, toExecute, &litPtr, litLimit_8, base, vBase, dictEnd, oend);
+                if (ZSTD_isError(oneSeqSize)) return oneSeqSize;
+                op += oneSeqSize;
+            }
+
+            /* last decoded sequences */
+            {
+                int n;
+                for (n = seqNb - MIN(seqNb, seqAdvance); n < seqNb; n++)
+                {
+                    const size_t oneSeqSize = ZSTD_execSequence(op, sequences[n & (ZSTD_SEQ_AHEAD-1)], &litPtr, litLimit_8, base, vBase, dictEnd, oend);
+                    if (ZSTD_isError(oneSeqSize)) return oneSeqSize;
+                    op += oneSeqSize;
+                }
+            }
+            nbSeq -= seqNb;
         }
 
         /* check if reached exact end */
@@ -1269,6 +2426,7 @@ static size_t ZSTD_decompressSequences(
         }
     }
 
+    ZSTD_STATS_CYCLES(dctx->stats, ZSTD_stage_decodeSequences, tick);
     return op-ostart;
 }
 
@@ -1280,18 +2438,103 @@ static size_t ZSTD_decompressBlock(
 {
     /* blockType == blockCompressed */
     const BYTE* ip = (const BYTE*)src;
+    size_t litCSize;
+    ZSTD_STATS_TICK(tick)
+    if (srcSize > ZSTD_BLOCKSIZE_MAX) return ERROR(corruption_detected);   /* a compressed block is always smaller than its content */
 
     /* Decode literals sub-block */
-    size_t litCSize = ZSTD_decodeLiteralsBlock(ctx, src, srcSize);
+    litCSize = ZSTD_decodeLiteralsBlock(ctx, src, srcSize);
     if (ZSTD_isError(litCSize)) return litCSize;
     ip += litCSize;
     srcSize -= litCSize;
+#if ZSTD_STATS
+    ((ZSTD_DCtx*)ctx)->stats.litBytes += ((ZSTD_DCtx*)ctx)->litSize;
+    ZSTD_STATS_CYCLES(((ZSTD_DCtx*)ctx)->stats, ZSTD_stage_decodeLiterals, tick);
+#endif
 
     return ZSTD_decompressSequences(ctx, dst, maxDstSize, ip, srcSize);
 }
 
 
-static size_t ZSTD_decompressDCtx(void* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+/** ZSTD_frameHeaderSize_fromDescriptor
+    @return : size of an extended frame header, given its frame descriptor byte */
+static size_t ZSTD_frameHeaderSize_fromDescriptor(BYTE frameDescriptor)
+{
+    return ZSTD_frameHeaderSize + 1
+         + ((frameDescriptor & ZSTD_frameDescriptor_window) ? 1 : 0)
+         + ZSTD_contentSizeFieldSize[frameDescriptor & ZSTD_frameDescriptor_contentSize];
+}
+
+size_t ZSTD_getFrameParams(ZSTD_frameParams* fparams, const void* src, size_t srcSize)
+{
+    const BYTE* ip = (const BYTE*)src;
+    U32 magicNumber;
+    BYTE frameDescriptor;
+    size_t headerSize;
+
+    if (srcSize < ZSTD_frameHeaderSize) return ZSTD_frameHeaderSize;
+    magicNumber = MEM_readLE32(src);
+    fparams->contentSize = ZSTD_CONTENTSIZE_UNKNOWN;
+    fparams->windowLog = 0;
+    fparams->checksumFlag = 0;
+    if (magicNumber == ZSTD_magicNumber) return 0;   /* regular frame : nothing recorded */
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+    if (ZSTD_isLegacy(magicNumber)) return 0;   /* legacy frames record nothing either */
+#endif
+    if (magicNumber != ZSTD_magicNumberExt) return ERROR(prefix_unknown);
+
+    if (srcSize < ZSTD_frameHeaderSize+1) return ZSTD_frameHeaderSize+1;
+    frameDescriptor = ip[ZSTD_frameHeaderSize];
+    if (frameDescriptor & ZSTD_frameDescriptor_reserved) return ERROR(frameParameter_unsupported);
+    headerSize = ZSTD_frameHeaderSize_fromDescriptor(frameDescriptor);
+    if (srcSize < headerSize) return headerSize;
+    ip += ZSTD_frameHeaderSize+1;
+
+    fparams->checksumFlag = (frameDescriptor & ZSTD_frameDescriptor_checksum) != 0;
+    if (frameDescriptor & ZSTD_frameDescriptor_window)
+    {
+        fparams->windowLog = *ip++;
+        if ((fparams->windowLog < ZSTD_WINDOWLOG_ABSOLUTEMIN) || (fparams->windowLog > ZSTD_WINDOWLOG_ABSOLUTEMAX))
+            return ERROR(frameParameter_unsupported);
+    }
+    switch(frameDescriptor & ZSTD_frameDescriptor_contentSize)
+    {
+    default:   /* impossible */
+    case 0 : break;
+    case 1 : fparams->contentSize = MEM_readLE16(ip); break;
+    case 2 : fparams->contentSize = MEM_readLE32(ip); break;
+    case 3 : fparams->contentSize = MEM_readLE64(ip); break;
+    }
+    return 0;
+}
+
+/** ZSTD_startFrame
+    prepare ctx to decode content of a frame described by ctx->fParams */
+static void ZSTD_startFrame(ZSTD_DCtx* ctx)
+{
+    ctx->frameDecodedSize = 0;
+    ctx->litEntropy = 0;   /* tables are only repeated within a frame */
+    ctx->seqTableStates[0] = ctx->seqTableStates[1] = ctx->seqTableStates[2] = ZSTD_SEQTABLE_NONE;
+    if (ctx->fParams.checksumFlag) XXH64_reset(&ctx->checksumState, 0);
+}
+
+static size_t ZSTD_checkFrameContentSize(const ZSTD_DCtx* ctx)
+{
+    if ((ctx->fParams.contentSize != ZSTD_CONTENTSIZE_UNKNOWN) && (ctx->frameDecodedSize != ctx->fParams.contentSize))
+        return ERROR(corruption_detected);
+    return 0;
+}
+
+static size_t ZSTD_checkFrameChecksum(ZSTD_DCtx* ctx, const void* src)
+{
+    if (MEM_readLE64(src) != XXH64_digest(&ctx->checksumState)) return ERROR(checksum_wrong);
+    return 0;
+}
+
+/** ZSTD_decompressFrame
+    decode the frame at the beginning of src; src may contain more data after it.
+    *frameSizePtr receives the compressed size of the frame (for v0.1 frames : all of srcSize) */
+static size_t ZSTD_decompressFrame(ZSTD_DCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize, size_t* frameSizePtr)
 {
     const BYTE* ip = (const BYTE*)src;
     const BYTE* iend = ip + srcSize;
@@ -1305,12 +2548,26 @@ static size_t ZSTD_decompressDCtx(void* ctx, void* dst, size_t maxDstSize, const
     /* Frame Header */
     if (srcSize < ZSTD_frameHeaderSize+ZSTD_blockHeaderSize) return ERROR(srcSize_wrong);
     magicNumber = MEM_readLE32(src);
+    ctx->legacyVersion = 0;
 #if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
-    if (ZSTD_isLegacy(magicNumber))
+    ctx->legacyVersion = ZSTD_isLegacy(magicNumber);
+    if (ctx->legacyVersion == 1)
+    {
+        *frameSizePtr = srcSize;   /* v0.1 frames extend to the end of src */
         return ZSTD_decompressLegacy(dst, maxDstSize, src, srcSize, magicNumber);
+    }
 #endif
-    if (magicNumber != ZSTD_magicNumber) return ERROR(prefix_unknown);
-    ip += ZSTD_frameHeaderSize; remainingSize -= ZSTD_frameHeaderSize;
+    {
+        size_t headerSize = ZSTD_getFrameParams(&ctx->fParams, src, srcSize);
+        if (ZSTD_isError(headerSize)) return headerSize;
+        if (headerSize > 0) return ERROR(srcSize_wrong);
+        if ((ctx->fParams.contentSize != ZSTD_CONTENTSIZE_UNKNOWN) && (ctx->fParams.contentSize > maxDstSize))
+            return ERROR(dstSize_tooSmall);   /* fail early, before decoding anything */
+        headerSize = (magicNumber == ZSTD_magicNumberExt) ? ZSTD_frameHeaderSize_fromDescriptor(ip[ZSTD_frameHeaderSize]) : ZSTD_frameHeaderSize;
+        ip += headerSize; remainingSize -= headerSize;
+        if (remainingSize < ZSTD_blockHeaderSize) return ERROR(srcSize_wrong);
+    }
+    ZSTD_startFrame(ctx);
 
     /* Loop on each block */
     while (1)
@@ -1322,6 +2579,7 @@ static size_t ZSTD_decompressDCtx(void* ctx, void* dst, size_t maxDstSize, const
         ip += ZSTD_blockHeaderSize;
         remainingSize -= ZSTD_blockHeaderSize;
         if (cBlockSize > remainingSize) return ERROR(srcSize_wrong);
+        ZSTD_STATS_BLOCK(ctx->stats, blockProperties.blockType);
 
         switch(blockProperties.blockType)
         {
@@ -1332,11 +2590,22 @@ static size_t ZSTD_decompressDCtx(void* ctx, void* dst, size_t maxDstSize, const
             decodedSize = ZSTD_copyUncompressedBlock(op, oend-op, ip, cBlockSize);
             break;
         case bt_rle :
-            return ERROR(GENERIC);   /* not yet supported */
+            decodedSize = ZSTD_generateRleBlock(op, oend-op, *ip, blockProperties.origSize);
             break;
         case bt_end :
             /* end of frame */
-            if (remainingSize) return ERROR(srcSize_wrong);
+            if (remainingSize < (ctx->fParams.checksumFlag ? ZSTD_frameChecksumSize : 0)) return ERROR(srcSize_wrong);
+            *frameSizePtr = (ip - (const BYTE*)src) + (ctx->fParams.checksumFlag ? ZSTD_frameChecksumSize : 0);
+            ctx->frameDecodedSize = op-ostart;
+            {
+                size_t errorCode = ZSTD_checkFrameContentSize(ctx);
+                if (ZSTD_isError(errorCode)) return errorCode;
+            }
+            if (ctx->fParams.checksumFlag)
+            {
+                size_t errorCode = ZSTD_checkFrameChecksum(ctx, ip);
+                if (ZSTD_isError(errorCode)) return errorCode;
+            }
             break;
         default:
             return ERROR(GENERIC);   /* impossible */
@@ -1344,6 +2613,7 @@ static size_t ZSTD_decompressDCtx(void* ctx, void* dst, size_t maxDstSize, const
         if (cBlockSize == 0) break;   /* bt_end */
 
         if (ZSTD_isError(decodedSize)) return decodedSize;
+        if (ctx->fParams.checksumFlag) XXH64_update(&ctx->checksumState, op, decodedSize);   /* while block is still in cache */
         op += decodedSize;
         ip += cBlockSize;
         remainingSize -= cBlockSize;
@@ -1352,14 +2622,278 @@ static size_t ZSTD_decompressDCtx(void* ctx, void* dst, size_t maxDstSize, const
     return op-ostart;
 }
 
+/** ZSTD_refDictContent
+    make dictionary [dictStart, dictEnd[ referenceable by a frame decoded into dst (dictStart==NULL : no dictionary) */
+static void ZSTD_refDictContent(ZSTD_DCtx* dctx, const char* dictStart, const char* dictEnd, void* dst)
+{
+    if (dictStart==NULL)
+    {
+        dctx->base = dctx->vBase = dctx->dictEnd = dst;
+        return;
+    }
+    if (dst == dictEnd)
+    {
+        /* dictionary is directly followed by dst : it's a regular prefix */
+        dctx->base = dictStart;
+        dctx->vBase = dctx->dictEnd = dictStart;
+    }
+    else
+    {
+        dctx->base = dst;
+        dctx->vBase = (const char*)dst - (dictEnd - dictStart);
+        dctx->dictEnd = dictEnd;
+    }
+}
+
+/** ZSTD_decompressMultiFrame
+    decode all frames of src, in order, into dst; skippable frames are jumped over.
+    Each frame is independent : only dictionary [dictStart, dictEnd[ (if dictStart != NULL) can be referenced */
+static size_t ZSTD_decompressMultiFrame(ZSTD_DCtx* dctx, const char* dictStart, const char* dictEnd,
+                                        void* dst, size_t maxDstSize,
+                                  const void* src, size_t srcSize)
+{
+    const BYTE* ip = (const BYTE*)src;
+    BYTE* const ostart = (BYTE*)dst;
+    BYTE* op = ostart;
+    BYTE* const oend = ostart + maxDstSize;
+
+    do
+    {
+        size_t frameSize = 0, decodedSize;
+        U32 magicNumber;
+        if (srcSize < ZSTD_frameHeaderSize) return ERROR(srcSize_wrong);
+        magicNumber = MEM_readLE32(ip);
+
+        if ((magicNumber & ZSTD_skippableMagicNumberMask) == ZSTD_skippableMagicNumberMin)
+        {
+            U32 contentSize;
+            if (srcSize < ZSTD_skippableHeaderSize) return ERROR(srcSize_wrong);
+            contentSize = MEM_readLE32(ip + ZSTD_frameHeaderSize);
+            if (contentSize > srcSize - ZSTD_skippableHeaderSize) return ERROR(srcSize_wrong);
+            frameSize = ZSTD_skippableHeaderSize + contentSize;
+            ip += frameSize;
+            srcSize -= frameSize;
+            continue;
+        }
+
+        ZSTD_refDictContent(dctx, dictStart, dictEnd, op);
+        decodedSize = ZSTD_decompressFrame(dctx, op, oend-op, ip, srcSize, &frameSize);
+        if (ZSTD_isError(decodedSize)) return decodedSize;
+        op += decodedSize;
+        ip += frameSize;
+        srcSize -= frameSize;
+    } while (srcSize);
+
+    return op-ostart;
+}
+
+size_t ZSTD_decompressDCtx(ZSTD_DCtx* dctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+{
+    return ZSTD_decompressMultiFrame(dctx, NULL, NULL, dst, maxDstSize, src, srcSize);
+}
+
 size_t ZSTD_decompress(void* dst, size_t maxDstSize, const void* src, size_t srcSize)
 {
     ZSTD_DCtx ctx;
-    ctx.base = dst;
+    ZSTD_resetDCtx(&ctx);
     return ZSTD_decompressDCtx(&ctx, dst, maxDstSize, src, srcSize);
 }
 
 
+/* ******************************
+*  Dictionary decompression
+********************************/
+size_t ZSTD_decompress_insertDictionary(ZSTD_DCtx* dctx, const void* dict, size_t dictSize)
+{
+    if (dctx->phase != 0) return ERROR(stage_wrong);   /* must be inserted at the beginning of a frame */
+    dctx->base = dict;
+    dctx->vBase = dict;
+    dctx->dictEnd = (const char*)dict + dictSize;
+    dctx->previousDstEnd = dctx->dictEnd;
+    return 0;
+}
+
+void ZSTD_copyDCtx(ZSTD_DCtx* dstDCtx, const ZSTD_DCtx* srcDCtx)
+{
+    const size_t staticSize = dstDCtx->staticSize;
+    const ZSTD_customMem customMem = dstDCtx->customMem;
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+    ZSTDv01_Dctx* const legacyContext = dstDCtx->legacyContext;
+#endif
+#if ZSTD_STATS
+    const ZSTD_stats stats = dstDCtx->stats;
+#endif
+    memcpy(dstDCtx, srcDCtx, sizeof(ZSTD_DCtx) - (BLOCKSIZE+8));   /* no need to copy workspace */
+    dstDCtx->staticSize = staticSize;   /* allocation properties of dstDCtx are preserved */
+    dstDCtx->customMem = customMem;
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+    dstDCtx->legacyContext = legacyContext;   /* owned by dstDCtx */
+#endif
+#if ZSTD_STATS
+    dstDCtx->stats = stats;             /* so are its counters */
+#endif
+}
+
+size_t ZSTD_decompress_usingPreparedDCtx(ZSTD_DCtx* dctx, const ZSTD_DCtx* preparedDCtx,
+                                         void* dst, size_t maxDstSize,
+                                   const void* src, size_t srcSize)
+{
+    /* dictionary is read first : preparedDCtx may be dctx itself */
+    const char* const dictStart = (const char*)preparedDCtx->base;
+    const char* const dictEnd = (const char*)preparedDCtx->dictEnd;
+    if (preparedDCtx->phase != 0) return ERROR(stage_wrong);
+    return ZSTD_decompressMultiFrame(dctx, dictStart, dictEnd, dst, maxDstSize, src, srcSize);
+}
+
+size_t ZSTD_decompress_usingDict(ZSTD_DCtx* dctx,
+                                 void* dst, size_t maxDstSize,
+                           const void* src, size_t srcSize,
+                           const void* dict, size_t dictSize)
+{
+    ZSTD_resetDCtx(dctx);
+    ZSTD_decompress_insertDictionary(dctx, dict, dictSize);
+    return ZSTD_decompress_usingPreparedDCtx(dctx, dctx, dst, maxDstSize, src, srcSize);
+}
+
+
+/* ******************************
+*  Digested dictionary : ZSTD_DDict
+********************************/
+struct ZSTD_DDict_s
+{
+    void* dictContent;
+    size_t dictContentSize;
+    ZSTD_DCtx* refContext;   /* dictionary inserted, at the beginning of a frame : read-only after creation */
+    ZSTD_customMem customMem;
+};
+
+ZSTD_DDict* ZSTD_createDDict_advanced(const void* dict, size_t dictSize, ZSTD_customMem customMem)
+{
+    ZSTD_DDict* ddict;
+    void* dictContent;
+    ZSTD_DCtx* dctx;
+
+    if (!customMem.customAlloc != !customMem.customFree) return NULL;
+    ddict = (ZSTD_DDict*)ZSTD_malloc(sizeof(ZSTD_DDict), customMem);
+    dictContent = ZSTD_malloc(dictSize+1, customMem);   /* +1 : malloc(0) may return NULL */
+    dctx = ZSTD_createDCtx_advanced(customMem);
+    if (!ddict || !dictContent || !dctx)
+    {
+        ZSTD_free(ddict, customMem); ZSTD_free(dictContent, customMem); ZSTD_freeDCtx(dctx);
+        return NULL;
+    }
+    memcpy(dictContent, dict, dictSize);
+    ZSTD_decompress_insertDictionary(dctx, dictContent, dictSize);   /* dctx was just reset : cannot fail */
+
+    ddict->dictContent = dictContent;
+    ddict->dictContentSize = dictSize;
+    ddict->refContext = dctx;
+    ddict->customMem = customMem;
+    return ddict;
+}
+
+ZSTD_DDict* ZSTD_createDDict(const void* dict, size_t dictSize)
+{
+    const ZSTD_customMem defaultMem = { NULL, NULL, NULL };
+    return ZSTD_createDDict_advanced(dict, dictSize, defaultMem);
+}
+
+size_t ZSTD_freeDDict(ZSTD_DDict* ddict)
+{
+    if (ddict==NULL) return 0;
+    ZSTD_freeDCtx(ddict->refContext);
+    ZSTD_free(ddict->dictContent, ddict->customMem);
+    ZSTD_free(ddict, ddict->customMem);
+    return 0;
+}
+
+size_t ZSTD_decompress_usingDDict(ZSTD_DCtx* dctx,
+                                  void* dst, size_t maxDstSize,
+                            const void* src, size_t srcSize,
+                            const ZSTD_DDict* ddict)
+{
+    return ZSTD_decompress_usingPreparedDCtx(dctx, ddict->refContext, dst, maxDstSize, src, srcSize);
+}
+
+
+/* ******************************
+*  Seekable source decompression
+********************************/
+size_t ZSTD_decompressRange(ZSTD_DCtx* dctx, void* dst, size_t maxDstSize,
+                      const void* src, size_t srcSize, unsigned long long rangeStart)
+{
+    const BYTE* const istart = (const BYTE*)src;
+    BYTE* const ostart = (BYTE*)dst;
+    BYTE* op = ostart;
+    BYTE* const oend = ostart + maxDstSize;
+    const BYTE* seekTable;
+    BYTE* tmpBuffer = NULL;
+    size_t tmpBufferSize = 0;
+    size_t result = 0;
+    U64 cPos = 0, dPos = 0;
+    U32 nbFrames, frameNb;
+
+    /* locate seek table, at end of src */
+    if (srcSize < ZSTD_skippableHeaderSize + ZSTD_seekTableFooterSize) return ERROR(prefix_unknown);
+    if (MEM_readLE32(istart + srcSize - 4) != ZSTD_seekTableMagicNumber) return ERROR(prefix_unknown);
+    nbFrames = MEM_readLE32(istart + srcSize - 8);
+    {
+        const U64 tableSize = (U64)nbFrames * ZSTD_seekTableEntrySize + ZSTD_seekTableFooterSize;
+        if (tableSize + ZSTD_skippableHeaderSize > srcSize) return ERROR(corruption_detected);
+        seekTable = istart + srcSize - tableSize;
+        if (MEM_readLE32(seekTable - 8) != ZSTD_skippableMagicNumber) return ERROR(corruption_detected);
+        if (MEM_readLE32(seekTable - 4) != tableSize) return ERROR(corruption_detected);
+        srcSize -= (size_t)tableSize + ZSTD_skippableHeaderSize;
+    }
+
+    /* decode only frames overlapping [rangeStart, rangeStart+maxDstSize[ */
+    for (frameNb=0; (frameNb<nbFrames) && (op<oend); frameNb++)
+    {
+        const size_t cSize = MEM_readLE32(seekTable + frameNb*ZSTD_seekTableEntrySize);
+        const size_t dSize = MEM_readLE32(seekTable + frameNb*ZSTD_seekTableEntrySize + 4);
+        if (cPos + cSize > srcSize) { result = ERROR(corruption_detected); break; }
+
+        if (dPos + dSize > rangeStart)
+        {
+            const size_t skipSize = (rangeStart > dPos) ? (size_t)(rangeStart - dPos) : 0;
+            size_t copySize = dSize - skipSize;
+            size_t decodedSize, frameSize = 0;
+            if (copySize > (size_t)(oend-op)) copySize = oend-op;
+
+            if ((skipSize==0) && (copySize==dSize))
+            {
+                /* whole frame requested : decode directly into dst */
+                dctx->base = dctx->vBase = dctx->dictEnd = op;
+                decodedSize = ZSTD_decompressFrame(dctx, op, oend-op, istart+cPos, cSize, &frameSize);
+            }
+            else
+            {
+                if (tmpBufferSize < dSize)
+                {
+                    ZSTD_free(tmpBuffer, dctx->customMem);
+                    tmpBuffer = (BYTE*)ZSTD_malloc(dSize, dctx->customMem);
+                    if (tmpBuffer==NULL) { result = ERROR(memory_allocation); break; }
+                    tmpBufferSize = dSize;
+                }
+                dctx->base = dctx->vBase = dctx->dictEnd = tmpBuffer;
+                decodedSize = ZSTD_decompressFrame(dctx, tmpBuffer, dSize, istart+cPos, cSize, &frameSize);
+                if (!ZSTD_isError(decodedSize)) memcpy(op, tmpBuffer+skipSize, copySize);
+            }
+            if (ZSTD_isError(decodedSize)) { result = decodedSize; break; }
+            if ((decodedSize != dSize) || (frameSize != cSize)) { result = ERROR(corruption_detected); break; }
+            op += copySize;
+        }
+
+        cPos += cSize;
+        dPos += dSize;
+    }
+
+    ZSTD_free(tmpBuffer, dctx->customMem);
+    if (ZSTD_isError(result)) return result;
+    return op-ostart;
+}
+
+
 /* ******************************
 *  Streaming Decompression API
 ********************************/
@@ -1370,21 +2904,88 @@ size_t ZSTD_resetDCtx(ZSTD_DCtx* dctx)
     dctx->phase = 0;
     dctx->previousDstEnd = NULL;
     dctx->base = NULL;
+    dctx->vBase = NULL;
+    dctx->dictEnd = NULL;
+    dctx->litEntropy = 0;
+    dctx->fParams.contentSize = ZSTD_CONTENTSIZE_UNKNOWN;
+    dctx->fParams.windowLog = 0;
+    dctx->fParams.checksumFlag = 0;
+    dctx->headerSize = 0;
+    dctx->legacyVersion = 0;
+    dctx->seqTableStates[0] = dctx->seqTableStates[1] = dctx->seqTableStates[2] = ZSTD_SEQTABLE_NONE;
     return 0;
 }
 
-ZSTD_DCtx* ZSTD_createDCtx(void)
+ZSTD_DCtx* ZSTD_createDCtx_advanced(ZSTD_customMem customMem)
 {
-    ZSTD_DCtx* dctx = (ZSTD_DCtx*)malloc(sizeof(ZSTD_DCtx));
+    ZSTD_DCtx* dctx;
+    if (!customMem.customAlloc != !customMem.customFree) return NULL;   /* both or none */
+    dctx = (ZSTD_DCtx*)ZSTD_malloc(sizeof(ZSTD_DCtx), customMem);
     if (dctx==NULL) return NULL;
+    dctx->staticSize = 0;
+    dctx->customMem = customMem;
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+    dctx->legacyContext = NULL;
+#endif
     ZSTD_resetDCtx(dctx);
+    ZSTD_resetDCtxStats(dctx);
     return dctx;
 }
 
+ZSTD_DCtx* ZSTD_createDCtx(void)
+{
+    const ZSTD_customMem defaultMem = { NULL, NULL, NULL };
+    return ZSTD_createDCtx_advanced(defaultMem);
+}
+
 size_t ZSTD_freeDCtx(ZSTD_DCtx* dctx)
 {
-    free(dctx);
+    if (dctx==NULL) return 0;
+    if (dctx->staticSize) return ERROR(memory_allocation);   /* not compatible with static DCtx */
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+    ZSTDv01_freeDCtx(dctx->legacyContext);
+#endif
+    ZSTD_free(dctx, dctx->customMem);
+    return 0;
+}
+
+size_t ZSTD_estimateDCtxSize(void) { return sizeof(ZSTD_DCtx); }
+
+ZSTD_DCtx* ZSTD_initStaticDCtx(void* workspace, size_t workspaceSize)
+{
+    ZSTD_DCtx* const dctx = (ZSTD_DCtx*)workspace;
+    if (workspaceSize < sizeof(ZSTD_DCtx)) return NULL;
+    if ((size_t)workspace & 7) return NULL;   /* 8-bytes aligned */
+    dctx->staticSize = workspaceSize;
+    memset(&dctx->customMem, 0, sizeof(dctx->customMem));
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+    dctx->legacyContext = NULL;   /* v0.1 frames can't be streamed : no allocation allowed */
+#endif
+    ZSTD_resetDCtx(dctx);
+    ZSTD_resetDCtxStats(dctx);
+    return dctx;
+}
+
+size_t ZSTD_getDCtxStats(const ZSTD_DCtx* dctx, ZSTD_stats* stats)
+{
+#if ZSTD_STATS
+    *stats = dctx->stats;
+    return 0;
+#else
+    (void)dctx; (void)stats;
+    return ERROR(stats_unsupported);
+#endif
+}
+
+size_t ZSTD_resetDCtxStats(ZSTD_DCtx* dctx)
+{
+#if ZSTD_STATS
+    memset(&dctx->stats, 0, sizeof(dctx->stats));
     return 0;
+#else
+    (void)dctx;
+    return ERROR(stats_unsupported);
+#endif
 }
 
 size_t ZSTD_nextSrcSizeToDecompress(ZSTD_DCtx* dctx)
@@ -1392,24 +2993,129 @@ size_t ZSTD_nextSrcSizeToDecompress(ZSTD_DCtx* dctx)
     return dctx->expected;
 }
 
+U32 ZSTD_getLegacyVersion(const ZSTD_DCtx* dctx)
+{
+    return dctx->legacyVersion;
+}
+
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+/** ZSTD_startLegacyFrame
+    v0.1 frames are decoded by zstd_v01.c, block by block ; src is the frame magic number.
+    Its history restarts whenever dst is not contiguous : callers wrap their buffer only at 4-blocks boundaries, like v0.1 compressor */
+static size_t ZSTD_startLegacyFrame(ZSTD_DCtx* ctx, const void* src, size_t srcSize)
+{
+    size_t errorCode;
+    if (ctx->legacyContext == NULL)
+    {
+        if (ctx->staticSize) return ERROR(memory_allocation);
+        ctx->legacyContext = ZSTDv01_createDCtx();
+        if (ctx->legacyContext == NULL) return ERROR(memory_allocation);
+    }
+    ZSTDv01_resetDCtx(ctx->legacyContext);
+    errorCode = ZSTDv01_decompressContinue(ctx->legacyContext, NULL, 0, src, srcSize);
+    if (ZSTDv01_isError(errorCode)) return ERROR(prefix_unknown);
+    ctx->phase = 8;
+    ctx->expected = ZSTDv01_nextSrcSizeToDecompress(ctx->legacyContext);
+    return 0;
+}
+#endif
+
 size_t ZSTD_decompressContinue(ZSTD_DCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
 {
     /* Sanity check */
     if (srcSize != ctx->expected) return ERROR(srcSize_wrong);
-    if (dst != ctx->previousDstEnd)  /* not contiguous */
-        ctx->base = dst;
 
     /* Decompress : frame header */
     if (ctx->phase == 0)
     {
         /* Check frame magic header */
         U32 magicNumber = MEM_readLE32(src);
+        memcpy(ctx->headerBuffer, src, ZSTD_frameHeaderSize);
+        ctx->headerSize = ZSTD_frameHeaderSize;
+        if (magicNumber == ZSTD_magicNumberExt)
+        {
+            ctx->phase = 3;
+            ctx->expected = 1;
+            return 0;
+        }
+        if ((magicNumber & ZSTD_skippableMagicNumberMask) == ZSTD_skippableMagicNumberMin)
+        {
+            ctx->phase = 6;
+            ctx->expected = ZSTD_skippableHeaderSize - ZSTD_frameHeaderSize;
+            return 0;
+        }
+        ctx->legacyVersion = 0;
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+        ctx->legacyVersion = ZSTD_isLegacy(magicNumber);
+        if (ctx->legacyVersion == 1) return ZSTD_startLegacyFrame(ctx, src, srcSize);
+        if (ctx->legacyVersion == 2) magicNumber = ZSTD_magicNumber;   /* same blocks, with v0.2 repcodes */
+#endif
         if (magicNumber != ZSTD_magicNumber) return ERROR(prefix_unknown);
+        ZSTD_getFrameParams(&ctx->fParams, src, srcSize);
+        ZSTD_startFrame(ctx);
+        ctx->phase = 1;
+        ctx->expected = ZSTD_blockHeaderSize;
+        return 0;
+    }
+
+    /* Decompress : frame descriptor, then optional frame parameters */
+    if ((ctx->phase == 3) || (ctx->phase == 5))
+    {
+        size_t result;
+        memcpy(ctx->headerBuffer + ctx->headerSize, src, srcSize);
+        ctx->headerSize += srcSize;
+        result = ZSTD_getFrameParams(&ctx->fParams, ctx->headerBuffer, ctx->headerSize);
+        if (ZSTD_isError(result)) return result;
+        if (result > 0)   /* need the rest of the header */
+        {
+            ctx->phase = 5;
+            ctx->expected = result - ctx->headerSize;
+            return 0;
+        }
+        ZSTD_startFrame(ctx);
         ctx->phase = 1;
         ctx->expected = ZSTD_blockHeaderSize;
         return 0;
     }
 
+    /* Skippable frame : content size, then content, which is ignored */
+    if (ctx->phase == 6)
+    {
+        ctx->expected = MEM_readLE32(src);
+        ctx->phase = ctx->expected ? 7 : 0;
+        return 0;
+    }
+    if (ctx->phase == 7)
+    {
+        ctx->expected = 0;
+        ctx->phase = 0;
+        return 0;
+    }
+
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+    /* v0.1 frame : block headers and contents, up to end mark */
+    if (ctx->phase == 8)
+    {
+        const size_t dstSize = MIN(maxDstSize, ZSTD_BLOCKSIZE_MAX);   /* v0.1 decodes literals at the end of dst : keep them within current block */
+        const size_t rSize = ZSTDv01_decompressContinue(ctx->legacyContext, dst, dstSize, src, srcSize);
+        if (ZSTDv01_isError(rSize)) return ERROR(corruption_detected);
+        ctx->expected = ZSTDv01_nextSrcSizeToDecompress(ctx->legacyContext);
+        if (ctx->expected == 0) ctx->phase = 0;
+        ctx->previousDstEnd = (const char*)dst + rSize;
+        return rSize;
+    }
+#endif
+
+    /* Decompress : content checksum, after end mark */
+    if (ctx->phase == 4)
+    {
+        size_t errorCode = ZSTD_checkFrameChecksum(ctx, src);
+        if (ZSTD_isError(errorCode)) return errorCode;
+        ctx->expected = 0;
+        ctx->phase = 0;
+        return 0;
+    }
+
     /* Decompress : block header */
     if (ctx->phase == 1)
     {
@@ -1418,13 +3124,16 @@ size_t ZSTD_decompressContinue(ZSTD_DCtx* ctx, void* dst, size_t maxDstSize, con
         if (ZSTD_isError(blockSize)) return blockSize;
         if (bp.blockType == bt_end)
         {
-            ctx->expected = 0;
-            ctx->phase = 0;
+            size_t errorCode = ZSTD_checkFrameContentSize(ctx);
+            if (ZSTD_isError(errorCode)) return errorCode;
+            ctx->expected = ctx->fParams.checksumFlag ? ZSTD_frameChecksumSize : 0;
+            ctx->phase = ctx->fParams.checksumFlag ? 4 : 0;
         }
         else
         {
             ctx->expected = blockSize;
             ctx->bType = bp.blockType;
+            ctx->rleSize = bp.origSize;
             ctx->phase = 2;
         }
 
@@ -1432,8 +3141,16 @@ size_t ZSTD_decompressContinue(ZSTD_DCtx* ctx, void* dst, size_t maxDstSize, con
     }
 
     /* Decompress : block content */
+    if (dst != ctx->previousDstEnd)   /* not contiguous */
+    {
+        /* previous segment (prefix or inserted dictionary) can still be referenced */
+        ctx->dictEnd = ctx->previousDstEnd;
+        ctx->vBase = (const char*)dst - ((const char*)(ctx->previousDstEnd) - (const char*)(ctx->base));
+        ctx->base = dst;
+    }
     {
         size_t rSize;
+        ZSTD_STATS_BLOCK(ctx->stats, ctx->bType);
         switch(ctx->bType)
         {
         case bt_compressed:
@@ -1443,7 +3160,7 @@ size_t ZSTD_decompressContinue(ZSTD_DCtx* ctx, void* dst, size_t maxDstSize, con
             rSize = ZSTD_copyUncompressedBlock(dst, maxDstSize, src, srcSize);
             break;
         case bt_rle :
-            return ERROR(GENERIC);   /* not yet handled */
+            rSize = ZSTD_generateRleBlock(dst, maxDstSize, *(const BYTE*)src, ctx->rleSize);
             break;
         case bt_end :   /* should never happen (filtered at phase 1) */
             rSize = 0;
@@ -1451,6 +3168,9 @@ size_t ZSTD_decompressContinue(ZSTD_DCtx* ctx, void* dst, size_t maxDstSize, con
         default:
             return ERROR(GENERIC);
         }
+        if (ZSTD_isError(rSize)) return rSize;
+        if (ctx->fParams.checksumFlag) XXH64_update(&ctx->checksumState, dst, rSize);
+        ctx->frameDecodedSize += rSize;
         ctx->phase = 1;
         ctx->expected = ZSTD_blockHeaderSize;
         ctx->previousDstEnd = (void*)( ((char*)dst) + rSize);
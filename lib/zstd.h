@@ -71,7 +71,8 @@ ZSTD_compress() :
              or an error code if it fails (which can be tested using ZSTD_isError())
 
 ZSTD_decompress() :
-    compressedSize : is the exact source size
+    compressedSize : is the exact source size. It may hold several concatenated frames : they are decoded in order.
+                     Skippable frames (see "zstd_static.h") are ignored.
     maxOriginalSize : is the size of the 'dst' buffer, which must be already allocated.
                       It must be equal or larger than originalSize, otherwise decompression will fail.
     return : the number of bytes decompressed into destination buffer (<= maxOriginalSize)
@@ -102,6 +103,32 @@ ZSTD_compressCCtx() :
 */
 size_t ZSTD_compressCCtx(ZSTD_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize);
 
+/**
+ZSTD_compress_usingDict() :
+    Same as ZSTD_compressCCtx(), using a dictionary : content which is presumed similar to 'src'.
+    Matches can reference dictionary content, which improves compression of small inputs.
+    Decompression requires the same dictionary (see ZSTD_decompress_usingDict()).
+    Note : only the last 512 KB of dictionary can be referenced.
+*/
+size_t ZSTD_compress_usingDict(ZSTD_CCtx* ctx,
+                               void* dst, size_t maxDstSize,
+                         const void* src, size_t srcSize,
+                         const void* dict,size_t dictSize);
+
+typedef struct ZSTD_DCtx_s ZSTD_DCtx;   /* incomplete type */
+ZSTD_DCtx* ZSTD_createDCtx(void);
+size_t     ZSTD_freeDCtx(ZSTD_DCtx* dctx);
+
+/**
+ZSTD_decompress_usingDict() :
+    Regenerates a frame compressed using dictionary 'dict' (see ZSTD_compress_usingDict(), ZSTD_HC_compress_usingDict()).
+    Dictionary must be identical to the one used during compression.
+*/
+size_t ZSTD_decompress_usingDict(ZSTD_DCtx* dctx,
+                                 void* dst, size_t maxDstSize,
+                           const void* src, size_t srcSize,
+                           const void* dict,size_t dictSize);
+
 
 #if defined (__cplusplus)
 }
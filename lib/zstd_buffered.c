@@ -0,0 +1,503 @@
+/*
+    zstd_buffered - buffered streaming interface for zstd
+    Copyright (C) 2015, Yann Collet.
+
+    BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+    You can contact the author at :
+    - zstd source repository : https://github.com/Cyan4973/zstd
+    - ztsd public forum : https://groups.google.com/forum/#!forum/lz4c
+*/
+
+/* *************************************
+*  Includes
+***************************************/
+#include <string.h>   /* memcpy */
+#include "mem.h"
+#include "error.h"
+#include "zstd_static.h"
+#include "zstdhc_static.h"
+#include "zstd_internal.h"   /* ZSTD_malloc, ZSTD_free */
+#include "zstd_buffered.h"
+
+
+/* *************************************
+*  Constants
+***************************************/
+#define ZBUFF_BLOCKSIZE  ZSTD_BLOCKSIZE_MAX
+#define ZBUFF_INBUFFSIZE ZBUFF_WINDOWSIZE   /* a whole nb of blocks */
+#define ZBUFF_ENDMARKSIZE 3
+
+
+/* *************************************
+*  Streaming compression
+***************************************/
+typedef enum { ZBUFFcs_init, ZBUFFcs_load, ZBUFFcs_flush, ZBUFFcs_final } ZBUFF_cStage;
+
+struct ZBUFF_CCtx_s
+{
+    ZSTD_CCtx* zc;          /* fast engine, created on first use */
+    ZSTD_HC_CCtx* hc;       /* HC engine, created on first use */
+    U32 useHC;
+    U32 checksumFlag;       /* applied to engine at next ZBUFF_compressInit() */
+    U64 pledgedSrcSizePlusOne;   /* 0 : unknown; only for next ZBUFF_compressInit() */
+    BYTE* inBuff;           /* ring buffer : current segment is history of next block */
+    size_t inToCompress;    /* start of data not compressed yet */
+    size_t inBuffPos;       /* end of buffered data */
+    size_t inBuffTarget;    /* end of current block */
+    BYTE* outBuff;          /* staging area, when dst is too small */
+    size_t outBuffSize;
+    size_t outBuffContentSize;
+    size_t outBuffFlushedSize;
+    ZBUFF_cStage stage;
+    ZSTD_customMem customMem;
+};   /* typedef'd to ZBUFF_CCtx within "zstd_buffered.h" */
+
+ZBUFF_CCtx* ZBUFF_createCCtx_advanced(ZSTD_customMem customMem)
+{
+    ZBUFF_CCtx* zbc;
+    if (!customMem.customAlloc != !customMem.customFree) return NULL;   /* both or none */
+    zbc = (ZBUFF_CCtx*)ZSTD_malloc(sizeof(ZBUFF_CCtx), customMem);
+    if (zbc==NULL) return NULL;
+    memset(zbc, 0, sizeof(ZBUFF_CCtx));
+    zbc->customMem = customMem;
+    zbc->outBuffSize = ZSTD_compressBound(ZBUFF_BLOCKSIZE);
+    zbc->inBuff  = (BYTE*)ZSTD_malloc(ZBUFF_INBUFFSIZE, customMem);
+    zbc->outBuff = (BYTE*)ZSTD_malloc(zbc->outBuffSize, customMem);
+    if ((zbc->inBuff==NULL) || (zbc->outBuff==NULL)) { ZBUFF_freeCCtx(zbc); return NULL; }
+    return zbc;
+}
+
+ZBUFF_CCtx* ZBUFF_createCCtx(void)
+{
+    const ZSTD_customMem defaultMem = { NULL, NULL, NULL };
+    return ZBUFF_createCCtx_advanced(defaultMem);
+}
+
+size_t ZBUFF_freeCCtx(ZBUFF_CCtx* zbc)
+{
+    if (zbc==NULL) return 0;
+    ZSTD_freeCCtx(zbc->zc);
+    ZSTD_HC_freeCCtx(zbc->hc);
+    ZSTD_free(zbc->inBuff, zbc->customMem);
+    ZSTD_free(zbc->outBuff, zbc->customMem);
+    ZSTD_free(zbc, zbc->customMem);
+    return 0;
+}
+
+size_t ZBUFF_setContentChecksum(ZBUFF_CCtx* zbc, unsigned checksumFlag)
+{
+    zbc->checksumFlag = (checksumFlag!=0);
+    return 0;
+}
+
+size_t ZBUFF_setPledgedSrcSize(ZBUFF_CCtx* zbc, unsigned long long pledgedSrcSize)
+{
+    if (pledgedSrcSize == ZSTD_CONTENTSIZE_UNKNOWN) return ERROR(srcSize_wrong);
+    zbc->pledgedSrcSizePlusOne = pledgedSrcSize+1;
+    return 0;
+}
+
+size_t ZBUFF_recommendedCInSize(void)  { return ZBUFF_BLOCKSIZE; }
+size_t ZBUFF_recommendedCOutSize(void) { return ZSTD_compressBound(ZBUFF_BLOCKSIZE); }
+
+
+/* engine selection */
+static size_t ZBUFF_engineContinue(ZBUFF_CCtx* zbc, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+{
+    if (zbc->useHC) return ZSTD_HC_compressContinue(zbc->hc, dst, maxDstSize, src, srcSize);
+    return ZSTD_compressContinue(zbc->zc, dst, maxDstSize, src, srcSize);
+}
+
+static size_t ZBUFF_engineEnd(ZBUFF_CCtx* zbc, void* dst, size_t maxDstSize)
+{
+    if (zbc->useHC) return ZSTD_HC_compressEnd(zbc->hc, dst, maxDstSize);
+    return ZSTD_compressEnd(zbc->zc, dst, maxDstSize);
+}
+
+size_t ZBUFF_compressInit(ZBUFF_CCtx* zbc, int compressionLevel, unsigned long long srcSizeHint)
+{
+    size_t hSize;
+
+    zbc->useHC = (compressionLevel > 1) || ((compressionLevel==1) && ZSTD_HC_getGlobalLevelTable());   /* custom tables define level 1 too */
+    if (zbc->useHC)
+    {
+        if (zbc->hc==NULL) zbc->hc = ZSTD_HC_createCCtx_advanced(zbc->customMem);
+        if (zbc->hc==NULL) return ERROR(memory_allocation);
+        ZSTD_HC_setContentChecksum(zbc->hc, zbc->checksumFlag);
+        if (zbc->pledgedSrcSizePlusOne) ZSTD_HC_setPledgedSrcSize(zbc->hc, zbc->pledgedSrcSizePlusOne-1);
+        hSize = ZSTD_HC_compressBegin(zbc->hc, zbc->outBuff, zbc->outBuffSize, compressionLevel, srcSizeHint);
+    }
+    else
+    {
+        if (zbc->zc==NULL) zbc->zc = ZSTD_createCCtx_advanced(zbc->customMem);
+        if (zbc->zc==NULL) return ERROR(memory_allocation);
+        ZSTD_setContentChecksum(zbc->zc, zbc->checksumFlag);
+        if (zbc->pledgedSrcSizePlusOne) ZSTD_setPledgedSrcSize(zbc->zc, zbc->pledgedSrcSizePlusOne-1);
+        hSize = ZSTD_compressBegin_advanced(zbc->zc, zbc->outBuff, zbc->outBuffSize, ZSTD_getParams(compressionLevel));
+    }
+    zbc->pledgedSrcSizePlusOne = 0;   /* only for this frame */
+    if (ZSTD_isError(hSize)) return hSize;
+
+    /* frame header is flushed with first output */
+    zbc->inToCompress = 0;
+    zbc->inBuffPos = 0;
+    zbc->inBuffTarget = ZBUFF_BLOCKSIZE;
+    zbc->outBuffContentSize = hSize;
+    zbc->outBuffFlushedSize = 0;
+    zbc->stage = ZBUFFcs_flush;
+    return 0;
+}
+
+
+/** ZBUFF_compressContinue_generic
+    flush : compress buffered input even if current block is not full
+    @return : hint of nb of bytes to load next, or an error code */
+static size_t ZBUFF_compressContinue_generic(ZBUFF_CCtx* zbc,
+                                             void* dst, size_t* maxDstSizePtr,
+                                       const void* src, size_t* srcSizePtr,
+                                             int flush)
+{
+    const BYTE* const istart = (const BYTE*)src;
+    const BYTE* ip = istart;
+    const BYTE* const iend = istart + *srcSizePtr;
+    BYTE* const ostart = (BYTE*)dst;
+    BYTE* op = ostart;
+    BYTE* const oend = ostart + *maxDstSizePtr;
+    U32 notDone = 1;
+
+    while (notDone)
+    {
+        switch(zbc->stage)
+        {
+        case ZBUFFcs_init :
+        case ZBUFFcs_final :
+            return ERROR(stage_wrong);   /* ZBUFF_compressInit() not called, or frame already ended */
+
+        case ZBUFFcs_load :
+            {
+                const size_t toLoad = zbc->inBuffTarget - zbc->inBuffPos;
+                const size_t loaded = MIN(toLoad, (size_t)(iend-ip));
+                if (loaded) memcpy(zbc->inBuff + zbc->inBuffPos, ip, loaded);
+                zbc->inBuffPos += loaded;
+                ip += loaded;
+            }
+            if ( (zbc->inBuffPos == zbc->inToCompress)
+              || (!flush && (zbc->inBuffPos < zbc->inBuffTarget)) )
+            {
+                notDone = 0;   /* nothing to compress, or current block not full */
+                break;
+            }
+
+            /* compress current block */
+            {
+                const size_t iSize = zbc->inBuffPos - zbc->inToCompress;
+                size_t oSize = oend - op;
+                BYTE* cDst = op;
+                size_t cSize;
+                if (oSize < ZSTD_compressBound(iSize)) cDst = zbc->outBuff, oSize = zbc->outBuffSize;   /* stage */
+                cSize = ZBUFF_engineContinue(zbc, cDst, oSize, zbc->inBuff + zbc->inToCompress, iSize);
+                if (ZSTD_isError(cSize)) return cSize;
+
+                /* prepare next block : blocks never straddle a ring wrap */
+                if (ZBUFF_INBUFFSIZE - zbc->inBuffPos < ZBUFF_BLOCKSIZE) zbc->inBuffPos = 0;
+                zbc->inBuffTarget = zbc->inBuffPos + ZBUFF_BLOCKSIZE;
+                zbc->inToCompress = zbc->inBuffPos;
+
+                if (cDst == op) { op += cSize; break; }   /* written directly into dst */
+                zbc->outBuffContentSize = cSize;
+                zbc->outBuffFlushedSize = 0;
+                zbc->stage = ZBUFFcs_flush;
+            }
+            /* fall-through */
+
+        case ZBUFFcs_flush :
+            {
+                const size_t toFlush = zbc->outBuffContentSize - zbc->outBuffFlushedSize;
+                const size_t flushed = MIN(toFlush, (size_t)(oend-op));
+                memcpy(op, zbc->outBuff + zbc->outBuffFlushedSize, flushed);
+                op += flushed;
+                zbc->outBuffFlushedSize += flushed;
+                if (flushed < toFlush) { notDone = 0; break; }   /* dst is full */
+                zbc->stage = ZBUFFcs_load;
+                break;
+            }
+        }
+    }
+
+    *srcSizePtr = ip - istart;
+    *maxDstSizePtr = op - ostart;
+    {
+        size_t hint = zbc->inBuffTarget - zbc->inBuffPos;
+        if (hint == 0) hint = ZBUFF_BLOCKSIZE;
+        return hint;
+    }
+}
+
+size_t ZBUFF_compressContinue(ZBUFF_CCtx* zbc, void* dst, size_t* maxDstSizePtr, const void* src, size_t* srcSizePtr)
+{
+    return ZBUFF_compressContinue_generic(zbc, dst, maxDstSizePtr, src, srcSizePtr, 0);
+}
+
+size_t ZBUFF_compressFlush(ZBUFF_CCtx* zbc, void* dst, size_t* maxDstSizePtr)
+{
+    size_t srcSize = 0;
+    size_t result = ZBUFF_compressContinue_generic(zbc, dst, maxDstSizePtr, NULL, &srcSize, 1);
+    if (ZSTD_isError(result)) return result;
+    if (zbc->stage != ZBUFFcs_flush) return 0;
+    return zbc->outBuffContentSize - zbc->outBuffFlushedSize;
+}
+
+size_t ZBUFF_compressEnd(ZBUFF_CCtx* zbc, void* dst, size_t* maxDstSizePtr)
+{
+    BYTE* const ostart = (BYTE*)dst;
+    BYTE* op = ostart;
+    BYTE* const oend = ostart + *maxDstSizePtr;
+
+    if (zbc->stage != ZBUFFcs_final)
+    {
+        size_t outSize = *maxDstSizePtr;
+        size_t remaining = ZBUFF_compressFlush(zbc, dst, &outSize);
+        if (ZSTD_isError(remaining)) return remaining;
+        op += outSize;
+        if (remaining) { *maxDstSizePtr = outSize; return remaining + ZBUFF_ENDMARKSIZE + (zbc->checksumFlag ? ZSTD_frameChecksumSize : 0); }
+
+        /* write end mark */
+        {
+            size_t eSize = ZBUFF_engineEnd(zbc, zbc->outBuff, zbc->outBuffSize);
+            if (ZSTD_isError(eSize)) return eSize;
+            zbc->outBuffContentSize = eSize;
+            zbc->outBuffFlushedSize = 0;
+            zbc->stage = ZBUFFcs_final;
+        }
+    }
+
+    /* flush end mark */
+    {
+        const size_t toFlush = zbc->outBuffContentSize - zbc->outBuffFlushedSize;
+        const size_t flushed = MIN(toFlush, (size_t)(oend-op));
+        memcpy(op, zbc->outBuff + zbc->outBuffFlushedSize, flushed);
+        op += flushed;
+        zbc->outBuffFlushedSize += flushed;
+        *maxDstSizePtr = op - ostart;
+        if (flushed < toFlush) return toFlush - flushed;
+        zbc->stage = ZBUFFcs_init;   /* frame completed */
+        return 0;
+    }
+}
+
+
+/* *************************************
+*  Streaming decompression
+***************************************/
+typedef enum { ZBUFFds_init, ZBUFFds_readHeader, ZBUFFds_read, ZBUFFds_flush } ZBUFF_dStage;
+
+struct ZBUFF_DCtx_s
+{
+    ZSTD_DCtx* zd;
+    BYTE* inBuff;           /* staging area, for frame header and input provided in small pieces */
+    size_t inPos;
+    BYTE* outBuff;          /* decoded data : history of one window, plus room for one block */
+    size_t outBuffSize;
+    size_t outStart;        /* start of data not flushed yet */
+    size_t outEnd;          /* end of decoded data */
+    ZBUFF_dStage stage;
+    ZSTD_customMem customMem;
+};   /* typedef'd to ZBUFF_DCtx within "zstd_buffered.h" */
+
+ZBUFF_DCtx* ZBUFF_createDCtx_advanced(ZSTD_customMem customMem)
+{
+    ZBUFF_DCtx* zbd;
+    if (!customMem.customAlloc != !customMem.customFree) return NULL;   /* both or none */
+    zbd = (ZBUFF_DCtx*)ZSTD_malloc(sizeof(ZBUFF_DCtx), customMem);
+    if (zbd==NULL) return NULL;
+    memset(zbd, 0, sizeof(ZBUFF_DCtx));
+    zbd->customMem = customMem;
+    zbd->zd = ZSTD_createDCtx_advanced(customMem);
+    zbd->inBuff  = (BYTE*)ZSTD_malloc(ZSTD_BLOCKSIZE_MAX, customMem);
+    zbd->outBuffSize = ZBUFF_WINDOWSIZE + ZSTD_BLOCKSIZE_MAX;
+    zbd->outBuff = (BYTE*)ZSTD_malloc(zbd->outBuffSize, customMem);
+    if ((zbd->zd==NULL) || (zbd->inBuff==NULL) || (zbd->outBuff==NULL)) { ZBUFF_freeDCtx(zbd); return NULL; }
+    return zbd;
+}
+
+ZBUFF_DCtx* ZBUFF_createDCtx(void)
+{
+    const ZSTD_customMem defaultMem = { NULL, NULL, NULL };
+    return ZBUFF_createDCtx_advanced(defaultMem);
+}
+
+size_t ZBUFF_freeDCtx(ZBUFF_DCtx* zbd)
+{
+    if (zbd==NULL) return 0;
+    ZSTD_freeDCtx(zbd->zd);
+    ZSTD_free(zbd->inBuff, zbd->customMem);
+    ZSTD_free(zbd->outBuff, zbd->customMem);
+    ZSTD_free(zbd, zbd->customMem);
+    return 0;
+}
+
+size_t ZBUFF_recommendedDInSize(void)  { return ZSTD_BLOCKSIZE_MAX + 3 /* block header */; }
+size_t ZBUFF_recommendedDOutSize(void) { return ZSTD_BLOCKSIZE_MAX; }
+
+size_t ZBUFF_decompressInit(ZBUFF_DCtx* zbd)
+{
+    size_t errorCode = ZSTD_resetDCtx(zbd->zd);
+    if (ZSTD_isError(errorCode)) return errorCode;
+    zbd->inPos = 0;
+    zbd->outStart = 0;
+    zbd->outEnd = 0;
+    zbd->stage = ZBUFFds_readHeader;
+    return 0;
+}
+
+/** ZBUFF_startFrame
+    frame header is complete into zbd->inBuff : size history buffer from its window, then pass header to decoder */
+static size_t ZBUFF_startFrame(ZBUFF_DCtx* zbd, const ZSTD_frameParams* fParams, size_t headerSize)
+{
+    size_t pos = 0;
+    if (fParams)   /* otherwise, header is left to ZSTD_decompressContinue() : skippable frame, or error */
+    {
+        const size_t windowSize = fParams->windowLog ? (size_t)1 << fParams->windowLog : ZBUFF_WINDOWSIZE;
+        const size_t neededSize = windowSize + ZSTD_BLOCKSIZE_MAX;
+        if (fParams->windowLog > ZBUFF_DWINDOWLOG_MAX) return ERROR(frameParameter_unsupported);
+        if (zbd->outBuffSize < neededSize)
+        {
+            ZSTD_free(zbd->outBuff, zbd->customMem);
+            zbd->outBuff = (BYTE*)ZSTD_malloc(neededSize, zbd->customMem);
+            zbd->outBuffSize = zbd->outBuff ? neededSize : 0;
+            if (zbd->outBuff == NULL) return ERROR(memory_allocation);
+        }
+    }
+    while (pos < headerSize)
+    {
+        const size_t toRead = MIN(ZSTD_nextSrcSizeToDecompress(zbd->zd), headerSize - pos);
+        const size_t errorCode = ZSTD_decompressContinue(zbd->zd, zbd->outBuff, zbd->outBuffSize, zbd->inBuff + pos, toRead);
+        if (ZSTD_isError(errorCode)) return errorCode;
+        pos += toRead;
+    }
+    zbd->inPos = 0;
+    return 0;
+}
+
+size_t ZBUFF_decompressContinue(ZBUFF_DCtx* zbd, void* dst, size_t* maxDstSizePtr, const void* src, size_t* srcSizePtr)
+{
+    const BYTE* const istart = (const BYTE*)src;
+    const BYTE* ip = istart;
+    const BYTE* const iend = istart + *srcSizePtr;
+    BYTE* const ostart = (BYTE*)dst;
+    BYTE* op = ostart;
+    BYTE* const oend = ostart + *maxDstSizePtr;
+    U32 notDone = 1;
+
+    while (notDone)
+    {
+        switch(zbd->stage)
+        {
+        case ZBUFFds_init :
+            return ERROR(stage_wrong);   /* ZBUFF_decompressInit() not called */
+
+        case ZBUFFds_readHeader :
+            {
+                ZSTD_frameParams fParams;
+                size_t headerSize = ZSTD_getFrameParams(&fParams, zbd->inBuff, zbd->inPos);
+                while (!ZSTD_isError(headerSize) && (headerSize > zbd->inPos))   /* load header exactly : next bytes belong to blocks */
+                {
+                    const size_t toLoad = MIN(headerSize - zbd->inPos, (size_t)(iend-ip));
+                    if (toLoad) memcpy(zbd->inBuff + zbd->inPos, ip, toLoad);
+                    zbd->inPos += toLoad;
+                    ip += toLoad;
+                    if (zbd->inPos < headerSize) break;
+                    headerSize = ZSTD_getFrameParams(&fParams, zbd->inBuff, zbd->inPos);
+                }
+                if (!ZSTD_isError(headerSize) && (headerSize > zbd->inPos)) { notDone = 0; break; }   /* need more input */
+                {
+                    const size_t errorCode = ZBUFF_startFrame(zbd, ZSTD_isError(headerSize) ? NULL : &fParams, zbd->inPos);
+                    if (ZSTD_isError(errorCode)) return errorCode;
+                }
+                zbd->stage = ZBUFFds_read;
+                break;
+            }
+
+        case ZBUFFds_read :
+            {
+                const size_t toRead = ZSTD_nextSrcSizeToDecompress(zbd->zd);
+                const BYTE* cSrc = ip;
+                size_t dSize;
+                if (toRead == 0) { notDone = 0; break; }   /* frame completed and flushed */
+                if (toRead > ZSTD_BLOCKSIZE_MAX) return ERROR(corruption_detected);
+
+                if ((zbd->inPos == 0) && ((size_t)(iend-ip) >= toRead))
+                    ip += toRead;   /* decode directly from src */
+                else
+                {
+                    const size_t toLoad = MIN(toRead - zbd->inPos, (size_t)(iend-ip));
+                    if (toLoad) memcpy(zbd->inBuff + zbd->inPos, ip, toLoad);
+                    zbd->inPos += toLoad;
+                    ip += toLoad;
+                    if (zbd->inPos < toRead) { notDone = 0; break; }   /* need more input */
+                    cSrc = zbd->inBuff;
+                    zbd->inPos = 0;
+                }
+
+                dSize = ZSTD_decompressContinue(zbd->zd, zbd->outBuff + zbd->outEnd, zbd->outBuffSize - zbd->outEnd, cSrc, toRead);
+                if (ZSTD_isError(dSize)) return dSize;
+                if (dSize == 0) break;   /* header */
+                zbd->outEnd += dSize;
+                zbd->stage = ZBUFFds_flush;
+            }
+            /* fall-through */
+
+        case ZBUFFds_flush :
+            {
+                const size_t toFlush = zbd->outEnd - zbd->outStart;
+                const size_t flushed = MIN(toFlush, (size_t)(oend-op));
+                memcpy(op, zbd->outBuff + zbd->outStart, flushed);
+                op += flushed;
+                zbd->outStart += flushed;
+                if (flushed < toFlush) { notDone = 0; break; }   /* dst is full */
+                /* next block : wrap when there is no room left ; previous segment remains referenceable.
+                   v0.1 frames can't reference previous segment : they wrap after each window, like their compressor */
+                if ( (zbd->outEnd + ZSTD_BLOCKSIZE_MAX > zbd->outBuffSize)
+                  || ((ZSTD_getLegacyVersion(zbd->zd) == 1) && (zbd->outEnd >= ZBUFF_WINDOWSIZE)) )
+                    zbd->outStart = zbd->outEnd = 0;
+                zbd->stage = ZBUFFds_read;
+                break;
+            }
+        }
+    }
+
+    *srcSizePtr = ip - istart;
+    *maxDstSizePtr = op - ostart;
+    if (zbd->stage == ZBUFFds_readHeader)   /* header incomplete */
+    {
+        ZSTD_frameParams fParams;
+        return ZSTD_getFrameParams(&fParams, zbd->inBuff, zbd->inPos) - zbd->inPos;
+    }
+    {
+        const size_t nextSrcSize = ZSTD_nextSrcSizeToDecompress(zbd->zd);
+        if (nextSrcSize == 0) return 0;   /* frame completed */
+        return nextSrcSize - zbd->inPos;
+    }
+}
@@ -0,0 +1,152 @@
+/*
+    zstd_buffered - buffered streaming interface for zstd
+    Header File
+    Copyright (C) 2015, Yann Collet.
+
+    BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are
+    met:
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following disclaimer
+    in the documentation and/or other materials provided with the
+    distribution.
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+    A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+    OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+    SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+    LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+    DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+    THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+    You can contact the author at :
+    - zstd source repository : https://github.com/Cyan4973/zstd
+    - ztsd public forum : https://groups.google.com/forum/#!forum/lz4c
+*/
+#ifndef ZSTD_BUFFERED_H
+#define ZSTD_BUFFERED_H
+
+/* The objects defined into this file should be considered experimental.
+ * They are not labelled stable, as their prototype may change in the future.
+ */
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* *************************************
+*  Includes
+***************************************/
+#include <stddef.h>   /* size_t */
+#include "zstd_static.h"   /* ZSTD_customMem, ZSTD_BLOCKSIZE_MAX */
+
+
+/* *************************************
+*  Constants
+***************************************/
+#define ZBUFF_WINDOWSIZE (4 * ZSTD_BLOCKSIZE_MAX)   /* streamed frames never reference data farther back */
+#define ZBUFF_DWINDOWLOG_MAX 26   /* largest window a ZBUFF_DCtx allocates : frames with a larger one are rejected */
+
+
+/* *************************************
+*  Streaming compression
+***************************************/
+typedef struct ZBUFF_CCtx_s ZBUFF_CCtx;
+ZBUFF_CCtx* ZBUFF_createCCtx(void);
+ZBUFF_CCtx* ZBUFF_createCCtx_advanced(ZSTD_customMem customMem);
+size_t      ZBUFF_freeCCtx(ZBUFF_CCtx* zbc);
+
+size_t ZBUFF_compressInit(ZBUFF_CCtx* zbc, int compressionLevel, unsigned long long srcSizeHint);
+size_t ZBUFF_compressContinue(ZBUFF_CCtx* zbc, void* dst, size_t* maxDstSizePtr, const void* src, size_t* srcSizePtr);
+size_t ZBUFF_compressFlush(ZBUFF_CCtx* zbc, void* dst, size_t* maxDstSizePtr);
+size_t ZBUFF_compressEnd(ZBUFF_CCtx* zbc, void* dst, size_t* maxDstSizePtr);
+/*
+  A ZBUFF_CCtx accepts input and output buffers of any size, and manages the compression window internally :
+  input is copied into a ring buffer of ZBUFF_WINDOWSIZE bytes, so caller's buffers can be re-used as soon as a call returns.
+  ZBUFF_compressInit() starts a new frame. Levels <= 1 use the fast engine (see ZSTD_getParams()), higher levels use HC.
+  srcSizeHint is optional (0 if unknown) : it selects HC parameters, as in ZSTD_HC_compressBegin().
+  ZBUFF_createCCtx_advanced() allocates the context, its buffers and engine contexts using customMem.
+
+  ZBUFF_compressContinue() consumes up to *srcSizePtr bytes, and writes up to *maxDstSizePtr bytes into dst.
+  On return, *srcSizePtr and *maxDstSizePtr contain the nb of bytes actually read and written (both can be zero).
+  Input not consumed must be presented again. A full block is compressed as soon as it is buffered :
+  when dst has room for ZSTD_compressBound(ZSTD_BLOCKSIZE_MAX) bytes, it is compressed directly into dst, without staging.
+  @return : a hint of preferred nb of bytes to provide next call (remaining to complete current block), or an error code.
+
+  ZBUFF_compressFlush() compresses buffered input immediately, as a smaller block, and writes as much as possible into dst.
+  ZBUFF_compressEnd() flushes, then writes the frame end mark. A new frame requires ZBUFF_compressInit().
+  For both, *maxDstSizePtr is updated with the nb of bytes written.
+  @return : nb of bytes still to be flushed (0 when done : call again while > 0), or an error code.
+
+  Blocks never straddle a ring wrap, and history restarts at each wrap :
+  a decoder keeping ZBUFF_WINDOWSIZE bytes of previous output can always resolve matches.
+*/
+
+size_t ZBUFF_setContentChecksum(ZBUFF_CCtx* zbc, unsigned checksumFlag);
+/*
+  1 : frames started by following ZBUFF_compressInit() end with a checksum of content (see ZSTD_setContentChecksum()).
+  @return : 0, or an error code
+*/
+
+size_t ZBUFF_setPledgedSrcSize(ZBUFF_CCtx* zbc, unsigned long long pledgedSrcSize);
+/*
+  Records pledgedSrcSize into the header of the frame started by next ZBUFF_compressInit() (see ZSTD_setPledgedSrcSize()).
+  Total input of that frame must be exactly pledgedSrcSize, otherwise ZBUFF_compressEnd() fails with srcSize_wrong.
+  @return : 0, or an error code
+*/
+
+size_t ZBUFF_recommendedCInSize(void);
+size_t ZBUFF_recommendedCOutSize(void);
+/*
+  Input and output sizes which let ZBUFF_compressContinue() work without staging : one full block each.
+*/
+
+
+/* *************************************
+*  Streaming decompression
+***************************************/
+typedef struct ZBUFF_DCtx_s ZBUFF_DCtx;
+ZBUFF_DCtx* ZBUFF_createDCtx(void);
+ZBUFF_DCtx* ZBUFF_createDCtx_advanced(ZSTD_customMem customMem);
+size_t      ZBUFF_freeDCtx(ZBUFF_DCtx* zbd);
+
+size_t ZBUFF_decompressInit(ZBUFF_DCtx* zbd);
+size_t ZBUFF_decompressContinue(ZBUFF_DCtx* zbd, void* dst, size_t* maxDstSizePtr, const void* src, size_t* srcSizePtr);
+/*
+  A ZBUFF_DCtx accepts input and output buffers of any size, including a few bytes at a time :
+  each call makes as much progress as available input and output space allow, and never blocks waiting for more.
+  ZBUFF_decompressInit() starts decoding a new frame.
+  ZBUFF_decompressContinue() reads up to *srcSizePtr bytes, and writes up to *maxDstSizePtr bytes into dst.
+  On return, *srcSizePtr and *maxDstSizePtr contain the nb of bytes actually read and written.
+  Input not consumed must be presented again. Input is staged only when a block is provided in several pieces.
+  Decoded data is kept internally, in a buffer of one window plus ZSTD_BLOCKSIZE_MAX bytes.
+  The window is read from the frame header (ZBUFF_WINDOWSIZE when not recorded), and the buffer grows as needed.
+  Frames announcing a window larger than 1<<ZBUFF_DWINDOWLOG_MAX fail with frameParameter_unsupported before any block is decoded.
+  @return : a hint of nb of bytes to provide next call (0 when frame is completely decoded and flushed), or an error code.
+*/
+
+size_t ZBUFF_recommendedDInSize(void);
+size_t ZBUFF_recommendedDOutSize(void);
+/*
+  Input size of a whole block with its header, and output size of one block.
+*/
+
+
+/* *************************************
+*  Error management
+***************************************/
+/* results can be tested using ZSTD_isError(), and described using ZSTD_getErrorName() (see "zstd.h") */
+
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif  /* ZSTD_BUFFERED_H */
@@ -42,6 +42,34 @@ extern "C" {
 ***************************************/
 #include "mem.h"
 #include "error.h"
+#include "zstd_static.h"   /* ZSTD_customMem */
+#include "huff0_static.h"  /* HUF_CTABLE_SIZE_U32 */
+#include "xxhash.h"        /* XXH64_state_t, content checksum */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#  include <emmintrin.h>   /* SSE2 */
+#  define ZSTD_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#  include <arm_neon.h>
+#  define ZSTD_NEON 1
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  include <xmmintrin.h>   /* _mm_prefetch */
+#  define ZSTD_PREFETCH(ptr)   _mm_prefetch((const char*)(ptr), _MM_HINT_T0)
+#elif defined(__GNUC__)
+#  define ZSTD_PREFETCH(ptr)   __builtin_prefetch((ptr), 0, 3)
+#else
+#  define ZSTD_PREFETCH(ptr)   /* disabled */
+#endif
+
+
+/* **************************************
+*  Memory allocation
+****************************************/
+/* customMem { NULL, NULL, NULL } means default malloc() / free() */
+void* ZSTD_malloc(size_t size, ZSTD_customMem customMem);
+void  ZSTD_free(void* ptr, ZSTD_customMem customMem);
 
 
 /* **************************************
@@ -51,7 +79,7 @@ static size_t ZSTD_read_ARCH(const void* p) { size_t r; memcpy(&r, p, sizeof(r))
 
 #define MIN(a,b) ((a)<(b) ? (a) : (b))
 
-static unsigned ZSTD_highbit(U32 val)
+MEM_STATIC unsigned ZSTD_highbit(U32 val)
 {
 #   if defined(_MSC_VER)   /* Visual */
     unsigned long r=0;
@@ -142,10 +170,32 @@ MEM_STATIC unsigned ZSTD_NbCommonBytes (register size_t val)
 }
 
 
+/** ZSTD_equal16
+    @return : 1 if the 16 bytes at p1 and p2 are identical */
+MEM_STATIC int ZSTD_equal16(const BYTE* p1, const BYTE* p2)
+{
+#if defined(ZSTD_SSE2)
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p1), _mm_loadu_si128((const __m128i*)p2))) == 0xFFFF;
+#elif defined(ZSTD_NEON)
+    return vminvq_u8(vceqq_u8(vld1q_u8(p1), vld1q_u8(p2))) == 0xFF;
+#else
+    return !((ZSTD_read_ARCH(p1) ^ ZSTD_read_ARCH(p2)) | (ZSTD_read_ARCH(p1+8) ^ ZSTD_read_ARCH(p2+8)));
+#endif
+}
+
 MEM_STATIC size_t ZSTD_count(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
 {
     const BYTE* const pStart = pIn;
 
+#if defined(ZSTD_SSE2) || defined(ZSTD_NEON)
+    /* long matches : skip identical 16-bytes chunks; short ones are sorted out by first word */
+    if ((pIn<pInLimit-15) && (ZSTD_read_ARCH(pMatch) == ZSTD_read_ARCH(pIn)))
+    {
+        pIn+=sizeof(size_t); pMatch+=sizeof(size_t);
+        while ((pIn<pInLimit-15) && ZSTD_equal16(pIn, pMatch)) { pIn+=16; pMatch+=16; }
+    }
+#endif
+
     while ((pIn<pInLimit-(sizeof(size_t)-1)))
     {
         size_t diff = ZSTD_read_ARCH(pMatch) ^ ZSTD_read_ARCH(pIn);
@@ -160,13 +210,29 @@ MEM_STATIC size_t ZSTD_count(const BYTE* pIn, const BYTE* pMatch, const BYTE* pI
     return (size_t)(pIn - pStart);
 }
 
+/** ZSTD_count_2segments
+    can count match length with ip & match in potentially 2 different segments.
+    convention : on reaching mEnd, match count continue starting from iStart */
+MEM_STATIC size_t ZSTD_count_2segments(const BYTE* ip, const BYTE* match, const BYTE* iEnd, const BYTE* mEnd, const BYTE* iStart)
+{
+    const BYTE* vEnd = ip + (mEnd - match);
+    size_t matchLength;
+    if (vEnd > iEnd) vEnd = iEnd;
+    matchLength = ZSTD_count(ip, match, vEnd);
+    if (match + matchLength == mEnd)
+        matchLength += ZSTD_count(ip+matchLength, iStart, iEnd);
+    return matchLength;
+}
+
 
-static void ZSTD_copy8(void* dst, const void* src) { memcpy(dst, src, 8); }
+MEM_STATIC void ZSTD_copy8(void* dst, const void* src) { memcpy(dst, src, 8); }
+MEM_STATIC void ZSTD_copy16(void* dst, const void* src) { memcpy(dst, src, 16); }   /* single vector move where available */
 
 #define COPY8(d,s) { ZSTD_copy8(d,s); d+=8; s+=8; }
+#define COPY16(d,s) { ZSTD_copy16(d,s); d+=16; s+=16; }
 
 /*! ZSTD_wildcopy : custom version of memcpy(), can copy up to 7-8 bytes too many */
-static void ZSTD_wildcopy(void* dst, const void* src, size_t length)
+MEM_STATIC void ZSTD_wildcopy(void* dst, const void* src, size_t length)
 {
     const BYTE* ip = (const BYTE*)src;
     BYTE* op = (BYTE*)dst;
@@ -176,6 +242,19 @@ static void ZSTD_wildcopy(void* dst, const void* src, size_t length)
     while (op < oend);
 }
 
+/*! ZSTD_wildcopy16 : same as ZSTD_wildcopy(), copying 16 bytes per step.
+    can also copy up to 7-8 bytes too many, but requires dst >= src+16 or no overlap */
+MEM_STATIC void ZSTD_wildcopy16(void* dst, const void* src, size_t length)
+{
+    const BYTE* ip = (const BYTE*)src;
+    BYTE* op = (BYTE*)dst;
+    BYTE* const oend = op + length;
+    while (op+16 <= oend)
+        COPY16(op, ip)
+    while (op < oend)
+        COPY8(op, ip)
+}
+
 
 typedef enum { bt_compressed, bt_raw, bt_rle, bt_end } blockType_t;
 
@@ -186,8 +265,91 @@ typedef struct
 } blockProperties_t;
 
 size_t ZSTD_noCompressBlock(void* op, size_t maxDstSize, const void* ip, size_t blockSize);
+size_t ZSTD_rleCompressBlock(void* op, size_t maxDstSize, const void* ip, size_t blockSize);
+
+/* legacy format version of the frame being decoded by ZSTD_decompressContinue() (0 : current format) ; body into zstd.c */
+U32    ZSTD_getLegacyVersion(const ZSTD_DCtx* dctx);
+
+
+/* frame header & end, shared by both engines ; bodies into zstd.c */
+#define ZSTD_frameChecksumSize 8
+size_t ZSTD_writeFrameHeader(void* dst, size_t maxDstSize, const ZSTD_frameParams* fparams, XXH64_state_t* checksumState);
+size_t ZSTD_writeFrameEnd(void* dst, size_t maxDstSize, const XXH64_state_t* checksumState);
+/*
+  Regular frame header (magic only) when fparams records neither content size nor checksum.
+  Otherwise, extended header records them, along with windowLog. With checksum, checksumState is reset.
+  checksumState==NULL : regular end mark. Otherwise, end mark is followed by its digest.
+  Compressors update checksumState with each block of source they consume.
+*/
 
 
+/* **************************************
+*  Statistics
+****************************************/
+/*!
+*  ZSTD_STATS :
+*  collect per-context counters, for ZSTD_getCCtxStats() & co.
+*  Costs a timestamp per stage of each block, and a few increments per sequence : disabled by default.
+*/
+#ifndef ZSTD_STATS
+#  define ZSTD_STATS 0
+#endif
+
+#if ZSTD_STATS
+#  if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#    include <intrin.h>      /* __rdtsc */
+#    define ZSTD_ticks() (U64)__rdtsc()
+#  elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#    include <x86intrin.h>   /* __rdtsc */
+#    define ZSTD_ticks() (U64)__rdtsc()
+#  else
+#    include <time.h>        /* clock */
+#    define ZSTD_ticks() (U64)clock()
+#  endif
+
+MEM_STATIC void ZSTD_statsCycles(ZSTD_stats* stats, ZSTD_stage_e stage, U64* tickPtr)
+{
+    const U64 now = ZSTD_ticks();
+    stats->cycles[stage] += now - *tickPtr;
+    *tickPtr = now;
+}
+
+MEM_STATIC void ZSTD_statsBlock(ZSTD_stats* stats, blockType_t bt)
+{
+    if (bt < bt_end) stats->nbBlocks[bt]++;
+}
+
+/* usage : ZSTD_STATS_TICK() is the last declaration of its block; ZSTD_STATS_CYCLES() charges time since previous tick */
+#  define ZSTD_STATS_TICK(t)                  U64 t = ZSTD_ticks();
+#  define ZSTD_STATS_CYCLES(stats, stage, t)  ZSTD_statsCycles(&(stats), stage, &(t))
+#  define ZSTD_STATS_BLOCK(stats, bt)         ZSTD_statsBlock(&(stats), bt)
+#  define ZSTD_STATS_ADD(counter, n)          ((counter) += (n))
+#else
+#  define ZSTD_STATS_TICK(t)
+#  define ZSTD_STATS_CYCLES(stats, stage, t)  ((void)0)
+#  define ZSTD_STATS_BLOCK(stats, bt)         ((void)0)
+#  define ZSTD_STATS_ADD(counter, n)          ((void)0)
+#endif
+
+
+#define REPCODE_STARTVALUE 4
+#define MLbits   7
+#define LLbits   6
+#define Offbits  5
+#define MaxML  ((1<<MLbits) - 1)
+#define MaxLL  ((1<<LLbits) - 1)
+#define MaxOff   31
+#define LongOffBits 25   /* offset codes above this nb of extra bits (long distance offsets, up to 2 GB) send them in 2 parts */
+
+typedef struct {
+    S16 norm[MaxML+1];   /* assumption : MaxML >= MaxLL and MaxOff */
+    U32 max;
+    U32 tableLog;
+    U32 repeat;          /* 1 : decoder has this table, it can be re-used */
+} seqTable_t;
+
+#define ZSTD_PROBE_TABLELOG 13
+
 typedef struct {
     void* buffer;
     U32*  offsetStart;
@@ -202,19 +364,70 @@ typedef struct {
     BYTE* matchLength;
     BYTE* dumpsStart;
     BYTE* dumps;
+    /* entropy tables, kept across blocks of a frame */
+    U32   litRepeat;   /* 1 : litCTable is known to the decoder */
+    U32   litCTable[HUF_CTABLE_SIZE_U32(HUF_MAX_SYMBOL_VALUE)];
+    seqTable_t llTable;
+    seqTable_t offTable;
+    seqTable_t mlTable;
+    U32   rawRun;      /* nb of consecutive raw blocks, makes incompressibility probe sparser */
+    U32   rawStart;    /* raw blocks since rawStart were skipped by match finder ... */
+    U32   rawEnd;      /* ... up to rawEnd (0 : none) */
+    U32   probeTable[1<<ZSTD_PROBE_TABLELOG];   /* sparse index of previous blocks, for incompressibility probe */
+#if ZSTD_STATS
+    ZSTD_stats stats;  /* counters of the owning context, never reset by frames */
+    U64   statsTick;   /* start of current block */
+#endif
 } seqStore_t;
 
 void ZSTD_resetSeqStore(seqStore_t* ssPtr);
 
-static const U32 g_searchStrength = 8;
+/* start of frame : decoder knows no entropy table */
+MEM_STATIC void ZSTD_resetSeqTables(seqStore_t* ssPtr)
+{
+    ssPtr->litRepeat = 0;
+    ssPtr->llTable.repeat = 0;
+    ssPtr->offTable.repeat = 0;
+    ssPtr->mlTable.repeat = 0;
+    ssPtr->rawRun = 0;
+    ssPtr->rawEnd = 0;
+}
 
-#define REPCODE_STARTVALUE 4
-#define MLbits   7
-#define LLbits   6
-#define Offbits  5
-#define MaxML  ((1<<MLbits) - 1)
-#define MaxLL  ((1<<LLbits) - 1)
-#define MaxOff   31
+/* incompressible data : each consecutive raw block halves the probed sample, down to 1<<ZSTD_PROBELOG_MAX */
+#define ZSTD_PROBELOG_MAX 3
+MEM_STATIC U32 ZSTD_probeLog(const seqStore_t* ssPtr) { return MIN(ssPtr->rawRun, ZSTD_PROBELOG_MAX); }
+
+/* ZSTD_isIncompressible(), ZSTD_indexRawBlock() : bodies into zstd.c.
+   Previous raw blocks are searched for repetitions between indexes lowLimit and src, using the match finder's base, dictBase and dictLimit */
+U32  ZSTD_isIncompressible(seqStore_t* ssPtr, const void* src, size_t srcSize,
+                           const BYTE* base, const BYTE* dictBase, U32 dictLimit, U32 lowLimit);
+void ZSTD_indexRawBlock(seqStore_t* ssPtr, const void* src, size_t srcSize, const BYTE* base);
+
+/* raw block [start, end[ stored without match search : the match finder skips it */
+MEM_STATIC void ZSTD_skipRawBlock(seqStore_t* ssPtr, U32 start, U32 end)
+{
+    if (!ssPtr->rawEnd) ssPtr->rawStart = start;
+    ssPtr->rawEnd = end;
+}
+
+/* block is about to be searched : @return 1 if skipped raw blocks, from ssPtr->rawStart, must be indexed first.
+   This block, or any later one, may repeat them. */
+MEM_STATIC U32 ZSTD_endRawSkip(seqStore_t* ssPtr)
+{
+    const U32 skipped = (ssPtr->rawEnd != 0);
+    ssPtr->rawEnd = 0;
+    return skipped;
+}
+
+MEM_STATIC void ZSTD_updateRawRun(seqStore_t* ssPtr, const void* blockHeader)
+{
+    const blockType_t bt = (blockType_t)((*(const BYTE*)blockHeader) >> 6);
+    ZSTD_STATS_BLOCK(ssPtr->stats, bt);
+    if (bt == bt_raw) ssPtr->rawRun++;
+    if (bt == bt_compressed) ssPtr->rawRun = 0;   /* rle blocks are neutral */
+}
+
+static const U32 g_searchStrength = 8;
 
 #define MIN_SEQUENCES_SIZE (2 /*seqNb*/ + 2 /*dumps*/ + 3 /*seqTables*/ + 1 /*bitStream*/)
 #define MIN_CBLOCK_SIZE (3 /*litCSize*/ + MIN_SEQUENCES_SIZE)
@@ -235,7 +448,7 @@ MEM_STATIC void ZSTD_storeSeq(seqStore_t* seqStorePtr, size_t litLength, const B
 #endif
 
     /* copy Literals */
-    ZSTD_wildcopy(seqStorePtr->lit, literals, litLength);
+    ZSTD_wildcopy16(seqStorePtr->lit, literals, litLength);
     seqStorePtr->lit += litLength;
 
     /* literal Length */
@@ -268,11 +481,13 @@ MEM_STATIC void ZSTD_storeSeq(seqStore_t* seqStorePtr, size_t litLength, const B
         }
     }
     else *(seqStorePtr->matchLength++) = (BYTE)matchCode;
+
+    ZSTD_STATS_ADD(seqStorePtr->stats.matchLengthHistogram[ZSTD_highbit((U32)matchCode + 4 /*MINMATCH*/)], 1);
 }
 
 
 /* prototype, body into zstd.c */
-size_t ZSTD_compressSequences(BYTE* dst, size_t maxDstSize, const seqStore_t* seqStorePtr, size_t srcSize);
+size_t ZSTD_compressSequences(BYTE* dst, size_t maxDstSize, seqStore_t* seqStorePtr, size_t srcSize);
 
 
 #if defined (__cplusplus)
@@ -48,18 +48,66 @@ extern "C" {
 #include "zstd.h"
 
 
+/* *************************************
+*  Types
+***************************************/
+typedef struct
+{
+    unsigned hashLog;        /* dispatch table : larger == more memory, better compression ; 0 : default (14) */
+    unsigned searchLength;   /* nb of bytes hashed : larger == faster, finds fewer matches ; 0 : default (7) */
+    unsigned acceleration;   /* larger == faster, skips more positions when no match is found ; 0 : default (1) */
+} ZSTD_parameters;
+
+/* parameters boundaries */
+#define ZSTD_HASHLOG_MAX 20
+#define ZSTD_HASHLOG_MIN 10
+#define ZSTD_SEARCHLENGTH_MAX 7
+#define ZSTD_SEARCHLENGTH_MIN 4
+#define ZSTD_ACCELERATION_MAX 32
+#define ZSTD_ACCELERATION_MIN 1
+
+/* fast compression levels : 1 (and 0) is default, negative levels are accelerated */
+#define ZSTD_MIN_CLEVEL (1-ZSTD_ACCELERATION_MAX)
+
+
+/* *************************************
+*  Advanced functions
+***************************************/
+size_t ZSTD_compress_advanced(ZSTD_CCtx* cctx,
+                              void* dst, size_t maxDstSize,
+                        const void* src, size_t srcSize,
+                              ZSTD_parameters params);
+/*
+  Same as ZSTD_compressCCtx(), with fine-tune control of each compression parameter.
+  A smaller hashLog reduces memory usage and improves speed on small caches ; a larger one improves compression.
+  Hash table is allocated and re-used by cctx : it only grows when a larger hashLog is requested.
+*/
+
+void ZSTD_validateParams(ZSTD_parameters* params);
+/* correct params value to remain within authorized range, 0 selecting default values */
+
+ZSTD_parameters ZSTD_getParams(int compressionLevel);
+size_t ZSTD_compressLevel(void* dst, size_t maxDstSize, const void* src, size_t srcSize, int compressionLevel);
+/*
+  Fast compression levels trade compression ratio for speed, while remaining within zstd frame format.
+  Levels 1 and 0 are ZSTD_compress(). Levels -1 to ZSTD_MIN_CLEVEL select acceleration = 1 - compressionLevel :
+  search skips positions faster while no match is found, and literals are stored raw
+  unless they represent a large share of the block, bypassing Huffman when its gain is small.
+  Levels > 1 are clamped to 1 : higher levels are provided by ZSTD_HC_compress() (see "zstdhc.h").
+  ZSTD_getParams() provides the parameters of a level, for use with _advanced() functions.
+*/
+
+
 /* *************************************
 *  Streaming functions
 ***************************************/
+size_t ZSTD_compressBegin_advanced(ZSTD_CCtx* cctx, void* dst, size_t maxDstSize, ZSTD_parameters params);
 size_t ZSTD_compressBegin(ZSTD_CCtx* cctx, void* dst, size_t maxDstSize);
 size_t ZSTD_compressContinue(ZSTD_CCtx* cctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize);
 size_t ZSTD_compressEnd(ZSTD_CCtx* cctx, void* dst, size_t maxDstSize);
 
 
-typedef struct ZSTD_DCtx_s ZSTD_DCtx;
-ZSTD_DCtx* ZSTD_createDCtx(void);
 size_t     ZSTD_resetDCtx(ZSTD_DCtx* dctx);
-size_t     ZSTD_freeDCtx(ZSTD_DCtx* dctx);
 
 size_t ZSTD_nextSrcSizeToDecompress(ZSTD_DCtx* dctx);
 size_t ZSTD_decompressContinue(ZSTD_DCtx* dctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize);
@@ -67,14 +115,291 @@ size_t ZSTD_decompressContinue(ZSTD_DCtx* dctx, void* dst, size_t maxDstSize, co
   Use above functions alternatively.
   ZSTD_nextSrcSizeToDecompress() tells how much bytes to provide as 'srcSize' to ZSTD_decompressContinue().
   ZSTD_decompressContinue() will use previous data blocks to improve compression if they are located prior to current block.
+  When 'dst' is not contiguous with previous block, the previous contiguous segment can still be referenced :
+  it must remain accessible, and only be overwritten beyond the distance the compressor can reference.
+  Legacy frames (v0.1, v0.2) are accepted too ; v0.1 blocks can only reference the contiguous segment.
   Result is the number of bytes regenerated within 'dst'.
   It can be zero, which is not an error; it just means ZSTD_decompressContinue() has decoded some header.
 */
 
+/* *************************************
+*  Block size
+***************************************/
+#define ZSTD_BLOCKSIZE_MAX (128 * 1024)   /* largest block accepted by decoders : format limit, sizes decoder buffers */
+#define ZSTD_BLOCKSIZE_MIN (1 * 1024)     /* smaller blocks would no longer fit within ZSTD_compressBound() */
+
+size_t ZSTD_setBlockSize(ZSTD_CCtx* cctx, size_t blockSize);
+/*
+  Select the size of blocks produced by ZSTD_compressContinue() and ZSTD_compressCCtx(), within [ZSTD_BLOCKSIZE_MIN, ZSTD_BLOCKSIZE_MAX].
+  0 selects default (ZSTD_BLOCKSIZE_MAX). Setting applies to next block, and remains active for following frames.
+  Smaller blocks are emitted sooner, at the cost of more headers ; any decoder can read them.
+  @result : 0, or an error code (srcSize_wrong if blockSize is out of range)
+*/
+
+size_t ZSTD_setContentChecksum(ZSTD_CCtx* cctx, unsigned checksumFlag);
+/*
+  checksumFlag==1 : following frames end with a 64-bits checksum (XXH64) of their regenerated content.
+  It is computed block after block, and verified by decoders the same way, while data is still in cache.
+  Such frames start with ZSTD_magicNumberExt, followed by a frame descriptor byte : older decoders reject them (prefix_unknown).
+  0 (default) produces regular frames, without checksum.
+  @result : 0, or an error code
+*/
+
+size_t ZSTD_setPledgedSrcSize(ZSTD_CCtx* cctx, unsigned long long pledgedSrcSize);
+/*
+  Record pledgedSrcSize, and window size, into the header of next frame (started by ZSTD_compressBegin*() or ZSTD_compress*()).
+  It only applies to this frame. Decoders reject the frame if its content doesn't match pledgedSrcSize,
+  so ZSTD_compressEnd() fails with srcSize_wrong when total input differs from pledgedSrcSize.
+  As for checksum, such frames start with ZSTD_magicNumberExt.
+  @result : 0, or an error code
+*/
+
+
+/* *************************************
+*  Custom memory allocation
+***************************************/
+typedef void* (*ZSTD_allocFunction) (void* opaque, size_t size);
+typedef void  (*ZSTD_freeFunction) (void* opaque, void* address);
+typedef struct { ZSTD_allocFunction customAlloc; ZSTD_freeFunction customFree; void* opaque; } ZSTD_customMem;
+
+ZSTD_CCtx* ZSTD_createCCtx_advanced(ZSTD_customMem customMem);
+ZSTD_DCtx* ZSTD_createDCtx_advanced(ZSTD_customMem customMem);
+/*
+  Create a context whose memory is provided by customMem.customAlloc(), and released by customMem.customFree().
+  Both functions receive customMem.opaque as first argument (for example, an arena handle).
+  customMem is stored into the context : later allocations made on its behalf use it too (ZSTD_decompressRange() temporary buffer).
+  { NULL, NULL, NULL } selects default malloc() / free(). Providing only one of the two functions is invalid : result is NULL.
+  Such a context is released normally, with ZSTD_free?Ctx().
+*/
+
+
+/* *************************************
+*  Batch compression
+***************************************/
+typedef struct
+{
+    const void* src;
+    size_t srcSize;
+    void*  dst;
+    size_t dstCapacity;
+    size_t cSize;   /* result : compressed size, or an error code */
+} ZSTD_batchItem;
+
+size_t ZSTD_compressBatch(ZSTD_CCtx* cctx, ZSTD_batchItem* items, size_t nbItems, ZSTD_parameters params);
+/*
+  Compress each item into its own independent frame, re-using cctx.
+  A context keeps its hash table from one frame to the next : previous content is invalidated by indexes, not cleared,
+  so starting a new frame costs the same for a small input than for a large table.
+  Items are independent : a large batch can be split across threads, using one cctx per thread.
+  @result : 0 if all items were compressed, or the error code of the first item which failed
+*/
+
+/* *************************************
+*  Static allocation
+***************************************/
+size_t     ZSTD_estimateCCtxSize(void);
+size_t     ZSTD_estimateCCtxSize_advanced(ZSTD_parameters params);
+ZSTD_CCtx* ZSTD_initStaticCCtx(void* workspace, size_t workspaceSize);
+size_t     ZSTD_estimateDCtxSize(void);
+ZSTD_DCtx* ZSTD_initStaticDCtx(void* workspace, size_t workspaceSize);
+size_t     ZSTD_decompressDCtx(ZSTD_DCtx* dctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize);
+/*
+  ZSTD_initStaticCCtx() and ZSTD_initStaticDCtx() build a context into a caller-provided 8-bytes aligned workspace,
+  which must be at least ZSTD_estimate?CtxSize() bytes. They return NULL if workspace is too small or misaligned.
+  ZSTD_estimateCCtxSize() is valid for default parameters ; ZSTD_estimateCCtxSize_advanced() for any parameters up to params.
+  Compression of a static CCtx fails with error memory_allocation when selected parameters need more than workspace.
+  Such a context never allocates memory; it is released by releasing workspace : ZSTD_free?Ctx() returns an error.
+  ZSTD_decompressDCtx() is ZSTD_decompress() using an existing context, instead of a stack-allocated one.
+  Note : ZSTD_compress() and ZSTD_decompressRange() still allocate internally, using default malloc().
+*/
+
+
+/* *************************************
+*  Dictionary functions
+***************************************/
+size_t ZSTD_compress_insertDictionary(ZSTD_CCtx* cctx, const void* dict, size_t dictSize);
+size_t ZSTD_duplicateCCtx(ZSTD_CCtx* dstCCtx, const ZSTD_CCtx* srcCCtx);
+size_t ZSTD_compress_usingPreparedCCtx(ZSTD_CCtx* cctx, const ZSTD_CCtx* preparedCCtx,
+                                       void* dst, size_t maxDstSize,
+                                 const void* src, size_t srcSize);
+/*
+  ZSTD_compress_insertDictionary() loads a dictionary into cctx tables.
+  It must be called after ZSTD_compressBegin(), and before first ZSTD_compressContinue().
+  Dictionary content is referenced, not copied : it must remain accessible and unmodified while in use.
+  ZSTD_duplicateCCtx() copies the state of srcCCtx into dstCCtx, including a loaded dictionary.
+  srcCCtx must be at the beginning of a frame (no ZSTD_compressContinue() yet) ; dstCCtx frame header must have been written by ZSTD_compressBegin().
+  ZSTD_compress_usingPreparedCCtx() compresses a full frame, starting from a copy of preparedCCtx.
+  It avoids re-hashing the same dictionary for each input, which matters for small inputs.
+*/
+
+size_t ZSTD_decompress_insertDictionary(ZSTD_DCtx* dctx, const void* dict, size_t dictSize);
+void   ZSTD_copyDCtx(ZSTD_DCtx* dstDCtx, const ZSTD_DCtx* srcDCtx);
+size_t ZSTD_decompress_usingPreparedDCtx(ZSTD_DCtx* dctx, const ZSTD_DCtx* preparedDCtx,
+                                         void* dst, size_t maxDstSize,
+                                   const void* src, size_t srcSize);
+/*
+  ZSTD_decompress_insertDictionary() references a dictionary into dctx, right after ZSTD_resetDCtx().
+  Streaming decompression can then proceed with ZSTD_decompressContinue() :
+  the first block written into a non-contiguous 'dst' can still reference the dictionary.
+  ZSTD_copyDCtx() and ZSTD_decompress_usingPreparedDCtx() allow a single dictionary insertion for many frames.
+*/
+
+
+/* *************************************
+*  Digested dictionaries
+***************************************/
+typedef struct ZSTD_CDict_s ZSTD_CDict;
+ZSTD_CDict* ZSTD_createCDict(const void* dict, size_t dictSize);
+ZSTD_CDict* ZSTD_createCDict_advanced(const void* dict, size_t dictSize, ZSTD_parameters params, ZSTD_customMem customMem);
+size_t      ZSTD_freeCDict(ZSTD_CDict* cdict);
+size_t ZSTD_compress_usingCDict(ZSTD_CCtx* cctx,
+                                void* dst, size_t maxDstSize,
+                          const void* src, size_t srcSize,
+                          const ZSTD_CDict* cdict);
+
+typedef struct ZSTD_DDict_s ZSTD_DDict;
+ZSTD_DDict* ZSTD_createDDict(const void* dict, size_t dictSize);
+ZSTD_DDict* ZSTD_createDDict_advanced(const void* dict, size_t dictSize, ZSTD_customMem customMem);
+size_t      ZSTD_freeDDict(ZSTD_DDict* ddict);
+size_t ZSTD_decompress_usingDDict(ZSTD_DCtx* dctx,
+                                  void* dst, size_t maxDstSize,
+                            const void* src, size_t srcSize,
+                            const ZSTD_DDict* ddict);
+/*
+  ZSTD_createCDict() and ZSTD_createDDict() digest a dictionary once : its content is copied and indexed.
+  They return NULL on allocation failure.
+  ZSTD_create?Dict_advanced() take all their memory (dictionary copy included) from customMem.
+  ZSTD_createCDict_advanced() also selects compression parameters, re-used by ZSTD_compress_usingCDict().
+  A digested dictionary is never modified by ZSTD_compress_usingCDict() or ZSTD_decompress_usingDDict() :
+  it can be shared by several threads simultaneously, each one using its own ZSTD_CCtx or ZSTD_DCtx.
+  It must remain valid until the last operation using it is completed.
+*/
+
+
 /* *************************************
 *  Prefix - version detection
 ***************************************/
 #define ZSTD_magicNumber 0xFD2FB523   /* v0.3 (current)*/
+#define ZSTD_magicNumberExt 0xFD2FB524   /* v0.3 frame, followed by a frame descriptor byte */
+
+
+/* *************************************
+*  Frame parameters
+***************************************/
+#define ZSTD_frameDescriptor_contentSize 0x03   /* content size field : 0 : none; 1, 2, 3 : 2, 4, 8 bytes LE */
+#define ZSTD_frameDescriptor_checksum    0x04   /* frame ends with XXH64 of content (8 bytes LE), after end mark */
+#define ZSTD_frameDescriptor_window      0x08   /* window descriptor field : 1 byte, windowLog */
+#define ZSTD_frameDescriptor_reserved    0xF0   /* version 0 : must be zero */
+#define ZSTD_FRAMEHEADERSIZE_MAX 14   /* magic, frame descriptor, window descriptor, content size */
+#define ZSTD_WINDOWLOG_REGULAR   19   /* regular frames (ZSTD_magicNumber) never reference data farther back than 1<<ZSTD_WINDOWLOG_REGULAR */
+/*
+  Extended frame header : ZSTD_magicNumberExt (4 bytes LE), frame descriptor (1 byte), then optional fields in this order :
+  window descriptor, content size.
+*/
+
+#define ZSTD_CONTENTSIZE_UNKNOWN (0ULL - 1)
+
+typedef struct
+{
+    unsigned long long contentSize;   /* ZSTD_CONTENTSIZE_UNKNOWN : not recorded */
+    unsigned windowLog;               /* matches reference up to (1<<windowLog) bytes back; 0 : not recorded */
+    unsigned checksumFlag;            /* 1 : frame ends with a checksum of content */
+} ZSTD_frameParams;
+
+size_t ZSTD_getFrameParams(ZSTD_frameParams* fparamsPtr, const void* src, size_t srcSize);
+/*
+  Read frame parameters from the frame header at the beginning of src. Nothing is decoded.
+  @result : 0, and *fparamsPtr is filled;
+            or > 0 : src is too small, result is the size of frame header to provide (<= ZSTD_FRAMEHEADERSIZE_MAX);
+            or an error code (prefix_unknown, frameParameter_unsupported).
+  Regular frames (ZSTD_magicNumber) and legacy frames (v0.1, v0.2) record no parameter :
+  frames with a larger window than 1<<ZSTD_WINDOWLOG_REGULAR are always written with an extended header.
+  ZSTD_decompress() fails with dstSize_tooSmall, before decoding anything, if a recorded content size exceeds maxOriginalSize.
+*/
+
+
+/* *************************************
+*  Skippable frames
+***************************************/
+#define ZSTD_skippableMagicNumberMin  0x184D2A50   /* 16 magic numbers, from Min to Min+15 */
+#define ZSTD_skippableMagicNumberMask 0xFFFFFFF0
+#define ZSTD_skippableHeaderSize  8
+/*
+  A skippable frame is : magic number (4 bytes LE), frame content size (4 bytes LE), then frame content.
+  Decoders jump over it without reading its content : it can carry any user data (metadata, identifiers...).
+  Frames can be concatenated : ZSTD_decompress() regenerates all frames of src in order, skipping skippable ones.
+  With ZSTD_decompressContinue(), a skippable frame requests its whole content in one call, and regenerates nothing.
+*/
+
+size_t ZSTD_writeSkippableFrame(void* dst, size_t maxDstSize, const void* src, size_t srcSize, unsigned magicVariant);
+/*
+  Write src as the content of a skippable frame, using magic number ZSTD_skippableMagicNumberMin + magicVariant.
+  magicVariant must be < 16.
+  @result : size written into dst (srcSize + ZSTD_skippableHeaderSize), or an error code
+*/
+
+
+/* *************************************
+*  Seekable format
+***************************************/
+#define ZSTD_skippableMagicNumber 0x184D2A5E   /* skippable frame holding the seek table */
+#define ZSTD_seekTableMagicNumber 0x8F92EAB1
+#define ZSTD_seekTableFooterSize  8
+#define ZSTD_seekTableEntrySize   8
+/*
+  A seekable source is a sequence of independent frames, followed by a seek table.
+  The seek table is a skippable frame (ignored by decoders unaware of it), whose content is :
+  - one entry per frame, in order : compressed size (4 bytes LE), regenerated size (4 bytes LE)
+  - number of frames (4 bytes LE)
+  - ZSTD_seekTableMagicNumber (4 bytes LE)
+  Compressed sizes include frame header and end mark.
+*/
+
+size_t ZSTD_decompressRange(ZSTD_DCtx* dctx, void* dst, size_t maxDstSize,
+                      const void* src, size_t srcSize, unsigned long long rangeStart);
+/*
+  Regenerate up to maxDstSize bytes, starting at position rangeStart of original content,
+  from a complete seekable source (all frames + seek table).
+  Only frames overlapping requested range are decoded.
+  Frames only partially requested are decoded into a temporary buffer, allocated by this function.
+  @result : nb of bytes written into dst (0 if rangeStart is beyond end of content), or an error code.
+*/
+
+
+/* *************************************
+*  Statistics
+***************************************/
+typedef enum { ZSTD_stage_matchFinding,         /* compression : match search, up to sequences storage */
+               ZSTD_stage_literals,             /* compression : literals sub-block (Huffman) */
+               ZSTD_stage_sequences,            /* compression : sequences (FSE) */
+               ZSTD_stage_decodeLiterals,       /* decompression : ZSTD_decodeLiteralsBlock() */
+               ZSTD_stage_decodeSeqHeaders,     /* decompression : ZSTD_decodeSeqHeaders() */
+               ZSTD_stage_decodeSequences,      /* decompression : sequences decoding and execution */
+               ZSTD_stage_max } ZSTD_stage_e;
+
+#define ZSTD_STATS_MLBUCKETS 32
+
+typedef struct
+{
+    unsigned long long cycles[ZSTD_stage_max];   /* cpu ticks (rdtsc on x86, clock() elsewhere) */
+    unsigned long long nbBlocks[3];              /* compressed, raw, rle */
+    unsigned long long nbSequences;
+    unsigned long long litBytes;                 /* literals of compressed blocks, before entropy coding */
+    unsigned long long matchLengthHistogram[ZSTD_STATS_MLBUCKETS];   /* bucket n : matchLength within [1<<n, 2<<n[ */
+} ZSTD_stats;
+
+size_t ZSTD_getCCtxStats(const ZSTD_CCtx* cctx, ZSTD_stats* stats);
+size_t ZSTD_getDCtxStats(const ZSTD_DCtx* dctx, ZSTD_stats* stats);
+size_t ZSTD_resetCCtxStats(ZSTD_CCtx* cctx);
+size_t ZSTD_resetDCtxStats(ZSTD_DCtx* dctx);
+/*
+  Counters accumulate over all frames handled by a context, from its creation or last reset.
+  They are only collected when the library is compiled with ZSTD_STATS=1 :
+  otherwise, these functions return error stats_unsupported, and contexts carry no counter nor timer.
+  Compression stages only count blocks which go through match search (not rle nor incompressible ones),
+  including blocks finally emitted raw. HC contexts : see ZSTD_HC_getCCtxStats().
+  @result : 0, or an error code
+*/
 
 
 /* *************************************
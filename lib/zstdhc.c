@@ -74,9 +74,56 @@
 /* *************************************
 *  Local Types
 ***************************************/
-#define BLOCKSIZE (128 KB)                 /* define, for static allocation */
+#define BLOCKSIZE ZSTD_BLOCKSIZE_MAX       /* define, for static allocation */
 #define WORKPLACESIZE (BLOCKSIZE*3)
 
+#define ZSTD_OPT_NUM (1<<12)               /* nb of positions considered by optimal parser at once */
+#define ZSTD_HC_RLE_INDEXTAIL 32          /* rle and probed raw blocks : nb of positions indexed at end of block, for next block */
+#define ZSTD_HC_INDEXLIMIT (1U << 30)     /* segment indexes continue from previous segment, up to this limit */
+
+#define ZSTD_HC_LDM_MINMATCH   64   /* length of hashed segments */
+#define ZSTD_HC_LDM_MINLENGTH 512   /* shorter matches do not pay for the extra blocks they create */
+#define ZSTD_HC_LDM_STRIDELOG   7   /* on average, 1 position every (1<<ZSTD_HC_LDM_STRIDELOG) is sampled into ldmTable */
+#define ZSTD_HC_LDM_BUCKETLOG   2   /* several positions kept per hash : the most recent ones may be too close */
+#define ZSTD_HC_LDM_HASHLOG_MIN 8
+
+#define ZSTD_HC_ROW_TAGBITS 8          /* row strategies : hash bits stored into tags */
+#define ZSTD_HC_ROW_HASHCACHE_SIZE 8   /* row strategies : nb of positions hashed ahead; power of 2 */
+
+typedef struct
+{
+    U32 offset;
+    U32 checksum;
+} ZSTD_HC_ldmEntry_t;
+
+typedef struct
+{
+    U32 off;
+    U32 len;
+} ZSTD_HC_match_t;
+
+typedef struct
+{
+    U32 price;    /* cost to reach this position, in 1/256 bits */
+    U32 off;      /* offset of last match */
+    U32 mlen;     /* length of last match ; 1 : last step is a literal */
+    U32 litlen;   /* nb of literals before last match, or since last match when mlen==1 */
+    U32 rep[2];   /* decoder repeat offsets once this position is reached */
+    U32 next;     /* backtracking : end position of next selected match */
+} ZSTD_HC_optimal_t;
+
+typedef struct
+{
+    U32 litFreq[256];
+    U32 litLengthFreq[MaxLL+1];
+    U32 matchLengthFreq[MaxML+1];
+    U32 offCodeFreq[MaxOff+1];
+    U32 litSum;       /* 0 : not initialized yet */
+    U32 litLengthSum;
+    U32 matchLengthSum;
+    U32 offCodeSum;
+} ZSTD_HC_optStats_t;
+
 struct ZSTD_HC_CCtx_s
 {
     const BYTE* end;        /* next block here to continue on current prefix */
@@ -85,45 +132,215 @@ struct ZSTD_HC_CCtx_s
     U32   dictLimit;        /* below that point, need extDict */
     U32   lowLimit;         /* below that point, no more data */
     U32   nextToUpdate;     /* index from which to continue dictionary update */
+    U32   loadedDictEnd;    /* end of loaded dictionary, which can be referenced by next segment */
     ZSTD_HC_parameters params;
     void* workSpace;
     size_t workSpaceSize;
+    size_t staticSize;      /* 0 : allocated by ZSTD_HC_createCCtx() */
+    ZSTD_customMem customMem;   /* { NULL, NULL, NULL } : default malloc() / free() */
+    size_t blockSize;       /* 0 : default (BLOCKSIZE) */
+    U32   checksumFlag;     /* 1 : frames end with a checksum of content */
+    XXH64_state_t checksumState;
+    U64   pledgedSrcSizePlusOne;   /* 0 : unknown; only for next frame */
+    U64   frameContentSizePlusOne;   /* 0 : unknown; pledged size of current frame, checked by ZSTD_HC_compressEnd() */
+    U64   consumedSrcSize;  /* input of current frame */
+    U32   ldmWindowLog;     /* 0 : long distance matching disabled */
+    U32   ldmHashLog;       /* ldmTable size, from ldmWindowLog and srcSizeHint */
+    const ZSTD_HC_levelTable* levelTable;   /* NULL : global level table */
 
     seqStore_t seqStore;    /* sequences storage ptrs */
     U32* hashTable;
     U32* contentTable;
+    U32  rowHashCache[ZSTD_HC_ROW_HASHCACHE_SIZE];   /* row strategies only */
+    U32  rowHashCacheIdx;   /* position of rowHashCache[] first hash; 0 : invalid */
+    ZSTD_HC_ldmEntry_t* ldmTable;  /* long distance matching only */
+    ZSTD_HC_optimal_t* optTable;   /* btopt only */
+    ZSTD_HC_match_t* matchTable;   /* btopt only */
+    ZSTD_HC_optStats_t optStats;   /* btopt only : symbol statistics, used to estimate prices */
 };
 
 
+ZSTD_HC_CCtx* ZSTD_HC_createCCtx_advanced(ZSTD_customMem customMem)
+{
+    ZSTD_HC_CCtx* cctx;
+    if (!customMem.customAlloc != !customMem.customFree) return NULL;   /* both or none */
+    cctx = (ZSTD_HC_CCtx*) ZSTD_malloc(sizeof(ZSTD_HC_CCtx), customMem);
+    if (cctx==NULL) return NULL;
+    memset(cctx, 0, sizeof(ZSTD_HC_CCtx));
+    cctx->customMem = customMem;
+    return cctx;
+}
+
 ZSTD_HC_CCtx* ZSTD_HC_createCCtx(void)
 {
-    return (ZSTD_HC_CCtx*) calloc(1, sizeof(ZSTD_HC_CCtx));
+    const ZSTD_customMem defaultMem = { NULL, NULL, NULL };
+    return ZSTD_HC_createCCtx_advanced(defaultMem);
 }
 
 size_t ZSTD_HC_freeCCtx(ZSTD_HC_CCtx* cctx)
 {
-    free(cctx->workSpace);
-    free(cctx);
+    if (cctx==NULL) return 0;
+    if (cctx->staticSize) return ERROR(memory_allocation);   /* not compatible with static CCtx */
+    ZSTD_free(cctx->workSpace, cctx->customMem);
+    ZSTD_free(cctx, cctx->customMem);
+    return 0;
+}
+
+static size_t ZSTD_HC_optSpaceSize(const ZSTD_HC_parameters* params)
+{
+    if (params->strategy != ZSTD_HC_btopt) return 0;
+    return (ZSTD_OPT_NUM+1) * (sizeof(ZSTD_HC_optimal_t) + sizeof(ZSTD_HC_match_t));
+}
+
+static size_t ZSTD_HC_ldmSpaceSize(U32 ldmHashLog)
+{
+    if (ldmHashLog == 0) return 0;
+    return ((size_t)1 << ldmHashLog) * sizeof(ZSTD_HC_ldmEntry_t);
+}
+
+/* contentTable : binary tree for bt strategies, one tag byte per hashTable cell for row strategies, unused for fast */
+static size_t ZSTD_HC_contentSpaceSize(const ZSTD_HC_parameters* params)
+{
+    switch(params->strategy)
+    {
+    case ZSTD_HC_fast : return 2 * sizeof(U32);
+    case ZSTD_HC_greedy :
+    case ZSTD_HC_lazy :
+    case ZSTD_HC_lazy2 : return (size_t)1 << params->hashLog;
+    default : return ((size_t)1 << params->contentLog) * sizeof(U32);
+    }
+}
+
+static size_t ZSTD_HC_tableSpaceSize(const ZSTD_HC_parameters* params)
+{
+    return ((size_t)1 << params->hashLog) * sizeof(U32) + ZSTD_HC_contentSpaceSize(params);
+}
+
+static size_t ZSTD_HC_workSpaceSize(const ZSTD_HC_parameters* params, U32 ldmHashLog)
+{
+    return ZSTD_HC_tableSpaceSize(params) + ZSTD_HC_ldmSpaceSize(ldmHashLog) + ZSTD_HC_optSpaceSize(params) + WORKPLACESIZE;
+}
+
+size_t ZSTD_HC_estimateCCtxSize(ZSTD_HC_parameters params)
+{
+    ZSTD_HC_validateParams(&params, 0);
+    return sizeof(ZSTD_HC_CCtx) + ZSTD_HC_workSpaceSize(&params, 0);
+}
+
+ZSTD_HC_CCtx* ZSTD_HC_initStaticCCtx(void* workspace, size_t workspaceSize)
+{
+    ZSTD_HC_CCtx* const cctx = (ZSTD_HC_CCtx*)workspace;
+    if (workspaceSize <= sizeof(ZSTD_HC_CCtx)) return NULL;
+    if ((size_t)workspace & 7) return NULL;   /* 8-bytes aligned */
+    memset(cctx, 0, sizeof(ZSTD_HC_CCtx));
+    cctx->staticSize = workspaceSize;
+    cctx->workSpace = (void*)(cctx+1);
+    cctx->workSpaceSize = workspaceSize - sizeof(ZSTD_HC_CCtx);
+    return cctx;
+}
+
+size_t ZSTD_HC_getCCtxStats(const ZSTD_HC_CCtx* ctx, ZSTD_stats* stats)
+{
+#if ZSTD_STATS
+    *stats = ctx->seqStore.stats;
+    return 0;
+#else
+    (void)ctx; (void)stats;
+    return ERROR(stats_unsupported);
+#endif
+}
+
+size_t ZSTD_HC_resetCCtxStats(ZSTD_HC_CCtx* ctx)
+{
+#if ZSTD_STATS
+    memset(&ctx->seqStore.stats, 0, sizeof(ctx->seqStore.stats));
+    return 0;
+#else
+    (void)ctx;
+    return ERROR(stats_unsupported);
+#endif
+}
+
+size_t ZSTD_HC_setBlockSize(ZSTD_HC_CCtx* ctx, size_t blockSize)
+{
+    if ((blockSize > ZSTD_BLOCKSIZE_MAX) || ((blockSize) && (blockSize < ZSTD_BLOCKSIZE_MIN))) return ERROR(srcSize_wrong);
+    ctx->blockSize = blockSize;
+    return 0;
+}
+
+size_t ZSTD_HC_setContentChecksum(ZSTD_HC_CCtx* ctx, unsigned checksumFlag)
+{
+    ctx->checksumFlag = (checksumFlag!=0);
+    return 0;
+}
+
+size_t ZSTD_HC_setPledgedSrcSize(ZSTD_HC_CCtx* ctx, unsigned long long pledgedSrcSize)
+{
+    if (pledgedSrcSize == ZSTD_CONTENTSIZE_UNKNOWN) return ERROR(srcSize_wrong);
+    ctx->pledgedSrcSizePlusOne = pledgedSrcSize+1;
+    return 0;
+}
+
+size_t ZSTD_HC_setLongDistance(ZSTD_HC_CCtx* ctx, U32 ldmWindowLog)
+{
+    if ((ldmWindowLog > ZSTD_HC_LDM_WINDOWLOG_MAX) || ((ldmWindowLog) && (ldmWindowLog < ZSTD_HC_LDM_WINDOWLOG_MIN))) return ERROR(GENERIC);
+    ctx->ldmWindowLog = ldmWindowLog;
+    return 0;
+}
+
+
+/* *************************************
+*  Level tables
+***************************************/
+static const ZSTD_HC_levelTable* g_ZSTD_HC_levelTable = NULL;   /* NULL : ZSTD_HC_defaultParameters */
+
+size_t ZSTD_HC_setGlobalLevelTable(const ZSTD_HC_levelTable* table)
+{
+    g_ZSTD_HC_levelTable = table;
+    return 0;
+}
+
+const ZSTD_HC_levelTable* ZSTD_HC_getGlobalLevelTable(void)
+{
+    return g_ZSTD_HC_levelTable;
+}
+
+size_t ZSTD_HC_setLevelTable(ZSTD_HC_CCtx* ctx, const ZSTD_HC_levelTable* table)
+{
+    ctx->levelTable = table;
     return 0;
 }
 
+/* ZSTD_HC_levelParams() :
+*  ctx is optional (NULL : global table only); entries are still to be validated */
+static ZSTD_HC_parameters ZSTD_HC_levelParams(const ZSTD_HC_CCtx* ctx, int compressionLevel, int tableID)
+{
+    const ZSTD_HC_levelTable* table = g_ZSTD_HC_levelTable;
+    if ((ctx != NULL) && (ctx->levelTable != NULL)) table = ctx->levelTable;
+    if (table == NULL) table = &ZSTD_HC_defaultParameters;
+    if (compressionLevel<=0) compressionLevel = 1;
+    if (compressionLevel > ZSTD_HC_MAX_CLEVEL) compressionLevel = ZSTD_HC_MAX_CLEVEL;
+    return (*table)[tableID][compressionLevel];
+}
+
 
 /** ZSTD_HC_validateParams
     correct params value to remain within authorized range
     optimize for srcSize if srcSize > 0 */
 void ZSTD_HC_validateParams(ZSTD_HC_parameters* params, U64 srcSizeHint)
 {
-    const U32 btPlus = (params->strategy == ZSTD_HC_btlazy2);
+    const U32 btPlus = (params->strategy >= ZSTD_HC_btlazy2);
 
     /* validate params */
     if (params->windowLog   > ZSTD_HC_WINDOWLOG_MAX) params->windowLog = ZSTD_HC_WINDOWLOG_MAX;
     if (params->windowLog   < ZSTD_HC_WINDOWLOG_MIN) params->windowLog = ZSTD_HC_WINDOWLOG_MIN;
 
-    /* correct params, to use less memory */
+    /* correct params, to use less memory : tables scale with srcSize, by power of 2 classes */
     if ((srcSizeHint > 0) && (srcSizeHint < (1<<ZSTD_HC_WINDOWLOG_MAX)))
     {
         U32 srcLog = ZSTD_highbit((U32)srcSizeHint-1) + 1;
         if (params->windowLog > srcLog) params->windowLog = srcLog;
+        if (params->hashLog > srcLog+1) params->hashLog = srcLog+1;
     }
 
     if (params->contentLog  > params->windowLog+btPlus) params->contentLog = params->windowLog+btPlus;   /* <= ZSTD_HC_CONTENTLOG_MAX */
@@ -134,7 +351,7 @@ void ZSTD_HC_validateParams(ZSTD_HC_parameters* params, U64 srcSizeHint)
     if (params->searchLog   < ZSTD_HC_SEARCHLOG_MIN) params->searchLog = ZSTD_HC_SEARCHLOG_MIN;
     if (params->searchLength> ZSTD_HC_SEARCHLENGTH_MAX) params->searchLength = ZSTD_HC_SEARCHLENGTH_MAX;
     if (params->searchLength< ZSTD_HC_SEARCHLENGTH_MIN) params->searchLength = ZSTD_HC_SEARCHLENGTH_MIN;
-    if ((U32)params->strategy>(U32)ZSTD_HC_btlazy2) params->strategy = ZSTD_HC_btlazy2;
+    if ((U32)params->strategy>(U32)ZSTD_HC_btopt) params->strategy = ZSTD_HC_btopt;
 }
 
 
@@ -142,32 +359,70 @@ static size_t ZSTD_HC_resetCCtx_advanced (ZSTD_HC_CCtx* zc,
                                           ZSTD_HC_parameters params,
                                           U64 srcSizeHint)
 {
+    const U32 prevLdmHashLog = zc->ldmHashLog;
+    U32 startIndex = 0;
     ZSTD_HC_validateParams(&params, srcSizeHint);
 
+    /* new segment indexes continue beyond previous ones : entries below lowLimit become invalid, without clearing tables */
+    if ((zc->base != NULL) && (zc->end != NULL))
+    {
+        startIndex = (U32)(zc->end - zc->base);
+        if (zc->nextToUpdate > startIndex) startIndex = zc->nextToUpdate;
+    }
+    if ( (params.hashLog != zc->params.hashLog) || (params.contentLog != zc->params.contentLog)
+      || (params.searchLog != zc->params.searchLog) || (params.strategy != zc->params.strategy) )
+        startIndex = 0;   /* different table layout */
+
+    /* long distance matching : table size follows window size, within srcSizeHint */
+    zc->ldmHashLog = 0;
+    if (zc->ldmWindowLog)
+    {
+        U32 ldmWindowLog = zc->ldmWindowLog;
+        if ((srcSizeHint > 0) && (srcSizeHint < ((U64)1 << ldmWindowLog)))
+        {
+            U32 srcLog = ZSTD_highbit((U32)srcSizeHint-1) + 1;
+            if (ldmWindowLog > srcLog) ldmWindowLog = srcLog;
+        }
+        zc->ldmHashLog = ldmWindowLog - ZSTD_HC_LDM_STRIDELOG;
+        if (ldmWindowLog < ZSTD_HC_LDM_HASHLOG_MIN + ZSTD_HC_LDM_STRIDELOG) zc->ldmHashLog = ZSTD_HC_LDM_HASHLOG_MIN;
+    }
+    if (zc->ldmHashLog != prevLdmHashLog) startIndex = 0;
+
     /* reserve table memory */
     {
-        const U32 contentLog = params.strategy == ZSTD_HC_fast ? 1 : params.contentLog;
-        const size_t tableSpace = ((1 << contentLog) + (1 << params.hashLog)) * sizeof(U32);
-        const size_t neededSpace = tableSpace + WORKPLACESIZE;
+        const size_t tableSpace = ZSTD_HC_tableSpaceSize(&params) + ZSTD_HC_ldmSpaceSize(zc->ldmHashLog);
+        const size_t neededSpace = ZSTD_HC_workSpaceSize(&params, zc->ldmHashLog);
         if (zc->workSpaceSize < neededSpace)
         {
-            free(zc->workSpace);
+            if (zc->staticSize) return ERROR(memory_allocation);   /* static CCtx : workspace cannot grow */
+            ZSTD_free(zc->workSpace, zc->customMem);
             zc->workSpaceSize = neededSpace;
-            zc->workSpace = malloc(neededSpace);
-            if (zc->workSpace == NULL) return ERROR(memory_allocation);
+            zc->workSpace = ZSTD_malloc(neededSpace, zc->customMem);
+            if (zc->workSpace == NULL) { zc->workSpaceSize = 0; return ERROR(memory_allocation); }
+            startIndex = 0;
+        }
+        if ((startIndex==0) || (startIndex > ZSTD_HC_INDEXLIMIT))
+        {
+            memset(zc->workSpace, 0, tableSpace);
+            startIndex = 1;   /* index 0 is the value of cleared entries */
         }
-        memset(zc->workSpace, 0, tableSpace );
         zc->hashTable = (U32*)(zc->workSpace);
         zc->contentTable = zc->hashTable + ((size_t)1 << params.hashLog);
-        zc->seqStore.buffer = (void*) (zc->contentTable + ((size_t)1 << contentLog));
+        zc->ldmTable = (ZSTD_HC_ldmEntry_t*) ((BYTE*)zc->contentTable + ZSTD_HC_contentSpaceSize(&params));
+        zc->optTable = (ZSTD_HC_optimal_t*) ((BYTE*)zc->ldmTable + ZSTD_HC_ldmSpaceSize(zc->ldmHashLog));
+        zc->matchTable = (ZSTD_HC_match_t*) (zc->optTable + (ZSTD_OPT_NUM+1));   /* only valid for btopt */
+        zc->seqStore.buffer = (void*) ((BYTE*)zc->optTable + ZSTD_HC_optSpaceSize(&params));
     }
+    zc->optStats.litSum = 0;   /* statistics are collected from first block */
 
-    zc->nextToUpdate = 1;
+    zc->nextToUpdate = startIndex+1;
+    zc->rowHashCacheIdx = 0;
     zc->end = NULL;
-    zc->base = NULL;
+    zc->base = NULL;   /* set by first segment, as src - dictLimit */
     zc->dictBase = NULL;
-    zc->dictLimit = 0;
-    zc->lowLimit = 0;
+    zc->dictLimit = startIndex;
+    zc->lowLimit = startIndex;
+    zc->loadedDictEnd = 0;
     zc->params = params;
     zc->seqStore.offsetStart = (U32*) (zc->seqStore.buffer);
     zc->seqStore.offCodeStart = (BYTE*) (zc->seqStore.offsetStart + (BLOCKSIZE>>2));
@@ -175,6 +430,7 @@ static size_t ZSTD_HC_resetCCtx_advanced (ZSTD_HC_CCtx* zc,
     zc->seqStore.litLengthStart =  zc->seqStore.litStart + BLOCKSIZE;
     zc->seqStore.matchLengthStart = zc->seqStore.litLengthStart + (BLOCKSIZE>>2);
     zc->seqStore.dumpsStart = zc->seqStore.matchLengthStart + (BLOCKSIZE>>2);
+    ZSTD_resetSeqTables(&zc->seqStore);
 
     return 0;
 }
@@ -226,12 +482,14 @@ size_t ZSTD_HC_compressBlock_fast_generic(ZSTD_HC_CCtx* ctx,
     const U32 hBits = ctx->params.hashLog;
     seqStore_t* seqStorePtr = &(ctx->seqStore);
     const BYTE* const base = ctx->base;
+    const U32 lowIndex = ctx->dictLimit;
+    const BYTE* const prefixStart = base + lowIndex;
     const size_t maxDist = ((size_t)1 << ctx->params.windowLog);
 
     const BYTE* const istart = (const BYTE*)src;
     const BYTE* ip = istart;
     const BYTE* anchor = istart;
-    const BYTE* const lowest = (size_t)(istart-base) > maxDist ? istart-maxDist : base;
+    const BYTE* const lowest = (size_t)(istart-prefixStart) > maxDist ? istart-maxDist : prefixStart;
     const BYTE* const iend = istart + srcSize;
     const BYTE* const ilimit = iend - 8;
 
@@ -239,12 +497,12 @@ size_t ZSTD_HC_compressBlock_fast_generic(ZSTD_HC_CCtx* ctx,
 
 
     /* init */
-    if (ip == base)
+    if (ip == prefixStart)
     {
-        hashTable[ZSTD_HC_hashPtr(base+1, hBits, mls)] = 1;
-        hashTable[ZSTD_HC_hashPtr(base+2, hBits, mls)] = 2;
-        hashTable[ZSTD_HC_hashPtr(base+3, hBits, mls)] = 3;
-        ip = base+4;
+        hashTable[ZSTD_HC_hashPtr(prefixStart+1, hBits, mls)] = lowIndex+1;
+        hashTable[ZSTD_HC_hashPtr(prefixStart+2, hBits, mls)] = lowIndex+2;
+        hashTable[ZSTD_HC_hashPtr(prefixStart+3, hBits, mls)] = lowIndex+3;
+        ip = prefixStart+4;
     }
     ZSTD_resetSeqStore(seqStorePtr);
 
@@ -259,7 +517,7 @@ size_t ZSTD_HC_compressBlock_fast_generic(ZSTD_HC_CCtx* ctx,
         if ( (match < lowest) ||
              (MEM_read32(match) != MEM_read32(ip)) )
         { ip += ((ip-anchor) >> g_searchStrength) + 1; offset_2 = offset_1; continue; }
-        while ((ip>anchor) && (match>base) && (ip[-1] == match[-1])) { ip--; match--; }  /* catch up */
+        while ((ip>anchor) && (match>prefixStart) && (ip[-1] == match[-1])) { ip--; match--; }  /* catch up */
 
         {
             size_t litLength = ip-anchor;
@@ -312,12 +570,122 @@ size_t ZSTD_HC_compressBlock_fast(ZSTD_HC_CCtx* ctx,
 }
 
 
+FORCE_INLINE
+size_t ZSTD_HC_compressBlock_fast_extDict_generic(ZSTD_HC_CCtx* ctx,
+                                                  void* dst, size_t maxDstSize,
+                                            const void* src, size_t srcSize,
+                                            const U32 mls)
+{
+    U32* hashTable = ctx->hashTable;
+    const U32 hBits = ctx->params.hashLog;
+    seqStore_t* seqStorePtr = &(ctx->seqStore);
+    const BYTE* const base = ctx->base;
+    const BYTE* const dictBase = ctx->dictBase;
+    const U32 maxDist = 1 << ctx->params.windowLog;
+
+    const BYTE* const istart = (const BYTE*)src;
+    const BYTE* ip = istart;
+    const BYTE* anchor = istart;
+    const U32 blockStart = (U32)(istart-base);
+    const U32 lowLimit = (ctx->lowLimit + maxDist >= blockStart) ? ctx->lowLimit : blockStart - maxDist;
+    const U32 dictLimit = ctx->dictLimit;
+    const BYTE* const dictStart = dictBase + lowLimit;
+    const BYTE* const dictEnd = dictBase + dictLimit;
+    const BYTE* const prefixStart = base + dictLimit;
+    const BYTE* const iend = istart + srcSize;
+    const BYTE* const ilimit = iend - 8;
+
+    U32 offset_2=REPCODE_STARTVALUE, offset_1=REPCODE_STARTVALUE;
+
+
+    /* init */
+    ZSTD_resetSeqStore(seqStorePtr);
+    hashTable[ZSTD_HC_hashPtr(ip, hBits, mls)] = blockStart;
+    ip++;
+
+    /* Main Search Loop */
+    while (ip < ilimit)  /* < instead of <=, because unconditionnal ZSTD_addPtr(ip+1) */
+    {
+        const size_t h = ZSTD_HC_hashPtr(ip, hBits, mls);
+        const U32 current = (U32)(ip-base);
+        const U32 repIndex = current - offset_2;
+        U32 matchIndex = hashTable[h];
+        const BYTE* match = (matchIndex < dictLimit ? dictBase : base) + matchIndex;
+        hashTable[h] = current;   /* update hash table */
+
+        if ( ((U32)((dictLimit-1) - repIndex) >= 3)   /* intentional underflow : 4 bytes must not straddle dictionary end */
+            && (repIndex >= lowLimit) )
+        {
+            const BYTE* const repMatch = (repIndex < dictLimit ? dictBase : base) + repIndex;
+            if (MEM_read32(repMatch) == MEM_read32(ip)) match = repMatch, matchIndex = repIndex;
+        }
+        if ( (matchIndex < lowLimit) || ((U32)((dictLimit-1) - matchIndex) < 3)
+            || (MEM_read32(match) != MEM_read32(ip)) )
+        { ip += ((ip-anchor) >> g_searchStrength) + 1; offset_2 = offset_1; continue; }
+
+        {
+            const BYTE* const matchEnd = matchIndex < dictLimit ? dictEnd : iend;
+            const BYTE* const lowMatchPtr = matchIndex < dictLimit ? dictStart : prefixStart;
+            const U32 offset = current - matchIndex;
+            size_t litLength, matchLength, offsetCode;
+            while ((ip>anchor) && (match>lowMatchPtr) && (ip[-1] == match[-1])) { ip--; match--; }  /* catch up */
+            litLength = ip-anchor;
+            matchLength = ZSTD_count_2segments(ip+MINMATCH, match+MINMATCH, iend, matchEnd, prefixStart);
+            offsetCode = offset;
+            if (offset == offset_2) offsetCode = 0;
+            offset_2 = offset_1;
+            offset_1 = offset;
+            ZSTD_storeSeq(seqStorePtr, litLength, anchor, offsetCode, matchLength);
+
+            /* Fill Table */
+            hashTable[ZSTD_HC_hashPtr(ip+1, hBits, mls)] = (U32)(ip+1-base);
+            ip += matchLength + MINMATCH;
+            anchor = ip;
+            if (ip < ilimit) /* same test as loop, for speed */
+                hashTable[ZSTD_HC_hashPtr(ip-2, hBits, mls)] = (U32)(ip-2-base);
+        }
+    }
+
+    /* Last Literals */
+    {
+        size_t lastLLSize = iend - anchor;
+        memcpy(seqStorePtr->lit, anchor, lastLLSize);
+        seqStorePtr->lit += lastLLSize;
+    }
+
+    /* Finale compression stage */
+    return ZSTD_compressSequences((BYTE*)dst, maxDstSize,
+                                  seqStorePtr, srcSize);
+}
+
+
+size_t ZSTD_HC_compressBlock_fast_extDict(ZSTD_HC_CCtx* ctx,
+                                          void* dst, size_t maxDstSize,
+                                    const void* src, size_t srcSize)
+{
+    const U32 mls = ctx->params.searchLength;
+    switch(mls)
+    {
+    default:
+    case 4 :
+        return ZSTD_HC_compressBlock_fast_extDict_generic(ctx, dst, maxDstSize, src, srcSize, 4);
+    case 5 :
+        return ZSTD_HC_compressBlock_fast_extDict_generic(ctx, dst, maxDstSize, src, srcSize, 5);
+    case 6 :
+        return ZSTD_HC_compressBlock_fast_extDict_generic(ctx, dst, maxDstSize, src, srcSize, 6);
+    case 7 :
+        return ZSTD_HC_compressBlock_fast_extDict_generic(ctx, dst, maxDstSize, src, srcSize, 7);
+    }
+}
+
+
 /* *************************************
 *  Binary Tree search
 ***************************************/
 /** ZSTD_HC_insertBt1 : add one ptr to tree
     @ip : assumed <= iend-8 */
-static U32 ZSTD_HC_insertBt1(ZSTD_HC_CCtx* zc, const BYTE* const ip, const U32 mls, const BYTE* const iend, U32 nbCompares)
+static U32 ZSTD_HC_insertBt1(ZSTD_HC_CCtx* zc, const BYTE* const ip, const U32 mls, const BYTE* const iend, U32 nbCompares,
+                             const U32 extDict)
 {
     U32* const hashTable = zc->hashTable;
     const U32 hashLog = zc->params.hashLog;
@@ -328,6 +696,10 @@ static U32 ZSTD_HC_insertBt1(ZSTD_HC_CCtx* zc, const BYTE* const ip, const U32 m
     U32 matchIndex  = hashTable[h];
     size_t commonLengthSmaller=0, commonLengthLarger=0;
     const BYTE* const base = zc->base;
+    const BYTE* const dictBase = zc->dictBase;
+    const U32 dictLimit = zc->dictLimit;
+    const BYTE* const dictEnd = dictBase + dictLimit;
+    const BYTE* const prefixStart = base + dictLimit;
     const BYTE* match = base + matchIndex;
     U32 current = (U32)(ip-base);
     const U32 btLow = btMask >= current ? 0 : current - btMask;
@@ -335,9 +707,10 @@ static U32 ZSTD_HC_insertBt1(ZSTD_HC_CCtx* zc, const BYTE* const ip, const U32 m
     U32* largerPtr  = bt + 2*(current&btMask) + 1;
     U32 dummy32;   /* to be nullified at the end */
     const U32 windowSize = 1 << zc->params.windowLog;
-    const U32 windowLow = windowSize >= current ? 0 : current - windowSize;
+    const U32 windowLow = (zc->lowLimit + windowSize >= current) ? zc->lowLimit : current - windowSize;
 
     if ((current-matchIndex == 1)   /* RLE */
+        && ((!extDict) || (matchIndex >= dictLimit))
         && MEM_read64(match) == MEM_read64(ip))
     {
         size_t rleLength = ZSTD_count(ip+sizeof(size_t), match+sizeof(size_t), iend) + sizeof(size_t);
@@ -351,8 +724,18 @@ static U32 ZSTD_HC_insertBt1(ZSTD_HC_CCtx* zc, const BYTE* const ip, const U32 m
         U32* nextPtr = bt + 2*(matchIndex & btMask);
         size_t matchLength = MIN(commonLengthSmaller, commonLengthLarger);   /* guaranteed minimum nb of common bytes */
 
-        match = base + matchIndex;
-        matchLength += ZSTD_count(ip+matchLength, match+matchLength, iend);
+        if ((!extDict) || (matchIndex+matchLength >= dictLimit))
+        {
+            match = base + matchIndex;
+            matchLength += ZSTD_count(ip+matchLength, match+matchLength, iend);
+        }
+        else
+        {
+            match = dictBase + matchIndex;
+            matchLength += ZSTD_count_2segments(ip+matchLength, match+matchLength, iend, dictEnd, prefixStart);
+            if (matchIndex+matchLength >= dictLimit)
+                match = base + matchIndex;   /* to prepare for next usage of match[matchLength] */
+        }
 
         if (ip+matchLength == iend)   /* equal : no way to know if inf or sup */
             break;   /* just drop , to guarantee consistency (miss a bit of compression; if someone knows better, please tell) */
@@ -387,7 +770,8 @@ size_t ZSTD_HC_insertBtAndFindBestMatch (
                         ZSTD_HC_CCtx* zc,
                         const BYTE* const ip, const BYTE* const iend,
                         size_t* offsetPtr,
-                        U32 nbCompares, const U32 mls)
+                        U32 nbCompares, const U32 mls,
+                        const U32 extDict)
 {
     U32* const hashTable = zc->hashTable;
     const U32 hashLog = zc->params.hashLog;
@@ -398,10 +782,14 @@ size_t ZSTD_HC_insertBtAndFindBestMatch (
     U32 matchIndex  = hashTable[h];
     size_t commonLengthSmaller=0, commonLengthLarger=0;
     const BYTE* const base = zc->base;
+    const BYTE* const dictBase = zc->dictBase;
+    const U32 dictLimit = zc->dictLimit;
+    const BYTE* const dictEnd = dictBase + dictLimit;
+    const BYTE* const prefixStart = base + dictLimit;
     const U32 current = (U32)(ip-base);
     const U32 btLow = btMask >= current ? 0 : current - btMask;
     const U32 windowSize = 1 << zc->params.windowLog;
-    const U32 windowLow = windowSize >= current ? 0 : current - windowSize;
+    const U32 windowLow = (zc->lowLimit + windowSize >= current) ? zc->lowLimit : current - windowSize;
     U32* smallerPtr = bt + 2*(current&btMask);
     U32* largerPtr  = bt + 2*(current&btMask) + 1;
     size_t bestLength = 0;
@@ -412,10 +800,21 @@ size_t ZSTD_HC_insertBtAndFindBestMatch (
     while (nbCompares-- && (matchIndex > windowLow))
     {
         U32* nextPtr = bt + 2*(matchIndex & btMask);
-        const BYTE* match = base + matchIndex;
         size_t matchLength = MIN(commonLengthSmaller, commonLengthLarger);   /* guaranteed minimum nb of common bytes */
+        const BYTE* match;
 
-        matchLength += ZSTD_count(ip+matchLength, match+matchLength, iend);
+        if ((!extDict) || (matchIndex+matchLength >= dictLimit))
+        {
+            match = base + matchIndex;
+            matchLength += ZSTD_count(ip+matchLength, match+matchLength, iend);
+        }
+        else
+        {
+            match = dictBase + matchIndex;
+            matchLength += ZSTD_count_2segments(ip+matchLength, match+matchLength, iend, dictEnd, prefixStart);
+            if (matchIndex+matchLength >= dictLimit)
+                match = base + matchIndex;   /* to prepare for next usage of match[matchLength] */
+        }
 
         if (matchLength > bestLength)
         {
@@ -452,7 +851,7 @@ size_t ZSTD_HC_insertBtAndFindBestMatch (
 }
 
 
-static const BYTE* ZSTD_HC_updateTree(ZSTD_HC_CCtx* zc, const BYTE* const ip, const BYTE* const iend, const U32 nbCompares, const U32 mls)
+static const BYTE* ZSTD_HC_updateTree(ZSTD_HC_CCtx* zc, const BYTE* const ip, const BYTE* const iend, const U32 nbCompares, const U32 mls, const U32 extDict)
 {
     const BYTE* const base = zc->base;
     const U32 target = (U32)(ip - base);
@@ -460,7 +859,7 @@ static const BYTE* ZSTD_HC_updateTree(ZSTD_HC_CCtx* zc, const BYTE* const ip, co
     //size_t dummy;
 
     for( ; idx < target ; )
-        idx += ZSTD_HC_insertBt1(zc, base+idx, mls, iend, nbCompares);
+        idx += ZSTD_HC_insertBt1(zc, base+idx, mls, iend, nbCompares, extDict);
         //ZSTD_HC_insertBtAndFindBestMatch(zc, base+idx, iend, &dummy, nbCompares, mls);
 
     zc->nextToUpdate = idx;
@@ -474,16 +873,17 @@ size_t ZSTD_HC_BtFindBestMatch (
                         ZSTD_HC_CCtx* zc,
                         const BYTE* const ip, const BYTE* const iLimit,
                         size_t* offsetPtr,
-                        const U32 maxNbAttempts, const U32 mls)
+                        const U32 maxNbAttempts, const U32 mls,
+                        const U32 extDict)
 {
-    const BYTE* nextToUpdate = ZSTD_HC_updateTree(zc, ip, iLimit, maxNbAttempts, mls);
+    const BYTE* nextToUpdate = ZSTD_HC_updateTree(zc, ip, iLimit, maxNbAttempts, mls, extDict);
     if (nextToUpdate > ip)
     {
         /* RLE data */
         *offsetPtr = 1;
         return ZSTD_count(ip, ip-1, iLimit);
     }
-    return ZSTD_HC_insertBtAndFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, mls);
+    return ZSTD_HC_insertBtAndFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, mls, extDict);
 }
 
 
@@ -496,118 +896,229 @@ FORCE_INLINE size_t ZSTD_HC_BtFindBestMatch_selectMLS (
     switch(matchLengthSearch)
     {
     default :
-    case 4 : return ZSTD_HC_BtFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 4);
-    case 5 : return ZSTD_HC_BtFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 5);
-    case 6 : return ZSTD_HC_BtFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 6);
+    case 4 : return ZSTD_HC_BtFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 4, 0);
+    case 5 : return ZSTD_HC_BtFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 5, 0);
+    case 6 : return ZSTD_HC_BtFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 6, 0);
+    }
+}
+
+
+FORCE_INLINE size_t ZSTD_HC_BtFindBestMatch_selectMLS_extDict (
+                        ZSTD_HC_CCtx* zc,   /* Index table will be updated */
+                        const BYTE* ip, const BYTE* const iLimit,
+                        size_t* offsetPtr,
+                        const U32 maxNbAttempts, const U32 matchLengthSearch)
+{
+    switch(matchLengthSearch)
+    {
+    default :
+    case 4 : return ZSTD_HC_BtFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 4, 1);
+    case 5 : return ZSTD_HC_BtFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 5, 1);
+    case 6 : return ZSTD_HC_BtFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 6, 1);
     }
 }
 
 
 /* ***********************
-*  Hash Chain
+*  Row hash
 *************************/
+/* greedy and lazy strategies store positions into rows of (1<<rowLog) cells sharing the same hash.
+*  Each cell also receives an 8-bits tag, made of other hash bits : a single compare of all tags of a row
+*  selects candidates, which stay within a few cache lines, instead of walking a chain of dependent loads.
+*  hashTable : positions; contentTable : tags.
+*  Cell 0 of each tag row stores row head (most recent cell), so that each row keeps (1<<rowLog)-1 positions. */
 
-#define NEXT_IN_CHAIN(d, mask)   chainTable[(d) & mask]
 
-/* Update chains up to ip (excluded) */
-static U32 ZSTD_HC_insertAndFindFirstIndex  (ZSTD_HC_CCtx* zc, const BYTE* ip, U32 mls)
+static U32 ZSTD_HC_rowLog(const ZSTD_HC_parameters* params)
+{
+    const U32 rowLog = params->searchLog > 4 ? 5 : 4;
+    return MIN(rowLog, params->hashLog);
+}
+
+/** ZSTD_HC_rowMatchMask
+    @return : bit n is set when tagRow[n] == tag */
+FORCE_INLINE U32 ZSTD_HC_rowMatchMask(const BYTE* tagRow, BYTE tag, U32 rowLog)
+{
+#ifdef ZSTD_SSE2
+    const __m128i tags = _mm_set1_epi8((char)tag);
+    U32 mask = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)tagRow), tags));
+    if (rowLog == 5) mask |= (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(tagRow+16)), tags)) << 16;
+    return mask;
+#else
+    U32 mask = 0;
+    int n;
+    for (n=(1<<rowLog)-1; n>=0; n--) mask = (mask << 1) | (tagRow[n] == tag);
+    return mask;
+#endif
+}
+
+FORCE_INLINE U32 ZSTD_HC_rowHash(const BYTE* p, U32 hashLog, U32 rowLog, U32 mls)
+{
+    return (U32)ZSTD_HC_hashPtr(p, hashLog - rowLog + ZSTD_HC_ROW_TAGBITS, mls);
+}
+
+/* rowHashCache[] keeps hashes of the ZSTD_HC_ROW_HASHCACHE_SIZE positions following nextToUpdate,
+*  so that their rows can be prefetched before being needed */
+static void ZSTD_HC_rowFillHashCache(ZSTD_HC_CCtx* zc, U32 idx, const BYTE* iLimit, U32 mls, U32 rowLog)
 {
-    U32* const hashTable  = zc->hashTable;
-    const U32 hashLog = zc->params.hashLog;
-    U32* const chainTable = zc->contentTable;
-    const U32 chainMask = (1 << zc->params.contentLog) - 1;
     const BYTE* const base = zc->base;
-    const U32 target = (U32)(ip - base);
+    U32 n;
+    for (n=0; n<ZSTD_HC_ROW_HASHCACHE_SIZE; n++)
+    {
+        const BYTE* const p = base + idx + n;
+        zc->rowHashCache[(idx+n) & (ZSTD_HC_ROW_HASHCACHE_SIZE-1)] = (p+8 <= iLimit) ? ZSTD_HC_rowHash(p, zc->params.hashLog, rowLog, mls) : 0;   /* beyond iLimit : never inserted within this block */
+    }
+    zc->rowHashCacheIdx = idx;
+}
+
+/** ZSTD_HC_rowNextHash
+    @return : cached hash of position idx, replaced by the one of idx + ZSTD_HC_ROW_HASHCACHE_SIZE */
+FORCE_INLINE U32 ZSTD_HC_rowNextHash(ZSTD_HC_CCtx* zc, U32 idx, const BYTE* iLimit, U32 mls, U32 rowLog)
+{
+    const BYTE* const p = zc->base + idx + ZSTD_HC_ROW_HASHCACHE_SIZE;
+    U32* const cached = zc->rowHashCache + (idx & (ZSTD_HC_ROW_HASHCACHE_SIZE-1));
+    const U32 h = *cached;
+    *cached = 0;
+    if (p+8 <= iLimit)
+    {
+        const U32 hNext = ZSTD_HC_rowHash(p, zc->params.hashLog, rowLog, mls);
+        const size_t nextRow = (size_t)(hNext >> ZSTD_HC_ROW_TAGBITS) << rowLog;
+        ZSTD_PREFETCH((const BYTE*)zc->contentTable + nextRow);
+        ZSTD_PREFETCH(zc->hashTable + nextRow);
+        *cached = hNext;
+    }
+    return h;
+}
+
+/* Update rows up to ip (excluded) */
+FORCE_INLINE void ZSTD_HC_rowUpdate(ZSTD_HC_CCtx* zc, const BYTE* ip, const BYTE* iLimit, U32 mls, U32 rowLog)
+{
+    U32* const hashTable = zc->hashTable;
+    BYTE* const tagTable = (BYTE*)zc->contentTable;
+    const U32 lastCell = (1 << rowLog) - 1;
+    const U32 target = (U32)(ip - zc->base);
     U32 idx = zc->nextToUpdate;
 
+    if (idx != zc->rowHashCacheIdx) ZSTD_HC_rowFillHashCache(zc, idx, iLimit, mls, rowLog);
+
     while(idx < target)
     {
-        size_t h = ZSTD_HC_hashPtr(base+idx, hashLog, mls);
-        NEXT_IN_CHAIN(idx, chainMask) = hashTable[h];
-        hashTable[h] = idx;
+        const U32 h = ZSTD_HC_rowNextHash(zc, idx, iLimit, mls, rowLog);
+        const size_t rowStart = (size_t)(h >> ZSTD_HC_ROW_TAGBITS) << rowLog;
+        BYTE* const tagRow = tagTable + rowStart;
+        const U32 head = (tagRow[0] <= 1) ? lastCell : tagRow[0] - 1U;   /* cells [1-lastCell], newest first */
+        tagRow[0] = (BYTE)head;
+        tagRow[head] = (BYTE)h;
+        hashTable[rowStart + head] = idx;
         idx++;
     }
 
-    zc->nextToUpdate = target;
-    return hashTable[ZSTD_HC_hashPtr(ip, hashLog, mls)];
+    zc->nextToUpdate = idx;
+    zc->rowHashCacheIdx = idx;
 }
 
 
 FORCE_INLINE /* inlining is important to hardwire a hot branch (template emulation) */
-size_t ZSTD_HC_HcFindBestMatch (
+size_t ZSTD_HC_RowFindBestMatch (
                         ZSTD_HC_CCtx* zc,   /* Index table will be updated */
                         const BYTE* const ip, const BYTE* const iLimit,
                         size_t* offsetPtr,
-                        const U32 maxNbAttempts, const U32 matchLengthSearch)
+                        const U32 maxNbAttempts, const U32 matchLengthSearch, const U32 rowLog)
 {
-    U32* const chainTable = zc->contentTable;
-    const U32 chainSize = (1 << zc->params.contentLog);
-    const U32 chainMask = chainSize-1;
+    const U32* const hashTable = zc->hashTable;
+    const BYTE* const tagTable = (const BYTE*)zc->contentTable;
     const BYTE* const base = zc->base;
     const BYTE* const dictBase = zc->dictBase;
     const U32 dictLimit = zc->dictLimit;
+    const U32 current = (U32)(ip-base);
     const U32 maxDistance = (1 << zc->params.windowLog);
-    const U32 lowLimit = (zc->lowLimit + maxDistance > (U32)(ip-base)) ? zc->lowLimit : (U32)(ip - base) - (maxDistance - 1);
-    U32 matchIndex;
-    const BYTE* match;
-    int nbAttempts=maxNbAttempts;
+    const U32 lowLimit = (zc->lowLimit + maxDistance > current) ? zc->lowLimit : current - (maxDistance - 1);
+    size_t rowStart;
+    const BYTE* tagRow;
+    U32 h, head, mask, matchMask[2];
+    int nbAttempts = maxNbAttempts;
     size_t ml=0;
-
-    /* HC4 match finder */
-    matchIndex = ZSTD_HC_insertAndFindFirstIndex (zc, ip, matchLengthSearch);
-
-    while ((matchIndex>lowLimit) && (nbAttempts))
+    U32 n;
+
+    ZSTD_HC_rowUpdate(zc, ip, iLimit, matchLengthSearch, rowLog);
+    h = (zc->rowHashCacheIdx == current) ? zc->rowHashCache[current & (ZSTD_HC_ROW_HASHCACHE_SIZE-1)]
+                                         : ZSTD_HC_rowHash(ip, zc->params.hashLog, rowLog, matchLengthSearch);
+    rowStart = (size_t)(h >> ZSTD_HC_ROW_TAGBITS) << rowLog;
+    tagRow = tagTable + rowStart;
+
+    /* candidates, most recent first : cells [head - lastCell], then [1 - head-1] */
+    head = tagRow[0];
+    if (head == 0) return 0;   /* empty row */
+    mask = ZSTD_HC_rowMatchMask(tagRow, (BYTE)h, rowLog) & ~1U;
+    matchMask[0] = mask >> head;
+    matchMask[1] = mask & ((1U << head) - 1);
+
+    for (n=0; n<2; n++)
     {
-        nbAttempts--;
-        if (matchIndex >= dictLimit)
+        const U32 cellStart = n ? 0 : head;
+        U32 m = matchMask[n];
+        for ( ; m && nbAttempts; m &= m-1)
         {
-            match = base + matchIndex;
-            if (match[ml] == ip[ml])   /* potentially better */
+            const U32 matchIndex = hashTable[rowStart + cellStart + ZSTD_highbit(m & (0-m))];
+            const BYTE* match;
+            if (matchIndex <= lowLimit) { nbAttempts = 0; break; }   /* older cells are even farther */
+            nbAttempts--;
+            if (matchIndex >= dictLimit)
             {
-                const size_t mlt = ZSTD_count(ip, match, iLimit);
-                if (mlt > ml)
-                //if (((int)(4*mlt) - (int)ZSTD_highbit((U32)(ip-match)+1)) > ((int)(4*ml) - (int)ZSTD_highbit((U32)((*offsetPtr)+1))))
+                match = base + matchIndex;
+                if (match[ml] == ip[ml])   /* potentially better */
                 {
-                    ml = mlt; *offsetPtr = ip-match;
-                    if (ip+mlt >= iLimit) break;
+                    const size_t mlt = ZSTD_count(ip, match, iLimit);
+                    if (mlt > ml)
+                    {
+                        ml = mlt; *offsetPtr = ip-match;
+                        if (ip+mlt >= iLimit) return ml;
+                    }
                 }
             }
-        }
-        else
-        {
-            match = dictBase + matchIndex;
-            if (MEM_read32(match) == MEM_read32(ip))   /* beware of end of dict */
+            else
             {
-                size_t mlt;
-                const BYTE* vLimit = ip + (dictLimit - matchIndex);
-                if (vLimit > iLimit) vLimit = iLimit;
-                mlt = ZSTD_count(ip+MINMATCH, match+MINMATCH, vLimit) + MINMATCH;
-                if ((ip+mlt == vLimit) && (vLimit < iLimit))
-                    mlt += ZSTD_count(ip+mlt, base+dictLimit, iLimit);
-                if (mlt > ml) { ml = mlt; *offsetPtr = (ip-base) - matchIndex; }
+                match = dictBase + matchIndex;
+                if (MEM_read32(match) == MEM_read32(ip))   /* beware of end of dict */
+                {
+                    size_t mlt;
+                    const BYTE* vLimit = ip + (dictLimit - matchIndex);
+                    if (vLimit > iLimit) vLimit = iLimit;
+                    mlt = ZSTD_count(ip+MINMATCH, match+MINMATCH, vLimit) + MINMATCH;
+                    if ((ip+mlt == vLimit) && (vLimit < iLimit))
+                        mlt += ZSTD_count(ip+mlt, base+dictLimit, iLimit);
+                    if (mlt > ml) { ml = mlt; *offsetPtr = (ip-base) - matchIndex; }
+                }
             }
         }
-
-        if (base + matchIndex <= ip - chainSize) break;
-        matchIndex = NEXT_IN_CHAIN(matchIndex, chainMask);
     }
 
     return ml;
 }
 
 
-FORCE_INLINE size_t ZSTD_HC_HcFindBestMatch_selectMLS (
+FORCE_INLINE size_t ZSTD_HC_RowFindBestMatch_selectMLS (
                         ZSTD_HC_CCtx* zc,   /* Index table will be updated */
                         const BYTE* ip, const BYTE* const iLimit,
                         size_t* offsetPtr,
                         const U32 maxNbAttempts, const U32 matchLengthSearch)
 {
+    if (ZSTD_HC_rowLog(&zc->params) == 5)
+    {
+        switch(matchLengthSearch)
+        {
+        case 4 : return ZSTD_HC_RowFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 4, 5);
+        case 5 : return ZSTD_HC_RowFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 5, 5);
+        default :
+        case 6 : return ZSTD_HC_RowFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 6, 5);
+        }
+    }
     switch(matchLengthSearch)
     {
+    case 4 : return ZSTD_HC_RowFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 4, 4);
+    case 5 : return ZSTD_HC_RowFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 5, 4);
     default :
-    case 4 : return ZSTD_HC_HcFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 4);
-    case 5 : return ZSTD_HC_HcFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 5);
-    case 6 : return ZSTD_HC_HcFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 6);
+    case 6 : return ZSTD_HC_RowFindBestMatch(zc, ip, iLimit, offsetPtr, maxNbAttempts, 6, 4);
     }
 }
 
@@ -616,7 +1127,7 @@ FORCE_INLINE size_t ZSTD_HC_HcFindBestMatch_selectMLS (
 FORCE_INLINE
 size_t ZSTD_HC_compressBlock_lazy_generic(ZSTD_HC_CCtx* ctx,
                                      void* dst, size_t maxDstSize, const void* src, size_t srcSize,
-                                     const U32 searchMethod, const U32 deep)   /* 0 : hc; 1 : bt */
+                                     const U32 searchMethod, const U32 deep)   /* 0 : row hash; 1 : bt */
 {
     seqStore_t* seqStorePtr = &(ctx->seqStore);
     const BYTE* const istart = (const BYTE*)src;
@@ -632,10 +1143,11 @@ size_t ZSTD_HC_compressBlock_lazy_generic(ZSTD_HC_CCtx* ctx,
     typedef size_t (*searchMax_f)(ZSTD_HC_CCtx* zc, const BYTE* ip, const BYTE* iLimit,
                         size_t* offsetPtr,
                         U32 maxNbAttempts, U32 matchLengthSearch);
-    searchMax_f searchMax = searchMethod ? ZSTD_HC_BtFindBestMatch_selectMLS : ZSTD_HC_HcFindBestMatch_selectMLS;
+    searchMax_f searchMax = searchMethod ? ZSTD_HC_BtFindBestMatch_selectMLS : ZSTD_HC_RowFindBestMatch_selectMLS;
 
     /* init */
     ZSTD_resetSeqStore(seqStorePtr);
+    ctx->rowHashCacheIdx = 0;   /* cached hashes stop at previous block's end */
     if (((ip-ctx->base) - ctx->dictLimit) < REPCODE_STARTVALUE) ip += REPCODE_STARTVALUE;
 
     /* Match Loop */
@@ -724,7 +1236,7 @@ size_t ZSTD_HC_compressBlock_lazy_generic(ZSTD_HC_CCtx* ctx,
         /* catch up */
         if (offset)
         {
-            while ((start>anchor) && (start>ctx->base+offset) && (start[-1] == start[-1-offset]))
+            while ((start>anchor) && (start>ctx->base+ctx->dictLimit+offset) && (start[-1] == start[-1-offset]))
                 { start--; matchLength++; }
         }
 
@@ -781,6 +1293,7 @@ size_t ZSTD_HC_compressBlock_greedy(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstS
 
     /* init */
     ZSTD_resetSeqStore(seqStorePtr);
+    ctx->rowHashCacheIdx = 0;   /* cached hashes stop at previous block's end */
     if (((ip-ctx->base) - ctx->dictLimit) < REPCODE_STARTVALUE) ip += REPCODE_STARTVALUE;
 
     /* Match Loop */
@@ -817,13 +1330,13 @@ size_t ZSTD_HC_compressBlock_greedy(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstS
         /* search */
         {
             size_t offset=999999;
-            size_t matchLength = ZSTD_HC_HcFindBestMatch_selectMLS(ctx, ip, iend, &offset, maxSearches, mls);
+            size_t matchLength = ZSTD_HC_RowFindBestMatch_selectMLS(ctx, ip, iend, &offset, maxSearches, mls);
             if (matchLength < MINMATCH)
             {
                 ip += ((ip-anchor) >> g_searchStrength) + 1;   /* jump faster over incompressible sections */
                 continue;
             }
-            while ((ip>anchor) && (ip-offset>ctx->base) && (ip[-1] == ip[-1-offset])) { ip--; matchLength++; }  /* catch up */
+            while ((ip>anchor) && (ip-offset>ctx->base+ctx->dictLimit) && (ip[-1] == ip[-1-offset])) { ip--; matchLength++; }  /* catch up */
             /* store sequence */
             {
                 size_t litLength = ip-anchor;
@@ -849,72 +1362,934 @@ size_t ZSTD_HC_compressBlock_greedy(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstS
 }
 
 
-typedef size_t (*ZSTD_HC_blockCompressor) (ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize);
-
-static ZSTD_HC_blockCompressor ZSTD_HC_selectBlockCompressor(ZSTD_HC_strategy strat)
+/* *************************************
+*  extDict variants
+*  (matches can also be found into a previous segment, such as a dictionary)
+***************************************/
+FORCE_INLINE
+size_t ZSTD_HC_compressBlock_lazy_extDict_generic(ZSTD_HC_CCtx* ctx,
+                                     void* dst, size_t maxDstSize, const void* src, size_t srcSize,
+                                     const U32 searchMethod, const U32 depth)   /* searchMethod : 0 : row hash; 1 : bt */
 {
-    switch(strat)
-    {
-    default :
-    case ZSTD_HC_fast:
-        return ZSTD_HC_compressBlock_fast;
-    case ZSTD_HC_greedy:
-        return ZSTD_HC_compressBlock_greedy;
-    case ZSTD_HC_lazy:
-        return ZSTD_HC_compressBlock_lazy;
-    case ZSTD_HC_lazy2:
-        return ZSTD_HC_compressBlock_lazy2;
-    case ZSTD_HC_btlazy2:
-        return ZSTD_HC_compressBlock_btlazy2;
-    }
+    seqStore_t* seqStorePtr = &(ctx->seqStore);
+    const BYTE* const istart = (const BYTE*)src;
+    const BYTE* ip = istart;
+    const BYTE* anchor = istart;
+    const BYTE* const iend = istart + srcSize;
+    const BYTE* const ilimit = iend - 8;
+    const BYTE* const base = ctx->base;
+    const U32 dictLimit = ctx->dictLimit;
+    const U32 lowLimit = ctx->lowLimit;
+    const BYTE* const prefixStart = base + dictLimit;
+    const BYTE* const dictBase = ctx->dictBase;
+    const BYTE* const dictEnd  = dictBase + dictLimit;
+    const BYTE* const dictStart  = dictBase + lowLimit;
+
+    size_t offset_2=REPCODE_STARTVALUE, offset_1=REPCODE_STARTVALUE;
+    const U32 maxSearches = 1 << ctx->params.searchLog;
+    const U32 mls = ctx->params.searchLength;
+
+    typedef size_t (*searchMax_f)(ZSTD_HC_CCtx* zc, const BYTE* ip, const BYTE* iLimit,
+                        size_t* offsetPtr,
+                        U32 maxNbAttempts, U32 matchLengthSearch);
+    searchMax_f searchMax = searchMethod ? ZSTD_HC_BtFindBestMatch_selectMLS_extDict : ZSTD_HC_RowFindBestMatch_selectMLS;
+
+    /* init */
+    ZSTD_resetSeqStore(seqStorePtr);
+    ctx->rowHashCacheIdx = 0;   /* cached hashes stop at previous block's end */
+
+    /* Match Loop */
+    while (ip < ilimit)
+    {
+        size_t matchLength=0;
+        size_t offset=0;
+        const BYTE* start=ip+1;
+        U32 current = (U32)(ip-base);
+
+        /* check repCode */
+        {
+            const U32 repIndex = (U32)(current+1 - offset_1);
+            const BYTE* const repBase = repIndex < dictLimit ? dictBase : base;
+            const BYTE* const repMatch = repBase + repIndex;
+            if (((U32)((dictLimit-1) - repIndex) >= 3) && (repIndex >= lowLimit))   /* intentional underflow */
+            if (MEM_read32(ip+1) == MEM_read32(repMatch))
+            {
+                /* repcode detected : we should take it */
+                const BYTE* const repEnd = repIndex < dictLimit ? dictEnd : iend;
+                matchLength = ZSTD_count_2segments(ip+1+MINMATCH, repMatch+MINMATCH, iend, repEnd, prefixStart) + MINMATCH;
+                if (depth==0) goto _storeSequence;
+            }
+        }
+
+        {
+            /* first search (depth 0) */
+            size_t offsetFound = 999999;
+            size_t ml2 = searchMax(ctx, ip, iend, &offsetFound, maxSearches, mls);
+            if (ml2 > matchLength)
+                matchLength = ml2, start = ip, offset=offsetFound;
+        }
+
+        if (matchLength < MINMATCH)
+        {
+            ip += ((ip-anchor) >> g_searchStrength) + 1;   /* jump faster over incompressible sections */
+            continue;
+        }
+
+        /* let's try to find a better solution */
+        if (depth>=1)
+        while (ip<ilimit)
+        {
+            ip ++;
+            current++;
+            /* check repCode */
+            if (offset)
+            {
+                const U32 repIndex = (U32)(current - offset_1);
+                const BYTE* const repBase = repIndex < dictLimit ? dictBase : base;
+                const BYTE* const repMatch = repBase + repIndex;
+                if (((U32)((dictLimit-1) - repIndex) >= 3) && (repIndex >= lowLimit))   /* intentional underflow */
+                if (MEM_read32(ip) == MEM_read32(repMatch))
+                {
+                    /* repcode detected */
+                    const BYTE* const repEnd = repIndex < dictLimit ? dictEnd : iend;
+                    size_t repLength = ZSTD_count_2segments(ip+MINMATCH, repMatch+MINMATCH, iend, repEnd, prefixStart) + MINMATCH;
+                    int gain2 = (int)(repLength * 3);
+                    int gain1 = (int)(matchLength*3 - ZSTD_highbit((U32)offset+1) + 1);
+                    if ((repLength >= MINMATCH) && (gain2 > gain1))
+                        matchLength = repLength, offset = 0, start = ip;
+                }
+            }
+
+            /* search match, depth 1 */
+            {
+                size_t offset2=999999;
+                size_t ml2 = searchMax(ctx, ip, iend, &offset2, maxSearches, mls);
+                int gain2 = (int)(ml2*(2+depth) - ZSTD_highbit((U32)offset2+1));   /* raw approx */
+                int gain1 = (int)(matchLength*(2+depth) - ZSTD_highbit((U32)offset+1) + (2+depth));
+                if ((ml2 >= MINMATCH) && (gain2 > gain1))
+                {
+                    matchLength = ml2, offset = offset2, start = ip;
+                    continue;   /* search a better one */
+                }
+            }
+
+            /* let's find an even better one */
+            if ((depth==2) && (ip<ilimit))
+            {
+                ip ++;
+                current++;
+                /* check repCode */
+                if (offset)
+                {
+                    const U32 repIndex = (U32)(current - offset_1);
+                    const BYTE* const repBase = repIndex < dictLimit ? dictBase : base;
+                    const BYTE* const repMatch = repBase + repIndex;
+                    if (((U32)((dictLimit-1) - repIndex) >= 3) && (repIndex >= lowLimit))   /* intentional underflow */
+                    if (MEM_read32(ip) == MEM_read32(repMatch))
+                    {
+                        /* repcode detected */
+                        const BYTE* const repEnd = repIndex < dictLimit ? dictEnd : iend;
+                        size_t repLength = ZSTD_count_2segments(ip+MINMATCH, repMatch+MINMATCH, iend, repEnd, prefixStart) + MINMATCH;
+                        int gain2 = (int)(repLength * 4);
+                        int gain1 = (int)(matchLength*4 - ZSTD_highbit((U32)offset+1) + 1);
+                        if ((repLength >= MINMATCH) && (gain2 > gain1))
+                            matchLength = repLength, offset = 0, start = ip;
+                    }
+                }
+
+                /* search match, depth 2 */
+                {
+                    size_t offset2=999999;
+                    size_t ml2 = searchMax(ctx, ip, iend, &offset2, maxSearches, mls);
+                    int gain2 = (int)(ml2*4 - ZSTD_highbit((U32)offset2+1));   /* raw approx */
+                    int gain1 = (int)(matchLength*4 - ZSTD_highbit((U32)offset+1) + 7);
+                    if ((ml2 >= MINMATCH) && (gain2 > gain1))
+                    {
+                        matchLength = ml2, offset = offset2, start = ip;
+                        continue;
+                    }
+                }
+            }
+            break;  /* nothing found : store previous solution */
+        }
+
+        /* catch up */
+        if (offset)
+        {
+            const U32 matchIndex = (U32)((start-base) - offset);
+            const BYTE* match = (matchIndex < dictLimit) ? dictBase + matchIndex : base + matchIndex;
+            const BYTE* const mStart = (matchIndex < dictLimit) ? dictStart : prefixStart;
+            while ((start>anchor) && (match>mStart) && (start[-1] == match[-1])) { start--; match--; matchLength++; }  /* catch up */
+        }
+
+        /* store sequence */
+_storeSequence:
+        {
+            /* note : offset==0 is a repcode after some literals, designating offset_1 */
+            size_t litLength = start - anchor;
+            offset_2 = offset_1;
+            if (offset) offset_1 = offset;
+            ZSTD_storeSeq(seqStorePtr, litLength, anchor, offset, matchLength-MINMATCH);
+            anchor = ip = start + matchLength;
+        }
+
+        /* check immediate repcode (no literal : designates offset_2) */
+        while (ip <= ilimit)
+        {
+            const U32 repIndex = (U32)((ip-base) - offset_2);
+            const BYTE* const repBase = repIndex < dictLimit ? dictBase : base;
+            const BYTE* const repMatch = repBase + repIndex;
+            if (((U32)((dictLimit-1) - repIndex) >= 3) && (repIndex >= lowLimit))   /* intentional underflow */
+            if (MEM_read32(ip) == MEM_read32(repMatch))
+            {
+                /* repcode detected : we should take it */
+                const BYTE* const repEnd = repIndex < dictLimit ? dictEnd : iend;
+                const size_t offtmp = offset_2;
+                matchLength = ZSTD_count_2segments(ip+MINMATCH, repMatch+MINMATCH, iend, repEnd, prefixStart) + MINMATCH;
+                offset_2 = offset_1; offset_1 = offtmp;   /* swap offset history */
+                ZSTD_storeSeq(seqStorePtr, 0, anchor, 0, matchLength-MINMATCH);
+                ip += matchLength;
+                anchor = ip;
+                continue;   /* faster when present ... (?) */
+            }
+            break;
+        }
+    }
+
+    /* Last Literals */
+    {
+        size_t lastLLSize = iend - anchor;
+        memcpy(seqStorePtr->lit, anchor, lastLLSize);
+        seqStorePtr->lit += lastLLSize;
+    }
+
+    /* Final compression stage */
+    return ZSTD_compressSequences((BYTE*)dst, maxDstSize,
+                                  seqStorePtr, srcSize);
+}
+
+size_t ZSTD_HC_compressBlock_greedy_extDict(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+{
+    return ZSTD_HC_compressBlock_lazy_extDict_generic(ctx, dst, maxDstSize, src, srcSize, 0, 0);
+}
+
+size_t ZSTD_HC_compressBlock_lazy_extDict(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+{
+    return ZSTD_HC_compressBlock_lazy_extDict_generic(ctx, dst, maxDstSize, src, srcSize, 0, 1);
+}
+
+size_t ZSTD_HC_compressBlock_lazy2_extDict(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+{
+    return ZSTD_HC_compressBlock_lazy_extDict_generic(ctx, dst, maxDstSize, src, srcSize, 0, 2);
+}
+
+size_t ZSTD_HC_compressBlock_btlazy2_extDict(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+{
+    return ZSTD_HC_compressBlock_lazy_extDict_generic(ctx, dst, maxDstSize, src, srcSize, 1, 2);
+}
+
+
+/* *************************************
+*  Optimal parser
+***************************************/
+#define ZSTD_OPT_SUFFICIENT_LEN 256   /* matches at least that long are selected without further analysis */
+#define ZSTD_OPT_BITCOST 8            /* prices are expressed in 1/(1<<ZSTD_OPT_BITCOST) bits */
+#define ZSTD_OPT_PRICE_MAX (1U<<30)
+#define ZSTD_OPT_FREQ_DIV 4           /* first block : weight of literals within block content */
+
+/** ZSTD_HC_insertBtAndGetAllMatches
+    same as ZSTD_HC_insertBtAndFindBestMatch(), but collects all matches longer than previous ones,
+    starting with repOffset when it matches.
+    @return : nb of matches stored into matches[], by increasing length */
+FORCE_INLINE /* inlining is important to hardwire a hot branch (template emulation) */
+U32 ZSTD_HC_insertBtAndGetAllMatches (
+                        ZSTD_HC_CCtx* zc,
+                        const BYTE* const ip, const BYTE* const iend,
+                        U32 nbCompares, const U32 mls,
+                        const U32 extDict, const U32 repOffset,
+                        ZSTD_HC_match_t* matches)
+{
+    U32* const hashTable = zc->hashTable;
+    const U32 hashLog = zc->params.hashLog;
+    const size_t h  = ZSTD_HC_hashPtr(ip, hashLog, mls);
+    U32* const bt   = zc->contentTable;
+    const U32 btLog = zc->params.contentLog - 1;
+    const U32 btMask= (1 << btLog) - 1;
+    U32 matchIndex  = hashTable[h];
+    size_t commonLengthSmaller=0, commonLengthLarger=0;
+    const BYTE* const base = zc->base;
+    const BYTE* const dictBase = zc->dictBase;
+    const U32 dictLimit = zc->dictLimit;
+    const BYTE* const dictEnd = dictBase + dictLimit;
+    const BYTE* const prefixStart = base + dictLimit;
+    const U32 current = (U32)(ip-base);
+    const U32 btLow = btMask >= current ? 0 : current - btMask;
+    const U32 windowSize = 1 << zc->params.windowLog;
+    const U32 windowLow = (zc->lowLimit + windowSize >= current) ? zc->lowLimit : current - windowSize;
+    U32* smallerPtr = bt + 2*(current&btMask);
+    U32* largerPtr  = bt + 2*(current&btMask) + 1;
+    size_t bestLength = MINMATCH-1;
+    U32 nbMatches = 0;
+    U32 dummy32;   /* to be nullified at the end */
+
+    /* repeat offset */
+    {
+        const U32 lowestIndex = extDict ? zc->lowLimit : dictLimit;
+        const U32 repIndex = current - repOffset;
+        if ( (repOffset <= current - lowestIndex)
+          && ((!extDict) || ((U32)((dictLimit-1) - repIndex) >= 3)) )   /* intentional underflow : 4 bytes must not straddle dictionary end */
+        {
+            const BYTE* const repMatch = ((extDict) && (repIndex < dictLimit) ? dictBase : base) + repIndex;
+            if (MEM_read32(ip) == MEM_read32(repMatch))
+            {
+                if ((extDict) && (repIndex < dictLimit))
+                    bestLength = ZSTD_count_2segments(ip+MINMATCH, repMatch+MINMATCH, iend, dictEnd, prefixStart) + MINMATCH;
+                else
+                    bestLength = ZSTD_count(ip+MINMATCH, repMatch+MINMATCH, iend) + MINMATCH;
+                matches[0].off = repOffset;
+                matches[0].len = (U32)bestLength;
+                nbMatches = 1;
+            }
+        }
+    }
+
+    hashTable[h] = current;   /* Update Hash Table */
+
+    while (nbCompares-- && (matchIndex > windowLow))
+    {
+        U32* nextPtr = bt + 2*(matchIndex & btMask);
+        size_t matchLength = MIN(commonLengthSmaller, commonLengthLarger);   /* guaranteed minimum nb of common bytes */
+        const BYTE* match;
+
+        if ((!extDict) || (matchIndex+matchLength >= dictLimit))
+        {
+            match = base + matchIndex;
+            matchLength += ZSTD_count(ip+matchLength, match+matchLength, iend);
+        }
+        else
+        {
+            match = dictBase + matchIndex;
+            matchLength += ZSTD_count_2segments(ip+matchLength, match+matchLength, iend, dictEnd, prefixStart);
+            if (matchIndex+matchLength >= dictLimit)
+                match = base + matchIndex;   /* to prepare for next usage of match[matchLength] */
+        }
+
+        if ((matchLength > bestLength) && (nbMatches < ZSTD_OPT_NUM))
+        {
+            matches[nbMatches].off = current - matchIndex;
+            matches[nbMatches].len = (U32)matchLength;
+            nbMatches++;
+            bestLength = matchLength;
+        }
+        if (ip+matchLength == iend)   /* equal : no way to know if inf or sup */
+            break;   /* just drop, to guarantee consistency (miss a little bit of compression) */
+
+        if (match[matchLength] < ip[matchLength])
+        {
+            /* match is smaller than current */
+            *smallerPtr = matchIndex;             /* update smaller idx */
+            commonLengthSmaller = matchLength;    /* all smaller will now have at least this guaranteed common length */
+            smallerPtr = nextPtr+1;               /* new "smaller" => larger of match */
+            if (matchIndex <= btLow) smallerPtr=&dummy32;  /* beyond tree size, stop the search */
+            matchIndex = (matchIndex <= btLow) ? windowLow : nextPtr[1];
+        }
+        else
+        {
+            /* match is larger than current */
+            *largerPtr = matchIndex;
+            commonLengthLarger = matchLength;
+            largerPtr = nextPtr;
+            if (matchIndex <= btLow) largerPtr=&dummy32; /* beyond tree size, stop the search */
+            matchIndex = (matchIndex <= btLow) ? windowLow : nextPtr[0];
+        }
+    }
+
+    *smallerPtr = *largerPtr = 0;
+
+    zc->nextToUpdate = current+1;   /* current has been inserted */
+    return nbMatches;
+}
+
+
+/** Tree updater, providing all matches */
+FORCE_INLINE /* inlining is important to hardwire a hot branch (template emulation) */
+U32 ZSTD_HC_BtGetAllMatches (
+                        ZSTD_HC_CCtx* zc,
+                        const BYTE* const ip, const BYTE* const iLimit,
+                        const U32 maxNbAttempts, const U32 mls,
+                        const U32 extDict, const U32 repOffset,
+                        ZSTD_HC_match_t* matches)
+{
+    const BYTE* nextToUpdate = ZSTD_HC_updateTree(zc, ip, iLimit, maxNbAttempts, mls, extDict);
+    if (nextToUpdate > ip)
+    {
+        /* RLE data */
+        matches[0].off = 1;
+        matches[0].len = (U32)ZSTD_count(ip, ip-1, iLimit);
+        return 1;
+    }
+    return ZSTD_HC_insertBtAndGetAllMatches(zc, ip, iLimit, maxNbAttempts, mls, extDict, repOffset, matches);
+}
+
+
+FORCE_INLINE U32 ZSTD_HC_BtGetAllMatches_selectMLS (
+                        ZSTD_HC_CCtx* zc,   /* Index table will be updated */
+                        const BYTE* ip, const BYTE* const iLimit,
+                        const U32 maxNbAttempts, const U32 matchLengthSearch,
+                        const U32 extDict, const U32 repOffset,
+                        ZSTD_HC_match_t* matches)
+{
+    switch(matchLengthSearch)
+    {
+    default :
+    case 4 : return ZSTD_HC_BtGetAllMatches(zc, ip, iLimit, maxNbAttempts, 4, extDict, repOffset, matches);
+    case 5 : return ZSTD_HC_BtGetAllMatches(zc, ip, iLimit, maxNbAttempts, 5, extDict, repOffset, matches);
+    case 6 : return ZSTD_HC_BtGetAllMatches(zc, ip, iLimit, maxNbAttempts, 6, extDict, repOffset, matches);
+    }
+}
+
+
+/** ZSTD_HC_bitWeight
+    @return : log2(stat+1), with ZSTD_OPT_BITCOST fractional bits (linear approximation) */
+static U32 ZSTD_HC_bitWeight(U32 stat)
+{
+    const U32 s = stat+1;
+    const U32 hb = ZSTD_highbit(s);
+    return (hb << ZSTD_OPT_BITCOST) + ((s << ZSTD_OPT_BITCOST) >> hb) - (1 << ZSTD_OPT_BITCOST);
+}
+
+/** ZSTD_HC_resetStats
+    first block of a frame : literals statistics are taken from block content, sequences ones are flat.
+    next blocks : previous statistics are aged, so that recent choices dominate */
+static void ZSTD_HC_resetStats(ZSTD_HC_optStats_t* stats, const BYTE* src, size_t srcSize)
+{
+    U32 u;
+
+    if (stats->litSum == 0)
+    {
+        size_t pos;
+        memset(stats->litFreq, 0, sizeof(stats->litFreq));
+        for (pos=0; pos<srcSize; pos++) stats->litFreq[src[pos]]++;
+        for (u=0; u<=255; u++) stats->litFreq[u] = 1 + (stats->litFreq[u] >> ZSTD_OPT_FREQ_DIV);
+        for (u=0; u<=MaxLL; u++) stats->litLengthFreq[u] = 1;
+        for (u=0; u<=MaxML; u++) stats->matchLengthFreq[u] = 1;
+        for (u=0; u<=MaxOff; u++) stats->offCodeFreq[u] = 1;
+    }
+    else
+    {
+        for (u=0; u<=255; u++) stats->litFreq[u] = 1 + (stats->litFreq[u] >> 1);
+        for (u=0; u<=MaxLL; u++) stats->litLengthFreq[u] = 1 + (stats->litLengthFreq[u] >> 1);
+        for (u=0; u<=MaxML; u++) stats->matchLengthFreq[u] = 1 + (stats->matchLengthFreq[u] >> 1);
+        for (u=0; u<=MaxOff; u++) stats->offCodeFreq[u] = 1 + (stats->offCodeFreq[u] >> 1);
+    }
+
+    stats->litSum = stats->litLengthSum = stats->matchLengthSum = stats->offCodeSum = 0;
+    for (u=0; u<=255; u++) stats->litSum += stats->litFreq[u];
+    for (u=0; u<=MaxLL; u++) stats->litLengthSum += stats->litLengthFreq[u];
+    for (u=0; u<=MaxML; u++) stats->matchLengthSum += stats->matchLengthFreq[u];
+    for (u=0; u<=MaxOff; u++) stats->offCodeSum += stats->offCodeFreq[u];
+}
+
+static U32 ZSTD_HC_getLiteralPrice(const ZSTD_HC_optStats_t* stats, BYTE literal)
+{
+    return ZSTD_HC_bitWeight(stats->litSum) - ZSTD_HC_bitWeight(stats->litFreq[literal]);
+}
+
+/** ZSTD_HC_getSeqPrice
+    @return : price of literal length and offset of a sequence ; offset == repOffset is encoded as a repeat offset */
+static U32 ZSTD_HC_getSeqPrice(const ZSTD_HC_optStats_t* stats, U32 litLength, U32 offset, U32 repOffset)
+{
+    const U32 llCode = litLength >= MaxLL ? MaxLL : litLength;
+    const U32 offCode = (offset == repOffset) ? 0 : ZSTD_highbit(offset) + 1;
+    U32 price = ZSTD_HC_bitWeight(stats->litLengthSum) - ZSTD_HC_bitWeight(stats->litLengthFreq[llCode]);
+    price += ZSTD_HC_bitWeight(stats->offCodeSum) - ZSTD_HC_bitWeight(stats->offCodeFreq[offCode]);
+    if (offCode) price += (offCode-1) << ZSTD_OPT_BITCOST;   /* offset extra bits */
+    if (llCode == MaxLL) price += (litLength < 255+MaxLL ? 8 : 32) << ZSTD_OPT_BITCOST;   /* dumps */
+    return price;
+}
+
+static U32 ZSTD_HC_getMatchLengthPrice(const ZSTD_HC_optStats_t* stats, U32 matchLength)
+{
+    const U32 ml = matchLength - MINMATCH;
+    const U32 mlCode = ml >= MaxML ? MaxML : ml;
+    U32 price = ZSTD_HC_bitWeight(stats->matchLengthSum) - ZSTD_HC_bitWeight(stats->matchLengthFreq[mlCode]);
+    if (mlCode == MaxML) price += (ml < 255+MaxML ? 8 : 32) << ZSTD_OPT_BITCOST;   /* dumps */
+    return price;
+}
+
+/** ZSTD_HC_storeMatch
+    stores a sequence, using repeat offset code when possible, and updates statistics and repeat offsets */
+static void ZSTD_HC_storeMatch(seqStore_t* seqStorePtr, ZSTD_HC_optStats_t* stats, U32* rep,
+                               const BYTE* literals, U32 litLength, U32 offset, U32 matchLength)
+{
+    const U32 repOffset = litLength ? rep[0] : rep[1];   /* same rule as decoder */
+    const U32 offsetCode = (offset == repOffset) ? 0 : offset;
+    const U32 offCode = offsetCode ? ZSTD_highbit(offsetCode) + 1 : 0;
+    const U32 ml = matchLength - MINMATCH;
+    U32 u;
+
+    ZSTD_storeSeq(seqStorePtr, litLength, literals, offsetCode, ml);
+    rep[1] = rep[0];
+    rep[0] = offset;
+
+    for (u=0; u<litLength; u++) stats->litFreq[literals[u]]++;
+    stats->litSum += litLength;
+    stats->litLengthFreq[litLength >= MaxLL ? MaxLL : litLength]++;
+    stats->litLengthSum++;
+    stats->offCodeFreq[offCode]++;
+    stats->offCodeSum++;
+    stats->matchLengthFreq[ml >= MaxML ? MaxML : ml]++;
+    stats->matchLengthSum++;
+}
+
+/** ZSTD_HC_compressBlock_opt_generic
+    collects all matches found at each position within a window of at most ZSTD_OPT_NUM bytes,
+    then selects the cheapest path, using prices estimated from current statistics */
+FORCE_INLINE
+size_t ZSTD_HC_compressBlock_opt_generic(ZSTD_HC_CCtx* ctx,
+                                     void* dst, size_t maxDstSize, const void* src, size_t srcSize,
+                                     const U32 extDict)
+{
+    seqStore_t* seqStorePtr = &(ctx->seqStore);
+    ZSTD_HC_optStats_t* const stats = &(ctx->optStats);
+    ZSTD_HC_optimal_t* const opt = ctx->optTable;
+    ZSTD_HC_match_t* const matches = ctx->matchTable;
+    const BYTE* const istart = (const BYTE*)src;
+    const BYTE* ip = istart;
+    const BYTE* anchor = istart;
+    const BYTE* const iend = istart + srcSize;
+    const BYTE* const ilimit = iend - 8;
+
+    U32 rep[2] = { REPCODE_STARTVALUE, REPCODE_STARTVALUE };   /* rep[0] : last offset; rep[1] : the one before */
+    const U32 maxSearches = 1 << ctx->params.searchLog;
+    const U32 mls = ctx->params.searchLength;
+
+    /* init */
+    ZSTD_resetSeqStore(seqStorePtr);
+    ZSTD_HC_resetStats(stats, istart, srcSize);
+    if (((ip-ctx->base) - ctx->dictLimit) < REPCODE_STARTVALUE) ip += REPCODE_STARTVALUE;
+
+    /* Match Loop */
+    while (ip < ilimit)
+    {
+        const U32 litlen = (U32)(ip - anchor);
+        const U32 repOffset = litlen ? rep[0] : rep[1];
+        U32 cur, last_pos, m, mlen;
+        U32 best_mlen = 0, best_off = 0;
+        U32 nbMatches = ZSTD_HC_BtGetAllMatches_selectMLS(ctx, ip, iend, maxSearches, mls, extDict, repOffset, matches);
+
+        if (!nbMatches) { ip++; continue; }
+
+        if (matches[nbMatches-1].len >= ZSTD_OPT_SUFFICIENT_LEN)
+        {
+            /* long enough : take it */
+            ZSTD_HC_storeMatch(seqStorePtr, stats, rep, anchor, litlen, matches[nbMatches-1].off, matches[nbMatches-1].len);
+            ip += matches[nbMatches-1].len;
+            anchor = ip;
+            continue;
+        }
+
+        /* initial prices */
+        opt[0].price = 0;
+        opt[0].mlen = 1;
+        opt[0].litlen = litlen;
+        opt[0].rep[0] = rep[0];
+        opt[0].rep[1] = rep[1];
+        for (mlen=1; mlen<MINMATCH; mlen++) opt[mlen].price = ZSTD_OPT_PRICE_MAX;
+        for (m=0; m<nbMatches; m++)
+        {
+            const U32 seqPrice = ZSTD_HC_getSeqPrice(stats, litlen, matches[m].off, repOffset);
+            for ( ; mlen <= matches[m].len; mlen++)
+            {
+                opt[mlen].price = seqPrice + ZSTD_HC_getMatchLengthPrice(stats, mlen);
+                opt[mlen].off = matches[m].off;
+                opt[mlen].mlen = mlen;
+                opt[mlen].litlen = litlen;
+                opt[mlen].rep[0] = matches[m].off;
+                opt[mlen].rep[1] = rep[0];
+            }
+        }
+        last_pos = mlen-1;
+
+        /* check further positions */
+        for (cur=1; cur <= last_pos; cur++)
+        {
+            const BYTE* const inr = ip + cur;
+
+            /* reach cur with a literal */
+            {
+                const U32 price = opt[cur-1].price + ZSTD_HC_getLiteralPrice(stats, inr[-1]);
+                if (price < opt[cur].price)
+                {
+                    opt[cur].price = price;
+                    opt[cur].off = 0;
+                    opt[cur].litlen = (opt[cur-1].mlen == 1) ? opt[cur-1].litlen + 1 : 1;
+                    opt[cur].mlen = 1;
+                    opt[cur].rep[0] = opt[cur-1].rep[0];
+                    opt[cur].rep[1] = opt[cur-1].rep[1];
+                }
+            }
+
+            if (cur == last_pos) break;
+            if (inr > ilimit) continue;
+
+            /* matches starting at cur */
+            {
+                const U32 curLit = (opt[cur].mlen == 1) ? opt[cur].litlen : 0;
+                const U32 curRep = curLit ? opt[cur].rep[0] : opt[cur].rep[1];
+                nbMatches = ZSTD_HC_BtGetAllMatches_selectMLS(ctx, inr, iend, maxSearches, mls, extDict, curRep, matches);
+                if (!nbMatches) continue;
+
+                if ( (matches[nbMatches-1].len >= ZSTD_OPT_SUFFICIENT_LEN)
+                  || (cur + matches[nbMatches-1].len >= ZSTD_OPT_NUM) )
+                {
+                    /* long enough : select it after cheapest path to cur */
+                    best_mlen = matches[nbMatches-1].len;
+                    best_off = matches[nbMatches-1].off;
+                    last_pos = cur;
+                    break;
+                }
+
+                mlen = MINMATCH;
+                for (m=0; m<nbMatches; m++)
+                {
+                    const U32 seqPrice = opt[cur].price + ZSTD_HC_getSeqPrice(stats, curLit, matches[m].off, curRep);
+                    for ( ; mlen <= matches[m].len; mlen++)
+                    {
+                        const U32 pos = cur + mlen;
+                        const U32 price = seqPrice + ZSTD_HC_getMatchLengthPrice(stats, mlen);
+                        while (last_pos < pos) opt[++last_pos].price = ZSTD_OPT_PRICE_MAX;
+                        if (price < opt[pos].price)
+                        {
+                            opt[pos].price = price;
+                            opt[pos].off = matches[m].off;
+                            opt[pos].mlen = mlen;
+                            opt[pos].litlen = curLit;
+                            opt[pos].rep[0] = matches[m].off;
+                            opt[pos].rep[1] = opt[cur].rep[0];
+                        }
+                    }
+                }
+            }
+        }
+
+        /* backtrack : link selected matches, from last position back to first one */
+        {
+            U32 pos = last_pos, next = 0;   /* a match never ends at position 0 */
+            while (pos > 0)
+            {
+                if (opt[pos].mlen == 1) { pos--; continue; }   /* literal */
+                opt[pos].next = next;
+                next = pos;
+                pos -= opt[pos].mlen;
+            }
+
+            /* store selected sequences */
+            for (pos = next; pos; pos = opt[pos].next)
+            {
+                const BYTE* const start = ip + pos - opt[pos].mlen;
+                ZSTD_HC_storeMatch(seqStorePtr, stats, rep, anchor, (U32)(start - anchor), opt[pos].off, opt[pos].mlen);
+                anchor = start + opt[pos].mlen;
+            }
+        }
+        ip += last_pos;
+
+        if (best_mlen)
+        {
+            ZSTD_HC_storeMatch(seqStorePtr, stats, rep, anchor, (U32)(ip - anchor), best_off, best_mlen);
+            ip += best_mlen;
+            anchor = ip;
+        }
+    }
+
+    /* Last Literals */
+    {
+        size_t lastLLSize = iend - anchor;
+        memcpy(seqStorePtr->lit, anchor, lastLLSize);
+        seqStorePtr->lit += lastLLSize;
+    }
+
+    /* Final compression stage */
+    return ZSTD_compressSequences((BYTE*)dst, maxDstSize,
+                                  seqStorePtr, srcSize);
+}
+
+size_t ZSTD_HC_compressBlock_btopt(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+{
+    return ZSTD_HC_compressBlock_opt_generic(ctx, dst, maxDstSize, src, srcSize, 0);
+}
+
+size_t ZSTD_HC_compressBlock_btopt_extDict(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
+{
+    return ZSTD_HC_compressBlock_opt_generic(ctx, dst, maxDstSize, src, srcSize, 1);
+}
+
+
+typedef size_t (*ZSTD_HC_blockCompressor) (ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize);
+
+static ZSTD_HC_blockCompressor ZSTD_HC_selectBlockCompressor(ZSTD_HC_strategy strat, int extDict)
+{
+    if (extDict)
+    {
+        switch(strat)
+        {
+        default :
+        case ZSTD_HC_fast:
+            return ZSTD_HC_compressBlock_fast_extDict;
+        case ZSTD_HC_greedy:
+            return ZSTD_HC_compressBlock_greedy_extDict;
+        case ZSTD_HC_lazy:
+            return ZSTD_HC_compressBlock_lazy_extDict;
+        case ZSTD_HC_lazy2:
+            return ZSTD_HC_compressBlock_lazy2_extDict;
+        case ZSTD_HC_btlazy2:
+            return ZSTD_HC_compressBlock_btlazy2_extDict;
+        case ZSTD_HC_btopt:
+            return ZSTD_HC_compressBlock_btopt_extDict;
+        }
+    }
+
+    switch(strat)
+    {
+    default :
+    case ZSTD_HC_fast:
+        return ZSTD_HC_compressBlock_fast;
+    case ZSTD_HC_greedy:
+        return ZSTD_HC_compressBlock_greedy;
+    case ZSTD_HC_lazy:
+        return ZSTD_HC_compressBlock_lazy;
+    case ZSTD_HC_lazy2:
+        return ZSTD_HC_compressBlock_lazy2;
+    case ZSTD_HC_btlazy2:
+        return ZSTD_HC_compressBlock_btlazy2;
+    case ZSTD_HC_btopt:
+        return ZSTD_HC_compressBlock_btopt;
+    }
 }
 
 
 size_t ZSTD_HC_compressBlock(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
 {
-    ZSTD_HC_blockCompressor blockCompressor = ZSTD_HC_selectBlockCompressor(ctx->params.strategy);
+    ZSTD_HC_blockCompressor blockCompressor = ZSTD_HC_selectBlockCompressor(ctx->params.strategy, ctx->lowLimit < ctx->dictLimit);
     return blockCompressor(ctx, dst, maxDstSize, src, srcSize);
 }
 
 
+/* *************************************
+*  Long distance matching
+***************************************/
+/* Segments of ZSTD_HC_LDM_MINMATCH bytes are hashed with a rolling hash.
+*  Only positions whose hash carries a specific tag are sampled (1 every (1<<ZSTD_HC_LDM_STRIDELOG) on average) :
+*  since sampling depends on content, a repeated segment is sampled again where it reappears, whatever its alignment.
+*  ldmTable therefore needs (windowSize >> ZSTD_HC_LDM_STRIDELOG) cells to cover the whole window,
+*  grouped into buckets of (1<<ZSTD_HC_LDM_BUCKETLOG) cells sharing the same hash. */
+static const U64 ZSTD_HC_ldmPrime = 11400714785074694791ULL;
+#define ZSTD_HC_LDM_CHAROFFSET 10   /* so that runs of zeroes generate non-zero hashes */
+
+static U64 ZSTD_HC_ldmHash(const BYTE* p)
+{
+    U64 h = 0;
+    U32 i;
+    for (i=0; i<ZSTD_HC_LDM_MINMATCH; i++) h = (h * ZSTD_HC_ldmPrime) + p[i] + ZSTD_HC_LDM_CHAROFFSET;
+    return h;
+}
+
+/* primePower : ZSTD_HC_ldmPrime ^ (ZSTD_HC_LDM_MINMATCH-1), weight of oldest byte */
+static U64 ZSTD_HC_ldmRollHash(U64 h, BYTE toRemove, BYTE toAdd, U64 primePower)
+{
+    h -= (toRemove + ZSTD_HC_LDM_CHAROFFSET) * primePower;
+    return (h * ZSTD_HC_ldmPrime) + toAdd + ZSTD_HC_LDM_CHAROFFSET;
+}
+
+/** ZSTD_HC_ldmFindMatch
+    scans positions [ip, iLimit) for a segment already present within long distance window, beyond regular window,
+    inserting sampled positions into ldmTable along the way.
+    A match found is extended forward up to iend, and backward down to ip.
+    Only current prefix is referenced (no extDict).
+    @result : match length (0 == no match), *matchStartPtr and *offsetPtr are only written when a match is found */
+static size_t ZSTD_HC_ldmFindMatch(ZSTD_HC_CCtx* zc,
+                                   const BYTE* ip, const BYTE* iLimit, const BYTE* const iend,
+                                   const BYTE** matchStartPtr, U32* offsetPtr)
+{
+    const BYTE* const base = zc->base;
+    const BYTE* const anchor = ip;
+    const BYTE* const prefixStart = base + zc->dictLimit;
+    const U32 bucketLog = zc->ldmHashLog - ZSTD_HC_LDM_BUCKETLOG;
+    const U32 tagMask = (1 << ZSTD_HC_LDM_STRIDELOG) - 1;
+    const U32 maxDistance = (U32)(((U64)1 << zc->ldmWindowLog) - 1);
+    const U32 minDistance = (U32)1 << zc->params.windowLog;   /* closer matches are left to regular match finders */
+    const BYTE* ilast = iLimit - 1;   /* last position to scan */
+    U64 primePower = 1;
+    U64 h;
+    U32 i;
+
+    if (iend - ip < ZSTD_HC_LDM_MINMATCH + 8) return 0;
+    if (ilast > iend - ZSTD_HC_LDM_MINMATCH) ilast = iend - ZSTD_HC_LDM_MINMATCH;
+    for (i=1; i<ZSTD_HC_LDM_MINMATCH; i++) primePower *= ZSTD_HC_ldmPrime;
+
+    h = ZSTD_HC_ldmHash(ip);
+    while (1)
+    {
+        if (((U32)(h >> (64 - bucketLog - ZSTD_HC_LDM_STRIDELOG)) & tagMask) == tagMask)
+        {
+            ZSTD_HC_ldmEntry_t* const bucket = zc->ldmTable + ((size_t)(h >> (64 - bucketLog)) << ZSTD_HC_LDM_BUCKETLOG);
+            const U32 checksum = (U32)h;
+            const U32 current = (U32)(ip-base);
+            size_t bestLength = 0;
+            U32 bestIndex = 0;
+
+            for (i=0; i < (1 << ZSTD_HC_LDM_BUCKETLOG); i++)
+            {
+                const U32 matchIndex = bucket[i].offset;
+                if ( (bucket[i].checksum == checksum) && (matchIndex >= zc->dictLimit)
+                  && (matchIndex + minDistance < current) && (current - matchIndex <= maxDistance) )
+                {
+                    const size_t mlt = ZSTD_count(ip, base + matchIndex, iend);
+                    if (mlt > bestLength) { bestLength = mlt; bestIndex = matchIndex; }
+                }
+            }
+
+            /* insert current position, most recent first */
+            memmove(bucket+1, bucket, ((1 << ZSTD_HC_LDM_BUCKETLOG) - 1) * sizeof(*bucket));
+            bucket[0].offset = current;
+            bucket[0].checksum = checksum;
+
+            if (bestLength >= ZSTD_HC_LDM_MINLENGTH)
+            {
+                const BYTE* match = base + bestIndex;
+                while ((ip > anchor) && (match > prefixStart) && (ip[-1] == match[-1])) { ip--; match--; bestLength++; }   /* catch up */
+                *matchStartPtr = ip;
+                *offsetPtr = (U32)(ip - match);
+                return bestLength;
+            }
+        }
+        if (ip >= ilast) break;
+        h = ZSTD_HC_ldmRollHash(h, ip[0], ip[ZSTD_HC_LDM_MINMATCH], primePower);
+        ip++;
+    }
+
+    return 0;
+}
+
+/** ZSTD_HC_compressBlock_ldm
+    a block made of a single sequence : the long distance match, without literal */
+static size_t ZSTD_HC_compressBlock_ldm(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize,
+                                        const BYTE* ip, size_t matchLength, U32 offset)
+{
+    seqStore_t* seqStorePtr = &(ctx->seqStore);
+    ZSTD_resetSeqStore(seqStorePtr);
+    ZSTD_storeSeq(seqStorePtr, 0, ip, offset, matchLength - MINMATCH);
+    return ZSTD_compressSequences((BYTE*)dst, maxDstSize, seqStorePtr, matchLength);
+}
+
+
+/** ZSTD_HC_writeBlock
+    adds block header to a block body of size cSize already written at dst+3,
+    or stores src uncompressed if cSize==0
+    @result : total size written into dst, or an error code */
+static size_t ZSTD_HC_writeBlock(void* dst, size_t maxDstSize, const void* src, size_t srcSize, size_t cSize)
+{
+    BYTE* const op = (BYTE*)dst;
+    if (ZSTD_isError(cSize)) return cSize;
+    if (cSize == 0) return ZSTD_noCompressBlock(op, maxDstSize, src, srcSize);   /* block is not compressible */
+    op[0] = (BYTE)(cSize>>16);
+    op[1] = (BYTE)(cSize>>8);
+    op[2] = (BYTE)cSize;
+    op[0] += (BYTE)(bt_compressed << 6); /* is a compressed block */
+    return cSize + 3;
+}
+
 static size_t ZSTD_HC_compress_generic (ZSTD_HC_CCtx* ctxPtr,
                                         void* dst, size_t maxDstSize,
                                   const void* src, size_t srcSize)
 {
-    size_t blockSize = BLOCKSIZE;
+    const size_t maxBlockSize = ctxPtr->blockSize ? ctxPtr->blockSize : BLOCKSIZE;
     size_t remaining = srcSize;
     const BYTE* ip = (const BYTE*)src;
+    const BYTE* const iend = ip + srcSize;
     BYTE* const ostart = (BYTE*)dst;
     BYTE* op = ostart;
-    const ZSTD_HC_blockCompressor blockCompressor = ZSTD_HC_selectBlockCompressor(ctxPtr->params.strategy);
+    const ZSTD_HC_blockCompressor blockCompressor = ZSTD_HC_selectBlockCompressor(ctxPtr->params.strategy, ctxPtr->lowLimit < ctxPtr->dictLimit);
 
     while (remaining)
     {
+        const BYTE* const istart = ip;
+        size_t blockSize = maxBlockSize;
         size_t cSize;
+        const BYTE* matchStart = NULL;
+        size_t matchLength = 0;
+        U32 offset = 0;
 
         if (maxDstSize < 3 + MIN_CBLOCK_SIZE) return ERROR(dstSize_tooSmall);   /* not enough space to store compressed block */
 
         if (remaining < blockSize) blockSize = remaining;
-        cSize = blockCompressor(ctxPtr, op+3, maxDstSize-3, ip, blockSize);
-        if (ZSTD_isError(cSize)) return cSize;
+        if (ctxPtr->ldmWindowLog)
+        {
+            matchLength = ZSTD_HC_ldmFindMatch(ctxPtr, ip, ip+blockSize, iend, &matchStart, &offset);
+            matchLength -= (matchLength % maxBlockSize) < MINMATCH ? matchLength % maxBlockSize : 0;   /* each block of match needs >= MINMATCH bytes */
+            if (matchLength) blockSize = matchStart - ip;   /* regular compressors only see leftover region */
+        }
 
-        if (cSize == 0)
+        if (blockSize)
         {
-            cSize = ZSTD_noCompressBlock(op, maxDstSize, ip, blockSize);   /* block is not compressible */
+            const U32 current = (U32)(ip - ctxPtr->base);
+            const U32 maxDist = 1U << ctxPtr->params.windowLog;
+            const U32 lowest = (ctxPtr->lowLimit + maxDist >= current) ? ctxPtr->lowLimit : current - maxDist;
+            cSize = ZSTD_rleCompressBlock(op, maxDstSize, ip, blockSize);   /* single byte run : no need for match search */
+            if ((cSize == 0) && ZSTD_isIncompressible(&ctxPtr->seqStore, ip, blockSize, ctxPtr->base, ctxPtr->dictBase, ctxPtr->dictLimit, lowest))
+            {
+                cSize = ZSTD_noCompressBlock(op, maxDstSize, ip, blockSize);   /* incompressible : neither */
+                ZSTD_skipRawBlock(&ctxPtr->seqStore, ctxPtr->nextToUpdate, current + (U32)blockSize);
+            }
+            if (cSize == 0)
+            {
+                /* skipped raw blocks : match finders index them first, from nextToUpdate, this block may repeat them */
+                if (ZSTD_endRawSkip(&ctxPtr->seqStore))
+                {
+                    U32 start = ctxPtr->seqStore.rawStart;
+                    if (start < ctxPtr->dictLimit) start = ctxPtr->dictLimit;
+                    if (start < lowest) start = lowest;
+                    if (start < ctxPtr->nextToUpdate) ctxPtr->nextToUpdate = start;
+                }
+                cSize = ZSTD_HC_writeBlock(op, maxDstSize, ip, blockSize, blockCompressor(ctxPtr, op+3, maxDstSize-3, ip, blockSize));
+                if ((!ZSTD_isError(cSize)) && ((op[0] >> 6) == bt_raw))
+                    ZSTD_indexRawBlock(&ctxPtr->seqStore, ip, blockSize, ctxPtr->base);   /* next blocks may repeat it */
+            }
+            else if (!ZSTD_isError(cSize))
+            {
+                /* regular match finders skip the block, except its end */
+                const U32 blockEnd = (U32)(ip + blockSize - ctxPtr->base);
+                if (ctxPtr->nextToUpdate + ZSTD_HC_RLE_INDEXTAIL < blockEnd) ctxPtr->nextToUpdate = blockEnd - ZSTD_HC_RLE_INDEXTAIL;
+            }
+            if (ZSTD_isError(cSize)) return cSize;
+            ZSTD_updateRawRun(&ctxPtr->seqStore, op);
+            remaining -= blockSize;
+            maxDstSize -= cSize;
+            ip += blockSize;
+            op += cSize;
         }
-        else
+
+        if (matchLength)
         {
-            op[0] = (BYTE)(cSize>>16);
-            op[1] = (BYTE)(cSize>>8);
-            op[2] = (BYTE)cSize;
-            op[0] += (BYTE)(bt_compressed << 6); /* is a compressed block */
-            cSize += 3;
+            const U32 matchEnd = (U32)(ip + matchLength - ctxPtr->base);
+            while (matchLength)
+            {
+                const size_t mSize = MIN(matchLength, maxBlockSize);
+                if (maxDstSize < 3 + MIN_CBLOCK_SIZE) return ERROR(dstSize_tooSmall);
+                cSize = ZSTD_HC_writeBlock(op, maxDstSize, ip, mSize, ZSTD_HC_compressBlock_ldm(ctxPtr, op+3, maxDstSize-3, ip, mSize, offset));
+                if (ZSTD_isError(cSize)) return cSize;
+                matchLength -= mSize;
+                remaining -= mSize;
+                maxDstSize -= cSize;
+                ip += mSize;
+                op += cSize;
+            }
+            /* regular match finders skip matched area, except its end */
+            if (ctxPtr->nextToUpdate + ZSTD_HC_LDM_MINMATCH < matchEnd) ctxPtr->nextToUpdate = matchEnd - ZSTD_HC_LDM_MINMATCH;
         }
 
-        remaining -= blockSize;
-        maxDstSize -= cSize;
-        ip += blockSize;
-        op += cSize;
+        /* content checksum : source is hashed right after being compressed, while still in cache */
+        if (ctxPtr->checksumFlag) XXH64_update(&ctxPtr->checksumState, istart, ip-istart);
     }
 
     return op-ostart;
@@ -930,16 +2305,126 @@ size_t ZSTD_HC_compressContinue (ZSTD_HC_CCtx* ctxPtr,
     /* Check if blocks follow each other */
     if (ip != ctxPtr->end)
     {
-        if (ctxPtr->end != NULL)
-            ZSTD_HC_resetCCtx_advanced(ctxPtr, ctxPtr->params, srcSize);
-        ctxPtr->base = ip;
+        if ((ctxPtr->loadedDictEnd) && ((U32)(ctxPtr->end - ctxPtr->base) == ctxPtr->loadedDictEnd))
+        {
+            /* loaded dictionary becomes extDict : indexes continue into new segment */
+            ctxPtr->lowLimit = ctxPtr->dictLimit;
+            ctxPtr->dictLimit = ctxPtr->loadedDictEnd;
+            ctxPtr->dictBase = ctxPtr->base;
+            ctxPtr->base = ip - ctxPtr->dictLimit;
+            ctxPtr->nextToUpdate = ctxPtr->dictLimit;
+        }
+        else
+        {
+            if (ctxPtr->end != NULL)
+                ZSTD_HC_resetCCtx_advanced(ctxPtr, ctxPtr->params, srcSize);
+            ctxPtr->base = ip - ctxPtr->dictLimit;
+        }
+    }
+
+    /* if input and dictionary overlap : reduce dictionary (presumed modified by input) */
+    if ((ip+srcSize > ctxPtr->dictBase + ctxPtr->lowLimit) && (ip < ctxPtr->dictBase + ctxPtr->dictLimit))
+    {
+        ctxPtr->lowLimit = (U32)(ip + srcSize - ctxPtr->dictBase);
+        if (ctxPtr->lowLimit > ctxPtr->dictLimit) ctxPtr->lowLimit = ctxPtr->dictLimit;
     }
 
     ctxPtr->end = ip + srcSize;
+    ctxPtr->consumedSrcSize += srcSize;
     return ZSTD_HC_compress_generic (ctxPtr, dst, dstSize, src, srcSize);
 }
 
 
+size_t ZSTD_HC_compress_insertDictionary(ZSTD_HC_CCtx* ctx, const void* dict, size_t dictSize)
+{
+    const BYTE* ip = (const BYTE*)dict;
+    const BYTE* const iend = ip + dictSize;
+    const size_t maxDist = (size_t)1 << ctx->params.windowLog;
+
+    /* Sanity check */
+    if (ctx->end != NULL) return ERROR(stage_wrong);   /* must be loaded before first ZSTD_HC_compressContinue() */
+    if (dictSize < 8) return 0;   /* too small to be useful : ignored */
+    if (dictSize > maxDist) ip = iend - maxDist;   /* only last part is within reach */
+
+    /* dictionary becomes current prefix */
+    ctx->base = ip - ctx->dictLimit;
+    ctx->end = iend;
+    ctx->loadedDictEnd = (U32)(iend - ctx->base);
+
+    /* fill tables */
+    switch(ctx->params.strategy)
+    {
+    case ZSTD_HC_fast:
+        {
+            U32* const hashTable = ctx->hashTable;
+            const U32 hBits = ctx->params.hashLog;
+            const U32 mls = ctx->params.searchLength;
+            for (ip++ ; ip <= iend-8; ip++)
+                hashTable[ZSTD_HC_hashPtr(ip, hBits, mls)] = (U32)(ip - ctx->base);
+        }
+        break;
+
+    case ZSTD_HC_greedy:
+    case ZSTD_HC_lazy:
+    case ZSTD_HC_lazy2:
+        ZSTD_HC_rowUpdate(ctx, iend-8, iend, MIN(ctx->params.searchLength, 6), ZSTD_HC_rowLog(&ctx->params));   /* same mls as ZSTD_HC_RowFindBestMatch_selectMLS() */
+        break;
+
+    case ZSTD_HC_btlazy2:
+    case ZSTD_HC_btopt:
+        ZSTD_HC_updateTree(ctx, iend-8, iend, 1 << ctx->params.searchLog, ctx->params.searchLength, 0);
+        break;
+
+    default:
+        return ERROR(GENERIC);   /* strategy doesn't exist; impossible */
+    }
+
+    return 0;
+}
+
+
+size_t ZSTD_HC_duplicateCCtx(ZSTD_HC_CCtx* dstCCtx, const ZSTD_HC_CCtx* srcCCtx)
+{
+    const size_t tableSpace = ZSTD_HC_tableSpaceSize(&srcCCtx->params);
+
+    /* srcCCtx must be at the beginning of a frame */
+    if ((U32)(srcCCtx->end - srcCCtx->base) != srcCCtx->loadedDictEnd) return ERROR(stage_wrong);
+
+    /* copy tables */
+    {
+        size_t errorCode = ZSTD_HC_resetCCtx_advanced(dstCCtx, srcCCtx->params, 0);
+        if (ZSTD_isError(errorCode)) return errorCode;
+    }
+    dstCCtx->params = srcCCtx->params;   /* no re-validation : keep exactly the same parameters */
+    memcpy(dstCCtx->workSpace, srcCCtx->workSpace, tableSpace);
+
+    /* copy dictionary pointers */
+    dstCCtx->end = srcCCtx->end;
+    dstCCtx->base = srcCCtx->base;
+    dstCCtx->dictBase = srcCCtx->dictBase;
+    dstCCtx->dictLimit = srcCCtx->dictLimit;
+    dstCCtx->lowLimit = srcCCtx->lowLimit;
+    dstCCtx->nextToUpdate = srcCCtx->nextToUpdate;
+    dstCCtx->loadedDictEnd = srcCCtx->loadedDictEnd;
+
+    return 0;
+}
+
+
+/** ZSTD_HC_writeFrameHeader
+    write header of next frame, using current ctx parameters (window, pledged size, checksum) */
+static size_t ZSTD_HC_writeFrameHeader(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize)
+{
+    ZSTD_frameParams fparams;
+    fparams.contentSize = ctx->pledgedSrcSizePlusOne ? ctx->pledgedSrcSizePlusOne-1 : ZSTD_CONTENTSIZE_UNKNOWN;
+    fparams.windowLog = (ctx->ldmWindowLog > ctx->params.windowLog) ? ctx->ldmWindowLog : ctx->params.windowLog;
+    fparams.checksumFlag = ctx->checksumFlag;
+    ctx->frameContentSizePlusOne = ctx->pledgedSrcSizePlusOne;
+    ctx->consumedSrcSize = 0;
+    ctx->pledgedSrcSizePlusOne = 0;   /* only for this frame */
+    return ZSTD_writeFrameHeader(dst, maxDstSize, &fparams, &ctx->checksumState);
+}
+
 size_t ZSTD_HC_compressBegin_advanced(ZSTD_HC_CCtx* ctx,
                                       void* dst, size_t maxDstSize,
                                       const ZSTD_HC_parameters params,
@@ -949,34 +2434,35 @@ size_t ZSTD_HC_compressBegin_advanced(ZSTD_HC_CCtx* ctx,
     if (maxDstSize < 4) return ERROR(dstSize_tooSmall);
     errorCode = ZSTD_HC_resetCCtx_advanced(ctx, params, srcSizeHint);
     if (ZSTD_isError(errorCode)) return errorCode;
-    MEM_writeLE32(dst, ZSTD_magicNumber); /* Write Header */
-    return 4;
+    return ZSTD_HC_writeFrameHeader(ctx, dst, maxDstSize);
 }
 
 
-size_t ZSTD_HC_compressBegin(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize, int compressionLevel, U64 srcSizeHint)
+static ZSTD_HC_parameters ZSTD_HC_getCCtxParams(const ZSTD_HC_CCtx* ctx, int compressionLevel, U64 srcSizeHint)
 {
-    int tableID = ((srcSizeHint-1) > 128 KB);   /* intentional underflow for 0 */
-    if (compressionLevel<=0) compressionLevel = 1;
-    if (compressionLevel > ZSTD_HC_MAX_CLEVEL) compressionLevel = ZSTD_HC_MAX_CLEVEL;
-    return ZSTD_HC_compressBegin_advanced(ctx, dst, maxDstSize, ZSTD_HC_defaultParameters[tableID][compressionLevel], srcSizeHint);
+    const int tableID = ((srcSizeHint-1) > 128 KB);   /* intentional underflow for 0 */
+    ZSTD_HC_parameters params = ZSTD_HC_levelParams(ctx, compressionLevel, tableID);
+    ZSTD_HC_validateParams(&params, srcSizeHint);
+    return params;
 }
 
-
-size_t ZSTD_HC_compressEnd(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize)
+ZSTD_HC_parameters ZSTD_HC_getParams(int compressionLevel, U64 srcSizeHint)
 {
-    BYTE* op = (BYTE*)dst;
+    return ZSTD_HC_getCCtxParams(NULL, compressionLevel, srcSizeHint);
+}
 
-    /* Sanity check */
-    (void)ctx;
-    if (maxDstSize < 3) return ERROR(dstSize_tooSmall);
 
-    /* End of frame */
-    op[0] = (BYTE)(bt_end << 6);
-    op[1] = 0;
-    op[2] = 0;
+size_t ZSTD_HC_compressBegin(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize, int compressionLevel, U64 srcSizeHint)
+{
+    return ZSTD_HC_compressBegin_advanced(ctx, dst, maxDstSize, ZSTD_HC_getCCtxParams(ctx, compressionLevel, srcSizeHint), srcSizeHint);
+}
+
 
-    return 3;
+size_t ZSTD_HC_compressEnd(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize)
+{
+    if ((ctx->frameContentSizePlusOne) && (ctx->consumedSrcSize != ctx->frameContentSizePlusOne-1))
+        return ERROR(srcSize_wrong);   /* frame header announces another content size */
+    return ZSTD_writeFrameEnd(dst, maxDstSize, ctx->checksumFlag ? &ctx->checksumState : NULL);
 }
 
 size_t ZSTD_HC_compress_advanced (ZSTD_HC_CCtx* ctx,
@@ -988,22 +2474,16 @@ size_t ZSTD_HC_compress_advanced (ZSTD_HC_CCtx* ctx,
     BYTE* op = ostart;
     size_t oSize;
 
-    /* correct params, to use less memory */
-    {
-        U32 srcLog = ZSTD_highbit((U32)srcSize-1) + 1;
-        U32 contentBtPlus = (ctx->params.strategy == ZSTD_HC_btlazy2);
-        if (params.windowLog > srcLog) params.windowLog = srcLog;
-        if (params.contentLog > srcLog+contentBtPlus) params.contentLog = srcLog+contentBtPlus;
-    }
-
-    /* Header */
+    /* Header (params are scaled down to srcSize) */
     oSize = ZSTD_HC_compressBegin_advanced(ctx, dst, maxDstSize, params, srcSize);
     if(ZSTD_isError(oSize)) return oSize;
     op += oSize;
     maxDstSize -= oSize;
 
     /* body (compression) */
-    ctx->base = (const BYTE*)src;
+    ctx->base = (const BYTE*)src - ctx->dictLimit;
+    ctx->end = (const BYTE*)src + srcSize;
+    ctx->consumedSrcSize = srcSize;
     oSize = ZSTD_HC_compress_generic (ctx, op,  maxDstSize, src, srcSize);
     if(ZSTD_isError(oSize)) return oSize;
     op += oSize;
@@ -1020,9 +2500,9 @@ size_t ZSTD_HC_compress_advanced (ZSTD_HC_CCtx* ctx,
 size_t ZSTD_HC_compressCCtx (ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize, int compressionLevel)
 {
     const int tableID = (srcSize > 128 KB);
-    if (compressionLevel<=1) return ZSTD_compress(dst, maxDstSize, src, srcSize);   /* fast mode */
-    if (compressionLevel > ZSTD_HC_MAX_CLEVEL) compressionLevel = ZSTD_HC_MAX_CLEVEL;
-    return ZSTD_HC_compress_advanced(ctx, dst, maxDstSize, src, srcSize, ZSTD_HC_defaultParameters[tableID][compressionLevel]);
+    const int customLevel1 = (compressionLevel==1) && (ctx->levelTable || g_ZSTD_HC_levelTable);   /* custom tables define level 1 too */
+    if ((compressionLevel<=1) && (!customLevel1) && (!ctx->staticSize) && (!ctx->blockSize) && (!ctx->ldmWindowLog) && (!ctx->checksumFlag) && (!ctx->pledgedSrcSizePlusOne)) return ZSTD_compressLevel(dst, maxDstSize, src, srcSize, compressionLevel);   /* fast mode (allocates its own context) */
+    return ZSTD_HC_compress_advanced(ctx, dst, maxDstSize, src, srcSize, ZSTD_HC_levelParams(ctx, compressionLevel, tableID));
 }
 
 size_t ZSTD_HC_compress(void* dst, size_t maxDstSize, const void* src, size_t srcSize, int compressionLevel)
@@ -1031,6 +2511,143 @@ size_t ZSTD_HC_compress(void* dst, size_t maxDstSize, const void* src, size_t sr
     ZSTD_HC_CCtx ctxBody;
     memset(&ctxBody, 0, sizeof(ctxBody));
     result = ZSTD_HC_compressCCtx(&ctxBody, dst, maxDstSize, src, srcSize, compressionLevel);
-    free(ctxBody.workSpace);
+    ZSTD_free(ctxBody.workSpace, ctxBody.customMem);
     return result;
 }
+
+
+/* *************************************
+*  Dictionary compression
+***************************************/
+size_t ZSTD_HC_compress_usingPreparedCCtx(ZSTD_HC_CCtx* ctx, const ZSTD_HC_CCtx* preparedCCtx,
+                                          void* dst, size_t maxDstSize,
+                                    const void* src, size_t srcSize)
+{
+    BYTE* const ostart = (BYTE*)dst;
+    BYTE* op = ostart;
+    size_t oSize;
+
+    /* Dictionary */
+    oSize = ZSTD_HC_duplicateCCtx(ctx, preparedCCtx);
+    if(ZSTD_isError(oSize)) return oSize;
+
+    /* Header (window from prepared params) */
+    oSize = ZSTD_HC_writeFrameHeader(ctx, dst, maxDstSize);
+    if(ZSTD_isError(oSize)) return oSize;
+    op += oSize;
+    maxDstSize -= oSize;
+
+    /* body (compression) */
+    oSize = ZSTD_HC_compressContinue(ctx, op, maxDstSize, src, srcSize);
+    if(ZSTD_isError(oSize)) return oSize;
+    op += oSize;
+    maxDstSize -= oSize;
+
+    /* Close frame */
+    oSize = ZSTD_HC_compressEnd(ctx, op, maxDstSize);
+    if(ZSTD_isError(oSize)) return oSize;
+    op += oSize;
+
+    return (op - ostart);
+}
+
+size_t ZSTD_HC_compress_usingDict(ZSTD_HC_CCtx* ctx,
+                                  void* dst, size_t maxDstSize,
+                            const void* src, size_t srcSize,
+                            const void* dict, size_t dictSize,
+                                  int compressionLevel)
+{
+    BYTE* const ostart = (BYTE*)dst;
+    BYTE* op = ostart;
+    size_t oSize;
+
+    /* Header : window must also cover dictionary */
+    oSize = ZSTD_HC_compressBegin(ctx, dst, maxDstSize, compressionLevel, (U64)srcSize + dictSize);
+    if(ZSTD_isError(oSize)) return oSize;
+    op += oSize;
+    maxDstSize -= oSize;
+
+    /* Dictionary */
+    oSize = ZSTD_HC_compress_insertDictionary(ctx, dict, dictSize);
+    if(ZSTD_isError(oSize)) return oSize;
+
+    /* body (compression) */
+    oSize = ZSTD_HC_compressContinue(ctx, op, maxDstSize, src, srcSize);
+    if(ZSTD_isError(oSize)) return oSize;
+    op += oSize;
+    maxDstSize -= oSize;
+
+    /* Close frame */
+    oSize = ZSTD_HC_compressEnd(ctx, op, maxDstSize);
+    if(ZSTD_isError(oSize)) return oSize;
+    op += oSize;
+
+    return (op - ostart);
+}
+
+
+/* *************************************
+*  Digested dictionary : ZSTD_HC_CDict
+***************************************/
+struct ZSTD_HC_CDict_s
+{
+    void* dictContent;
+    size_t dictContentSize;
+    ZSTD_HC_CCtx* refContext;   /* dictionary loaded, at the beginning of a frame : read-only after creation */
+    ZSTD_customMem customMem;
+};
+
+ZSTD_HC_CDict* ZSTD_HC_createCDict_advanced(const void* dict, size_t dictSize, ZSTD_HC_parameters params, ZSTD_customMem customMem)
+{
+    ZSTD_HC_CDict* cdict;
+    void* dictContent;
+    ZSTD_HC_CCtx* cctx;
+    BYTE header[4];
+    size_t errorCode;
+
+    if (!customMem.customAlloc != !customMem.customFree) return NULL;
+    cdict = (ZSTD_HC_CDict*)ZSTD_malloc(sizeof(ZSTD_HC_CDict), customMem);
+    dictContent = ZSTD_malloc(dictSize+1, customMem);   /* +1 : malloc(0) may return NULL */
+    cctx = ZSTD_HC_createCCtx_advanced(customMem);
+    if (!cdict || !dictContent || !cctx) goto _error;
+    memcpy(dictContent, dict, dictSize);
+    errorCode = ZSTD_HC_compressBegin_advanced(cctx, header, sizeof(header), params, 0);
+    if (ZSTD_isError(errorCode)) goto _error;
+    errorCode = ZSTD_HC_compress_insertDictionary(cctx, dictContent, dictSize);
+    if (ZSTD_isError(errorCode)) goto _error;
+
+    cdict->dictContent = dictContent;
+    cdict->dictContentSize = dictSize;
+    cdict->refContext = cctx;
+    cdict->customMem = customMem;
+    return cdict;
+
+_error:
+    ZSTD_free(cdict, customMem);
+    ZSTD_free(dictContent, customMem);
+    ZSTD_HC_freeCCtx(cctx);
+    return NULL;
+}
+
+ZSTD_HC_CDict* ZSTD_HC_createCDict(const void* dict, size_t dictSize, int compressionLevel)
+{
+    const ZSTD_customMem defaultMem = { NULL, NULL, NULL };
+    return ZSTD_HC_createCDict_advanced(dict, dictSize, ZSTD_HC_levelParams(NULL, compressionLevel, 0), defaultMem);
+}
+
+size_t ZSTD_HC_freeCDict(ZSTD_HC_CDict* cdict)
+{
+    if (cdict==NULL) return 0;
+    ZSTD_HC_freeCCtx(cdict->refContext);
+    ZSTD_free(cdict->dictContent, cdict->customMem);
+    ZSTD_free(cdict, cdict->customMem);
+    return 0;
+}
+
+size_t ZSTD_HC_compress_usingCDict(ZSTD_HC_CCtx* ctx,
+                                   void* dst, size_t maxDstSize,
+                             const void* src, size_t srcSize,
+                             const ZSTD_HC_CDict* cdict)
+{
+    return ZSTD_HC_compress_usingPreparedCCtx(ctx, cdict->refContext, dst, maxDstSize, src, srcSize);
+}
@@ -70,6 +70,18 @@ ZSTD_HC_compressCCtx() :
 */
 size_t ZSTD_HC_compressCCtx(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize, int compressionLevel);
 
+/**
+ZSTD_HC_compress_usingDict() :
+    Same as ZSTD_HC_compressCCtx(), using a dictionary : content which is presumed similar to 'src'.
+    Matches can reference dictionary content, which improves compression of small inputs.
+    Decompression requires the same dictionary (see ZSTD_decompress_usingDict(), in zstd.h).
+*/
+size_t ZSTD_HC_compress_usingDict(ZSTD_HC_CCtx* ctx,
+                                  void* dst, size_t maxDstSize,
+                            const void* src, size_t srcSize,
+                            const void* dict,size_t dictSize,
+                                  int compressionLevel);
+
 
 #if defined (__cplusplus)
 }
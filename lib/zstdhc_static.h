@@ -40,18 +40,19 @@ extern "C" {
 ***************************************/
 #include "mem.h"
 #include "zstdhc.h"
+#include "zstd_static.h"   /* ZSTD_customMem */
 
 
 /* *************************************
 *  Types
 ***************************************/
 /** from faster to stronger */
-typedef enum { ZSTD_HC_fast, ZSTD_HC_greedy, ZSTD_HC_lazy, ZSTD_HC_lazy2, ZSTD_HC_btlazy2 } ZSTD_HC_strategy;
+typedef enum { ZSTD_HC_fast, ZSTD_HC_greedy, ZSTD_HC_lazy, ZSTD_HC_lazy2, ZSTD_HC_btlazy2, ZSTD_HC_btopt } ZSTD_HC_strategy;
 
 typedef struct
 {
     U32 windowLog;     /* largest match distance : impact decompression buffer size */
-    U32 contentLog;    /* full search segment : larger == more compression, slower, more memory (useless for fast) */
+    U32 contentLog;    /* full search segment : larger == more compression, slower, more memory (useless for fast, greedy, lazy and lazy2) */
     U32 hashLog;       /* dispatch table : larger == more memory, faster*/
     U32 searchLog;     /* nb of searches : larger == more compression, slower*/
     U32 searchLength;  /* size of matches : larger == faster decompression */
@@ -69,6 +70,8 @@ typedef struct
 #define ZSTD_HC_SEARCHLOG_MIN 1
 #define ZSTD_HC_SEARCHLENGTH_MAX 7
 #define ZSTD_HC_SEARCHLENGTH_MIN 4
+#define ZSTD_HC_LDM_WINDOWLOG_MAX 31   /* largest offset supported by format */
+#define ZSTD_HC_LDM_WINDOWLOG_MIN ZSTD_HC_WINDOWLOG_MIN
 
 
 /* *************************************
@@ -83,9 +86,75 @@ size_t ZSTD_HC_compress_advanced (ZSTD_HC_CCtx* ctx,
 
 /** ZSTD_HC_validateParams
     correct params value to remain within authorized range
-    srcSizeHint value is optional, select 0 if not known */
+    srcSizeHint value is optional, select 0 if not known.
+    When known, windowLog, contentLog and hashLog are reduced to fit srcSizeHint, so memory usage follows input size */
 void ZSTD_HC_validateParams(ZSTD_HC_parameters* params, U64 srcSizeHint);
 
+/** ZSTD_HC_getParams
+    @result : parameters of compressionLevel, from the table selected by srcSizeHint, validated for srcSizeHint.
+    srcSizeHint value is optional, select 0 if not known */
+ZSTD_HC_parameters ZSTD_HC_getParams(int compressionLevel, U64 srcSizeHint);
+
+/** ZSTD_HC_setBlockSize
+    Same as ZSTD_setBlockSize() (see "zstd_static.h") : select size of produced blocks, 0 means default.
+    @result : 0, or an error code */
+size_t ZSTD_HC_setBlockSize(ZSTD_HC_CCtx* ctx, size_t blockSize);
+
+/** ZSTD_HC_setContentChecksum
+    Same as ZSTD_setContentChecksum() (see "zstd_static.h") : 1 appends a checksum of content to following frames.
+    @result : 0, or an error code */
+size_t ZSTD_HC_setContentChecksum(ZSTD_HC_CCtx* ctx, unsigned checksumFlag);
+
+/** ZSTD_HC_setPledgedSrcSize
+    Same as ZSTD_setPledgedSrcSize() (see "zstd_static.h") : records content size into next frame header only,
+    and ZSTD_HC_compressEnd() fails with srcSize_wrong when total input differs from it.
+    @result : 0, or an error code */
+size_t ZSTD_HC_setPledgedSrcSize(ZSTD_HC_CCtx* ctx, unsigned long long pledgedSrcSize);
+
+/** ZSTD_HC_setLongDistance
+    Enable long distance matching, for repetitions farther than windowLog, up to (1<<ldmWindowLog) bytes back.
+    Long matches (>= 512 bytes) beyond windowLog are searched first, using a sparse rolling hash,
+    regular match finders then only process areas in between.
+    ldmWindowLog must be within [ZSTD_HC_LDM_WINDOWLOG_MIN, ZSTD_HC_LDM_WINDOWLOG_MAX]; 0 disables it (default).
+    It applies to following frames, starting with ZSTD_HC_compressBegin*() or ZSTD_HC_compress*().
+    Memory usage grows by (1<<ldmWindowLog)/16 bytes (less if srcSizeHint is smaller),
+    not included into ZSTD_HC_estimateCCtxSize().
+    Matches only reference current prefix : decoder needs full window in memory (all previous output of the frame).
+    @result : 0, or an error code */
+size_t ZSTD_HC_setLongDistance(ZSTD_HC_CCtx* ctx, U32 ldmWindowLog);
+
+/** ZSTD_HC_getCCtxStats, ZSTD_HC_resetCCtxStats
+    Same as ZSTD_getCCtxStats() and ZSTD_resetCCtxStats() (see "zstd_static.h") : needs ZSTD_STATS=1.
+    Frames of level 1, redirected towards ZSTD_compress(), are not counted.
+    @result : 0, or an error code */
+size_t ZSTD_HC_getCCtxStats(const ZSTD_HC_CCtx* ctx, ZSTD_stats* stats);
+size_t ZSTD_HC_resetCCtxStats(ZSTD_HC_CCtx* ctx);
+
+
+/* *************************************
+*  Custom memory allocation
+***************************************/
+ZSTD_HC_CCtx* ZSTD_HC_createCCtx_advanced(ZSTD_customMem customMem);
+/*
+  Same as ZSTD_createCCtx_advanced() (see "zstd_static.h") : context and tables are allocated using customMem.
+  Note : when level 1 is redirected towards ZSTD_compress(), the context allocated there uses default malloc().
+*/
+
+
+/* *************************************
+*  Static allocation
+***************************************/
+size_t        ZSTD_HC_estimateCCtxSize(ZSTD_HC_parameters params);
+ZSTD_HC_CCtx* ZSTD_HC_initStaticCCtx(void* workspace, size_t workspaceSize);
+/*
+  ZSTD_HC_estimateCCtxSize() : size of a context able to compress with any parameters up to params.
+  ZSTD_HC_initStaticCCtx() builds a context into a caller-provided 8-bytes aligned workspace.
+  It returns NULL if workspace is too small or misaligned.
+  Such a context never allocates memory : compression fails with error memory_allocation
+  when selected parameters need more than workspace, and level 1 is not redirected towards ZSTD_compress().
+  It is released by releasing workspace : ZSTD_HC_freeCCtx() returns an error.
+*/
+
 
 /* *************************************
 *  Streaming functions
@@ -95,10 +164,48 @@ size_t ZSTD_HC_compressContinue(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize,
 size_t ZSTD_HC_compressEnd(ZSTD_HC_CCtx* ctx, void* dst, size_t maxDstSize);
 
 
+/* *************************************
+*  Dictionary functions
+***************************************/
+size_t ZSTD_HC_compress_insertDictionary(ZSTD_HC_CCtx* ctx, const void* dict, size_t dictSize);
+size_t ZSTD_HC_duplicateCCtx(ZSTD_HC_CCtx* dstCCtx, const ZSTD_HC_CCtx* srcCCtx);
+size_t ZSTD_HC_compress_usingPreparedCCtx(ZSTD_HC_CCtx* ctx, const ZSTD_HC_CCtx* preparedCCtx,
+                                          void* dst, size_t maxDstSize,
+                                    const void* src, size_t srcSize);
+/*
+  ZSTD_HC_compress_insertDictionary() loads a dictionary into ctx tables, using ctx parameters.
+  It must be called after ZSTD_HC_compressBegin(), and before first ZSTD_HC_compressContinue().
+  Provide dictSize within srcSizeHint of ZSTD_HC_compressBegin(), since window must cover the dictionary.
+  Only the last (1<<windowLog) bytes of dictionary can be referenced.
+  Dictionary content is referenced, not copied : it must remain accessible and unmodified while in use.
+  ZSTD_HC_duplicateCCtx() copies the state of srcCCtx into dstCCtx, including a loaded dictionary and parameters.
+  srcCCtx must be at the beginning of a frame (no ZSTD_HC_compressContinue() yet).
+  ZSTD_HC_compress_usingPreparedCCtx() compresses a full frame, starting from a copy of preparedCCtx.
+  It avoids re-hashing the same dictionary for each input, which matters for small inputs.
+*/
+
+typedef struct ZSTD_HC_CDict_s ZSTD_HC_CDict;
+ZSTD_HC_CDict* ZSTD_HC_createCDict(const void* dict, size_t dictSize, int compressionLevel);
+ZSTD_HC_CDict* ZSTD_HC_createCDict_advanced(const void* dict, size_t dictSize, ZSTD_HC_parameters params, ZSTD_customMem customMem);
+size_t         ZSTD_HC_freeCDict(ZSTD_HC_CDict* cdict);
+size_t ZSTD_HC_compress_usingCDict(ZSTD_HC_CCtx* ctx,
+                                   void* dst, size_t maxDstSize,
+                             const void* src, size_t srcSize,
+                             const ZSTD_HC_CDict* cdict);
+/*
+  ZSTD_HC_createCDict() digests a dictionary once, for a given compression level : its content is copied and indexed.
+  Parameters are selected from the table for small inputs (<= 128 KB), which is the typical use case of dictionaries.
+  Use ZSTD_HC_createCDict_advanced() to select parameters directly, and allocate all its memory from customMem.
+  A ZSTD_HC_CDict is never modified by ZSTD_HC_compress_usingCDict() :
+  it can be shared by several threads simultaneously, each one using its own ZSTD_HC_CCtx.
+  Frames are decompressed using ZSTD_decompress_usingDict() or ZSTD_decompress_usingDDict().
+*/
+
+
 /* *************************************
 *  Pre-defined compression levels
 ***************************************/
-#define ZSTD_HC_MAX_CLEVEL 20
+#define ZSTD_HC_MAX_CLEVEL 22
 static const ZSTD_HC_parameters ZSTD_HC_defaultParameters[2][ZSTD_HC_MAX_CLEVEL+1] = {
 {   /* for <= 128 KB */
     /* W,  C,  H,  S,  L, strat */
@@ -123,6 +230,8 @@ static const ZSTD_HC_parameters ZSTD_HC_defaultParameters[2][ZSTD_HC_MAX_CLEVEL+
     { 17, 18, 16,  9,  4, ZSTD_HC_btlazy2 },  /* level 18 */
     { 17, 18, 16, 10,  4, ZSTD_HC_btlazy2 },  /* level 19 */
     { 17, 18, 18, 12,  4, ZSTD_HC_btlazy2 },  /* level 20 */
+    { 17, 18, 17,  6,  4, ZSTD_HC_btopt   },  /* level 21 */
+    { 17, 18, 18,  8,  4, ZSTD_HC_btopt   },  /* level 22 */
 },
 {   /* for > 128 KB */
     /* W,  C,  H,  S,  L, strat */
@@ -147,10 +256,39 @@ static const ZSTD_HC_parameters ZSTD_HC_defaultParameters[2][ZSTD_HC_MAX_CLEVEL+
     { 25, 24, 23,  5,  5, ZSTD_HC_btlazy2 },  /* level 18 */
     { 25, 26, 23,  5,  5, ZSTD_HC_btlazy2 },  /* level 19 */
     { 26, 27, 24,  6,  5, ZSTD_HC_btlazy2 },  /* level 20 */
+    { 26, 27, 24,  5,  4, ZSTD_HC_btopt   },  /* level 21 */
+    { 26, 27, 24,  7,  4, ZSTD_HC_btopt   },  /* level 22 */
 }
 };
 
 
+/* *************************************
+*  Custom compression levels
+***************************************/
+/** ZSTD_HC_levelTable
+    Same layout as ZSTD_HC_defaultParameters : row 0 for sources <= 128 KB, row 1 for larger ones (or unknown size).
+    Entries are corrected by ZSTD_HC_validateParams() when used, like default ones. Level 0 entries are never used. */
+typedef ZSTD_HC_parameters ZSTD_HC_levelTable[2][ZSTD_HC_MAX_CLEVEL+1];
+
+/** ZSTD_HC_setLevelTable
+    Select parameters of compression levels for this context, for ZSTD_HC_compressCCtx() and ZSTD_HC_compressBegin().
+    table is referenced, not copied : it must remain valid while ctx uses it. NULL reverts to the global table.
+    With a custom table, level 1 uses its entry instead of being redirected towards ZSTD_compress().
+    @result : 0, or an error code */
+size_t ZSTD_HC_setLevelTable(ZSTD_HC_CCtx* ctx, const ZSTD_HC_levelTable* table);
+
+/** ZSTD_HC_setGlobalLevelTable
+    Same as ZSTD_HC_setLevelTable(), for all contexts without their own table,
+    and for ZSTD_HC_compress(), ZSTD_HC_getParams(), ZSTD_HC_createCDict() and ZBUFF_compressInit().
+    Not thread-safe : select it once at startup, before any compression. NULL reverts to ZSTD_HC_defaultParameters.
+    @result : 0, or an error code */
+size_t ZSTD_HC_setGlobalLevelTable(const ZSTD_HC_levelTable* table);
+
+/** ZSTD_HC_getGlobalLevelTable
+    @result : table selected by ZSTD_HC_setGlobalLevelTable(), or NULL for ZSTD_HC_defaultParameters */
+const ZSTD_HC_levelTable* ZSTD_HC_getGlobalLevelTable(void);
+
+
 #if defined (__cplusplus)
 }
 #endif
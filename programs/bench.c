@@ -37,32 +37,38 @@
 #  define _LARGEFILE64_SOURCE
 #endif
 
-/* S_ISREG & gettimeofday() are not supported by MSVC */
-#if defined(_MSC_VER) || defined(_WIN32)
-#  define BMK_LEGACY_TIMER 1
+/* clock_gettime() requires POSIX.1b */
+#if !defined(_WIN32) && !defined(__APPLE__) && !defined(_POSIX_C_SOURCE)
+#  define _POSIX_C_SOURCE 199309L
 #endif
 
 
 /* *************************************
 *  Includes
 ***************************************/
-#include <stdlib.h>      /* malloc, free */
+#include <stdlib.h>      /* malloc, free, qsort */
 #include <string.h>      /* memset */
 #include <stdio.h>       /* fprintf, fopen, ftello64 */
 #include <sys/types.h>   /* stat64 */
 #include <sys/stat.h>    /* stat64 */
 
-/* Use ftime() if gettimeofday() is not available */
-#if defined(BMK_LEGACY_TIMER)
-#  include <sys/timeb.h>   /* timeb, ftime */
+#include "threading.h"   /* pthread_mutex_t, pthread_cond_t */
+#include "pool.h"        /* POOL_create, POOL_add */
+
+/* Monotonic high resolution timer */
+#if defined(_WIN32)
+#  include <windows.h>           /* QueryPerformanceCounter */
+#elif defined(__APPLE__)
+#  include <mach/mach_time.h>    /* mach_absolute_time */
 #else
-#  include <sys/time.h>    /* gettimeofday */
+#  include <time.h>              /* clock_gettime */
 #endif
 
 #include "mem.h"
-#include "zstd.h"
-#include "zstdhc.h"
+#include "zstd_static.h"   /* ZSTD_compressBatch, ZSTD_decompressDCtx */
+#include "zstdhc_static.h"   /* ZSTD_HC_getGlobalLevelTable */
 #include "xxhash.h"
+#include "bench.h"
 
 
 /* *************************************
@@ -77,12 +83,16 @@
 *  Constants
 ***************************************/
 #define NBLOOPS    3
-#define TIMELOOP   2500
+#define TIMELOOP   2500   /* ms */
+#define LATENCY_TIMELOOP   500   /* ms */
+#define LATENCY_SAMPLES   1000   /* per thread */
 
 #define KB *(1 <<10)
 #define MB *(1 <<20)
 #define GB *(1U<<30)
 
+#define NANOSEC_PER_MILLISEC 1000000ULL
+
 static const size_t maxMemory = sizeof(size_t)==4  ?  (2 GB - 64 MB) : (size_t)(1ULL << ((sizeof(size_t)*8)-31));
 #define DEFAULT_CHUNKSIZE   (4 MB)
 
@@ -102,6 +112,9 @@ static U32 prime2 = 2246822519U;
 ***************************************/
 static int nbIterations = NBLOOPS;
 static size_t g_blockSize = 0;
+static unsigned g_nbThreads = 1;
+static BMK_outputFormat_e g_outputFormat = BMK_format_human;
+static int g_csvHeaderDone = 0;
 
 void BMK_SetNbIterations(int nbLoops)
 {
@@ -115,47 +128,66 @@ void BMK_SetBlockSize(size_t blockSize)
     DISPLAY("using blocks of size %u KB \n", (U32)(blockSize>>10));
 }
 
+void BMK_SetNbThreads(unsigned nbThreads)
+{
+    if (nbThreads < 1) nbThreads = 1;
+    if (nbThreads > POOL_maxThreads())
+    {
+        nbThreads = POOL_maxThreads();
+        DISPLAY("Warning : benchmark limited to %u thread(s) \n", nbThreads);
+    }
+    g_nbThreads = nbThreads;
+    DISPLAY("- %u threads -\n", g_nbThreads);
+}
+
+void BMK_SetOutputFormat(BMK_outputFormat_e format)
+{
+    g_outputFormat = format;
+}
+
 
 /* ********************************************************
 *  Private functions
 **********************************************************/
 
-#if defined(BMK_LEGACY_TIMER)
+/* BMK_getNanoTime() :
+*  monotonic clock, in nanoseconds; only differences between 2 calls are meaningful */
+#if defined(_WIN32)
+
+static U64 BMK_getNanoTime(void)
+{
+    static LARGE_INTEGER ticksPerSecond = { { 0, 0 } };
+    LARGE_INTEGER now;
+    if (!ticksPerSecond.QuadPart) QueryPerformanceFrequency(&ticksPerSecond);
+    QueryPerformanceCounter(&now);
+    return (U64)(now.QuadPart / ticksPerSecond.QuadPart) * 1000000000ULL
+         + (U64)(now.QuadPart % ticksPerSecond.QuadPart) * 1000000000ULL / (U64)ticksPerSecond.QuadPart;
+}
+
+#elif defined(__APPLE__)
 
-static int BMK_GetMilliStart(void)
+static U64 BMK_getNanoTime(void)
 {
-  /* Based on Legacy ftime()
-  *  Rolls over every ~ 12.1 days (0x100000/24/60/60)
-  *  Use GetMilliSpan to correct for rollover */
-  struct timeb tb;
-  int nCount;
-  ftime( &tb );
-  nCount = (int) (tb.millitm + (tb.time & 0xfffff) * 1000);
-  return nCount;
+    static mach_timebase_info_data_t rate = { 0, 0 };
+    if (!rate.denom) mach_timebase_info(&rate);
+    return mach_absolute_time() * rate.numer / rate.denom;
 }
 
 #else
 
-static int BMK_GetMilliStart(void)
+static U64 BMK_getNanoTime(void)
 {
-  /* Based on newer gettimeofday()
-  *  Use GetMilliSpan to correct for rollover */
-  struct timeval tv;
-  int nCount;
-  gettimeofday(&tv, NULL);
-  nCount = (int) (tv.tv_usec/1000 + (tv.tv_sec & 0xfffff) * 1000);
-  return nCount;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (U64)ts.tv_sec * 1000000000ULL + (U64)ts.tv_nsec;
 }
 
 #endif
 
 
-static int BMK_GetMilliSpan( int nTimeStart )
+static U64 BMK_getNanoSpan(U64 nanoStart)
 {
-  int nSpan = BMK_GetMilliStart() - nTimeStart;
-  if ( nSpan < 0 )
-    nSpan += 0x100000 * 1000;
-  return nSpan;
+    return BMK_getNanoTime() - nanoStart;
 }
 
 
@@ -229,153 +261,479 @@ typedef struct
     size_t resSize;
 } blockParam_t;
 
-typedef size_t (*compressor_t) (void* dst, size_t maxDstSize, const void* src, size_t srcSize, int compressionLevel);
+typedef enum { BMK_compression, BMK_decompression, BMK_compressionLatency, BMK_decompressionLatency } BMK_phase_e;
 
-static size_t local_compress_fast (void* dst, size_t maxDstSize, const void* src, size_t srcSize, int compressionLevel)
+/* Shared by all threads of a benchmark : counts jobs still running */
+typedef struct
 {
-    (void)compressionLevel;
-    return ZSTD_compress(dst, maxDstSize, src, srcSize);
-}
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;   /* signaled whenever a job completes */
+    unsigned pending;
+} BMK_sync_t;
+
+/* One benchmark thread : owns its contexts and destination buffers */
+typedef struct
+{
+    BMK_sync_t* sync;
+    BMK_phase_e phase;
+    int cLevel;
+    U32 fastEngine;   /* ZSTD_CCtx, instead of ZSTD_HC_CCtx */
+    U32 nbBlocks;
+    blockParam_t* blockTable;
+    ZSTD_batchItem* batchTable;
+    ZSTD_CCtx* cctx;
+    ZSTD_HC_CCtx* hcctx;
+    ZSTD_DCtx* dctx;
+    void* compressedBuffer;
+    void* resultBuffer;
+    U64* latencies;      /* LATENCY_SAMPLES entries */
+    /* results of last phase */
+    U32 nbLoops;
+    U64 nanoTime;
+    U32 nbLatencies;
+    /* results over all iterations */
+    double fastestC, fastestD;   /* nanoseconds per loop */
+} BMK_thread_t;
 
 #define MIN(a,b) ((a)<(b) ? (a) : (b))
 
+static void BMK_compressBlock(BMK_thread_t* thread, U32 blockNb)
+{
+    blockParam_t* const block = thread->blockTable + blockNb;
+    if (thread->fastEngine)
+    {
+        ZSTD_compressBatch(thread->cctx, thread->batchTable + blockNb, 1, ZSTD_getParams(thread->cLevel));
+        block->cSize = thread->batchTable[blockNb].cSize;
+    }
+    else
+        block->cSize = ZSTD_HC_compressCCtx(thread->hcctx, block->cPtr, block->cRoom, block->srcPtr, block->srcSize, thread->cLevel);
+}
+
+static void BMK_decompressBlock(BMK_thread_t* thread, U32 blockNb)
+{
+    blockParam_t* const block = thread->blockTable + blockNb;
+    block->resSize = ZSTD_decompressDCtx(thread->dctx, block->resPtr, block->srcSize, block->cPtr, block->cSize);
+}
+
+/* BMK_runPhase() :
+*  job run by each benchmark thread; signals completion through thread->sync */
+static void BMK_runPhase(void* opaque)
+{
+    BMK_thread_t* const thread = (BMK_thread_t*)opaque;
+    const U32 nbBlocks = thread->nbBlocks;
+    U32 blockNb;
+    U64 nanoStart;
+
+    thread->nbLoops = 0;
+    thread->nbLatencies = 0;
+    nanoStart = BMK_getNanoTime();
+    switch(thread->phase)
+    {
+    case BMK_compression:
+        do
+        {
+            if (thread->fastEngine)
+                ZSTD_compressBatch(thread->cctx, thread->batchTable, nbBlocks, ZSTD_getParams(thread->cLevel));
+            else
+                for (blockNb=0; blockNb<nbBlocks; blockNb++)
+                    BMK_compressBlock(thread, blockNb);
+            thread->nbLoops++;
+        } while (BMK_getNanoSpan(nanoStart) < TIMELOOP * NANOSEC_PER_MILLISEC);
+        thread->nanoTime = BMK_getNanoSpan(nanoStart);
+        if (thread->fastEngine)
+            for (blockNb=0; blockNb<nbBlocks; blockNb++)
+                thread->blockTable[blockNb].cSize = thread->batchTable[blockNb].cSize;
+        break;
+
+    case BMK_decompression:
+        do
+        {
+            for (blockNb=0; blockNb<nbBlocks; blockNb++)
+                BMK_decompressBlock(thread, blockNb);
+            thread->nbLoops++;
+        } while (BMK_getNanoSpan(nanoStart) < TIMELOOP * NANOSEC_PER_MILLISEC);
+        thread->nanoTime = BMK_getNanoSpan(nanoStart);
+        break;
+
+    case BMK_compressionLatency:
+    case BMK_decompressionLatency:
+        /* time blocks one by one, round robin, until enough samples or time is up */
+        if (!nbBlocks) break;
+        blockNb = 0;
+        do
+        {
+            const U64 blockStart = BMK_getNanoTime();
+            if (thread->phase == BMK_compressionLatency)
+                BMK_compressBlock(thread, blockNb);
+            else
+                BMK_decompressBlock(thread, blockNb);
+            thread->latencies[thread->nbLatencies++] = BMK_getNanoSpan(blockStart);
+            if (++blockNb == nbBlocks) blockNb = 0;
+        } while ( (thread->nbLatencies < LATENCY_SAMPLES)
+               && (BMK_getNanoSpan(nanoStart) < LATENCY_TIMELOOP * NANOSEC_PER_MILLISEC) );
+        thread->nanoTime = BMK_getNanoSpan(nanoStart);
+        break;
+    }
+
+    pthread_mutex_lock(&thread->sync->mutex);
+    thread->sync->pending--;
+    pthread_cond_broadcast(&thread->sync->cond);
+    pthread_mutex_unlock(&thread->sync->mutex);
+}
+
+/* BMK_runThreads() :
+*  runs phase on all threads concurrently, and waits for all of them.
+*  @result : wall clock time, in nanoseconds */
+static U64 BMK_runThreads(POOL_ctx* pool, BMK_sync_t* sync, BMK_thread_t* threads, unsigned nbThreads, BMK_phase_e phase)
+{
+    U64 nanoStart;
+    unsigned t;
+
+    sync->pending = nbThreads;
+    for (t=0; t<nbThreads; t++) threads[t].phase = phase;
+    nanoStart = BMK_getNanoTime();
+    for (t=0; t<nbThreads; t++) POOL_add(pool, BMK_runPhase, threads+t);
+    pthread_mutex_lock(&sync->mutex);
+    while (sync->pending) pthread_cond_wait(&sync->cond, &sync->mutex);
+    pthread_mutex_unlock(&sync->mutex);
+    return BMK_getNanoSpan(nanoStart);
+}
+
+
+/* Latency percentiles, in microseconds */
+typedef struct { double p50, p90, p99, max; } BMK_latency_t;
+
+static int BMK_compareU64(const void* a, const void* b)
+{
+    const U64 x = *(const U64*)a, y = *(const U64*)b;
+    return (x > y) - (x < y);
+}
+
+/* BMK_getLatency() :
+*  gathers samples of all threads into samples, then sorts them */
+static BMK_latency_t BMK_getLatency(U64* samples, const BMK_thread_t* threads, unsigned nbThreads)
+{
+    BMK_latency_t lat = { 0., 0., 0., 0. };
+    size_t nbSamples = 0;
+    unsigned t;
+
+    for (t=0; t<nbThreads; t++)
+    {
+        memcpy(samples + nbSamples, threads[t].latencies, threads[t].nbLatencies * sizeof(U64));
+        nbSamples += threads[t].nbLatencies;
+    }
+    if (!nbSamples) return lat;
+    qsort(samples, nbSamples, sizeof(U64), BMK_compareU64);
+    lat.p50 = (double)samples[(nbSamples-1) * 50 / 100] / 1000.;
+    lat.p90 = (double)samples[(nbSamples-1) * 90 / 100] / 1000.;
+    lat.p99 = (double)samples[(nbSamples-1) * 99 / 100] / 1000.;
+    lat.max = (double)samples[nbSamples-1] / 1000.;
+    return lat;
+}
+
+
+/* Results of one benchmark, speeds in MB/s */
+typedef struct
+{
+    const char* fileName;
+    int cLevel;
+    unsigned nbThreads;
+    size_t srcSize;
+    size_t cSize;
+    size_t blockSize;
+    U32 nbBlocks;
+    double cSpeed, dSpeed;   /* aggregate, all threads */
+    const BMK_thread_t* threads;
+    BMK_latency_t cLatency, dLatency;
+} BMK_result_t;
+
+static double BMK_speed(size_t srcSize, double nanoPerLoop) { return (double)srcSize / nanoPerLoop * 1000.; }
+
+static void BMK_printJsonString(const char* s)
+{
+    printf("\"");
+    for ( ; *s; s++)
+    {
+        if ((*s == '"') || (*s == '\\')) printf("\\%c", *s);
+        else if ((unsigned char)*s < 0x20) printf("\\u%04x", (unsigned)(unsigned char)*s);
+        else putchar(*s);
+    }
+    printf("\"");
+}
+
+static void BMK_printCsvString(const char* s)
+{
+    printf("\"");
+    for ( ; *s; s++)
+    {
+        if (*s == '"') putchar('"');
+        putchar(*s);
+    }
+    printf("\"");
+}
+
+/* BMK_printResult() :
+*  machine readable output, to stdout : one JSON object per line, or one CSV row */
+static void BMK_printResult(const BMK_result_t* r)
+{
+    unsigned t;
+
+    if (g_outputFormat == BMK_format_json)
+    {
+        printf("{\"file\":");
+        BMK_printJsonString(r->fileName);
+        printf(",\"level\":%i,\"threads\":%u,\"srcSize\":%llu,\"cSize\":%llu,\"ratio\":%.3f,\"blockSize\":%llu,\"nbBlocks\":%u",
+               r->cLevel, r->nbThreads, (unsigned long long)r->srcSize, (unsigned long long)r->cSize,
+               (double)r->srcSize / (double)r->cSize, (unsigned long long)r->blockSize, r->nbBlocks);
+        printf(",\"cSpeed\":%.2f,\"dSpeed\":%.2f", r->cSpeed, r->dSpeed);
+        printf(",\"cSpeedPerThread\":[");
+        for (t=0; t<r->nbThreads; t++) printf("%s%.2f", t ? "," : "", BMK_speed(r->srcSize, r->threads[t].fastestC));
+        printf("],\"dSpeedPerThread\":[");
+        for (t=0; t<r->nbThreads; t++) printf("%s%.2f", t ? "," : "", BMK_speed(r->srcSize, r->threads[t].fastestD));
+        printf("],\"cLatencyUs\":{\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}",
+               r->cLatency.p50, r->cLatency.p90, r->cLatency.p99, r->cLatency.max);
+        printf(",\"dLatencyUs\":{\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}}\n",
+               r->dLatency.p50, r->dLatency.p90, r->dLatency.p99, r->dLatency.max);
+    }
+    else   /* BMK_format_csv */
+    {
+        if (!g_csvHeaderDone)
+        {
+            printf("file,level,threads,srcSize,cSize,ratio,blockSize,nbBlocks,cSpeed,dSpeed,cSpeedPerThread,dSpeedPerThread,"
+                   "cP50us,cP90us,cP99us,cMaxUs,dP50us,dP90us,dP99us,dMaxUs\n");
+            g_csvHeaderDone = 1;
+        }
+        BMK_printCsvString(r->fileName);
+        printf(",%i,%u,%llu,%llu,%.3f,%llu,%u,%.2f,%.2f,\"",
+               r->cLevel, r->nbThreads, (unsigned long long)r->srcSize, (unsigned long long)r->cSize,
+               (double)r->srcSize / (double)r->cSize, (unsigned long long)r->blockSize, r->nbBlocks, r->cSpeed, r->dSpeed);
+        for (t=0; t<r->nbThreads; t++) printf("%s%.2f", t ? ";" : "", BMK_speed(r->srcSize, r->threads[t].fastestC));
+        printf("\",\"");
+        for (t=0; t<r->nbThreads; t++) printf("%s%.2f", t ? ";" : "", BMK_speed(r->srcSize, r->threads[t].fastestD));
+        printf("\",%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+               r->cLatency.p50, r->cLatency.p90, r->cLatency.p99, r->cLatency.max,
+               r->dLatency.p50, r->dLatency.p90, r->dLatency.p99, r->dLatency.max);
+    }
+    fflush(stdout);
+}
+
+static void BMK_freeThreads(BMK_thread_t* threads, unsigned nbThreads)
+{
+    unsigned t;
+    if (!threads) return;
+    for (t=0; t<nbThreads; t++)
+    {
+        free(threads[t].blockTable);
+        free(threads[t].batchTable);
+        free(threads[t].compressedBuffer);
+        free(threads[t].resultBuffer);
+        free(threads[t].latencies);
+        ZSTD_freeCCtx(threads[t].cctx);
+        ZSTD_HC_freeCCtx(threads[t].hcctx);
+        ZSTD_freeDCtx(threads[t].dctx);
+    }
+    free(threads);
+}
+
 static int BMK_benchMem(void* srcBuffer, size_t srcSize, const char* fileName, int cLevel)
 {
     const size_t blockSize = (g_blockSize ? g_blockSize : srcSize) + (!srcSize);   /* avoid div by 0 */
     const U32 nbBlocks = (U32) ((srcSize + (blockSize-1)) / blockSize);
-    blockParam_t* const blockTable = (blockParam_t*) malloc(nbBlocks * sizeof(blockParam_t));
     const size_t maxCompressedSize = (size_t)nbBlocks * ZSTD_compressBound(blockSize);
-    void* const compressedBuffer = malloc(maxCompressedSize);
-    void* const resultBuffer = malloc(srcSize);
-    const compressor_t compressor = (cLevel <= 1) ? local_compress_fast : ZSTD_HC_compress;
+    const unsigned nbThreads = g_nbThreads;
+    BMK_thread_t* const threads = (BMK_thread_t*) calloc(nbThreads, sizeof(BMK_thread_t));
+    U64* const samples = (U64*) malloc((size_t)nbThreads * LATENCY_SAMPLES * sizeof(U64));
+    POOL_ctx* const pool = POOL_create(nbThreads, nbThreads);
+    const char* const fullName = fileName;
+    BMK_sync_t sync;
     U64 crcOrig;
+    int allocError = !threads || !samples || !pool;
+    unsigned t;
 
     /* init */
     if (strlen(fileName)>16)
         fileName += strlen(fileName)-16;
 
     /* Memory allocation & restrictions */
-    if (!compressedBuffer || !resultBuffer || !blockTable)
+    for (t=0; (t<nbThreads) && !allocError; t++)
+    {
+        BMK_thread_t* const thread = threads+t;
+        thread->sync = &sync;
+        thread->cLevel = cLevel;
+        thread->fastEngine = (cLevel < 1) || ((cLevel == 1) && !ZSTD_HC_getGlobalLevelTable());   /* custom tables define level 1 too */
+        thread->nbBlocks = nbBlocks;
+        thread->blockTable = (blockParam_t*) malloc(nbBlocks * sizeof(blockParam_t));
+        thread->batchTable = (ZSTD_batchItem*) malloc(nbBlocks * sizeof(ZSTD_batchItem));   /* fast levels : one context for all blocks */
+        thread->compressedBuffer = malloc(maxCompressedSize);
+        thread->resultBuffer = malloc(srcSize);
+        thread->latencies = (U64*) malloc(LATENCY_SAMPLES * sizeof(U64));
+        thread->cctx = ZSTD_createCCtx();
+        thread->hcctx = ZSTD_HC_createCCtx();
+        thread->dctx = ZSTD_createDCtx();
+        thread->fastestC = thread->fastestD = 1e18;
+        allocError = !thread->blockTable || !thread->batchTable || !thread->compressedBuffer || !thread->resultBuffer
+                  || !thread->latencies || !thread->cctx || !thread->hcctx || !thread->dctx;
+    }
+    if (allocError)
     {
         DISPLAY("\nError: not enough memory!\n");
-        free(compressedBuffer);
-        free(resultBuffer);
-        free(blockTable);
+        BMK_freeThreads(threads, nbThreads);
+        free(samples);
+        POOL_free(pool);
         return 12;
     }
+    pthread_mutex_init(&sync.mutex, NULL);
+    pthread_cond_init(&sync.cond, NULL);
 
     /* Calculating input Checksum */
     crcOrig = XXH64(srcBuffer, srcSize, 0);
 
     /* Init blockTable data */
+    for (t=0; t<nbThreads; t++)
     {
+        BMK_thread_t* const thread = threads+t;
         U32 i;
         size_t remaining = srcSize;
         char* srcPtr = (char*)srcBuffer;
-        char* cPtr = (char*)compressedBuffer;
-        char* resPtr = (char*)resultBuffer;
+        char* cPtr = (char*)thread->compressedBuffer;
+        char* resPtr = (char*)thread->resultBuffer;
         for (i=0; i<nbBlocks; i++)
         {
             size_t thisBlockSize = MIN(remaining, blockSize);
-            blockTable[i].srcPtr = srcPtr;
-            blockTable[i].cPtr = cPtr;
-            blockTable[i].resPtr = resPtr;
-            blockTable[i].srcSize = thisBlockSize;
-            blockTable[i].cRoom = ZSTD_compressBound(thisBlockSize);
+            thread->blockTable[i].srcPtr = srcPtr;
+            thread->blockTable[i].cPtr = cPtr;
+            thread->blockTable[i].resPtr = resPtr;
+            thread->blockTable[i].srcSize = thisBlockSize;
+            thread->blockTable[i].cRoom = ZSTD_compressBound(thisBlockSize);
+            thread->batchTable[i].src = srcPtr;
+            thread->batchTable[i].srcSize = thisBlockSize;
+            thread->batchTable[i].dst = cPtr;
+            thread->batchTable[i].dstCapacity = thread->blockTable[i].cRoom;
             srcPtr += thisBlockSize;
-            cPtr += blockTable[i].cRoom;
+            cPtr += thread->blockTable[i].cRoom;
             resPtr += thisBlockSize;
             remaining -= thisBlockSize;
         }
-    }
 
-    /* warmimg up memory */
-    BMK_datagen(compressedBuffer, maxCompressedSize, 0.10, 1);
+        /* warmimg up memory */
+        BMK_datagen(thread->compressedBuffer, maxCompressedSize, 0.10, 1);
+    }
 
     /* Bench */
     {
         int loopNb;
         size_t cSize = 0;
-        double fastestC = 100000000., fastestD = 100000000.;
+        double fastestC = 1e18, fastestD = 1e18;   /* nanoseconds per loop, all threads together */
         double ratio = 0.;
-        U64 crcCheck = 0;
+        int crcError = 0;
 
         DISPLAY("\r%79s\r", "");
         for (loopNb = 1; loopNb <= nbIterations; loopNb++)
         {
-            int nbLoops;
-            int milliTime;
+            U64 wallTime;
+            U32 totalLoops;
             U32 blockNb;
 
             /* Compression */
             DISPLAY("%2i-%-17.17s :%10u ->\r", loopNb, fileName, (U32)srcSize);
-            memset(compressedBuffer, 0xE5, maxCompressedSize);
+            for (t=0; t<nbThreads; t++) memset(threads[t].compressedBuffer, 0xE5, maxCompressedSize);
 
-            nbLoops = 0;
-            milliTime = BMK_GetMilliStart();
-            while (BMK_GetMilliStart() == milliTime);
-            milliTime = BMK_GetMilliStart();
-            while (BMK_GetMilliSpan(milliTime) < TIMELOOP)
+            wallTime = BMK_runThreads(pool, &sync, threads, nbThreads, BMK_compression);
+            for (totalLoops=0, t=0; t<nbThreads; t++)
             {
-                for (blockNb=0; blockNb<nbBlocks; blockNb++)
-                    blockTable[blockNb].cSize = compressor(blockTable[blockNb].cPtr,  blockTable[blockNb].cRoom, blockTable[blockNb].srcPtr,blockTable[blockNb].srcSize, cLevel);
-                nbLoops++;
+                const double nanoPerLoop = (double)threads[t].nanoTime / threads[t].nbLoops;
+                if (nanoPerLoop < threads[t].fastestC) threads[t].fastestC = nanoPerLoop;
+                totalLoops += threads[t].nbLoops;
             }
-            milliTime = BMK_GetMilliSpan(milliTime);
+            if ((double)wallTime < fastestC*totalLoops) fastestC = (double)wallTime / totalLoops;
+            if (nbThreads==1) fastestC = threads[0].fastestC;
 
             cSize = 0;
             for (blockNb=0; blockNb<nbBlocks; blockNb++)
-                cSize += blockTable[blockNb].cSize;
-            if ((double)milliTime < fastestC*nbLoops) fastestC = (double)milliTime / nbLoops;
+                cSize += threads[0].blockTable[blockNb].cSize;
             ratio = (double)srcSize / (double)cSize;
-            DISPLAY("%2i-%-17.17s :%10i ->%10i (%5.3f),%6.1f MB/s\r", loopNb, fileName, (int)srcSize, (int)cSize, ratio, (double)srcSize / fastestC / 1000.);
+            DISPLAY("%2i-%-17.17s :%10i ->%10i (%5.3f),%6.1f MB/s\r", loopNb, fileName, (int)srcSize, (int)cSize, ratio, BMK_speed(srcSize, fastestC));
 
-#if 1
             /* Decompression */
-            memset(resultBuffer, 0xD6, srcSize);
+            for (t=0; t<nbThreads; t++) memset(threads[t].resultBuffer, 0xD6, srcSize);
 
-            nbLoops = 0;
-            milliTime = BMK_GetMilliStart();
-            while (BMK_GetMilliStart() == milliTime);
-            milliTime = BMK_GetMilliStart();
-            for ( ; BMK_GetMilliSpan(milliTime) < TIMELOOP; nbLoops++)
+            wallTime = BMK_runThreads(pool, &sync, threads, nbThreads, BMK_decompression);
+            for (totalLoops=0, t=0; t<nbThreads; t++)
             {
-                for (blockNb=0; blockNb<nbBlocks; blockNb++)
-                    blockTable[blockNb].resSize = ZSTD_decompress(blockTable[blockNb].resPtr, blockTable[blockNb].srcSize,
-                                                                  blockTable[blockNb].cPtr, blockTable[blockNb].cSize);
+                const double nanoPerLoop = (double)threads[t].nanoTime / threads[t].nbLoops;
+                if (nanoPerLoop < threads[t].fastestD) threads[t].fastestD = nanoPerLoop;
+                totalLoops += threads[t].nbLoops;
             }
-            milliTime = BMK_GetMilliSpan(milliTime);
-
-            if ((double)milliTime < fastestD*nbLoops) fastestD = (double)milliTime / nbLoops;
-            DISPLAY("%2i-%-17.17s :%10i ->%10i (%5.3f),%6.1f MB/s ,%6.1f MB/s\r", loopNb, fileName, (int)srcSize, (int)cSize, ratio, (double)srcSize / fastestC / 1000., (double)srcSize / fastestD / 1000.);
+            if ((double)wallTime < fastestD*totalLoops) fastestD = (double)wallTime / totalLoops;
+            if (nbThreads==1) fastestD = threads[0].fastestD;
+            DISPLAY("%2i-%-17.17s :%10i ->%10i (%5.3f),%6.1f MB/s ,%6.1f MB/s\r", loopNb, fileName, (int)srcSize, (int)cSize, ratio, BMK_speed(srcSize, fastestC), BMK_speed(srcSize, fastestD));
 
             /* CRC Checking */
-            crcCheck = XXH64(resultBuffer, srcSize, 0);
-            if (crcOrig!=crcCheck)
+            for (t=0; t<nbThreads; t++)
             {
-                unsigned u;
-                unsigned eBlockSize = (unsigned)(MIN(65536*2, blockSize));
-                DISPLAY("\n!!! WARNING !!! %14s : Invalid Checksum : %x != %x\n", fileName, (unsigned)crcOrig, (unsigned)crcCheck);
-                for (u=0; u<srcSize; u++)
+                const U64 crcCheck = XXH64(threads[t].resultBuffer, srcSize, 0);
+                if (crcOrig!=crcCheck)
                 {
-                    if (((BYTE*)srcBuffer)[u] != ((BYTE*)resultBuffer)[u])
+                    unsigned u;
+                    unsigned eBlockSize = (unsigned)(MIN(65536*2, blockSize));
+                    DISPLAY("\n!!! WARNING !!! %14s : Invalid Checksum : %x != %x\n", fileName, (unsigned)crcOrig, (unsigned)crcCheck);
+                    for (u=0; u<srcSize; u++)
                     {
-                        printf("Decoding error at pos %u (block %u, pos %u) \n", u, u / eBlockSize, u % eBlockSize);
-                        break;
+                        if (((BYTE*)srcBuffer)[u] != ((BYTE*)threads[t].resultBuffer)[u])
+                        {
+                            printf("Decoding error at pos %u (block %u, pos %u) \n", u, u / eBlockSize, u % eBlockSize);
+                            break;
+                        }
                     }
+                    crcError = 1;
+                    break;
                 }
-                break;
             }
-#endif
+            if (crcError) break;
         }
 
-        if (crcOrig == crcCheck)
-            DISPLAY("%2i-%-17.17s :%10i ->%10i (%5.3f),%6.1f MB/s ,%6.1f MB/s \n", cLevel, fileName, (int)srcSize, (int)cSize, ratio, (double)srcSize / fastestC / 1000., (double)srcSize / fastestD / 1000.);
+        if (!crcError)
+        {
+            BMK_result_t result;
+            result.fileName = fullName;
+            result.cLevel = cLevel;
+            result.nbThreads = nbThreads;
+            result.srcSize = srcSize;
+            result.cSize = cSize;
+            result.blockSize = blockSize;
+            result.nbBlocks = nbBlocks;
+            result.cSpeed = BMK_speed(srcSize, fastestC);
+            result.dSpeed = BMK_speed(srcSize, fastestD);
+            result.threads = threads;
+
+            /* Latency, per block */
+            DISPLAY("%2i-%-17.17s : measuring block latency \r", cLevel, fileName);
+            BMK_runThreads(pool, &sync, threads, nbThreads, BMK_compressionLatency);
+            result.cLatency = BMK_getLatency(samples, threads, nbThreads);
+            BMK_runThreads(pool, &sync, threads, nbThreads, BMK_decompressionLatency);
+            result.dLatency = BMK_getLatency(samples, threads, nbThreads);
+
+            DISPLAY("%2i-%-17.17s :%10i ->%10i (%5.3f),%6.1f MB/s ,%6.1f MB/s \n", cLevel, fileName, (int)srcSize, (int)cSize, ratio, result.cSpeed, result.dSpeed);
+            if (nbThreads > 1)
+            {
+                DISPLAY("    per thread :");
+                for (t=0; t<nbThreads; t++)
+                    DISPLAY(" %.1f/%.1f", BMK_speed(srcSize, threads[t].fastestC), BMK_speed(srcSize, threads[t].fastestD));
+                DISPLAY(" MB/s \n");
+            }
+            DISPLAY("    block latency (us) : comp p50 %.1f, p90 %.1f, p99 %.1f, max %.1f ; dec p50 %.1f, p90 %.1f, p99 %.1f, max %.1f \n",
+                    result.cLatency.p50, result.cLatency.p90, result.cLatency.p99, result.cLatency.max,
+                    result.dLatency.p50, result.dLatency.p90, result.dLatency.p99, result.dLatency.max);
+            if (g_outputFormat != BMK_format_human) BMK_printResult(&result);
+        }
     }
 
     /* End cleaning */
-    free(compressedBuffer);
-    free(resultBuffer);
+    POOL_free(pool);
+    pthread_mutex_destroy(&sync.mutex);
+    pthread_cond_destroy(&sync.cond);
+    BMK_freeThreads(threads, nbThreads);
+    free(samples);
     return 0;
 }
 
@@ -413,7 +771,7 @@ static size_t BMK_findMaxMem(U64 requiredMem)
     return (size_t)(requiredMem - step);
 }
 
-static int BMK_benchOneFile(char* inFileName, int cLevel)
+static int BMK_benchOneFile(char* inFileName, int cLevel, int cLevelLast)
 {
     FILE*  inFile;
     U64    inFileSize;
@@ -429,9 +787,9 @@ static int BMK_benchOneFile(char* inFileName, int cLevel)
         return 11;
     }
 
-    /* Memory allocation & restrictions */
+    /* Memory allocation & restrictions : source, plus compressed and result buffers for each thread */
     inFileSize = BMK_GetFileSize(inFileName);
-    benchedSize = BMK_findMaxMem(inFileSize * 3) / 3;
+    benchedSize = BMK_findMaxMem(inFileSize * (1 + 2*g_nbThreads)) / (1 + 2*g_nbThreads);
     if ((U64)benchedSize > inFileSize) benchedSize = (size_t)inFileSize;
     if (benchedSize < inFileSize)
         DISPLAY("Not enough memory for '%s' full size; testing %i MB only...\n", inFileName, (int)(benchedSize >> 20));
@@ -456,14 +814,11 @@ static int BMK_benchOneFile(char* inFileName, int cLevel)
     }
 
     /* Bench */
-    if (cLevel<0)
     {
         int l;
-        for (l=1; l <= -cLevel; l++)
+        for (l=cLevel; l <= cLevelLast; l++)
             result = BMK_benchMem(srcBuffer, benchedSize, inFileName, l);
     }
-    else
-        result = BMK_benchMem(srcBuffer, benchedSize, inFileName, cLevel);
 
     /* clean up */
     free(srcBuffer);
@@ -472,7 +827,7 @@ static int BMK_benchOneFile(char* inFileName, int cLevel)
 }
 
 
-static int BMK_syntheticTest(int cLevel, double compressibility)
+static int BMK_syntheticTest(int cLevel, int cLevelLast, double compressibility)
 {
     size_t benchedSize = 10000000;
     void* srcBuffer = malloc(benchedSize);
@@ -497,14 +852,11 @@ static int BMK_syntheticTest(int cLevel, double compressibility)
     snprintf (name, 20, "Synthetic %2u%%", (unsigned)(compressibility*100));
 #endif
     /* Bench */
-    if (cLevel<0)
     {
         int l;
-        for (l=1; l <= -cLevel; l++)
+        for (l=cLevel; l <= cLevelLast; l++)
             result = BMK_benchMem(srcBuffer, benchedSize, name, l);
     }
-    else
-        result = BMK_benchMem(srcBuffer, benchedSize, name, cLevel);
 
     /* End */
     free(srcBuffer);
@@ -513,13 +865,13 @@ static int BMK_syntheticTest(int cLevel, double compressibility)
 }
 
 
-int BMK_benchFiles(char** fileNamesTable, unsigned nbFiles, unsigned cLevel)
+int BMK_benchFiles(char** fileNamesTable, unsigned nbFiles, int cLevel, int cLevelLast)
 {
     double compressibility = (double)g_compressibilityDefault / 100;
 
     if (nbFiles == 0)
     {
-        BMK_syntheticTest(cLevel, compressibility);
+        BMK_syntheticTest(cLevel, cLevelLast, compressibility);
     }
     else
     {
@@ -527,7 +879,7 @@ int BMK_benchFiles(char** fileNamesTable, unsigned nbFiles, unsigned cLevel)
         unsigned fileIdx = 0;
         while (fileIdx<nbFiles)
         {
-            BMK_benchOneFile(fileNamesTable[fileIdx], cLevel);
+            BMK_benchOneFile(fileNamesTable[fileIdx], cLevel, cLevelLast);
             fileIdx++;
         }
     }
@@ -26,10 +26,17 @@
 
 
 /* Main function */
-int BMK_benchFiles(char** fileNamesTable, unsigned nbFiles, unsigned cLevel);
+int BMK_benchFiles(char** fileNamesTable, unsigned nbFiles, int cLevel, int cLevelLast);
+/* benchmarks all compression levels from cLevel to cLevelLast, using synthetic data when nbFiles==0 */
 
 /* Set Parameters */
 void BMK_SetNbIterations(int nbLoops);
 void BMK_SetBlockSize(size_t blockSize);
+void BMK_SetNbThreads(unsigned nbThreads);
+/* runs nbThreads concurrent benchmarks, each one with its own contexts; limited to 1 without ZSTD_MULTITHREAD */
+
+typedef enum { BMK_format_human, BMK_format_csv, BMK_format_json } BMK_outputFormat_e;
+void BMK_SetOutputFormat(BMK_outputFormat_e format);
+/* csv and json also write one record per file and level to stdout (json : one object per line) */
 
 
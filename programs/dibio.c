@@ -0,0 +1,281 @@
+/*
+  dibio.c - dictionary trainer, file i/o
+  Copyright (C) Yann Collet 2015
+
+  GPL v2 License
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along
+  with this program; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+  You can contact the author at :
+  - ZSTD source repository : https://github.com/Cyan4973/zstd
+  - Public forum : https://groups.google.com/forum/#!forum/lz4c
+*/
+
+/* *************************************
+*  Compiler Options
+***************************************/
+/* Disable some Visual warning messages */
+#ifdef _MSC_VER
+#  define _CRT_SECURE_NO_WARNINGS
+#  define _CRT_SECURE_NO_DEPRECATE     /* VS2005 */
+#endif
+
+
+/* *************************************
+*  Includes
+***************************************/
+#include <stdio.h>      /* fprintf, fopen, fread, fwrite */
+#include <stdlib.h>     /* malloc, free */
+#include <string.h>     /* memcpy */
+#include <time.h>       /* clock */
+#include <sys/types.h>  /* stat */
+#include <sys/stat.h>   /* stat */
+#include "mem.h"
+#include "dibio.h"
+#include "pool.h"
+#include "zstd_static.h"   /* ZSTD_isError */
+
+#if !defined(S_ISREG)
+#  define S_ISREG(x) (((x) & S_IFMT) == S_IFREG)
+#endif
+
+
+/* *************************************
+*  Constants
+***************************************/
+#define KB *(1U<<10)
+#define MB *(1U<<20)
+#define GB *(1U<<30)
+
+#define DiB_SAMPLESIZE_MAX (128 KB)   /* dictionaries matter for the beginning of inputs only */
+#define DiB_MEMORY_MAX (MEM_32bits() ? 512 MB : 2 GB)
+
+#define MIN(a,b) ((a)<(b) ? (a) : (b))
+
+
+/* *************************************
+*  Macros
+***************************************/
+#define DISPLAY(...)         fprintf(stderr, __VA_ARGS__)
+#define DISPLAYLEVEL(l, ...) if (g_displayLevel>=l) { DISPLAY(__VA_ARGS__); }
+static U32 g_displayLevel = 2;   /* 0 : no display;   1: errors;   2 : + result + interaction + warnings;   3 : + progression;   4 : + information */
+
+#define DISPLAYUPDATE(l, ...) if (g_displayLevel>=l) { \
+            if (((clock() - g_time) > refreshRate) || (g_displayLevel>=4)) \
+            { g_time = clock(); DISPLAY(__VA_ARGS__); \
+            if (g_displayLevel>=4) fflush(stderr); } }
+static const clock_t refreshRate = CLOCKS_PER_SEC * 15 / 100;
+static clock_t g_time = 0;
+
+
+/* *************************************
+*  Local Parameters
+***************************************/
+static U32 g_nbThreads = 1;
+
+void DiB_setNotificationLevel(unsigned level) { g_displayLevel=level; }
+void DiB_setNbThreads(unsigned nbThreads)
+{
+    if (nbThreads < 1) nbThreads = 1;
+    if (nbThreads > POOL_maxThreads()) nbThreads = POOL_maxThreads();
+    g_nbThreads = nbThreads;
+}
+
+
+/* *************************************
+*  Exceptions
+***************************************/
+#ifndef DEBUG
+#  define DEBUG 0
+#endif
+#define DEBUGOUTPUT(...) if (DEBUG) DISPLAY(__VA_ARGS__);
+#define EXM_THROW(error, ...)                                             \
+{                                                                         \
+    DEBUGOUTPUT("Error defined at %s, line %i : \n", __FILE__, __LINE__); \
+    DISPLAYLEVEL(1, "Error %i : ", error);                                \
+    DISPLAYLEVEL(1, __VA_ARGS__);                                         \
+    DISPLAYLEVEL(1, "\n");                                                \
+    exit(error);                                                          \
+}
+
+
+/* *************************************
+*  Sample loading
+***************************************/
+static U64 DiB_getFileSize(const char* infilename)
+{
+    int r;
+#if defined(_MSC_VER)
+    struct _stat64 statbuf;
+    r = _stat64(infilename, &statbuf);
+#else
+    struct stat statbuf;
+    r = stat(infilename, &statbuf);
+#endif
+    if (r || !S_ISREG(statbuf.st_mode)) return 0;
+    return (U64)statbuf.st_size;
+}
+
+/* @return : nb of samples loaded into buffer; buffer is allocated, sizes are written into samplesSizes[] */
+static unsigned DiB_loadFiles(BYTE** bufferPtr, size_t* samplesSizes, const char** fileNamesTable, unsigned nbFiles)
+{
+    size_t totalSize = 0, pos = 0;
+    unsigned n, nbSamples = 0;
+    BYTE* buffer;
+
+    for (n=0; n<nbFiles; n++)
+    {
+        const size_t fileSize = (size_t)MIN(DiB_getFileSize(fileNamesTable[n]), DiB_SAMPLESIZE_MAX);
+        if (totalSize + fileSize > DiB_MEMORY_MAX)
+        {
+            DISPLAYLEVEL(2, "Warning : memory limit reached, only %u samples loaded \n", n);
+            nbFiles = n;
+            break;
+        }
+        totalSize += fileSize;
+    }
+    buffer = (BYTE*)malloc(totalSize + 1);
+    if (buffer == NULL) EXM_THROW(31, "not enough memory to load %u MB of samples", (U32)(totalSize >> 20));
+
+    for (n=0; n<nbFiles; n++)
+    {
+        const size_t fileSize = (size_t)MIN(DiB_getFileSize(fileNamesTable[n]), DiB_SAMPLESIZE_MAX);
+        FILE* f;
+        size_t readSize;
+        if ((fileSize == 0) || (pos + fileSize > totalSize)) continue;   /* not a regular file, or modified since */
+        f = fopen(fileNamesTable[n], "rb");
+        if (f == NULL) { DISPLAYLEVEL(2, "Warning : cannot open %s \n", fileNamesTable[n]); continue; }
+        readSize = fread(buffer + pos, 1, fileSize, f);
+        fclose(f);
+        pos += readSize;
+        samplesSizes[nbSamples++] = readSize;
+        DISPLAYUPDATE(3, "\rLoading samples : %u / %u ", n+1, nbFiles);
+    }
+    DISPLAYLEVEL(3, "\r%u samples loaded (%u KB)              \n", nbSamples, (U32)(pos >> 10));
+
+    *bufferPtr = buffer;
+    return nbSamples;
+}
+
+
+/* *************************************
+*  Parallel candidates
+***************************************/
+typedef struct
+{
+    const BYTE* samples;
+    const size_t* samplesSizes;
+    unsigned nbSamples;
+    DiB_params params;
+    BYTE* dict;
+    size_t dictCapacity;
+    size_t dictSize;   /* result, or error code */
+    size_t cSize;      /* evaluation result, or error code */
+} DiB_job_t;
+
+static void DiB_trainJob(void* opaque)
+{
+    DiB_job_t* const job = (DiB_job_t*)opaque;
+    job->dictSize = DiB_trainFromBuffer(job->dict, job->dictCapacity, job->samples, job->samplesSizes, job->nbSamples, job->params);
+    job->cSize = job->dictSize;
+    if (!ZSTD_isError(job->dictSize))
+        job->cSize = DiB_evaluateDictionary(job->dict, job->dictSize, job->samples, job->samplesSizes, job->nbSamples, job->params.compressionLevel);
+}
+
+/* builds one candidate per segment size, in parallel, and keeps the best one */
+static size_t DiB_trainParallel(BYTE* dictBuffer, size_t dictCapacity,
+                          const BYTE* samples, const size_t* samplesSizes, unsigned nbSamples,
+                                DiB_params params)
+{
+    DiB_job_t jobs[DiB_NB_SEGMENTSIZES];
+    POOL_ctx* pool;
+    size_t result = ERROR(GENERIC);
+    size_t bestCSize = (size_t)-1;
+    unsigned n;
+
+    pool = POOL_create(MIN(g_nbThreads, DiB_NB_SEGMENTSIZES), DiB_NB_SEGMENTSIZES);
+    if (pool == NULL) EXM_THROW(32, "cannot create thread pool");
+    for (n=0; n<DiB_NB_SEGMENTSIZES; n++)
+    {
+        jobs[n].samples = samples;
+        jobs[n].samplesSizes = samplesSizes;
+        jobs[n].nbSamples = nbSamples;
+        jobs[n].params = params;
+        jobs[n].params.segmentSize = DiB_segmentSizes[n];
+        jobs[n].dictCapacity = dictCapacity;
+        jobs[n].dict = (BYTE*)malloc(dictCapacity);
+        if (jobs[n].dict == NULL) EXM_THROW(33, "not enough memory for candidate dictionaries");
+        POOL_add(pool, DiB_trainJob, jobs+n);
+    }
+    POOL_free(pool);   /* waits for all jobs */
+
+    for (n=0; n<DiB_NB_SEGMENTSIZES; n++)
+    {
+        if (ZSTD_isError(jobs[n].cSize)) { if (!ZSTD_isError(result)) result = jobs[n].cSize; continue; }
+        DISPLAYLEVEL(4, "segment size %4u : dictionary %6u bytes, samples compressed to %u bytes \n",
+                        DiB_segmentSizes[n], (U32)jobs[n].dictSize, (U32)jobs[n].cSize);
+        if (jobs[n].cSize < bestCSize)
+        {
+            bestCSize = jobs[n].cSize;
+            memcpy(dictBuffer, jobs[n].dict, jobs[n].dictSize);
+            result = jobs[n].dictSize;
+        }
+    }
+    for (n=0; n<DiB_NB_SEGMENTSIZES; n++) free(jobs[n].dict);
+    return result;
+}
+
+
+/* *************************************
+*  Functions
+***************************************/
+int DiB_trainFromFiles(const char* dictFileName, unsigned maxDictSize,
+                       const char** fileNamesTable, unsigned nbFiles,
+                       DiB_params params)
+{
+    BYTE* samples = NULL;
+    size_t* const samplesSizes = (size_t*)malloc((nbFiles+1) * sizeof(size_t));
+    BYTE* const dictBuffer = (BYTE*)malloc(maxDictSize);
+    unsigned nbSamples;
+    size_t dictSize;
+
+    /* load samples */
+    if (!samplesSizes || !dictBuffer) EXM_THROW(30, "not enough memory");
+    nbSamples = DiB_loadFiles(&samples, samplesSizes, fileNamesTable, nbFiles);
+
+    /* train */
+    DISPLAYLEVEL(3, "Training dictionary (%u threads) ... \n", g_nbThreads);
+    if ((params.segmentSize == 0) && (g_nbThreads > 1) && (nbSamples >= 2))
+        dictSize = DiB_trainParallel(dictBuffer, maxDictSize, samples, samplesSizes, nbSamples, params);
+    else
+        dictSize = DiB_trainFromBuffer(dictBuffer, maxDictSize, samples, samplesSizes, nbSamples, params);
+    if (ZSTD_isError(dictSize)) EXM_THROW(34, "dictionary training failed : %s", ZSTD_getErrorName(dictSize));
+
+    /* save */
+    {
+        FILE* const f = fopen(dictFileName, "wb");
+        size_t writeSize;
+        if (f == NULL) EXM_THROW(35, "cannot open %s", dictFileName);
+        writeSize = fwrite(dictBuffer, 1, dictSize, f);
+        if (writeSize != dictSize) EXM_THROW(36, "write error to %s", dictFileName);
+        if (fclose(f)) EXM_THROW(37, "cannot close %s", dictFileName);
+    }
+    DISPLAYLEVEL(2, "Saved dictionary of %u bytes into %s (from %u samples) \n", (U32)dictSize, dictFileName, nbSamples);
+
+    free(samples);
+    free(samplesSizes);
+    free(dictBuffer);
+    return 0;
+}
@@ -1,6 +1,6 @@
 /*
-  fileio.h - file i/o handler
-  Copyright (C) Yann Collet 2013-2015
+  dibio.h - dictionary trainer, file i/o
+  Copyright (C) Yann Collet 2015
 
   GPL v2 License
 
@@ -29,16 +29,31 @@ extern "C" {
 #endif
 
 
+/* *************************************
+*  Includes
+***************************************/
+#include "dictBuilder.h"   /* DiB_params */
+
+
 /* *************************************
 *  Parameters
 ***************************************/
-void FIO_legacy_setNotificationLevel(unsigned level);
+void DiB_setNotificationLevel(unsigned level);
+void DiB_setNbThreads(unsigned nbThreads);   /* candidate dictionaries are built in parallel */
 
 
 /* *************************************
-*  Stream/File functions
+*  Functions
 ***************************************/
-unsigned long long FIO_decompressLegacyFrame(FILE* foutput, FILE* finput, U32 magicNumberLE);
+int DiB_trainFromFiles(const char* dictFileName, unsigned maxDictSize,
+                       const char** fileNamesTable, unsigned nbFiles,
+                       DiB_params params);
+/**
+DiB_trainFromFiles() :
+    Each file is a sample; only its first 128 KB are used.
+    Writes a dictionary of at most maxDictSize bytes into dictFileName.
+    @result : 0 on success (errors are fatal)
+*/
 
 
 #if defined (__cplusplus)
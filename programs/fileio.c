@@ -52,7 +52,9 @@
 #define GCC_VERSION (__GNUC__ * 100 + __GNUC_MINOR__)
 
 #define _FILE_OFFSET_BITS 64   /* Large file support on 32-bits unix */
+#define _LARGEFILE_SOURCE 1    /* enable fseeko() */
 #define _POSIX_SOURCE 1        /* enable fileno() within <stdio.h> on unix */
+#define _POSIX_C_SOURCE 200112L   /* posix_madvise(), ftruncate() */
 
 
 /* *************************************
@@ -67,12 +69,15 @@
 #include <sys/stat.h>   /* stat64 */
 #include "mem.h"
 #include "fileio.h"
+#include "pool.h"
+#include "threading.h"
 #include "zstd_static.h"
 #include "zstdhc_static.h"
+#include "zstd_buffered.h"
+#include "xxhash.h"      /* XXH64, content checksum of segmented frames */
 
 #if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
-#  include "zstd_legacy.h"  /* legacy */
-#  include "fileio_legacy.h"  /* legacy */
+#  include "zstd_legacy.h"  /* ZSTD_isLegacy */
 #endif
 
 
@@ -93,10 +98,36 @@
 #  define IS_CONSOLE(stdStream) isatty(fileno(stdStream))
 #endif
 
+#if defined(_MSC_VER) && (_MSC_VER >= 1400)
+#  define LONG_SEEK _fseeki64
+#elif defined(__MINGW32__)
+#  define LONG_SEEK fseeko64
+#else
+#  define LONG_SEEK fseeko
+#endif
+
 #if !defined(S_ISREG)
 #  define S_ISREG(x) (((x) & S_IFMT) == S_IFREG)
 #endif
 
+#if !defined(FIO_MMAP)
+#  if defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+#    define FIO_MMAP 1
+#  else
+#    define FIO_MMAP 0
+#  endif
+#endif
+#if FIO_MMAP
+#  include <sys/mman.h>   /* mmap, munmap, posix_madvise */
+#endif
+
+/* Monotonic wall clock, for --adapt */
+#if defined(_WIN32)
+#  include <windows.h>           /* QueryPerformanceCounter */
+#elif defined(__APPLE__)
+#  include <mach/mach_time.h>    /* mach_absolute_time */
+#endif
+
 
 /* *************************************
 *  Constants
@@ -123,6 +154,8 @@ static const unsigned FIO_blockHeaderSize = 3;
 
 #define CACHELINE 64
 
+#define MIN(a,b) ((a)<(b) ? (a) : (b))
+
 
 /* *************************************
 *  Macros
@@ -143,9 +176,28 @@ static clock_t g_time = 0;
 *  Local Parameters
 ***************************************/
 static U32 g_overwrite = 0;
+static U32 g_nbThreads = 1;
+static U32 g_seekable = 0;
+static U32 g_checksum = 0;
+static U32 g_contentSize = 0;
+static U32 g_adapt = 0;
 
 void FIO_overwriteMode(void) { g_overwrite=1; }
 void FIO_setNotificationLevel(unsigned level) { g_displayLevel=level; }
+void FIO_setSeekable(unsigned seekable) { g_seekable = (seekable>0); }
+void FIO_setChecksum(unsigned checksum) { g_checksum = (checksum>0); }
+void FIO_setContentSize(unsigned contentSize) { g_contentSize = (contentSize>0); }
+void FIO_setAdapt(unsigned adapt) { g_adapt = (adapt>0); }
+void FIO_setNbThreads(unsigned nbThreads)
+{
+    if (nbThreads < 1) nbThreads = 1;
+    if (nbThreads > POOL_maxThreads())
+    {
+        DISPLAYLEVEL(2, "Note : %u threads requested, %u supported \n", nbThreads, POOL_maxThreads());
+        nbThreads = POOL_maxThreads();
+    }
+    g_nbThreads = nbThreads;
+}
 
 
 /* *************************************
@@ -175,6 +227,95 @@ static unsigned FIO_GetMilliSpan(clock_t nPrevious)
     return nSpan;
 }
 
+/* FIO_getNanoTime() :
+*  monotonic wall clock, in nanoseconds (clock() counts cpu time, not time blocked in fwrite()) */
+#if defined(_WIN32)
+
+static U64 FIO_getNanoTime(void)
+{
+    static LARGE_INTEGER ticksPerSecond = { { 0, 0 } };
+    LARGE_INTEGER now;
+    if (!ticksPerSecond.QuadPart) QueryPerformanceFrequency(&ticksPerSecond);
+    QueryPerformanceCounter(&now);
+    return (U64)(now.QuadPart / ticksPerSecond.QuadPart) * 1000000000ULL
+         + (U64)(now.QuadPart % ticksPerSecond.QuadPart) * 1000000000ULL / (U64)ticksPerSecond.QuadPart;
+}
+
+#elif defined(__APPLE__)
+
+static U64 FIO_getNanoTime(void)
+{
+    static mach_timebase_info_data_t rate = { 0, 0 };
+    if (!rate.denom) mach_timebase_info(&rate);
+    return mach_absolute_time() * rate.numer / rate.denom;
+}
+
+#else
+
+static U64 FIO_getNanoTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (U64)ts.tv_sec * 1000000000ULL + (U64)ts.tv_nsec;
+}
+
+#endif
+
+
+/* *************************************
+*  Custom compression levels
+***************************************/
+static ZSTD_HC_levelTable g_levelTable;
+
+static const char* g_strategyNames[] = { "ZSTD_HC_fast", "ZSTD_HC_greedy", "ZSTD_HC_lazy",
+                                         "ZSTD_HC_lazy2", "ZSTD_HC_btlazy2", "ZSTD_HC_btopt" };
+#define FIO_NB_STRATEGIES (sizeof(g_strategyNames) / sizeof(*g_strategyNames))
+
+/* FIO_loadLevelTable() :
+*  reads rows in ZSTD_HC_defaultParameters format, as written by paramgrill (or zstdhc_static.h itself) :
+*  a line containing "for <= 128 KB" or "for > 128 KB" selects a size class,
+*  following lines "{ W, C, H, S, L, strategy }" set its levels 0, 1, 2, ...
+*  Levels not listed keep their default parameters. */
+void FIO_loadLevelTable(const char* tableFileName)
+{
+    FILE* const f = fopen(tableFileName, "r");
+    char line[256];
+    int tableID = -1;
+    U32 cLevel = 0;
+    U32 nbRows = 0;
+
+    if (f==NULL) EXM_THROW(14, "Pb opening level table %s", tableFileName);
+    memcpy(g_levelTable, ZSTD_HC_defaultParameters, sizeof(g_levelTable));
+
+    while (fgets(line, sizeof(line), f))
+    {
+        unsigned w, c, h, s, l;
+        char strategy[32];
+        U32 u;
+        if (strstr(line, "for <= 128 KB")) { tableID = 0; cLevel = 0; continue; }
+        if (strstr(line, "for > 128 KB")) { tableID = 1; cLevel = 0; continue; }
+        if (sscanf(line, " { %u , %u , %u , %u , %u , %31[A-Za-z0-9_]", &w, &c, &h, &s, &l, strategy) != 6) continue;
+        if (tableID < 0) EXM_THROW(15, "%s : level row before size class (\"for <= 128 KB\" or \"for > 128 KB\")", tableFileName);
+        if (cLevel > ZSTD_HC_MAX_CLEVEL) EXM_THROW(15, "%s : more than %u levels in a size class", tableFileName, ZSTD_HC_MAX_CLEVEL);
+        for (u=0; u<FIO_NB_STRATEGIES; u++)
+            if (!strcmp(strategy, g_strategyNames[u])) break;
+        if (u==FIO_NB_STRATEGIES) EXM_THROW(15, "%s : unknown strategy %s", tableFileName, strategy);
+        g_levelTable[tableID][cLevel].windowLog = w;
+        g_levelTable[tableID][cLevel].contentLog = c;
+        g_levelTable[tableID][cLevel].hashLog = h;
+        g_levelTable[tableID][cLevel].searchLog = s;
+        g_levelTable[tableID][cLevel].searchLength = l;
+        g_levelTable[tableID][cLevel].strategy = (ZSTD_HC_strategy)u;
+        cLevel++;
+        nbRows++;
+    }
+    fclose(f);
+    if (!nbRows) EXM_THROW(15, "%s : no level row found", tableFileName);
+
+    ZSTD_HC_setGlobalLevelTable(&g_levelTable);
+    DISPLAYLEVEL(4, "Loaded %u levels from %s \n", nbRows, tableFileName);
+}
+
 
 static void FIO_getFileHandles(FILE** pfinput, FILE** pfoutput, const char* input_filename, const char* output_filename)
 {
@@ -237,6 +378,174 @@ static U64 FIO_getFileSize(const char* infilename)
 }
 
 
+/* *************************************
+*  Memory-mapped files
+***************************************/
+/* Regular files are mapped when possible, so that (de)compression reads them in place.
+*  Pipes, stdin, and platforms without mmap() use stdio instead. */
+typedef struct
+{
+    BYTE*  start;   /* NULL when not mapped */
+    size_t size;
+} FIO_map_t;
+
+/* FIO_mapInput() :
+*  map finput for reading, hinting the kernel that it will be read sequentially.
+*  @result : 1 on success, 0 if finput must be read using stdio (not a regular file, empty, or too large for address space) */
+static int FIO_mapInput(FIO_map_t* map, FILE* finput, U64 fileSize)
+{
+    map->start = NULL;
+    map->size = 0;
+#if FIO_MMAP
+    if ((fileSize==0) || ((U64)(size_t)fileSize != fileSize)) return 0;
+    {
+        void* const p = mmap(NULL, (size_t)fileSize, PROT_READ, MAP_PRIVATE, fileno(finput), 0);
+        if (p==MAP_FAILED) return 0;
+        posix_madvise(p, (size_t)fileSize, POSIX_MADV_SEQUENTIAL);
+        map->start = (BYTE*)p;
+        map->size = (size_t)fileSize;
+    }
+    return 1;
+#else
+    (void)finput; (void)fileSize;
+    return 0;
+#endif
+}
+
+/* FIO_mapOutput() :
+*  preallocate foutput to fileSize, and map it for writing.
+*  @result : 1 on success, 0 if foutput must be written using stdio (not a regular file, or cannot be mapped) */
+static int FIO_mapOutput(FIO_map_t* map, FILE* foutput, U64 fileSize)
+{
+    map->start = NULL;
+    map->size = 0;
+#if FIO_MMAP
+    if ((fileSize==0) || ((U64)(size_t)fileSize != fileSize)) return 0;
+    {
+        int const fd = fileno(foutput);
+        struct stat statbuf;
+        void* p;
+        if (fstat(fd, &statbuf) || !S_ISREG(statbuf.st_mode)) return 0;
+        if (ftruncate(fd, (off_t)fileSize)) return 0;
+        p = mmap(NULL, (size_t)fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p==MAP_FAILED) { int const unused = ftruncate(fd, 0); (void)unused; return 0; }
+        posix_madvise(p, (size_t)fileSize, POSIX_MADV_SEQUENTIAL);
+        map->start = (BYTE*)p;
+        map->size = (size_t)fileSize;
+    }
+    return 1;
+#else
+    (void)foutput; (void)fileSize;
+    return 0;
+#endif
+}
+
+/* FIO_prefetch() : ask the kernel to start reading map[pos, pos+size) now. pos must be page-aligned. */
+static void FIO_prefetch(const FIO_map_t* map, size_t pos, size_t size)
+{
+#if FIO_MMAP
+    if (pos >= map->size) return;
+    if (size > map->size - pos) size = map->size - pos;
+    posix_madvise(map->start + pos, size, POSIX_MADV_WILLNEED);
+#else
+    (void)map; (void)pos; (void)size;
+#endif
+}
+
+static void FIO_unmap(FIO_map_t* map)
+{
+#if FIO_MMAP
+    if (map->start) munmap(map->start, map->size);
+#endif
+    map->start = NULL;
+    map->size = 0;
+}
+
+
+/* *************************************
+*  Asynchronous I/O
+***************************************/
+/* Reads and writes are handed over to a dedicated worker, so they overlap with (de)compression.
+*  Each FIO_aio_t has a single worker : its requests complete in submission order.
+*  Without ZSTD_MULTITHREAD, requests are executed immediately by FIO_aio_submit(). */
+typedef struct
+{
+    POOL_ctx* pool;
+    FILE* file;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;   /* signaled whenever a request completes */
+} FIO_aio_t;
+
+typedef struct
+{
+    FIO_aio_t* aio;
+    BYTE*  buffer;
+    size_t size;     /* requested */
+    size_t result;   /* transferred */
+    U32    pending;
+} FIO_aioJob_t;
+
+static void FIO_aio_init(FIO_aio_t* aio, FILE* file)
+{
+    aio->file = file;
+    aio->pool = POOL_create(1, 2);
+    if (aio->pool==NULL) EXM_THROW(21, "Allocation error : not enough memory");
+    pthread_mutex_init(&aio->mutex, NULL);
+    pthread_cond_init(&aio->cond, NULL);
+}
+
+/* FIO_aio_free() : waits for all pending requests */
+static void FIO_aio_free(FIO_aio_t* aio)
+{
+    POOL_free(aio->pool);
+    pthread_mutex_destroy(&aio->mutex);
+    pthread_cond_destroy(&aio->cond);
+}
+
+static void FIO_aio_complete(FIO_aioJob_t* job, size_t result)
+{
+    pthread_mutex_lock(&job->aio->mutex);
+    job->result = result;
+    job->pending = 0;
+    pthread_cond_broadcast(&job->aio->cond);
+    pthread_mutex_unlock(&job->aio->mutex);
+}
+
+static void FIO_aio_readJob(void* opaque)
+{
+    FIO_aioJob_t* const job = (FIO_aioJob_t*)opaque;
+    FIO_aio_complete(job, fread(job->buffer, 1, job->size, job->aio->file));
+}
+
+static void FIO_aio_writeJob(void* opaque)
+{
+    FIO_aioJob_t* const job = (FIO_aioJob_t*)opaque;
+    FIO_aio_complete(job, fwrite(job->buffer, 1, job->size, job->aio->file));
+}
+
+/* FIO_aio_submit() : job must not be pending */
+static void FIO_aio_submit(FIO_aio_t* aio, FIO_aioJob_t* job, POOL_function ioFunction, void* buffer, size_t size)
+{
+    job->aio = aio;
+    job->buffer = (BYTE*)buffer;
+    job->size = size;
+    job->result = 0;
+    job->pending = 1;
+    POOL_add(aio->pool, ioFunction, job);
+}
+
+/* FIO_aio_wait() :
+*  @result : nb of bytes transferred by job, or 0 if it was never submitted */
+static size_t FIO_aio_wait(FIO_aioJob_t* job)
+{
+    if (job->aio==NULL) return 0;
+    pthread_mutex_lock(&job->aio->mutex);
+    while (job->pending) pthread_cond_wait(&job->aio->cond, &job->aio->mutex);
+    pthread_mutex_unlock(&job->aio->mutex);
+    return job->result;
+}
+
+
 typedef void* (*FIO_createC) (void);
 static void* local_ZSTD_createCCtx(void) { return (void*) ZSTD_createCCtx(); }
 static void* local_ZSTD_HC_createCCtx(void) { return (void*) ZSTD_HC_createCCtx(); }
@@ -244,14 +553,29 @@ static void* local_ZSTD_HC_createCCtx(void) { return (void*) ZSTD_HC_createCCtx(
 typedef size_t (*FIO_initC) (void* ctx, void* dst, size_t maxDstSize, int cLevel, U64 srcSizeHint);
 static size_t local_ZSTD_compressBegin (void* ctx, void* dst, size_t maxDstSize, int cLevel, U64 srcSizeHint)
 {
-    (void)cLevel; (void)srcSizeHint;
-    return ZSTD_compressBegin((ZSTD_CCtx*)ctx, dst, maxDstSize);
+    (void)srcSizeHint;
+    return ZSTD_compressBegin_advanced((ZSTD_CCtx*)ctx, dst, maxDstSize, ZSTD_getParams(cLevel));
 }
 static size_t local_ZSTD_HC_compressBegin (void* ctx, void* dst, size_t maxDstSize, int cLevel, U64 srcSizeHint)
 {
     return ZSTD_HC_compressBegin((ZSTD_HC_CCtx*)ctx, dst, maxDstSize, cLevel, srcSizeHint);
 }
 
+/* FIO_restartC :
+*  resets ctx at the start of a later segment of the same frame, as the engine does itself
+*  when ZBUFF_CCtx ring buffer wraps : firstBlockSize is the size of the segment's first block */
+typedef size_t (*FIO_restartC) (void* ctx, void* dst, size_t maxDstSize, int cLevel, U64 srcSizeHint, size_t firstBlockSize);
+static size_t local_ZSTD_restart (void* ctx, void* dst, size_t maxDstSize, int cLevel, U64 srcSizeHint, size_t firstBlockSize)
+{
+    (void)firstBlockSize;
+    return local_ZSTD_compressBegin(ctx, dst, maxDstSize, cLevel, srcSizeHint);
+}
+static size_t local_ZSTD_HC_restart (void* ctx, void* dst, size_t maxDstSize, int cLevel, U64 srcSizeHint, size_t firstBlockSize)
+{
+    /* frame parameters, tables sized for the first block : see ZSTD_HC_compressContinue() */
+    return ZSTD_HC_compressBegin_advanced((ZSTD_HC_CCtx*)ctx, dst, maxDstSize, ZSTD_HC_getParams(cLevel, srcSizeHint), firstBlockSize);
+}
+
 typedef size_t (*FIO_continueC) (void* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize);
 static size_t local_ZSTD_compressContinue (void* ctx, void* dst, size_t maxDstSize, const void* src, size_t srcSize)
 {
@@ -272,102 +596,627 @@ static size_t local_ZSTD_HC_compressEnd (void* ctx, void* dst, size_t maxDstSize
     return ZSTD_HC_compressEnd((ZSTD_HC_CCtx*)ctx, dst, maxDstSize);
 }
 
+typedef size_t (*FIO_checksumC) (void* ctx, unsigned checksumFlag);
+static size_t local_ZSTD_setContentChecksum(void* ctx, unsigned flag) { return ZSTD_setContentChecksum((ZSTD_CCtx*)ctx, flag); }
+static size_t local_ZSTD_HC_setContentChecksum(void* ctx, unsigned flag) { return ZSTD_HC_setContentChecksum((ZSTD_HC_CCtx*)ctx, flag); }
+
+typedef size_t (*FIO_pledgeC) (void* ctx, U64 pledgedSrcSize);
+static size_t local_ZSTD_setPledgedSrcSize(void* ctx, U64 size) { return ZSTD_setPledgedSrcSize((ZSTD_CCtx*)ctx, size); }
+static size_t local_ZSTD_HC_setPledgedSrcSize(void* ctx, U64 size) { return ZSTD_HC_setPledgedSrcSize((ZSTD_HC_CCtx*)ctx, size); }
+
 typedef void (*FIO_freeC) (void* ctx);
 static void local_ZSTD_freeCCtx(void* ctx) { ZSTD_freeCCtx((ZSTD_CCtx*)ctx); }
 static void local_ZSTD_HC_freeCCtx(void* ctx) { ZSTD_HC_freeCCtx((ZSTD_HC_CCtx*)ctx); }
 
+typedef struct
+{
+    FIO_createC createC;
+    FIO_initC initC;
+    FIO_restartC restartC;
+    FIO_continueC continueC;
+    FIO_endC endC;
+    FIO_checksumC checksumC;
+    FIO_pledgeC pledgeC;
+    FIO_freeC freeC;
+} FIO_compressor_t;
+
+/* FIO_engineID() :
+*  @result : 0 when cLevel uses the fast engine, 1 for the HC engine */
+static int FIO_engineID(int cLevel)
+{
+    return (cLevel > 1) || ((cLevel == 1) && ZSTD_HC_getGlobalLevelTable());   /* custom tables define level 1 too */
+}
 
-unsigned long long FIO_compressFilename(const char* output_filename, const char* input_filename, int cLevel)
+static FIO_compressor_t FIO_selectCompressor(int cLevel)
+{
+    FIO_compressor_t c;
+    if (!FIO_engineID(cLevel))
+    {
+        c.createC = local_ZSTD_createCCtx;
+        c.initC = local_ZSTD_compressBegin;
+        c.restartC = local_ZSTD_restart;
+        c.continueC = local_ZSTD_compressContinue;
+        c.endC = local_ZSTD_compressEnd;
+        c.checksumC = local_ZSTD_setContentChecksum;
+        c.pledgeC = local_ZSTD_setPledgedSrcSize;
+        c.freeC = local_ZSTD_freeCCtx;
+    }
+    else
+    {
+        c.createC = local_ZSTD_HC_createCCtx;
+        c.initC = local_ZSTD_HC_compressBegin;
+        c.restartC = local_ZSTD_HC_restart;
+        c.continueC = local_ZSTD_HC_compressContinue;
+        c.endC = local_ZSTD_HC_compressEnd;
+        c.checksumC = local_ZSTD_HC_setContentChecksum;
+        c.pledgeC = local_ZSTD_HC_setPledgedSrcSize;
+        c.freeC = local_ZSTD_HC_freeCCtx;
+    }
+    return c;
+}
+
+/* Frames made of segments compressed separately (by several contexts, or one context reset at each segment)
+*  can't use the engine's content checksum : fileio hashes segments in order, and writes the checksum itself. */
+
+/* FIO_checksumHeader() :
+*  turns the frame header written by initC into one announcing a content checksum.
+*  A regular header becomes an extended one : header must have room for one more byte. @result : new header size */
+static size_t FIO_checksumHeader(BYTE* header, size_t hSize)
 {
+    if (MEM_readLE32(header) == ZSTD_magicNumberExt)
+    {
+        header[4] |= ZSTD_frameDescriptor_checksum;
+        return hSize;
+    }
+    MEM_writeLE32(header, ZSTD_magicNumberExt);
+    header[hSize] = ZSTD_frameDescriptor_checksum;
+    return hSize+1;
+}
+
+/* FIO_checksumEnd() :
+*  appends content checksum after the end mark written by endC. @result : new end size */
+static size_t FIO_checksumEnd(BYTE* end, size_t eSize, const XXH64_state_t* checksumState)
+{
+    MEM_writeLE64(end+eSize, XXH64_digest(checksumState));
+    return eSize+8;
+}
+
+
+/* *************************************
+*  Multi-threaded compression
+***************************************/
+/* The single-threaded ZBUFF_CCtx compresses through a ring buffer of FIO_WINDOWNBBLOCKS blocks (ZBUFF_WINDOWSIZE).
+*  Each ring wrap is a non-contiguous input, which resets the compression context :
+*  segments of FIO_WINDOWNBBLOCKS blocks are therefore independent, and can be compressed in parallel,
+*  while remaining decodable within the same ring buffer. */
+#define FIO_WINDOWNBBLOCKS 4
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;       /* signaled whenever a job completes */
+    void*  ctxTable[2][POOL_MAX_THREADS];   /* idle compression contexts, per engine */
+    unsigned nbIdleCtx[2];
+    FIO_compressor_t comp[2];   /* fast, HC : with --adapt, segments may use both */
+    U64 srcSizeHint;
+    U32 fullFrames;   /* each segment is a complete frame (seekable mode) */
+    U32 checksumFlag; /* engine checksum, for full frames only */
+    U32 contentSizeFlag;   /* each full frame records its content size */
+} FIO_mtCtx_t;
+
+typedef struct
+{
+    FIO_mtCtx_t* mt;
+    BYTE*  srcBuffer;   /* not allocated when input is mapped */
+    const BYTE* src;
+    size_t srcSize;
+    int    cLevel;
+    BYTE*  dstBuffer;
+    size_t dstCapacity;
+    size_t dstSize;   /* result, or error code */
+    U64    nanoTime;  /* spent within continueC() */
+    U32    done;
+} FIO_job_t;
+
+static void FIO_compressJob(void* opaque)
+{
+    FIO_job_t* const job = (FIO_job_t*)opaque;
+    FIO_mtCtx_t* const mt = job->mt;
+    const int engineID = FIO_engineID(job->cLevel);
+    const FIO_compressor_t* const comp = mt->comp + engineID;
+    void* ctx = NULL;
+    size_t result;
+
+    pthread_mutex_lock(&mt->mutex);
+    if (mt->nbIdleCtx[engineID]) ctx = mt->ctxTable[engineID][--mt->nbIdleCtx[engineID]];
+    pthread_mutex_unlock(&mt->mutex);
+    if (ctx==NULL) ctx = comp->createC();   /* at most one per worker and engine */
+
+    if (ctx==NULL) result = ERROR(memory_allocation);
+    else
+    {
+        /* start a new segment; unless it's a full frame,
+         * frame header is written once by the main thread, so it is overwritten here */
+        size_t pos = 0;
+        comp->checksumC(ctx, mt->checksumFlag);
+        if (mt->contentSizeFlag) comp->pledgeC(ctx, job->srcSize);
+        result = comp->initC(ctx, job->dstBuffer, job->dstCapacity, job->cLevel, mt->srcSizeHint);
+        if ((!ZSTD_isError(result)) && (mt->fullFrames)) pos = result;
+        if (!ZSTD_isError(result))
+        {
+            const U64 nanoStart = FIO_getNanoTime();
+            result = comp->continueC(ctx, job->dstBuffer+pos, job->dstCapacity-pos, job->src, job->srcSize);
+            job->nanoTime = FIO_getNanoTime() - nanoStart;
+        }
+        if ((!ZSTD_isError(result)) && (mt->fullFrames))
+        {
+            pos += result;
+            result = comp->endC(ctx, job->dstBuffer+pos, job->dstCapacity-pos);
+        }
+        if (!ZSTD_isError(result)) result += pos;
+    }
+
+    pthread_mutex_lock(&mt->mutex);
+    if (ctx) mt->ctxTable[engineID][mt->nbIdleCtx[engineID]++] = ctx;
+    job->dstSize = result;
+    job->done = 1;
+    pthread_cond_broadcast(&mt->cond);
+    pthread_mutex_unlock(&mt->mutex);
+}
+
+typedef struct
+{
+    BYTE* table;
+    size_t size;
+    size_t capacity;
+    U32 nbFrames;
+} FIO_seekTable_t;
+
+static void FIO_seekTable_add(FIO_seekTable_t* st, size_t cSize, size_t dSize)
+{
+    if (st->size + ZSTD_seekTableEntrySize > st->capacity)
+    {
+        st->capacity = (st->capacity + ZSTD_seekTableEntrySize) * 2;
+        st->table = (BYTE*)realloc(st->table, st->capacity);
+        if (st->table==NULL) EXM_THROW(21, "Allocation error : not enough memory");
+    }
+    MEM_writeLE32(st->table + st->size, (U32)cSize);
+    MEM_writeLE32(st->table + st->size + 4, (U32)dSize);
+    st->size += ZSTD_seekTableEntrySize;
+    st->nbFrames++;
+}
+
+static size_t FIO_seekTable_write(FILE* foutput, const FIO_seekTable_t* st)
+{
+    BYTE header[ZSTD_skippableHeaderSize];
+    BYTE footer[ZSTD_seekTableFooterSize];
+    const size_t frameContentSize = st->size + ZSTD_seekTableFooterSize;
+    MEM_writeLE32(header, ZSTD_skippableMagicNumber);
+    MEM_writeLE32(header+4, (U32)frameContentSize);
+    MEM_writeLE32(footer, st->nbFrames);
+    MEM_writeLE32(footer+4, ZSTD_seekTableMagicNumber);
+    if (fwrite(header, 1, sizeof(header), foutput) != sizeof(header)) return 0;
+    if (fwrite(st->table, 1, st->size, foutput) != st->size) return 0;
+    if (fwrite(footer, 1, sizeof(footer), foutput) != sizeof(footer)) return 0;
+    return ZSTD_skippableHeaderSize + frameContentSize;
+}
+
+/* FIO_adaptLevel() :
+*  --adapt : compares time to compress last written segment with time blocked writing it.
+*  When compression can't keep up with output, level goes down; when output is the bottleneck, it goes up.
+*  Segments still compressed at a previous level are ignored, so each change is measured before the next one.
+*  Segments are independent : each one may use a different level, and engine, within the same frame.
+*  @result : level of next segments */
+static int FIO_adaptLevel(int cLevel, const FIO_job_t* job, U64 writeTime)
+{
+    const U64 compressTime = job->nanoTime / g_nbThreads;   /* workers compress segments concurrently */
+    const int prevLevel = cLevel;
+    if (job->cLevel != cLevel) return cLevel;
+    if ((compressTime > writeTime) && (cLevel > ZSTD_MIN_CLEVEL)) cLevel--;   /* output starves */
+    else if ((compressTime*4 < writeTime*3) && (cLevel < ZSTD_HC_MAX_CLEVEL)) cLevel++;   /* time to spare for compression */
+    if (cLevel != prevLevel)
+        DISPLAYLEVEL(4, "\rlevel %i -> %i (compression %u us, write %u us) \n", prevLevel, cLevel,
+                     (U32)(compressTime/1000), (U32)(writeTime/1000));
+    return cLevel;
+}
+
+/* FIO_compressSegments() :
+*  compress all of finput by segments, using g_nbThreads workers, and write them in order into foutput.
+*  When map is not NULL, segments are compressed directly from it, and finput is not read.
+*  In seekable mode, each segment is a complete frame, and a seek table is written after the last one.
+*  Otherwise, frame header and end mark are not handled here, and checksumState (if not NULL) is updated with each segment.
+*  @result : compressed size; *srcSizePtr receives the amount of data read */
+static U64 FIO_compressSegments(FILE* foutput, FILE* finput, const FIO_map_t* map, const char* output_filename, U64* srcSizePtr,
+                                size_t blockSize, int cLevel, U64 srcSizeHint,
+                                XXH64_state_t* checksumState)
+{
+    FIO_mtCtx_t mt;
+    FIO_job_t* jobs;
+    POOL_ctx* pool;
+    FIO_seekTable_t seekTable;
+    const size_t segmentSize = FIO_WINDOWNBBLOCKS * blockSize;
+    const unsigned nbJobs = 2 * g_nbThreads;   /* bounds memory : in-flight segments never exceed this */
+    U64 nbJobsStarted = 0, nbJobsWritten = 0;
+    U64 filesize = 0, compressedfilesize = 0;
+    int readEnded = 0;
+    unsigned u, e;
+
+    /* Init */
+    memset(&mt, 0, sizeof(mt));
+    memset(&seekTable, 0, sizeof(seekTable));
+    pthread_mutex_init(&mt.mutex, NULL);
+    pthread_cond_init(&mt.cond, NULL);
+    mt.comp[0] = FIO_selectCompressor(0);
+    mt.comp[1] = FIO_selectCompressor(ZSTD_HC_MAX_CLEVEL);
+    mt.srcSizeHint = (srcSizeHint && (srcSizeHint < segmentSize)) ? srcSizeHint : segmentSize;   /* segments are independent */
+    mt.fullFrames = g_seekable;
+    mt.checksumFlag = g_seekable && g_checksum;
+    mt.contentSizeFlag = g_seekable && g_contentSize;
+    pool = POOL_create(g_nbThreads, nbJobs);
+    jobs = (FIO_job_t*)calloc(nbJobs, sizeof(FIO_job_t));
+    if (!pool || !jobs) EXM_THROW(21, "Allocation error : not enough memory");
+    for (u=0; u<nbJobs; u++)
+    {
+        jobs[u].mt = &mt;
+        jobs[u].dstCapacity = ZSTD_compressBound(segmentSize);
+        if (map==NULL) jobs[u].srcBuffer = (BYTE*)malloc(segmentSize);
+        jobs[u].dstBuffer = (BYTE*)malloc(jobs[u].dstCapacity);
+        if ((!jobs[u].srcBuffer && !map) || !jobs[u].dstBuffer) EXM_THROW(21, "Allocation error : not enough memory");
+    }
+
+    /* Main loop : read and dispatch segments, write results in order */
+    while (1)
+    {
+        if ((!readEnded) && (nbJobsStarted - nbJobsWritten < nbJobs))
+        {
+            FIO_job_t* const job = jobs + (nbJobsStarted % nbJobs);
+            size_t inSize;
+            if (map)
+            {
+                inSize = MIN(segmentSize, (size_t)(map->size - filesize));
+                job->src = map->start + filesize;
+            }
+            else
+            {
+                inSize = fread(job->srcBuffer, (size_t)1, segmentSize, finput);
+                job->src = job->srcBuffer;
+            }
+            if (inSize < segmentSize) readEnded = 1;   /* end of input (or read error) */
+            if (inSize==0) continue;
+            filesize += inSize;
+            DISPLAYUPDATE(2, "\rRead : %u MB   ", (U32)(filesize>>20));
+            job->srcSize = inSize;
+            job->cLevel = cLevel;
+            job->done = 0;
+            nbJobsStarted++;
+            POOL_add(pool, FIO_compressJob, job);
+            continue;
+        }
+        if (nbJobsWritten == nbJobsStarted) break;   /* eof, and all jobs written */
+
+        /* write oldest job */
+        {
+            FIO_job_t* const job = jobs + (nbJobsWritten % nbJobs);
+            size_t sizeCheck;
+            U64 writeStart;
+            pthread_mutex_lock(&mt.mutex);
+            while (!job->done) pthread_cond_wait(&mt.cond, &mt.mutex);
+            pthread_mutex_unlock(&mt.mutex);
+            if (ZSTD_isError(job->dstSize))
+                EXM_THROW(24, "Compression error : %s ", ZSTD_getErrorName(job->dstSize));
+            writeStart = FIO_getNanoTime();
+            sizeCheck = fwrite(job->dstBuffer, 1, job->dstSize, foutput);
+            if (sizeCheck!=job->dstSize) EXM_THROW(25, "Write error : cannot write compressed block into %s", output_filename);
+            if (g_adapt) cLevel = FIO_adaptLevel(cLevel, job, FIO_getNanoTime() - writeStart);
+            if (g_seekable) FIO_seekTable_add(&seekTable, job->dstSize, job->srcSize);
+            if (checksumState) XXH64_update(checksumState, job->src, job->srcSize);   /* while workers compress next segments */
+            compressedfilesize += job->dstSize;
+            nbJobsWritten++;
+            DISPLAYUPDATE(2, "\rRead : %u MB  ==> %.2f%%   ", (U32)(filesize>>20), (double)compressedfilesize/filesize*100);
+        }
+    }
+
+    /* Seek table */
+    if (g_seekable)
+    {
+        size_t const tableSize = FIO_seekTable_write(foutput, &seekTable);
+        if (tableSize==0) EXM_THROW(27, "Write error : cannot write seek table into %s", output_filename);
+        compressedfilesize += tableSize;
+    }
+
+    /* clean */
+    POOL_free(pool);
+    for (e=0; e<2; e++)
+        for (u=0; u<mt.nbIdleCtx[e]; u++) mt.comp[e].freeC(mt.ctxTable[e][u]);
+    for (u=0; u<nbJobs; u++) { free(jobs[u].srcBuffer); free(jobs[u].dstBuffer); }
+    free(jobs);
+    free(seekTable.table);
+    pthread_mutex_destroy(&mt.mutex);
+    pthread_cond_destroy(&mt.cond);
+
+    *srcSizePtr = filesize;
+    return compressedfilesize;
+}
+
+
+/* FIO_compressFrame() :
+*  compress all of finput (or map, if not NULL) into a single frame.
+*  Segments of FIO_WINDOWNBBLOCKS blocks are compressed in parallel.
+*  contentSize, if not 0, is recorded into frame header.
+*  With --adapt, header comes from fast engine : its window covers a full segment, whichever level follows.
+*  @result : compressed size; *srcSizePtr receives the amount of data read */
+static U64 FIO_compressFrame(FILE* foutput, FILE* finput, const FIO_map_t* map, const char* output_filename, U64* srcSizePtr,
+                             int cLevel, U64 srcSizeHint, U64 contentSize)
+{
+    const int headerLevel = g_adapt ? 0 : cLevel;
+    const FIO_compressor_t compressor = FIO_selectCompressor(headerLevel);
+    const FIO_compressor_t* const comp = &compressor;
     U64 filesize = 0;
     U64 compressedfilesize = 0;
-    BYTE* inBuff;
-    BYTE* inSlot;
-    BYTE* inEnd;
     BYTE* outBuff;
     size_t blockSize = 128 KB;
-    size_t inBuffSize = 4 * blockSize;
     size_t outBuffSize = ZSTD_compressBound(blockSize);
-    FILE* finput;
-    FILE* foutput;
     size_t sizeCheck, cSize;
     void* ctx;
-    FIO_createC createC=NULL;
-    FIO_initC initC=NULL;
-    FIO_continueC continueC = NULL;
-    FIO_endC endC = NULL;
-    FIO_freeC freeC = NULL;
-
-    /* Init */
-    if (cLevel <= 1)
-    {
-        createC = local_ZSTD_createCCtx;
-        initC = local_ZSTD_compressBegin;
-        continueC = local_ZSTD_compressContinue;
-        endC = local_ZSTD_compressEnd;
-        freeC = local_ZSTD_freeCCtx;
-    }
-    else
-    {
-        createC = local_ZSTD_HC_createCCtx;
-        initC = local_ZSTD_HC_compressBegin;
-        continueC = local_ZSTD_HC_compressContinue;
-        endC = local_ZSTD_HC_compressEnd;
-        freeC = local_ZSTD_HC_freeCCtx;
-    }
-    FIO_getFileHandles(&finput, &foutput, input_filename, output_filename);
-    filesize = FIO_getFileSize(input_filename);
+    XXH64_state_t checksumState;
 
     /* Allocate Memory */
-    ctx = createC();
-    inBuff  = (BYTE*)malloc(inBuffSize);
+    ctx = comp->createC();
     outBuff = (BYTE*)malloc(outBuffSize);
-    if (!inBuff || !outBuff || !ctx) EXM_THROW(21, "Allocation error : not enough memory");
-    inSlot = inBuff;
-    inEnd = inBuff + inBuffSize;
+    if (!outBuff || !ctx) EXM_THROW(21, "Allocation error : not enough memory");
 
     /* Write Frame Header */
-    cSize = initC(ctx, outBuff, outBuffSize, cLevel, filesize);
+    if (contentSize) comp->pledgeC(ctx, contentSize);
+    cSize = comp->initC(ctx, outBuff, outBuffSize, headerLevel, srcSizeHint);
     if (ZSTD_isError(cSize)) EXM_THROW(22, "Compression error : cannot create frame header");
+    if (g_checksum) cSize = FIO_checksumHeader(outBuff, cSize);
+    XXH64_reset(&checksumState, 0);
 
     sizeCheck = fwrite(outBuff, 1, cSize, foutput);
     if (sizeCheck!=cSize) EXM_THROW(23, "Write error : cannot write header into %s", output_filename);
     compressedfilesize += cSize;
-    filesize = 0;
+
+    DISPLAYLEVEL(4, "Compressing using %u threads \n", g_nbThreads);
+    compressedfilesize += FIO_compressSegments(foutput, finput, map, output_filename, &filesize,
+                                               blockSize, cLevel, srcSizeHint, g_checksum ? &checksumState : NULL);
+
+    /* End of Frame : segments were compressed by other contexts, so ctx can't check content size itself */
+    if (contentSize)
+    {
+        if (filesize != contentSize) EXM_THROW(26, "Compression error : %s ", ZSTD_getErrorName(ERROR(srcSize_wrong)));
+        cSize = comp->initC(ctx, outBuff, outBuffSize, headerLevel, srcSizeHint);   /* restart without pledged size */
+        if (ZSTD_isError(cSize)) EXM_THROW(26, "Compression error : cannot create frame end");
+    }
+    cSize = comp->endC(ctx, outBuff, outBuffSize);
+    if (ZSTD_isError(cSize)) EXM_THROW(26, "Compression error : %s ", ZSTD_getErrorName(cSize));
+    if (g_checksum) cSize = FIO_checksumEnd(outBuff, cSize, &checksumState);
+
+    sizeCheck = fwrite(outBuff, 1, cSize, foutput);
+    if (sizeCheck!=cSize) EXM_THROW(27, "Write error : cannot write frame end into %s", output_filename);
+    compressedfilesize += cSize;
+
+    /* clean */
+    free(outBuff);
+    comp->freeC(ctx);
+
+    *srcSizePtr = filesize;
+    return compressedfilesize;
+}
+
+
+/* FIO_compressMapped() :
+*  single-threaded compression, directly from a memory-mapped input.
+*  Each segment of FIO_WINDOWNBBLOCKS blocks starts with a context reset (restartC), exactly where ZBUFF_CCtx ring buffer wraps,
+*  so the result is identical to FIO_compressStream().
+*  Next segment is prefetched, and previous one is written, while current one is compressed.
+*  @result : compressed size */
+static U64 FIO_compressMapped(FILE* foutput, const FIO_map_t* map, const char* output_filename,
+                              const FIO_compressor_t* comp, int cLevel, U64 srcSizeHint)
+{
+    U64 compressedfilesize = 0;
+    const size_t segmentSize = FIO_WINDOWNBBLOCKS * (128 KB);
+    const size_t outBuffSize = ZSTD_compressBound(segmentSize);
+    BYTE* const outBuffs = (BYTE*)malloc(2*outBuffSize);
+    void* const ctx = comp->createC();
+    FIO_aio_t writer;
+    FIO_aioJob_t wJobs[2];
+    unsigned w = 0;
+    size_t pos = 0;
+    size_t cSize;
+    XXH64_state_t checksumState;
+
+    if (!outBuffs || !ctx) EXM_THROW(21, "Allocation error : not enough memory");
+    FIO_aio_init(&writer, foutput);
+    memset(wJobs, 0, sizeof(wJobs));
+    XXH64_reset(&checksumState, 0);
 
     /* Main compression loop */
-    while (1)
+    while (pos < map->size)
     {
-        size_t inSize;
+        size_t const segSize = MIN(segmentSize, map->size - pos);
+        BYTE* const outBuff = outBuffs + w*outBuffSize;
+        size_t hSize;
+
+        FIO_prefetch(map, pos+segSize, segmentSize);
+        if (FIO_aio_wait(wJobs+w) != wJobs[w].size)   /* outBuff is free again */
+            EXM_THROW(25, "Write error : cannot write compressed block into %s", output_filename);
+
+        if (pos==0)
+        {
+            if (g_contentSize) comp->pledgeC(ctx, map->size);
+            hSize = comp->initC(ctx, outBuff, outBuffSize, cLevel, srcSizeHint);
+            if (ZSTD_isError(hSize)) EXM_THROW(22, "Compression error : cannot create frame header");
+            if (g_checksum) hSize = FIO_checksumHeader(outBuff, hSize);
+        }
+        else
+        {
+            if (g_contentSize) comp->pledgeC(ctx, map->size - pos);   /* rest of the frame, checked by endC */
+            hSize = comp->restartC(ctx, outBuff, outBuffSize, cLevel, srcSizeHint, MIN(128 KB, segSize));
+            if (ZSTD_isError(hSize)) EXM_THROW(22, "Compression error : cannot reset context");
+            hSize = 0;   /* frame header is written only once */
+        }
 
-        /* Fill input Buffer */
-        if (inSlot + blockSize > inEnd) inSlot = inBuff;
-        inSize = fread(inSlot, (size_t)1, blockSize, finput);
+        cSize = comp->continueC(ctx, outBuff+hSize, outBuffSize-hSize, map->start+pos, segSize);
+        if (ZSTD_isError(cSize)) EXM_THROW(24, "Compression error : %s ", ZSTD_getErrorName(cSize));
+        if (g_checksum) XXH64_update(&checksumState, map->start+pos, segSize);   /* segment is still in cache */
+        cSize += hSize;
+        pos += segSize;
+
+        FIO_aio_submit(&writer, wJobs+w, FIO_aio_writeJob, outBuff, cSize);
+        w ^= 1;
+        compressedfilesize += cSize;
+        DISPLAYUPDATE(2, "\rRead : %u MB  ==> %.2f%%   ", (U32)(pos>>20), (double)compressedfilesize/pos*100);
+    }
+
+    /* End of Frame */
+    if (FIO_aio_wait(wJobs+w) != wJobs[w].size)
+        EXM_THROW(25, "Write error : cannot write compressed block into %s", output_filename);
+    cSize = comp->endC(ctx, outBuffs + w*outBuffSize, outBuffSize);
+    if (ZSTD_isError(cSize)) EXM_THROW(26, "Compression error : %s ", ZSTD_getErrorName(cSize));
+    if (g_checksum) cSize = FIO_checksumEnd(outBuffs + w*outBuffSize, cSize, &checksumState);
+    FIO_aio_submit(&writer, wJobs+w, FIO_aio_writeJob, outBuffs + w*outBuffSize, cSize);
+    compressedfilesize += cSize;
+
+    if (FIO_aio_wait(wJobs+0) != wJobs[0].size) EXM_THROW(27, "Write error : cannot write frame end into %s", output_filename);
+    if (FIO_aio_wait(wJobs+1) != wJobs[1].size) EXM_THROW(27, "Write error : cannot write frame end into %s", output_filename);
+
+    /* clean */
+    FIO_aio_free(&writer);
+    free(outBuffs);
+    comp->freeC(ctx);
+
+    return compressedfilesize;
+}
+
+
+/* FIO_compressStream() :
+*  single-threaded : ZBUFF_CCtx manages the window.
+*  Next input chunk is read, and previous output is written, while current chunk is compressed.
+*  contentSize, if not 0, is recorded into frame header. */
+static U64 FIO_compressStream(FILE* foutput, FILE* finput, const char* output_filename, U64* srcSizePtr,
+                              int cLevel, U64 srcSizeHint, U64 contentSize)
+{
+    U64 filesize = 0;
+    U64 compressedfilesize = 0;
+    const size_t inBuffSize = ZBUFF_recommendedCInSize();
+    const size_t outBuffSize = ZBUFF_recommendedCOutSize();
+    BYTE* const inBuffs  = (BYTE*)malloc(2*inBuffSize);
+    BYTE* const outBuffs = (BYTE*)malloc(2*outBuffSize);
+    ZBUFF_CCtx* const zbc = ZBUFF_createCCtx();
+    FIO_aio_t reader, writer;
+    FIO_aioJob_t rJobs[2], wJobs[2];
+    unsigned r = 0, w = 0;
+    size_t errorCode;
+
+    if (!inBuffs || !outBuffs || !zbc) EXM_THROW(21, "Allocation error : not enough memory");
+    ZBUFF_setContentChecksum(zbc, g_checksum);
+    if (contentSize) ZBUFF_setPledgedSrcSize(zbc, contentSize);
+    errorCode = ZBUFF_compressInit(zbc, cLevel, srcSizeHint);
+    if (ZSTD_isError(errorCode)) EXM_THROW(22, "Compression error : cannot create frame header");
+    FIO_aio_init(&reader, finput);
+    FIO_aio_init(&writer, foutput);
+    memset(rJobs, 0, sizeof(rJobs));
+    memset(wJobs, 0, sizeof(wJobs));
+    FIO_aio_submit(&reader, rJobs+0, FIO_aio_readJob, inBuffs, inBuffSize);
+
+    /* Main compression loop */
+    while (1)
+    {
+        BYTE* const inBuff = inBuffs + r*inBuffSize;
+        size_t const inSize = FIO_aio_wait(rJobs+r);
+        size_t inPos = 0;
         if (inSize==0) break;
         filesize += inSize;
         DISPLAYUPDATE(2, "\rRead : %u MB   ", (U32)(filesize>>20));
+        if (inSize == inBuffSize)   /* otherwise, end of input is reached */
+            FIO_aio_submit(&reader, rJobs+(r^1), FIO_aio_readJob, inBuffs + (r^1)*inBuffSize, inBuffSize);
 
-        /* Compress Block */
-        cSize = continueC(ctx, outBuff, outBuffSize, inSlot, inSize);
-        if (ZSTD_isError(cSize))
-            EXM_THROW(24, "Compression error : %s ", ZSTD_getErrorName(cSize));
-
-        /* Write cBlock */
-        sizeCheck = fwrite(outBuff, 1, cSize, foutput);
-        if (sizeCheck!=cSize) EXM_THROW(25, "Write error : cannot write compressed block into %s", output_filename);
-        compressedfilesize += cSize;
-        inSlot += inSize;
+        while (inPos < inSize)
+        {
+            BYTE* const outBuff = outBuffs + w*outBuffSize;
+            size_t srcSize = inSize - inPos;
+            size_t cSize = outBuffSize;
+            if (FIO_aio_wait(wJobs+w) != wJobs[w].size)   /* outBuff is free again */
+                EXM_THROW(25, "Write error : cannot write compressed block into %s", output_filename);
+            errorCode = ZBUFF_compressContinue(zbc, outBuff, &cSize, inBuff+inPos, &srcSize);
+            if (ZSTD_isError(errorCode))
+                EXM_THROW(24, "Compression error : %s ", ZSTD_getErrorName(errorCode));
+            inPos += srcSize;
+
+            if (cSize)
+            {
+                FIO_aio_submit(&writer, wJobs+w, FIO_aio_writeJob, outBuff, cSize);
+                w ^= 1;
+                compressedfilesize += cSize;
+            }
+        }
 
         DISPLAYUPDATE(2, "\rRead : %u MB  ==> %.2f%%   ", (U32)(filesize>>20), (double)compressedfilesize/filesize*100);
+        if (inSize < inBuffSize) break;
+        r ^= 1;
     }
 
     /* End of Frame */
-    cSize = endC(ctx, outBuff, outBuffSize);
-    if (ZSTD_isError(cSize)) EXM_THROW(26, "Compression error : cannot create frame end");
+    do
+    {
+        BYTE* const outBuff = outBuffs + w*outBuffSize;
+        size_t cSize = outBuffSize;
+        if (FIO_aio_wait(wJobs+w) != wJobs[w].size)
+            EXM_THROW(27, "Write error : cannot write frame end into %s", output_filename);
+        errorCode = ZBUFF_compressEnd(zbc, outBuff, &cSize);
+        if (ZSTD_isError(errorCode)) EXM_THROW(26, "Compression error : %s ", ZSTD_getErrorName(errorCode));
+
+        FIO_aio_submit(&writer, wJobs+w, FIO_aio_writeJob, outBuff, cSize);
+        w ^= 1;
+        compressedfilesize += cSize;
+    } while (errorCode);
 
-    sizeCheck = fwrite(outBuff, 1, cSize, foutput);
-    if (sizeCheck!=cSize) EXM_THROW(27, "Write error : cannot write frame end into %s", output_filename);
-    compressedfilesize += cSize;
+    if (FIO_aio_wait(wJobs+0) != wJobs[0].size) EXM_THROW(27, "Write error : cannot write frame end into %s", output_filename);
+    if (FIO_aio_wait(wJobs+1) != wJobs[1].size) EXM_THROW(27, "Write error : cannot write frame end into %s", output_filename);
+
+    /* clean */
+    FIO_aio_free(&reader);
+    FIO_aio_free(&writer);
+    free(inBuffs);
+    free(outBuffs);
+    ZBUFF_freeCCtx(zbc);
+
+    *srcSizePtr = filesize;
+    return compressedfilesize;
+}
+
+
+unsigned long long FIO_compressFilename(const char* output_filename, const char* input_filename, int cLevel)
+{
+    const U64 segmentSize = FIO_WINDOWNBBLOCKS * (128 KB);
+    U64 filesize;
+    U64 srcSizeHint;
+    U64 contentSize;
+    U64 compressedfilesize;
+    FILE* finput;
+    FILE* foutput;
+    FIO_map_t map;
+    const FIO_compressor_t comp = FIO_selectCompressor(cLevel);
+
+    /* Init */
+    FIO_getFileHandles(&finput, &foutput, input_filename, output_filename);
+    filesize = FIO_getFileSize(input_filename);
+    FIO_mapInput(&map, finput, filesize);
+    srcSizeHint = ((filesize==0) || (filesize > segmentSize)) ? segmentSize : filesize;   /* history never extends beyond a segment : neither do tables */
+    contentSize = g_contentSize ? filesize : 0;   /* 0 : unknown (not a regular file) */
+
+    /* Compression */
+    if (g_seekable)   /* independent frames + seek table */
+        compressedfilesize = FIO_compressSegments(foutput, finput, map.start ? &map : NULL, output_filename, &filesize,
+                                                  128 KB, cLevel, srcSizeHint, NULL);
+    else if ((g_nbThreads > 1) || g_adapt)   /* --adapt : level changes between segments */
+        compressedfilesize = FIO_compressFrame(foutput, finput, map.start ? &map : NULL, output_filename, &filesize,
+                                               cLevel, srcSizeHint, contentSize);
+    else if (map.start)
+        compressedfilesize = FIO_compressMapped(foutput, &map, output_filename, &comp, cLevel, srcSizeHint);
+    else
+        compressedfilesize = FIO_compressStream(foutput, finput, output_filename, &filesize,
+                                                cLevel, srcSizeHint, contentSize);
 
     /* Status */
     DISPLAYLEVEL(2, "\r%79s\r", "");
@@ -375,9 +1224,7 @@ unsigned long long FIO_compressFilename(const char* output_filename, const char*
         (unsigned long long) filesize, (unsigned long long) compressedfilesize, (double)compressedfilesize/filesize*100);
 
     /* clean */
-    free(inBuff);
-    free(outBuff);
-    freeC(ctx);
+    FIO_unmap(&map);
     fclose(finput);
     if (fclose(foutput)) EXM_THROW(28, "Write error : cannot properly close %s", output_filename);
 
@@ -385,16 +1232,60 @@ unsigned long long FIO_compressFilename(const char* output_filename, const char*
 }
 
 
-unsigned long long FIO_decompressFrame(FILE* foutput, FILE* finput,
+/* *************************************
+*  Decompression input
+***************************************/
+typedef struct
+{
+    FILE* file;
+    FIO_map_t map;   /* when mapped, file is not read */
+    size_t pos;      /* position within map */
+} FIO_input_t;
+
+/* FIO_getInput() :
+*  @result : pointer to the next size bytes of input : directly within map if any, otherwise read into buffer.
+*  *readSizePtr receives the nb of bytes available, which is < size only at end of input */
+static const BYTE* FIO_getInput(FIO_input_t* input, void* buffer, size_t size, size_t* readSizePtr)
+{
+    if (input->map.start)
+    {
+        const BYTE* const ptr = input->map.start + input->pos;
+        *readSizePtr = MIN(size, input->map.size - input->pos);
+        input->pos += *readSizePtr;
+        return ptr;
+    }
+    *readSizePtr = fread(buffer, 1, size, input->file);
+    return (const BYTE*)buffer;
+}
+
+/* FIO_readInput() : same as FIO_getInput(), but always copies into buffer.
+*  @result : nb of bytes read */
+static size_t FIO_readInput(FIO_input_t* input, void* buffer, size_t size)
+{
+    size_t readSize;
+    const BYTE* const ptr = FIO_getInput(input, buffer, size, &readSize);
+    if (ptr != buffer) memcpy(buffer, ptr, readSize);
+    return readSize;
+}
+
+
+/* FIO_decompressFrame() :
+*  each decoded block is written by writer while next one is decoded.
+*  This is safe as long as outBuff holds more than 2 blocks : the block being written is only read from, as history.
+*  Decoding restarts from the beginning of outBuff when less than wrapSize bytes remain.
+*  All writes are completed on return. */
+unsigned long long FIO_decompressFrame(FIO_aio_t* writer, FIO_input_t* input,
                                        BYTE* inBuff, size_t inBuffSize,
-                                       BYTE* outBuff, size_t outBuffSize,
+                                       BYTE* outBuff, size_t outBuffSize, size_t wrapSize,
                                        ZSTD_DCtx* dctx)
 {
     BYTE* op = outBuff;
     BYTE* const oend = outBuff + outBuffSize;
     U64   filesize = 0;
+    FIO_aioJob_t wJob;
     size_t toRead;
-    size_t sizeCheck;
+
+    memset(&wJob, 0, sizeof(wJob));
 
 
     /* Main decompression Loop */
@@ -402,26 +1293,27 @@ unsigned long long FIO_decompressFrame(FILE* foutput, FILE* finput,
     while (toRead)
     {
         size_t readSize, decodedSize;
+        const BYTE* ip;
 
         /* Fill input buffer */
         if (toRead > inBuffSize)
             EXM_THROW(34, "too large block");
-        readSize = fread(inBuff, 1, toRead, finput);
+        ip = FIO_getInput(input, inBuff, toRead, &readSize);
         if (readSize != toRead)
             EXM_THROW(35, "Read error");
 
         /* Decode block */
-        decodedSize = ZSTD_decompressContinue(dctx, op, oend-op, inBuff, readSize);
-        if (ZSTD_isError(decodedSize)) EXM_THROW(36, "Decoding error : input corrupted");
+        decodedSize = ZSTD_decompressContinue(dctx, op, oend-op, ip, readSize);
+        if (ZSTD_isError(decodedSize)) EXM_THROW(36, "Decoding error : %s", ZSTD_getErrorName(decodedSize));
 
         if (decodedSize)   /* not a header */
         {
             /* Write block */
-            sizeCheck = fwrite(op, 1, decodedSize, foutput);
-            if (sizeCheck != decodedSize) EXM_THROW(37, "Write error : unable to write data block to destination file");
+            if (FIO_aio_wait(&wJob) != wJob.size) EXM_THROW(37, "Write error : unable to write data block to destination file");
+            FIO_aio_submit(writer, &wJob, FIO_aio_writeJob, op, decodedSize);
             filesize += decodedSize;
             op += decodedSize;
-            if (op==oend) op = outBuff;
+            if ((size_t)(oend-op) < wrapSize) op = outBuff;
             DISPLAYUPDATE(2, "\rDecoded : %u MB...     ", (U32)(filesize>>20) );
         }
 
@@ -429,14 +1321,209 @@ unsigned long long FIO_decompressFrame(FILE* foutput, FILE* finput,
         toRead = ZSTD_nextSrcSizeToDecompress(dctx);
     }
 
+    if (FIO_aio_wait(&wJob) != wJob.size) EXM_THROW(37, "Write error : unable to write data block to destination file");
+    return filesize;
+}
+
+
+/* *************************************
+*  Multi-threaded decompression
+***************************************/
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;   /* signaled whenever a job completes */
+} FIO_syncCtx_t;
+
+typedef struct
+{
+    FIO_syncCtx_t* sync;
+    BYTE*  srcBuffer;   /* not used when input is mapped */
+    size_t srcCapacity;
+    const BYTE* src;
+    size_t srcSize;
+    BYTE*  dstBuffer;   /* not used when output is mapped */
+    size_t dstCapacity;
+    BYTE*  dst;
+    size_t dstSize;   /* expected regenerated size */
+    size_t result;
+    U32    done;
+} FIO_dJob_t;
+
+static void FIO_decompressJob(void* opaque)
+{
+    FIO_dJob_t* const job = (FIO_dJob_t*)opaque;
+    size_t const result = ZSTD_decompress(job->dst, job->dstSize, job->src, job->srcSize);
+
+    pthread_mutex_lock(&job->sync->mutex);
+    job->result = result;
+    job->done = 1;
+    pthread_cond_broadcast(&job->sync->cond);
+    pthread_mutex_unlock(&job->sync->mutex);
+}
+
+/* FIO_loadSeekTable() :
+*  @result : seek table entries, read from the end of finput, or NULL if there is no valid seek table.
+*  finput position is back to beginning on success, and undefined otherwise. */
+static BYTE* FIO_loadSeekTable(FILE* finput, U64 fileSize, U32* nbFramesPtr)
+{
+    BYTE footer[ZSTD_seekTableFooterSize];
+    BYTE header[ZSTD_skippableHeaderSize];
+    BYTE* table;
+    U64 tableSize, totalCSize = 0;
+    U32 nbFrames, u;
+
+    if (fileSize < ZSTD_skippableHeaderSize + ZSTD_seekTableFooterSize) return NULL;
+    if (LONG_SEEK(finput, -(long)ZSTD_seekTableFooterSize, SEEK_END)) return NULL;
+    if (fread(footer, 1, sizeof(footer), finput) != sizeof(footer)) return NULL;
+    if (MEM_readLE32(footer+4) != ZSTD_seekTableMagicNumber) return NULL;
+    nbFrames = MEM_readLE32(footer);
+    tableSize = (U64)nbFrames * ZSTD_seekTableEntrySize + ZSTD_seekTableFooterSize;
+    if (tableSize + ZSTD_skippableHeaderSize > fileSize) return NULL;
+    if (LONG_SEEK(finput, -(long)(tableSize + ZSTD_skippableHeaderSize), SEEK_END)) return NULL;
+    if (fread(header, 1, sizeof(header), finput) != sizeof(header)) return NULL;
+    if (MEM_readLE32(header) != ZSTD_skippableMagicNumber) return NULL;
+    if (MEM_readLE32(header+4) != tableSize) return NULL;
+
+    table = (BYTE*)malloc((size_t)tableSize);
+    if (table==NULL) return NULL;
+    if (fread(table, 1, (size_t)tableSize, finput) != tableSize) { free(table); return NULL; }
+
+    /* seek table must describe the whole file */
+    for (u=0; u<nbFrames; u++) totalCSize += MEM_readLE32(table + u*ZSTD_seekTableEntrySize);
+    if ((totalCSize + tableSize + ZSTD_skippableHeaderSize != fileSize) || LONG_SEEK(finput, 0, SEEK_SET))
+    {
+        free(table);
+        return NULL;
+    }
+
+    *nbFramesPtr = nbFrames;
+    return table;
+}
+
+/* FIO_decompressSeekable() :
+*  decode frames listed into seek table in parallel, using g_nbThreads workers.
+*  Since regenerated size is known, a regular output file is preallocated and mapped : frames are decoded in place.
+*  @result : regenerated size */
+static U64 FIO_decompressSeekable(FILE* foutput, FIO_input_t* input, const BYTE* seekTable, U32 nbFrames)
+{
+    FIO_syncCtx_t sync;
+    FIO_dJob_t* jobs;
+    POOL_ctx* pool;
+    FIO_map_t outMap;
+    const unsigned nbJobs = 2 * g_nbThreads;
+    U32 nbJobsStarted = 0, nbJobsWritten = 0;
+    U64 filesize = 0, dstPos = 0;
+    unsigned u;
+
+    /* Init */
+    for (u=0; u<nbFrames; u++) filesize += MEM_readLE32(seekTable + u*ZSTD_seekTableEntrySize + 4);
+    FIO_mapOutput(&outMap, foutput, filesize);
+    filesize = 0;
+    pthread_mutex_init(&sync.mutex, NULL);
+    pthread_cond_init(&sync.cond, NULL);
+    pool = POOL_create(g_nbThreads, nbJobs);
+    jobs = (FIO_dJob_t*)calloc(nbJobs, sizeof(FIO_dJob_t));
+    if (!pool || !jobs) EXM_THROW(33, "Allocation error : not enough memory");
+    for (u=0; u<nbJobs; u++) jobs[u].sync = &sync;
+
+    /* Main loop : read and dispatch frames, write results in order */
+    while (nbJobsWritten < nbFrames)
+    {
+        if ((nbJobsStarted < nbFrames) && (nbJobsStarted - nbJobsWritten < nbJobs))
+        {
+            FIO_dJob_t* const job = jobs + (nbJobsStarted % nbJobs);
+            size_t readSize;
+            job->srcSize = MEM_readLE32(seekTable + nbJobsStarted*ZSTD_seekTableEntrySize);
+            job->dstSize = MEM_readLE32(seekTable + nbJobsStarted*ZSTD_seekTableEntrySize + 4);
+            if ((input->map.start==NULL) && (job->srcCapacity < job->srcSize))
+            {
+                free(job->srcBuffer);
+                job->srcCapacity = job->srcSize;
+                job->srcBuffer = (BYTE*)malloc(job->srcCapacity);
+                if (!job->srcBuffer) EXM_THROW(33, "Allocation error : not enough memory");
+            }
+            if (outMap.start)
+            {
+                job->dst = outMap.start + dstPos;
+                dstPos += job->dstSize;
+            }
+            else
+            {
+                if (job->dstCapacity < job->dstSize)
+                {
+                    free(job->dstBuffer);
+                    job->dstCapacity = job->dstSize;
+                    job->dstBuffer = (BYTE*)malloc(job->dstCapacity);
+                    if (!job->dstBuffer) EXM_THROW(33, "Allocation error : not enough memory");
+                }
+                job->dst = job->dstBuffer;
+            }
+            job->src = FIO_getInput(input, job->srcBuffer, job->srcSize, &readSize);
+            if (readSize != job->srcSize) EXM_THROW(35, "Read error");
+            job->done = 0;
+            nbJobsStarted++;
+            POOL_add(pool, FIO_decompressJob, job);
+            continue;
+        }
+
+        /* write oldest job */
+        {
+            FIO_dJob_t* const job = jobs + (nbJobsWritten % nbJobs);
+            size_t sizeCheck;
+            pthread_mutex_lock(&sync.mutex);
+            while (!job->done) pthread_cond_wait(&sync.cond, &sync.mutex);
+            pthread_mutex_unlock(&sync.mutex);
+            if (ZSTD_isError(job->result)) EXM_THROW(36, "Decoding error : %s", ZSTD_getErrorName(job->result));
+            if (job->result != job->dstSize) EXM_THROW(36, "Decoding error : input corrupted");
+            if (outMap.start==NULL)
+            {
+                sizeCheck = fwrite(job->dst, 1, job->dstSize, foutput);
+                if (sizeCheck != job->dstSize) EXM_THROW(37, "Write error : unable to write data block to destination file");
+            }
+            filesize += job->dstSize;
+            nbJobsWritten++;
+            DISPLAYUPDATE(2, "\rDecoded : %u MB...     ", (U32)(filesize>>20) );
+        }
+    }
+
+    /* clean */
+    POOL_free(pool);
+    FIO_unmap(&outMap);
+    for (u=0; u<nbJobs; u++) { free(jobs[u].srcBuffer); free(jobs[u].dstBuffer); }
+    free(jobs);
+    pthread_mutex_destroy(&sync.mutex);
+    pthread_cond_destroy(&sync.cond);
+
     return filesize;
 }
 
 
+/* FIO_skipFrame() : skip the content of a skippable frame; magic number is already read */
+static void FIO_skipFrame(FIO_input_t* input)
+{
+    BYTE buffer[4 KB];
+    U32 toSkip;
+    if (FIO_readInput(input, buffer, 4) != 4) EXM_THROW(31, "Read error : cannot read header");
+    toSkip = MEM_readLE32(buffer);
+    while (toSkip)
+    {
+        size_t const toRead = MIN(toSkip, sizeof(buffer));
+        size_t readSize;
+        FIO_getInput(input, buffer, toRead, &readSize);
+        if (readSize != toRead) EXM_THROW(35, "Read error");
+        toSkip -= (U32)toRead;
+    }
+}
+
+
 #define MAXHEADERSIZE (FIO_FRAMEHEADERSIZE+3)
 unsigned long long FIO_decompressFilename(const char* output_filename, const char* input_filename)
 {
     FILE* finput, *foutput;
+    FIO_input_t input;
+    FIO_aio_t writer;
+    U64   srcFileSize;
     BYTE* inBuff=NULL;
     size_t inBuffSize = 0;
     BYTE* outBuff=NULL;
@@ -444,7 +1531,9 @@ unsigned long long FIO_decompressFilename(const char* output_filename, const cha
     U32   blockSize = 128 KB;
     U32   wNbBlocks = 4;
     U64   filesize = 0;
-    BYTE* header[MAXHEADERSIZE];
+    BYTE  header[ZSTD_FRAMEHEADERSIZE_MAX];
+    ZSTD_frameParams fParams;
+    size_t frameOutSize, wrapSize;
     size_t toRead;
     size_t sizeCheck;
 
@@ -452,6 +1541,29 @@ unsigned long long FIO_decompressFilename(const char* output_filename, const cha
     /* Init */
     ZSTD_DCtx* dctx = ZSTD_createDCtx();
     FIO_getFileHandles(&finput, &foutput, input_filename, output_filename);
+    srcFileSize = FIO_getFileSize(input_filename);   /* 0 if not a regular file */
+    input.file = finput;
+    input.pos = 0;
+    FIO_mapInput(&input.map, finput, srcFileSize);
+    FIO_aio_init(&writer, foutput);
+
+    /* Seekable source : frames can be decoded in parallel */
+    if (g_nbThreads > 1)
+    {
+        U32 nbFrames;
+        BYTE* const seekTable = srcFileSize ? FIO_loadSeekTable(finput, srcFileSize, &nbFrames) : NULL;
+        if (seekTable)
+        {
+            DISPLAYLEVEL(4, "Decoding %u frames using %u threads \n", nbFrames, g_nbThreads);
+            filesize = FIO_decompressSeekable(foutput, &input, seekTable, nbFrames);
+            free(seekTable);
+            /* only the seek table remains, it will be skipped below */
+        }
+        else if (srcFileSize)
+        {
+            if (LONG_SEEK(finput, 0, SEEK_SET)) EXM_THROW(31, "Read error : cannot rewind %s", input_filename);
+        }
+    }
 
     /* for each frame */
     for ( ; ; )
@@ -459,51 +1571,82 @@ unsigned long long FIO_decompressFilename(const char* output_filename, const cha
         /* check magic number -> version */
         U32 magicNumber;
         toRead = sizeof(ZSTD_magicNumber);;
-        sizeCheck = fread(header, (size_t)1, toRead, finput);
+        sizeCheck = FIO_readInput(&input, header, toRead);
         if (sizeCheck==0) break;   /* no more input */
         if (sizeCheck != toRead) EXM_THROW(31, "Read error : cannot read header");
 
         magicNumber = MEM_readLE32(header);
-#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
-        if (ZSTD_isLegacy(magicNumber))
+        if ((magicNumber & ZSTD_skippableMagicNumberMask) == ZSTD_skippableMagicNumberMin)
         {
-            filesize += FIO_decompressLegacyFrame(foutput, finput, magicNumber);
+            FIO_skipFrame(&input);
             continue;
         }
-#endif   /* ZSTD_LEGACY_SUPPORT */
-        if (magicNumber != ZSTD_magicNumber) EXM_THROW(32, "Error : unknown frame prefix");
-
-        /* prepare frame decompression, by completing header */
-        ZSTD_resetDCtx(dctx);
-        toRead = ZSTD_nextSrcSizeToDecompress(dctx) - sizeof(ZSTD_magicNumber);
-        if (toRead > MAXHEADERSIZE) EXM_THROW(30, "Not enough memory to read header");
-        sizeCheck = fread(&header[sizeof(ZSTD_magicNumber)], 1, toRead, finput);
-        if (sizeCheck != toRead) EXM_THROW(31, "Read error : cannot read header");
-        sizeCheck = ZSTD_decompressContinue(dctx, NULL, 0, header, sizeof(ZSTD_magicNumber)+toRead);   // Decode frame header
-        if (ZSTD_isError(sizeCheck)) EXM_THROW(32, "Error decoding header");
+        if ((magicNumber != ZSTD_magicNumber) && (magicNumber != ZSTD_magicNumberExt)
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+            && !ZSTD_isLegacy(magicNumber)   /* legacy frames are streamed like regular ones */
+#endif
+           ) EXM_THROW(32, "Error : unknown frame prefix");
 
-        /* Here later : blockSize determination */
+        /* complete frame header, then decode it */
+        {
+            size_t hSize = sizeof(ZSTD_magicNumber);
+            size_t pos = 0;
+            while ((toRead = ZSTD_getFrameParams(&fParams, header, hSize)) > 0)
+            {
+                if (ZSTD_isError(toRead)) EXM_THROW(32, "Error decoding header : %s", ZSTD_getErrorName(toRead));
+                sizeCheck = FIO_readInput(&input, header+hSize, toRead-hSize);
+                if (sizeCheck != toRead-hSize) EXM_THROW(31, "Read error : cannot read header");
+                hSize = toRead;
+            }
+            ZSTD_resetDCtx(dctx);
+            while (pos < hSize)
+            {
+                toRead = ZSTD_nextSrcSizeToDecompress(dctx);
+                sizeCheck = ZSTD_decompressContinue(dctx, NULL, 0, header+pos, toRead);
+                if (ZSTD_isError(sizeCheck)) EXM_THROW(32, "Error decoding header : %s", ZSTD_getErrorName(sizeCheck));
+                pos += toRead;
+            }
+        }
 
-        /* Allocate Memory (if needed) */
+        /* Allocate Memory (if needed) :
+         * when window size is known, outBuff keeps a full window of history behind 2 blocks,
+         * and never exceeds content size. Otherwise, it mirrors the compressor's ring buffer (wraps only when full). */
+        frameOutSize = wNbBlocks * blockSize;
+        wrapSize = 1;
+        if (fParams.windowLog)
+        {
+            U64 const windowSize = (U64)1 << fParams.windowLog;
+            U64 outSize = (windowSize > blockSize ? windowSize : blockSize) + 2*blockSize;
+            wrapSize = blockSize;
+            if (outSize >= fParams.contentSize)   /* whole content fits (unknown content size is (U64)-1) : never wraps */
+            {
+                outSize = fParams.contentSize ? fParams.contentSize : 1;
+                wrapSize = 1;
+            }
+            if ((U64)(size_t)outSize != outSize) EXM_THROW(33, "Allocation error : window too large");
+            frameOutSize = (size_t)outSize;
+        }
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+        if (ZSTD_isLegacy(magicNumber)) wrapSize = blockSize;   /* legacy blocks always fit; full blocks still wrap at ring end, like legacy compressors */
+#endif
         {
             size_t newInBuffSize = blockSize + FIO_blockHeaderSize;
-            size_t newOutBuffSize = wNbBlocks * blockSize;
             if (newInBuffSize > inBuffSize)
             {
                 free(inBuff);
                 inBuffSize = newInBuffSize;
                 inBuff  = (BYTE*)malloc(inBuffSize);
             }
-            if (newOutBuffSize > outBuffSize)
+            if (frameOutSize > outBuffSize)
             {
                 free(outBuff);
-                outBuffSize = newOutBuffSize;
+                outBuffSize = frameOutSize;
                 outBuff  = (BYTE*)malloc(outBuffSize);
             }
         }
         if (!inBuff || !outBuff) EXM_THROW(33, "Allocation error : not enough memory");
 
-        filesize += FIO_decompressFrame(foutput, finput, inBuff, inBuffSize, outBuff, outBuffSize, dctx);
+        filesize += FIO_decompressFrame(&writer, &input, inBuff, inBuffSize, outBuff, frameOutSize, wrapSize, dctx);
     }
 
     DISPLAYLEVEL(2, "\r%79s\r", "");
@@ -513,6 +1656,8 @@ unsigned long long FIO_decompressFilename(const char* output_filename, const cha
     free(inBuff);
     free(outBuff);
     ZSTD_freeDCtx(dctx);
+    FIO_aio_free(&writer);
+    FIO_unmap(&input.map);
     fclose(finput);
     if (fclose(foutput)) EXM_THROW(38, "Write error : cannot properly close %s", output_filename);
 
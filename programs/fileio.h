@@ -47,6 +47,12 @@ extern "C" {
 ***************************************/
 void FIO_overwriteMode(void);
 void FIO_setNotificationLevel(unsigned level);
+void FIO_setNbThreads(unsigned nbThreads);   /* 1 (default) means single-threaded; decompression needs a seek table */
+void FIO_setSeekable(unsigned seekable);     /* compress into independent frames, followed by a seek table */
+void FIO_setChecksum(unsigned checksum);     /* frames end with a checksum of content, verified by decoder */
+void FIO_setContentSize(unsigned contentSize); /* frames record content size (when known), so decoder can allocate exactly */
+void FIO_setAdapt(unsigned adapt);           /* compression level follows output speed : lower when compression is the bottleneck, higher when output is */
+void FIO_loadLevelTable(const char* tableFileName); /* compression levels from a table in ZSTD_HC_defaultParameters format, as written by paramgrill */
 
 
 /* *************************************
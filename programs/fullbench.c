@@ -63,6 +63,7 @@
 #include "mem.h"
 #include "zstd.h"
 #include "fse_static.h"
+#include "huff0_static.h"
 #include "datagen.h"
 
 
@@ -209,10 +210,10 @@ typedef struct
 } blockProperties_t;
 
 static size_t g_cSize = 0;
-static U32 g_litCtx[40 * 1024];
+static U32 g_litCtx[48 * 1024];
 
 extern size_t ZSTD_getcBlockSize(const void* src, size_t srcSize, blockProperties_t* bpPtr);
-extern size_t ZSTD_decodeSeqHeaders(int* nbSeq, const BYTE** dumpsPtr, size_t* dumpsLengthPtr, FSE_DTable* DTableLL, FSE_DTable* DTableML, FSE_DTable* DTableOffb, const void* src, size_t srcSize);
+extern size_t ZSTD_decodeSeqHeaders(int* nbSeq, const BYTE** dumpsPtr, size_t* dumpsLengthPtr, FSE_DTable* DTableLL, FSE_DTable* DTableML, FSE_DTable* DTableOffb, U32* tableStates, const void* src, size_t srcSize);
 
 size_t local_ZSTD_compress(void* dst, size_t dstSize, void* buff2, const void* src, size_t srcSize)
 {
@@ -236,11 +237,51 @@ size_t local_ZSTD_decodeLiteralsBlock(void* dst, size_t dstSize, void* buff2, co
 size_t local_ZSTD_decodeSeqHeaders(void* dst, size_t dstSize, void* buff2, const void* src, size_t srcSize)
 {
     U32 DTableML[1<<11], DTableLL[1<<10], DTableOffb[1<<9];
+    U32 tableStates[3] = { 0, 0, 0 };   /* first block : no previous table */
     const BYTE* dumps;
     size_t length;
     int nbSeq;
     (void)src; (void)srcSize; (void)dst; (void)dstSize;
-    return ZSTD_decodeSeqHeaders(&nbSeq, &dumps, &length, DTableLL, DTableML, DTableOffb, buff2, g_cSize);
+    return ZSTD_decodeSeqHeaders(&nbSeq, &dumps, &length, DTableLL, DTableML, DTableOffb, tableStates, buff2, g_cSize);
+}
+
+size_t local_HUF_decompress4X2(void* dst, size_t dstSize, void* buff2, const void* src, size_t srcSize)
+{
+    (void)src; (void)dstSize;
+    return HUF_decompress4X2(dst, srcSize, buff2, g_cSize);
+}
+
+size_t local_HUF_decompress4X4(void* dst, size_t dstSize, void* buff2, const void* src, size_t srcSize)
+{
+    (void)src; (void)dstSize;
+    return HUF_decompress4X4(dst, srcSize, buff2, g_cSize);
+}
+
+size_t local_HUF_decompress4X6(void* dst, size_t dstSize, void* buff2, const void* src, size_t srcSize)
+{
+    (void)src; (void)dstSize;
+    return HUF_decompress4X6(dst, srcSize, buff2, g_cSize);
+}
+
+size_t local_HUF_readDTableX2(void* dst, size_t dstSize, void* buff2, const void* src, size_t srcSize)
+{
+    HUF_CREATE_STATIC_DTABLEX2(DTable, HUF_MAX_TABLELOG);
+    (void)src; (void)srcSize; (void)dst; (void)dstSize;
+    return HUF_readDTableX2(DTable, buff2, g_cSize);
+}
+
+size_t local_HUF_readDTableX4(void* dst, size_t dstSize, void* buff2, const void* src, size_t srcSize)
+{
+    HUF_CREATE_STATIC_DTABLEX4(DTable, HUF_MAX_TABLELOG);
+    (void)src; (void)srcSize; (void)dst; (void)dstSize;
+    return HUF_readDTableX4(DTable, buff2, g_cSize);
+}
+
+size_t local_HUF_readDTableX6(void* dst, size_t dstSize, void* buff2, const void* src, size_t srcSize)
+{
+    HUF_CREATE_STATIC_DTABLEX6(DTable, HUF_MAX_TABLELOG);
+    (void)src; (void)srcSize; (void)dst; (void)dstSize;
+    return HUF_readDTableX6(DTable, buff2, g_cSize);
 }
 
 size_t local_conditionalNull(void* dst, size_t dstSize, void* buff2, const void* src, size_t srcSize)
@@ -300,6 +341,24 @@ size_t benchMem(void* src, size_t srcSize, U32 benchNb)
     case 32:
         benchFunction = local_ZSTD_decodeSeqHeaders; benchName = "ZSTD_decodeSeqHeaders";
         break;
+    case 41:
+        benchFunction = local_HUF_decompress4X2; benchName = "HUF_decompress4X2";
+        break;
+    case 42:
+        benchFunction = local_HUF_decompress4X4; benchName = "HUF_decompress4X4";
+        break;
+    case 43:
+        benchFunction = local_HUF_decompress4X6; benchName = "HUF_decompress4X6";
+        break;
+    case 44:
+        benchFunction = local_HUF_readDTableX2; benchName = "HUF_readDTableX2";
+        break;
+    case 45:
+        benchFunction = local_HUF_readDTableX4; benchName = "HUF_readDTableX4";
+        break;
+    case 46:
+        benchFunction = local_HUF_readDTableX6; benchName = "HUF_readDTableX6";
+        break;
     case 101:
         benchFunction = local_conditionalNull; benchName = "conditionalNull";
         break;
@@ -368,6 +427,30 @@ size_t benchMem(void* src, size_t srcSize, U32 benchNb)
             break;
         }
 
+    case 41 :   /* HUF_decompress4X* : literals of first block */
+    case 42 :
+    case 43 :
+    case 44 :   /* HUF_readDTableX* : speed relative to literals size, to compare with decoding */
+    case 45 :
+    case 46 :
+        {
+            blockProperties_t bp;
+            const BYTE* ip = dstBuff + 4 + 3;   /* jump magic number and first block header */
+            ZSTD_compress(dstBuff, dstBuffSize, src, srcSize);
+            ZSTD_getcBlockSize(dstBuff+4, dstBuffSize, &bp);   // Get first block type
+            if ((bp.blockType != bt_compressed) || ((ip[0] & 3) != 0))
+            {
+                DISPLAY("%s : impossible to test on this sample (literals not compressed)\n", benchName);
+                free(dstBuff);
+                free(buff2);
+                return 0;
+            }
+            g_cSize = (MEM_readLE32(ip+2) & 0xFFFFFF) >> 5;   /* literals compressed size */
+            srcSize = (MEM_readLE32(ip) & 0x1FFFFF) >> 2;     /* literals regenerated size */
+            memcpy(buff2, ip+5, g_cSize);
+            break;
+        }
+
     /* test functions */
 
     case 101:   /* conditionalNull */
@@ -48,9 +48,16 @@
 #include <string.h>      /* strcmp */
 #include "zstd_static.h"
 #include "zstdhc_static.h"
+#include "fse_static.h"      /* FSE_createCTable_advanced */
+#include "huff0_static.h"    /* HUF_compress4X_repeat */
+#include "dictBuilder.h"
+#include "zstd_buffered.h"
 #include "datagen.h"     /* RDG_genBuffer */
 #include "xxhash.h"      /* XXH64 */
 #include "mem.h"
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+#  include "zstd_v02.h"   /* ZSTDv02_decompress, ZSTDv02_magicNumber */
+#endif
 
 
 /**************************************
@@ -70,6 +77,8 @@ static const U32 nbTestsDefault = 32 KB;
 static const U32 prime1 = 2654435761U;
 static const U32 prime2 = 2246822519U;
 
+#define MAX(a,b) ((a)>(b)?(a):(b))
+
 
 
 /**************************************
@@ -135,6 +144,65 @@ static unsigned FUZ_highbit32(U32 v32)
 }
 
 
+/* counts allocations, to check custom memory functions */
+typedef struct { U32 nbAllocs; U32 nbFrees; } FUZ_memCounter;
+
+static void* FUZ_countingAlloc(void* opaque, size_t size)
+{
+    ((FUZ_memCounter*)opaque)->nbAllocs++;
+    return malloc(size);
+}
+
+static void FUZ_countingFree(void* opaque, void* address)
+{
+    ((FUZ_memCounter*)opaque)->nbFrees++;
+    free(address);
+}
+
+
+/* decodes a frame with ZBUFF_DCtx, using input and output pieces of random sizes, some as small as 1 byte */
+static size_t FUZ_ZBUFF_decompress(ZBUFF_DCtx* zbd, void* dst, size_t maxDstSize, const void* src, size_t srcSize, U32* rand32)
+{
+    size_t inPos = 0, outPos = 0, hint;
+    size_t errorCode = ZBUFF_decompressInit(zbd);
+    if (ZSTD_isError(errorCode)) return errorCode;
+    do
+    {
+        const U32 sizeLog = FUZ_rand(rand32) % 18;
+        size_t readSize = (FUZ_rand(rand32) & ((1<<sizeLog)-1)) + 1;
+        size_t writeSize = (FUZ_rand(rand32) & ((1<<(17-sizeLog))-1)) + 1;
+        if (readSize > srcSize - inPos) readSize = srcSize - inPos;
+        if (writeSize > maxDstSize - outPos) writeSize = maxDstSize - outPos;
+        hint = ZBUFF_decompressContinue(zbd, (BYTE*)dst + outPos, &writeSize, (const BYTE*)src + inPos, &readSize);
+        if (ZSTD_isError(hint)) return hint;
+        if ((readSize == 0) && (writeSize == 0) && (inPos == srcSize)) return ERROR(srcSize_wrong);   /* truncated */
+        inPos += readSize;
+        outPos += writeSize;
+    } while (hint);
+    return outPos;
+}
+
+/* writes a single block frame : huffman literals (type 0 : new table, 3 : previous table), no sequence */
+static size_t FUZ_writeLiteralsFrame(void* dst, const void* hufStream, size_t hufSize, size_t litSize, BYTE litType)
+{
+    static const BYTE noSequence[] = { 0x00, 0x00, 0x54, 0x00, 0x00, 0x00, 0x04 };   /* raw LL, Off and ML tables */
+    static const BYTE endMark[] = { 0xC0, 0x00, 0x00 };
+    const size_t blockSize = 5 + hufSize + sizeof(noSequence);
+    BYTE* op = (BYTE*)dst;
+    MEM_writeLE32(op, ZSTD_magicNumber); op += 4;
+    op[0] = (BYTE)(blockSize >> 16); op[1] = (BYTE)(blockSize >> 8); op[2] = (BYTE)blockSize; op += 3;
+    op[0] = (BYTE)((litSize << 2) + litType);
+    op[1] = (BYTE)(litSize >> 6);
+    op[2] = (BYTE)((litSize >> 14) + (hufSize << 5));
+    op[3] = (BYTE)(hufSize >> 3);
+    op[4] = (BYTE)(hufSize >> 11);
+    op += 5;
+    memcpy(op, hufStream, hufSize); op += hufSize;
+    memcpy(op, noSequence, sizeof(noSequence)); op += sizeof(noSequence);
+    memcpy(op, endMark, sizeof(endMark)); op += sizeof(endMark);
+    return op - (BYTE*)dst;
+}
+
 static int basicUnitTests(U32 seed, double compressibility)
 {
     int testResult = 0;
@@ -221,6 +289,1276 @@ static int basicUnitTests(U32 seed, double compressibility)
         DISPLAYLEVEL(4, "OK \n");
     }
 
+    /* rle blocks */
+    {
+        ZSTD_DCtx* dctx = ZSTD_createDCtx();
+        const size_t sampleSize = 3 * ZSTD_BLOCKSIZE_MAX + 17;   /* last block shorter */
+        const size_t maxRleFrameSize = 4 + 4 * (3+1) + 3;   /* frame header, 4 rle blocks, end mark */
+        U32 n;
+        if (dctx==NULL) goto _output_error;
+        memset(CNBuffer, 0, sampleSize);
+
+        DISPLAYLEVEL(4, "test%3i : rle blocks : ", testNb++);
+        for (n=0; n<2; n++)   /* fast, then HC */
+        {
+            const BYTE* ip = (const BYTE*)compressedBuffer;
+            BYTE* op = (BYTE*)decodedBuffer;
+            size_t toRead;
+            cSize = n ? ZSTD_HC_compress(compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 9)
+                      : ZSTD_compress(compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            if (cSize > maxRleFrameSize) goto _output_error;
+            memset(decodedBuffer, 1, sampleSize);
+            result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, cSize);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+            result = ZSTD_decompress(decodedBuffer, sampleSize-1, compressedBuffer, cSize);
+            if (!ZSTD_isError(result)) goto _output_error;
+
+            /* streaming */
+            memset(decodedBuffer, 1, sampleSize);
+            result = ZSTD_resetDCtx(dctx);
+            if (ZSTD_isError(result)) goto _output_error;
+            while ((toRead = ZSTD_nextSrcSizeToDecompress(dctx)) != 0)
+            {
+                result = ZSTD_decompressContinue(dctx, op, (BYTE*)decodedBuffer + sampleSize - op, ip, toRead);
+                if (ZSTD_isError(result)) goto _output_error;
+                ip += toRead;
+                op += result;
+            }
+            if ((size_t)(op - (BYTE*)decodedBuffer) != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        }
+        ZSTD_freeDCtx(dctx);
+        DISPLAYLEVEL(4, "OK \n");
+    }
+
+    /* literals barely compressible by Huffman : new table built, but literals sent raw ; next block uses same symbols */
+    {
+        const size_t sampleSize = 2 * ZSTD_BLOCKSIZE_MAX;
+        U32 rand32 = seed;
+        U32 n;
+
+        DISPLAYLEVEL(4, "test%3i : huffman table not sent : ", testNb++);
+        for (n=0; n<128; n++)
+        {
+            const U32 nbSymbols = 176 + (FUZ_rand(&rand32) & 31);
+            const size_t litSize = 800 + (FUZ_rand(&rand32) % 600);
+            size_t u;
+            memset(CNBuffer, 0, sampleSize);   /* each block : literals, then a long match */
+            for (u=0; u<litSize; u++)
+            {
+                ((BYTE*)CNBuffer)[u] = (BYTE)(FUZ_rand(&rand32) % nbSymbols);
+                ((BYTE*)CNBuffer)[ZSTD_BLOCKSIZE_MAX + u] = (BYTE)(FUZ_rand(&rand32) % nbSymbols);
+            }
+            cSize = (n&1) ? ZSTD_HC_compress(compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 5)
+                          : ZSTD_compress(compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, cSize);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        }
+        DISPLAYLEVEL(4, "OK \n");
+    }
+
+    /* tables are never repeated from a previous frame */
+    {
+        static const BYTE rawSeqFrame[] = { 0x23, 0xB5, 0x2F, 0xFD,   /* ZSTD_magicNumber */
+                                            0x00, 0x00, 0x0E,         /* compressed block, 14 bytes */
+                                            0x11, 0x00, 0x00, 'z', 's', 't', 'd',   /* 4 raw literals */
+                                            0x00, 0x00, 0x54, 0x00,   /* no sequence; LL, Off and ML tables : bt_raw; no dump */
+                                            0x00, 0x00, 0x04,         /* LLbits+Offbits+MLbits initial states */
+                                            0xC0, 0x00, 0x00 };       /* end of frame */
+        static const BYTE repeatSeqFrame[] = { 0x23, 0xB5, 0x2F, 0xFD,
+                                               0x00, 0x00, 0x0F,         /* compressed block, 15 bytes */
+                                               0x11, 0x00, 0x00, 'z', 's', 't', 'd',
+                                               0x00, 0x00, 0xFC, 0x00,   /* no sequence; LL, Off and ML tables : bt_ext; no dump */
+                                               0x00,                     /* ext : repeat all 3 tables */
+                                               0x00, 0x00, 0x04,         /* valid for the raw tables of rawSeqFrame */
+                                               0xC0, 0x00, 0x00 };
+        ZSTD_DCtx* const dctx = ZSTD_createDCtx();
+        if (dctx==NULL) goto _output_error;
+
+        DISPLAYLEVEL(4, "test%3i : repeated sequence tables at frame start : ", testNb++);
+        result = ZSTD_decompress(decodedBuffer, COMPRESSIBLE_NOISE_LENGTH, repeatSeqFrame, sizeof(repeatSeqFrame));
+        if (result != ERROR(corruption_detected)) goto _output_error;
+        result = ZSTD_decompressDCtx(dctx, decodedBuffer, COMPRESSIBLE_NOISE_LENGTH, rawSeqFrame, sizeof(rawSeqFrame));
+        if (result != 4) goto _output_error;
+        result = ZSTD_decompressDCtx(dctx, decodedBuffer, COMPRESSIBLE_NOISE_LENGTH, repeatSeqFrame, sizeof(repeatSeqFrame));
+        if (result != ERROR(corruption_detected)) goto _output_error;
+        memcpy(compressedBuffer, rawSeqFrame, sizeof(rawSeqFrame));   /* second frame of one buffer */
+        memcpy((BYTE*)compressedBuffer + sizeof(rawSeqFrame), repeatSeqFrame, sizeof(repeatSeqFrame));
+        result = ZSTD_decompress(decodedBuffer, COMPRESSIBLE_NOISE_LENGTH, compressedBuffer, sizeof(rawSeqFrame) + sizeof(repeatSeqFrame));
+        if (result != ERROR(corruption_detected)) goto _output_error;
+        DISPLAYLEVEL(4, "OK \n");
+        ZSTD_freeDCtx(dctx);
+    }
+
+    /* incompressible blocks, followed by compressible ones */
+    {
+        const size_t noiseSize = 4 * ZSTD_BLOCKSIZE_MAX;
+        const size_t sampleSize = noiseSize + 2 * ZSTD_BLOCKSIZE_MAX;
+        U32 rand32 = seed;
+        size_t u;
+        U32 n;
+        for (u=0; u<noiseSize; u++) ((BYTE*)CNBuffer)[u] = (BYTE)(FUZ_rand(&rand32) >> 5);
+        RDG_genBuffer((char*)CNBuffer+noiseSize, sampleSize-noiseSize, 0.5, 0., randState);
+
+        DISPLAYLEVEL(4, "test%3i : incompressible blocks : ", testNb++);
+        for (n=0; n<2; n++)   /* fast, then HC */
+        {
+            cSize = n ? ZSTD_HC_compress(compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 9)
+                      : ZSTD_compress(compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            if (cSize > noiseSize + 4 * 3 + (sampleSize-noiseSize) * 3 / 4) goto _output_error;   /* raw blocks, then compressed ones */
+            result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, cSize);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        }
+        DISPLAYLEVEL(4, "OK \n");
+    }
+
+    /* incompressible data, repeated : skipped raw blocks must remain reachable by match finder */
+    {
+        const size_t noiseSize = 2 * ZSTD_BLOCKSIZE_MAX + 40000;
+        const size_t sampleSize = 2 * noiseSize;
+        U32 rand32 = seed;
+        size_t u;
+        U32 n;
+        for (u=0; u<noiseSize; u++) ((BYTE*)CNBuffer)[u] = (BYTE)(FUZ_rand(&rand32) >> 5);
+        memcpy((char*)CNBuffer+noiseSize, CNBuffer, noiseSize);
+
+        DISPLAYLEVEL(4, "test%3i : repeated incompressible data : ", testNb++);
+        for (n=0; n<2; n++)   /* fast, then HC */
+        {
+            cSize = n ? ZSTD_HC_compress(compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 9)
+                      : ZSTD_compress(compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            if (cSize > noiseSize + noiseSize / 4) goto _output_error;   /* second copy must be found as a match */
+            result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, cSize);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        }
+        DISPLAYLEVEL(4, "OK \n");
+    }
+
+    /* buffered streaming compression */
+    {
+        ZBUFF_CCtx* zbc = ZBUFF_createCCtx();
+        const size_t sampleSize = 3 * ZBUFF_WINDOWSIZE + 1000;   /* several ring wraps */
+        U32 rand32 = seed;
+        int n;
+        if (zbc==NULL) goto _output_error;
+        RDG_genBuffer(CNBuffer, sampleSize, compressibility, 0., randState);
+
+        DISPLAYLEVEL(4, "test%3i : buffered streaming compression : ", testNb++);
+        for (n=1; n<=9; n+=8)   /* fast, then HC */
+        {
+            size_t inPos = 0, outPos = 0, remaining;
+            result = ZBUFF_compressInit(zbc, n, 0);
+            if (ZSTD_isError(result)) goto _output_error;
+            while (inPos < sampleSize)
+            {
+                size_t srcSize = (FUZ_rand(&rand32) & 0x3FFF) + 1;   /* 1 - 16 KB */
+                if (srcSize > sampleSize - inPos) srcSize = sampleSize - inPos;
+                size_t dstSize = (FUZ_rand(&rand32) & 1) ? ZBUFF_recommendedCOutSize() : (FUZ_rand(&rand32) & 0xFF);
+                result = ZBUFF_compressContinue(zbc, (BYTE*)compressedBuffer + outPos, &dstSize, (const BYTE*)CNBuffer + inPos, &srcSize);
+                if (ZSTD_isError(result)) goto _output_error;
+                inPos += srcSize;
+                outPos += dstSize;
+                if ((FUZ_rand(&rand32) & 15) == 0)   /* occasional flush */
+                {
+                    do {
+                        dstSize = FUZ_rand(&rand32) & 0x3FF;
+                        remaining = ZBUFF_compressFlush(zbc, (BYTE*)compressedBuffer + outPos, &dstSize);
+                        if (ZSTD_isError(remaining)) goto _output_error;
+                        outPos += dstSize;
+                    } while (remaining);
+                }
+            }
+            do {
+                size_t dstSize = FUZ_rand(&rand32) & 0xFF;
+                remaining = ZBUFF_compressEnd(zbc, (BYTE*)compressedBuffer + outPos, &dstSize);
+                if (ZSTD_isError(remaining)) goto _output_error;
+                outPos += dstSize;
+            } while (remaining);
+
+            result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, outPos);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+            cSize = outPos;
+        }
+        ZBUFF_freeCCtx(zbc);
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : buffered streaming decompression : ", testNb++);
+        {
+            ZBUFF_DCtx* zbd = ZBUFF_createDCtx();
+            if (zbd==NULL) goto _output_error;
+            memset(decodedBuffer, 0, sampleSize);
+            result = FUZ_ZBUFF_decompress(zbd, decodedBuffer, sampleSize, compressedBuffer, cSize, &rand32);   /* last HC frame */
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+            cSize = ZSTD_compress(compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);   /* single pass */
+            if (ZSTD_isError(cSize)) goto _output_error;
+            memset(decodedBuffer, 0, sampleSize);
+            result = FUZ_ZBUFF_decompress(zbd, decodedBuffer, sampleSize, compressedBuffer, cSize, &rand32);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+            result = FUZ_ZBUFF_decompress(zbd, decodedBuffer, sampleSize, compressedBuffer, cSize-1, &rand32);   /* truncated */
+            if (!ZSTD_isError(result)) goto _output_error;
+            ZBUFF_freeDCtx(zbd);
+        }
+        DISPLAYLEVEL(4, "OK \n");
+    }
+
+    /* buffered streaming decompression, window larger than ZBUFF_WINDOWSIZE */
+    {
+        ZBUFF_DCtx* const zbd = ZBUFF_createDCtx();
+        const size_t segmentSize = 1 MB;
+        const size_t sampleSize = 3 * segmentSize;   /* segments repeat the first one : matches reach 1 MB back */
+        static const int levels[] = { 9, 16, 20 };
+        U32 rand32 = seed;
+        size_t u;
+        U32 n;
+        if (zbd==NULL) goto _output_error;
+        for (u=0; u<segmentSize; u++) ((BYTE*)CNBuffer)[u] = (BYTE)(FUZ_rand(&rand32) >> 5);
+        for (u=segmentSize; u<sampleSize; u++)
+            ((BYTE*)CNBuffer)[u] = (FUZ_rand(&rand32) & 255) ? ((BYTE*)CNBuffer)[u-segmentSize] : (BYTE)(FUZ_rand(&rand32) >> 5);
+
+        DISPLAYLEVEL(4, "test%3i : buffered streaming decompression, large window : ", testNb++);
+        for (n=0; n<sizeof(levels)/sizeof(levels[0]); n++)
+        {
+            cSize = ZSTD_HC_compress(compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, levels[n]);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            if (cSize > sampleSize / 2) goto _output_error;   /* long matches were found */
+            memset(decodedBuffer, 0, sampleSize);
+            result = FUZ_ZBUFF_decompress(zbd, decodedBuffer, sampleSize, compressedBuffer, cSize, &rand32);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        }
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : window too large for ZBUFF_DCtx : ", testNb++);
+        {
+            ZSTD_frameParams fParams;
+            size_t readSize = cSize, writeSize = sampleSize;
+            result = ZSTD_getFrameParams(&fParams, compressedBuffer, cSize);
+            if ((result != 0) || (fParams.windowLog <= ZSTD_WINDOWLOG_REGULAR)) goto _output_error;   /* window is recorded */
+            ((BYTE*)compressedBuffer)[5] = ZBUFF_DWINDOWLOG_MAX + 1;   /* window descriptor */
+            result = ZBUFF_decompressInit(zbd);
+            if (ZSTD_isError(result)) goto _output_error;
+            result = ZBUFF_decompressContinue(zbd, decodedBuffer, &writeSize, compressedBuffer, &readSize);
+            if (result != ERROR(frameParameter_unsupported)) goto _output_error;
+        }
+        DISPLAYLEVEL(4, "OK \n");
+        ZBUFF_freeDCtx(zbd);
+    }
+
+#if defined(ZSTD_LEGACY_SUPPORT) && (ZSTD_LEGACY_SUPPORT==1)
+    /* legacy frames */
+    {
+        ZBUFF_DCtx* const zbd = ZBUFF_createDCtx();
+        const size_t sampleSize = 3 * ZBUFF_WINDOWSIZE + 1000;
+        U32 rand32 = seed;
+        U32 n, nbValid = 0;
+        if (zbd==NULL) goto _output_error;
+
+        DISPLAYLEVEL(4, "test%3i : v0.2 frames : ", testNb++);
+        for (n=0; (n<64) && (nbValid<4); n++)
+        {
+            /* v0.2 blocks only differ by their initial repcodes : a frame regenerated by the v0.2 decoder is a valid v0.2 frame */
+            const size_t size = (FUZ_rand(&rand32) % sampleSize) + 1;
+            cSize = ZSTD_compress(compressedBuffer, ZSTD_compressBound(size), CNBuffer, size);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            MEM_writeLE32(compressedBuffer, ZSTDv02_magicNumber);
+            result = ZSTDv02_decompress(decodedBuffer, size, compressedBuffer, cSize);
+            if ((result != size) || memcmp(decodedBuffer, CNBuffer, size)) continue;
+            nbValid++;
+            memset(decodedBuffer, 0, size);
+            result = ZSTD_decompress(decodedBuffer, size, compressedBuffer, cSize);
+            if (result != size) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, size)) goto _output_error;
+            memset(decodedBuffer, 0, size);
+            result = FUZ_ZBUFF_decompress(zbd, decodedBuffer, size, compressedBuffer, cSize, &rand32);
+            if (result != size) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, size)) goto _output_error;
+        }
+        if (!nbValid) goto _output_error;
+        DISPLAYLEVEL(4, "OK (%u frames) \n", nbValid);
+
+        DISPLAYLEVEL(4, "test%3i : v0.1 frame : ", testNb++);
+        {
+            BYTE* op = (BYTE*)compressedBuffer;
+            size_t pos = 0;
+            op[0]=0xFD; op[1]=0x2F; op[2]=0xB5; op[3]=0x1E;   /* ZSTDv01_magicNumber, big endian */
+            op += 4;
+            while (pos < sampleSize)
+            {
+                size_t blockSize = (FUZ_rand(&rand32) % (128 KB)) + 1;   /* raw blocks of random sizes */
+                if (blockSize > sampleSize - pos) blockSize = sampleSize - pos;
+                op[0] = (BYTE)(0x40 + (blockSize>>16)); op[1] = (BYTE)(blockSize>>8); op[2] = (BYTE)blockSize;
+                memcpy(op+3, (const BYTE*)CNBuffer + pos, blockSize);
+                op += 3 + blockSize;
+                pos += blockSize;
+            }
+            op[0]=0xC0; op[1]=0; op[2]=0;   /* end of frame */
+            cSize = (op + 3) - (BYTE*)compressedBuffer;
+            memset(decodedBuffer, 0, sampleSize);
+            result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, cSize);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+            memset(decodedBuffer, 0, sampleSize);
+            result = FUZ_ZBUFF_decompress(zbd, decodedBuffer, sampleSize, compressedBuffer, cSize, &rand32);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+            result = FUZ_ZBUFF_decompress(zbd, decodedBuffer, sampleSize, compressedBuffer, cSize-1, &rand32);   /* truncated */
+            if (!ZSTD_isError(result)) goto _output_error;
+        }
+        DISPLAYLEVEL(4, "OK \n");
+        ZBUFF_freeDCtx(zbd);
+    }
+#endif
+
+    /* batch compression */
+    {
+        ZSTD_CCtx* const cctx = ZSTD_createCCtx();
+        ZSTD_batchItem items[64];
+        const ZSTD_parameters params = ZSTD_getParams(1);
+        U32 rand32 = seed;
+        size_t srcPos = 0, dstPos = 0;
+        U32 n;
+        DISPLAYLEVEL(4, "test%3i : batch compression : ", testNb++);
+        if (cctx==NULL) goto _output_error;
+        RDG_genBuffer(CNBuffer, 64 * 8 KB, compressibility, 0., randState);
+        for (n=0; n<64; n++)
+        {
+            items[n].srcSize = (FUZ_rand(&rand32) & 0x1FFF) + 1;   /* 1 - 8 KB */
+            items[n].src = (const BYTE*)CNBuffer + srcPos;
+            items[n].dst = (BYTE*)compressedBuffer + dstPos;
+            items[n].dstCapacity = ZSTD_compressBound(items[n].srcSize);
+            srcPos += items[n].srcSize;
+            dstPos += items[n].dstCapacity;
+        }
+        items[63].dstCapacity = 4;   /* too small */
+        result = ZSTD_compressBatch(cctx, items, 64, params);
+        if (result != items[63].cSize) goto _output_error;
+        if (!ZSTD_isError(result)) goto _output_error;
+        for (n=0; n<63; n++)
+        {
+            /* a re-used context must produce the same frame as a new one */
+            cSize = ZSTD_compress(decodedBuffer, ZSTD_compressBound(items[n].srcSize), items[n].src, items[n].srcSize);
+            if (cSize != items[n].cSize) goto _output_error;
+            if (memcmp(decodedBuffer, items[n].dst, cSize)) goto _output_error;
+            result = ZSTD_decompress(decodedBuffer, items[n].srcSize, items[n].dst, items[n].cSize);
+            if (result != items[n].srcSize) goto _output_error;
+            if (memcmp(decodedBuffer, items[n].src, result)) goto _output_error;
+        }
+        ZSTD_freeCCtx(cctx);
+        DISPLAYLEVEL(4, "OK \n");
+    }
+
+    /* content checksum */
+    {
+        ZSTD_CCtx* const cctx = ZSTD_createCCtx();
+        ZSTD_HC_CCtx* const hcctx = ZSTD_HC_createCCtx();
+        ZSTD_DCtx* const dctx = ZSTD_createDCtx();
+        const size_t sampleSize = 3 * ZSTD_BLOCKSIZE_MAX + 1234;
+        U32 n;
+        DISPLAYLEVEL(4, "test%3i : content checksum : ", testNb++);
+        if ((cctx==NULL) || (hcctx==NULL) || (dctx==NULL)) goto _output_error;
+        RDG_genBuffer(CNBuffer, sampleSize, compressibility, 0., randState);
+        ZSTD_setContentChecksum(cctx, 1);
+        ZSTD_HC_setContentChecksum(hcctx, 1);
+        for (n=0; n<2; n++)   /* fast, then HC */
+        {
+            const BYTE* ip = (const BYTE*)compressedBuffer;
+            BYTE* op = (BYTE*)decodedBuffer;
+            size_t toRead;
+            cSize = n ? ZSTD_HC_compressCCtx(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 5)
+                      : ZSTD_compressCCtx(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            if (MEM_readLE32(compressedBuffer) != ZSTD_magicNumberExt) goto _output_error;
+            result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, cSize);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+
+            /* streaming */
+            memset(decodedBuffer, 0, sampleSize);
+            ZSTD_resetDCtx(dctx);
+            while ((toRead = ZSTD_nextSrcSizeToDecompress(dctx)) != 0)
+            {
+                result = ZSTD_decompressContinue(dctx, op, (BYTE*)decodedBuffer + sampleSize - op, ip, toRead);
+                if (ZSTD_isError(result)) goto _output_error;
+                ip += toRead;
+                op += result;
+            }
+            if (ip != (const BYTE*)compressedBuffer + cSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+
+            /* corrupted checksum */
+            ((BYTE*)compressedBuffer)[cSize-1] ^= 1;
+            result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, cSize);
+            if (result != ERROR(checksum_wrong)) goto _output_error;
+            ip = (const BYTE*)compressedBuffer;
+            op = (BYTE*)decodedBuffer;
+            ZSTD_resetDCtx(dctx);
+            while ((toRead = ZSTD_nextSrcSizeToDecompress(dctx)) != 0)
+            {
+                result = ZSTD_decompressContinue(dctx, op, (BYTE*)decodedBuffer + sampleSize - op, ip, toRead);
+                if (ZSTD_isError(result)) break;
+                ip += toRead;
+                op += result;
+            }
+            if (result != ERROR(checksum_wrong)) goto _output_error;
+
+            /* reserved descriptor bit */
+            ((BYTE*)compressedBuffer)[cSize-1] ^= 1;
+            ((BYTE*)compressedBuffer)[4] |= 0x80;
+            result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, cSize);
+            if (result != ERROR(frameParameter_unsupported)) goto _output_error;
+        }
+
+        /* disabled : regular frame, identical to one from a new context */
+        ZSTD_setContentChecksum(cctx, 0);
+        cSize = ZSTD_compressCCtx(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+        result = ZSTD_compress(decodedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+        if ((cSize != result) || memcmp(decodedBuffer, compressedBuffer, cSize)) goto _output_error;
+        ZSTD_freeCCtx(cctx);
+        ZSTD_HC_freeCCtx(hcctx);
+        ZSTD_freeDCtx(dctx);
+        DISPLAYLEVEL(4, "OK \n");
+    }
+
+    /* content size */
+    {
+        ZSTD_CCtx* const cctx = ZSTD_createCCtx();
+        ZSTD_HC_CCtx* const hcctx = ZSTD_HC_createCCtx();
+        ZSTD_DCtx* const dctx = ZSTD_createDCtx();
+        const size_t sampleSize = 2 * ZSTD_BLOCKSIZE_MAX + 5678;
+        ZSTD_frameParams fParams;
+        U32 n;
+        DISPLAYLEVEL(4, "test%3i : frame content size : ", testNb++);
+        if ((cctx==NULL) || (hcctx==NULL) || (dctx==NULL)) goto _output_error;
+        RDG_genBuffer(CNBuffer, sampleSize, compressibility, 0., randState);
+        for (n=0; n<4; n++)   /* fast, HC, then both with checksum */
+        {
+            const BYTE* ip = (const BYTE*)compressedBuffer;
+            BYTE* op = (BYTE*)decodedBuffer;
+            size_t toRead;
+            ZSTD_setContentChecksum(cctx, n>=2);
+            ZSTD_HC_setContentChecksum(hcctx, n>=2);
+            if (n&1)
+            {
+                ZSTD_HC_setPledgedSrcSize(hcctx, sampleSize);
+                cSize = ZSTD_HC_compressCCtx(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 5);
+            }
+            else
+            {
+                ZSTD_setPledgedSrcSize(cctx, sampleSize);
+                cSize = ZSTD_compressCCtx(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+            }
+            if (ZSTD_isError(cSize)) goto _output_error;
+
+            /* frame parameters */
+            result = ZSTD_getFrameParams(&fParams, compressedBuffer, 5);
+            if (result <= 5) goto _output_error;   /* needs more header */
+            result = ZSTD_getFrameParams(&fParams, compressedBuffer, cSize);
+            if (result != 0) goto _output_error;
+            if (fParams.contentSize != sampleSize) goto _output_error;
+            if ((fParams.windowLog < 10) || (fParams.checksumFlag != (n>=2))) goto _output_error;
+
+            /* one shot, into a buffer of exact size */
+            result = ZSTD_decompress(decodedBuffer, (size_t)fParams.contentSize, compressedBuffer, cSize);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+            result = ZSTD_decompress(decodedBuffer, sampleSize-1, compressedBuffer, cSize);
+            if (result != ERROR(dstSize_tooSmall)) goto _output_error;
+
+            /* streaming */
+            memset(decodedBuffer, 0, sampleSize);
+            ZSTD_resetDCtx(dctx);
+            while ((toRead = ZSTD_nextSrcSizeToDecompress(dctx)) != 0)
+            {
+                result = ZSTD_decompressContinue(dctx, op, (BYTE*)decodedBuffer + sampleSize - op, ip, toRead);
+                if (ZSTD_isError(result)) goto _output_error;
+                ip += toRead;
+                op += result;
+            }
+            if (ip != (const BYTE*)compressedBuffer + cSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        }
+
+        /* pledge applies to next frame only */
+        cSize = ZSTD_compressCCtx(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+        result = ZSTD_getFrameParams(&fParams, compressedBuffer, cSize);
+        if ((result != 0) || (fParams.contentSize != ZSTD_CONTENTSIZE_UNKNOWN)) goto _output_error;
+
+        /* content doesn't match pledged size : frame end is refused */
+        ZSTD_setContentChecksum(cctx, 0);
+        ZSTD_setPledgedSrcSize(cctx, sampleSize+1);
+        cSize = ZSTD_compressCCtx(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+        if (cSize != ERROR(srcSize_wrong)) goto _output_error;
+        ZSTD_HC_setContentChecksum(hcctx, 0);
+        ZSTD_HC_setPledgedSrcSize(hcctx, sampleSize-1);
+        cSize = ZSTD_HC_compressCCtx(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 5);
+        if (cSize != ERROR(srcSize_wrong)) goto _output_error;
+        {
+            ZBUFF_CCtx* const zbc = ZBUFF_createCCtx();
+            int level;
+            if (zbc==NULL) goto _output_error;
+            for (level=1; level<=5; level+=4)   /* fast, then HC engine */
+            {
+                size_t srcSize = 500, dstSize = ZSTD_compressBound(sampleSize);
+                ZSTD_setPledgedSrcSize(cctx, 1000);
+                result = ZSTD_compressBegin(cctx, compressedBuffer, dstSize);
+                if (ZSTD_isError(result)) goto _output_error;
+                result = ZSTD_compressContinue(cctx, compressedBuffer, dstSize, CNBuffer, 500);
+                if (ZSTD_isError(result)) goto _output_error;
+                result = ZSTD_compressEnd(cctx, compressedBuffer, dstSize);
+                if (result != ERROR(srcSize_wrong)) goto _output_error;
+                ZSTD_HC_setPledgedSrcSize(hcctx, 1000);
+                result = ZSTD_HC_compressBegin(hcctx, compressedBuffer, dstSize, level, 0);
+                if (ZSTD_isError(result)) goto _output_error;
+                result = ZSTD_HC_compressContinue(hcctx, compressedBuffer, dstSize, CNBuffer, 500);
+                if (ZSTD_isError(result)) goto _output_error;
+                result = ZSTD_HC_compressEnd(hcctx, compressedBuffer, dstSize);
+                if (result != ERROR(srcSize_wrong)) goto _output_error;
+                ZBUFF_setPledgedSrcSize(zbc, 1000);
+                result = ZBUFF_compressInit(zbc, level, 0);
+                if (ZSTD_isError(result)) goto _output_error;
+                result = ZBUFF_compressContinue(zbc, compressedBuffer, &dstSize, CNBuffer, &srcSize);
+                if (ZSTD_isError(result) || (srcSize != 500)) goto _output_error;
+                dstSize = ZSTD_compressBound(sampleSize);
+                result = ZBUFF_compressEnd(zbc, compressedBuffer, &dstSize);
+                if (result != ERROR(srcSize_wrong)) goto _output_error;
+            }
+            ZBUFF_freeCCtx(zbc);
+        }
+        ZSTD_freeCCtx(cctx);
+        ZSTD_HC_freeCCtx(hcctx);
+        ZSTD_freeDCtx(dctx);
+        DISPLAYLEVEL(4, "OK \n");
+    }
+
+    /* concatenated and skippable frames */
+    {
+        ZSTD_DCtx* const dctx = ZSTD_createDCtx();
+        const size_t sampleSize = ZSTD_BLOCKSIZE_MAX + 999;
+        static const char metadata[] = "tenant:42";
+        BYTE* const op = (BYTE*)compressedBuffer;
+        const BYTE* ip = op;
+        BYTE* dp = (BYTE*)decodedBuffer;
+        size_t toRead;
+        DISPLAYLEVEL(4, "test%3i : concatenated and skippable frames : ", testNb++);
+        if (dctx==NULL) goto _output_error;
+        RDG_genBuffer(CNBuffer, 2*sampleSize, compressibility, 0., randState);
+        cSize = ZSTD_writeSkippableFrame(op, ZSTD_skippableHeaderSize + sizeof(metadata), metadata, sizeof(metadata), 0);
+        if (cSize != ZSTD_skippableHeaderSize + sizeof(metadata)) goto _output_error;
+        result = ZSTD_compress(op+cSize, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+        if (ZSTD_isError(result)) goto _output_error;
+        cSize += result;
+        result = ZSTD_writeSkippableFrame(op+cSize, ZSTD_skippableHeaderSize, NULL, 0, 15);   /* empty */
+        if (result != ZSTD_skippableHeaderSize) goto _output_error;
+        cSize += result;
+        result = ZSTD_HC_compress(op+cSize, ZSTD_compressBound(sampleSize), (const BYTE*)CNBuffer + sampleSize, sampleSize, 5);
+        if (ZSTD_isError(result)) goto _output_error;
+        cSize += result;
+        result = ZSTD_writeSkippableFrame(op+cSize, 64, metadata, sizeof(metadata), 16);
+        if (!ZSTD_isError(result)) goto _output_error;   /* magicVariant too large */
+        result = ZSTD_writeSkippableFrame(op+cSize, ZSTD_skippableHeaderSize-1, NULL, 0, 0);
+        if (result != ERROR(dstSize_tooSmall)) goto _output_error;   /* no room for header */
+        result = ZSTD_writeSkippableFrame(op+cSize, ZSTD_skippableHeaderSize + sizeof(metadata) - 1, metadata, sizeof(metadata), 0);
+        if (result != ERROR(dstSize_tooSmall)) goto _output_error;
+
+        /* one shot */
+        result = ZSTD_decompress(decodedBuffer, 2*sampleSize, compressedBuffer, cSize);
+        if (result != 2*sampleSize) goto _output_error;
+        if (memcmp(decodedBuffer, CNBuffer, 2*sampleSize)) goto _output_error;
+        result = ZSTD_decompress(decodedBuffer, 2*sampleSize, compressedBuffer, cSize-1);
+        if (!ZSTD_isError(result)) goto _output_error;   /* truncated last frame */
+        result = ZSTD_decompress(decodedBuffer, 2*sampleSize, compressedBuffer, ZSTD_skippableHeaderSize + sizeof(metadata) - 1);
+        if (result != ERROR(srcSize_wrong)) goto _output_error;   /* truncated skippable frame */
+        result = ZSTD_decompress(decodedBuffer, 2*sampleSize, compressedBuffer, ZSTD_skippableHeaderSize + sizeof(metadata));
+        if (result != 0) goto _output_error;   /* skippable frame only */
+
+        /* streaming, one frame after another */
+        memset(decodedBuffer, 0, 2*sampleSize);
+        while (ip < op+cSize)
+        {
+            ZSTD_resetDCtx(dctx);
+            while ((toRead = ZSTD_nextSrcSizeToDecompress(dctx)) != 0)
+            {
+                result = ZSTD_decompressContinue(dctx, dp, (BYTE*)decodedBuffer + 2*sampleSize - dp, ip, toRead);
+                if (ZSTD_isError(result)) goto _output_error;
+                ip += toRead;
+                dp += result;
+            }
+        }
+        if ((ip != op+cSize) || (dp != (BYTE*)decodedBuffer + 2*sampleSize)) goto _output_error;
+        if (memcmp(decodedBuffer, CNBuffer, 2*sampleSize)) goto _output_error;
+        ZSTD_freeDCtx(dctx);
+        DISPLAYLEVEL(4, "OK \n");
+    }
+
+    /* seekable source test */
+    {
+        ZSTD_DCtx* dctx = ZSTD_createDCtx();
+        BYTE* const op = (BYTE*)compressedBuffer;
+        BYTE entries[10 * ZSTD_seekTableEntrySize];
+        const size_t frameSize = 100 KB + 17;
+        const size_t totalSize = 10 * frameSize;
+        U32 frameNb;
+        DISPLAYLEVEL(4, "test%3i : decompress range from seekable source : ", testNb++);
+        if (dctx==NULL) goto _output_error;
+        cSize = 0;
+        for (frameNb=0; frameNb<10; frameNb++)
+        {
+            result = ZSTD_compress(op+cSize, ZSTD_compressBound(frameSize), (const BYTE*)CNBuffer + frameNb*frameSize, frameSize);
+            if (ZSTD_isError(result)) goto _output_error;
+            MEM_writeLE32(entries + frameNb*ZSTD_seekTableEntrySize, (U32)result);
+            MEM_writeLE32(entries + frameNb*ZSTD_seekTableEntrySize + 4, (U32)frameSize);
+            cSize += result;
+        }
+        MEM_writeLE32(op+cSize, ZSTD_skippableMagicNumber);
+        MEM_writeLE32(op+cSize+4, sizeof(entries) + ZSTD_seekTableFooterSize);
+        memcpy(op+cSize+8, entries, sizeof(entries));
+        cSize += 8 + sizeof(entries);
+        MEM_writeLE32(op+cSize, 10);
+        MEM_writeLE32(op+cSize+4, ZSTD_seekTableMagicNumber);
+        cSize += ZSTD_seekTableFooterSize;
+
+        result = ZSTD_decompressRange(dctx, decodedBuffer, 250 KB, compressedBuffer, cSize, 3*frameSize + 999);   /* over 3 frames */
+        if (result != 250 KB) goto _output_error;
+        if (memcmp(decodedBuffer, (const BYTE*)CNBuffer + 3*frameSize + 999, result)) goto _output_error;
+        result = ZSTD_decompressRange(dctx, decodedBuffer, COMPRESSIBLE_NOISE_LENGTH, compressedBuffer, cSize, 0);   /* everything */
+        if (result != totalSize) goto _output_error;
+        if (memcmp(decodedBuffer, CNBuffer, result)) goto _output_error;
+        result = ZSTD_decompressRange(dctx, decodedBuffer, 100, compressedBuffer, cSize, totalSize-10);   /* tail */
+        if (result != 10) goto _output_error;
+        if (memcmp(decodedBuffer, (const BYTE*)CNBuffer + totalSize-10, result)) goto _output_error;
+        result = ZSTD_decompressRange(dctx, decodedBuffer, 100, compressedBuffer, cSize, totalSize);   /* beyond end */
+        if (result != 0) goto _output_error;
+        result = ZSTD_decompressRange(dctx, decodedBuffer, 100, compressedBuffer, cSize-1, 0);   /* no seek table */
+        if (!ZSTD_isError(result)) goto _output_error;
+        ZSTD_freeDCtx(dctx);
+        DISPLAYLEVEL(4, "OK \n");
+    }
+
+    /* static allocation tests */
+    {
+        const size_t sampleSize = 70 KB;
+        const ZSTD_HC_parameters hcParams = ZSTD_HC_defaultParameters[0][9];
+        ZSTD_HC_parameters largerParams = hcParams;
+        const ZSTD_parameters minParams = { ZSTD_HASHLOG_MIN, 0, 0 };
+        const size_t cctxSize = ZSTD_estimateCCtxSize();
+        const size_t dctxSize = ZSTD_estimateDCtxSize();
+        const size_t hcctxSize = ZSTD_HC_estimateCCtxSize(hcParams);
+        const size_t workspaceSize = MAX(MAX(cctxSize, dctxSize), hcctxSize);
+        void* const workspaceBuffer = malloc(2 * workspaceSize + 64);
+        BYTE* const cWorkspace = (BYTE*)(((size_t)workspaceBuffer + 31) & ~(size_t)31);   /* 32-bytes aligned */
+        BYTE* const dWorkspace = cWorkspace + ((workspaceSize + 31) & ~(size_t)31);
+        ZSTD_CCtx* cctx;
+        ZSTD_DCtx* dctx;
+        ZSTD_HC_CCtx* hcctx;
+        if (workspaceBuffer==NULL) goto _output_error;
+        RDG_genBuffer(CNBuffer, sampleSize, compressibility, 0., randState);
+
+        DISPLAYLEVEL(4, "test%3i : static contexts : compress & decompress : ", testNb++);
+        if (ZSTD_initStaticCCtx(cWorkspace, ZSTD_estimateCCtxSize_advanced(minParams)-1) != NULL) goto _output_error;
+        if (ZSTD_initStaticDCtx(dWorkspace+1, dctxSize) != NULL) goto _output_error;
+        cctx = ZSTD_initStaticCCtx(cWorkspace, cctxSize-1);   /* too small for default parameters */
+        if (cctx==NULL) goto _output_error;
+        result = ZSTD_compressCCtx(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+        if (result != ERROR(memory_allocation)) goto _output_error;
+        cctx = ZSTD_initStaticCCtx(cWorkspace, cctxSize);
+        dctx = ZSTD_initStaticDCtx(dWorkspace, dctxSize);
+        if ((cctx==NULL) || (dctx==NULL)) goto _output_error;
+        cSize = ZSTD_compressCCtx(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+        if (ZSTD_isError(cSize)) goto _output_error;
+        result = ZSTD_decompressDCtx(dctx, decodedBuffer, sampleSize, compressedBuffer, cSize);
+        if (result != sampleSize) goto _output_error;
+        if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        if (!ZSTD_isError(ZSTD_freeCCtx(cctx))) goto _output_error;
+        if (!ZSTD_isError(ZSTD_freeDCtx(dctx))) goto _output_error;
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : static HC context : ", testNb++);
+        if (ZSTD_HC_initStaticCCtx(cWorkspace, 100) != NULL) goto _output_error;
+        hcctx = ZSTD_HC_initStaticCCtx(cWorkspace, hcctxSize);
+        if (hcctx==NULL) goto _output_error;
+        cSize = ZSTD_HC_compress_advanced(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, hcParams);
+        if (ZSTD_isError(cSize)) goto _output_error;
+        result = ZSTD_decompressDCtx(dctx, decodedBuffer, sampleSize, compressedBuffer, cSize);
+        if (result != sampleSize) goto _output_error;
+        if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        cSize = ZSTD_HC_compressCCtx(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 1);
+        if (ZSTD_isError(cSize)) goto _output_error;
+        result = ZSTD_decompressDCtx(dctx, decodedBuffer, sampleSize, compressedBuffer, cSize);
+        if (result != sampleSize) goto _output_error;
+        if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        largerParams.hashLog++;   /* needs more than workspace */
+        result = ZSTD_HC_compress_advanced(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, largerParams);
+        if (result != ERROR(memory_allocation)) goto _output_error;
+        if (!ZSTD_isError(ZSTD_HC_freeCCtx(hcctx))) goto _output_error;
+        DISPLAYLEVEL(4, "OK \n");
+
+        free(workspaceBuffer);
+    }
+
+    /* custom memory functions */
+    {
+        FUZ_memCounter counter = { 0, 0 };
+        const ZSTD_customMem customMem = { FUZ_countingAlloc, FUZ_countingFree, &counter };
+        const ZSTD_customMem invalidMem = { FUZ_countingAlloc, NULL, &counter };
+        const ZSTD_parameters smallParams = { 12, 5, 0 };
+        const size_t sampleSize = 70 KB;
+        ZSTD_CCtx* cctx;
+        ZSTD_HC_CCtx* hcctx;
+        ZSTD_DCtx* dctx;
+        ZSTD_CDict* cdict;
+        ZSTD_DDict* ddict;
+        FSE_CTable* ct;
+        FSE_DTable* dt;
+        RDG_genBuffer(CNBuffer, sampleSize, compressibility, 0., randState);
+
+        DISPLAYLEVEL(4, "test%3i : custom memory functions : ", testNb++);
+        if (ZSTD_createCCtx_advanced(invalidMem) != NULL) goto _output_error;
+        if (ZSTD_HC_createCCtx_advanced(invalidMem) != NULL) goto _output_error;
+        if (ZSTD_createDCtx_advanced(invalidMem) != NULL) goto _output_error;
+        if (counter.nbAllocs != 0) goto _output_error;
+        cctx = ZSTD_createCCtx_advanced(customMem);
+        hcctx = ZSTD_HC_createCCtx_advanced(customMem);
+        dctx = ZSTD_createDCtx_advanced(customMem);
+        if (!cctx || !hcctx || !dctx) goto _output_error;
+        if (counter.nbAllocs != 3) goto _output_error;
+        cSize = ZSTD_compressCCtx(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+        if (ZSTD_isError(cSize)) goto _output_error;
+        result = ZSTD_decompressDCtx(dctx, decodedBuffer, sampleSize, compressedBuffer, cSize);
+        if (result != sampleSize) goto _output_error;
+        cSize = ZSTD_HC_compressCCtx(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 6);
+        if (ZSTD_isError(cSize)) goto _output_error;
+        if (counter.nbAllocs != 5) goto _output_error;   /* + hash tables */
+        result = ZSTD_decompressDCtx(dctx, decodedBuffer, sampleSize, compressedBuffer, cSize);
+        if (result != sampleSize) goto _output_error;
+        if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        cdict = ZSTD_createCDict_advanced(CNBuffer, 16 KB, smallParams, customMem);
+        ddict = ZSTD_createDDict_advanced(CNBuffer, 16 KB, customMem);
+        if (!cdict || !ddict) goto _output_error;
+        cSize = ZSTD_compress_usingCDict(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, cdict);
+        if (ZSTD_isError(cSize)) goto _output_error;
+        result = ZSTD_decompress_usingDDict(dctx, decodedBuffer, sampleSize, compressedBuffer, cSize, ddict);
+        if (result != sampleSize) goto _output_error;
+        if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        ct = FSE_createCTable_advanced(255, 11, FUZ_countingAlloc, &counter);
+        dt = FSE_createDTable_advanced(11, FUZ_countingAlloc, &counter);
+        if (!ct || !dt) goto _output_error;
+        FSE_freeCTable_advanced(ct, FUZ_countingFree, &counter);
+        FSE_freeDTable_advanced(dt, FUZ_countingFree, &counter);
+        ZSTD_freeCDict(cdict);
+        ZSTD_freeDDict(ddict);
+        ZSTD_freeCCtx(cctx);
+        ZSTD_HC_freeCCtx(hcctx);
+        ZSTD_freeDCtx(dctx);
+        if (counter.nbAllocs != 5+7+2) goto _output_error;
+        if (counter.nbFrees != counter.nbAllocs) goto _output_error;
+        DISPLAYLEVEL(4, "OK \n");
+    }
+
+    /* fast compression parameters */
+    {
+        ZSTD_CCtx* cctx = ZSTD_createCCtx();
+        const size_t sampleSize = 100 KB;
+        size_t defaultCSize;
+        U32 hashLog, searchLength;
+        if (!cctx) goto _output_error;
+        RDG_genBuffer(CNBuffer, sampleSize, compressibility, 0., randState);
+
+        DISPLAYLEVEL(4, "test%3i : fast compression with all parameters : ", testNb++);
+        defaultCSize = ZSTD_compressCCtx(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+        if (ZSTD_isError(defaultCSize)) goto _output_error;
+        for (hashLog = ZSTD_HASHLOG_MIN; hashLog <= ZSTD_HASHLOG_MAX; hashLog++)
+        for (searchLength = ZSTD_SEARCHLENGTH_MIN; searchLength <= ZSTD_SEARCHLENGTH_MAX; searchLength++)
+        {
+            ZSTD_parameters params;
+            params.hashLog = hashLog;
+            params.searchLength = searchLength;
+            params.acceleration = 0;
+            cSize = ZSTD_compress_advanced(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, params);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, cSize);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+            if ((hashLog == 14) && (searchLength == 7) && (cSize != defaultCSize)) goto _output_error;   /* default parameters */
+        }
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : accelerated fast levels : ", testNb++);
+        {
+            int level;
+            size_t previousCSize = defaultCSize;
+            if (ZSTD_compressLevel(compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 0) != defaultCSize) goto _output_error;
+            if (ZSTD_getParams(ZSTD_MIN_CLEVEL-1).acceleration != ZSTD_ACCELERATION_MAX) goto _output_error;
+            for (level = -1; level >= ZSTD_MIN_CLEVEL; level -= 5)
+            {
+                cSize = ZSTD_compressLevel(compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, level);
+                if (ZSTD_isError(cSize)) goto _output_error;
+                if (cSize < previousCSize) goto _output_error;   /* faster levels never compress better on this sample */
+                previousCSize = cSize;
+                result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, cSize);
+                if (result != sampleSize) goto _output_error;
+                if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+            }
+        }
+        DISPLAYLEVEL(4, "OK \n");
+
+        ZSTD_freeCCtx(cctx);
+    }
+
+    /* optimal parser */
+    {
+        ZSTD_HC_CCtx* hcctx = ZSTD_HC_createCCtx();
+        const size_t sampleSize = 300 KB;   /* several blocks : statistics are carried over */
+        size_t btlazy2Size;
+        if (!hcctx) goto _output_error;
+        RDG_genBuffer(CNBuffer, sampleSize, compressibility, 0., randState);
+
+        DISPLAYLEVEL(4, "test%3i : btopt compression : ", testNb++);
+        btlazy2Size = ZSTD_HC_compressCCtx(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 20);
+        if (ZSTD_isError(btlazy2Size)) goto _output_error;
+        cSize = ZSTD_HC_compressCCtx(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 21);
+        if (ZSTD_isError(cSize)) goto _output_error;
+        if (cSize > btlazy2Size) goto _output_error;
+        result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, cSize);
+        if (result != sampleSize) goto _output_error;
+        if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        DISPLAYLEVEL(4, "OK (%u < %u bytes) \n", (U32)cSize, (U32)btlazy2Size);
+
+        ZSTD_HC_freeCCtx(hcctx);
+    }
+
+    /* HC context re-use : tables are invalidated, not cleared, between frames */
+    {
+        ZSTD_HC_CCtx* const hcctx = ZSTD_HC_createCCtx();
+        const int hcLevels[] = { 2, 5, 9, 13, 20, 21 };
+        const size_t frameSize = 5 KB;
+        BYTE* const refBuffer = (BYTE*)compressedBuffer + ZSTD_compressBound(COMPRESSIBLE_NOISE_LENGTH)/2;
+        U32 n, f;
+        if (!hcctx) goto _output_error;
+        RDG_genBuffer(CNBuffer, 64 * frameSize, compressibility, 0., randState);
+
+        DISPLAYLEVEL(4, "test%3i : re-use HC context across frames : ", testNb++);
+        for (n=0; n < sizeof(hcLevels)/sizeof(hcLevels[0]); n++)
+        {
+            for (f=0; f<64; f++)
+            {
+                const BYTE* const frame = (const BYTE*)CNBuffer + f*frameSize;
+                size_t refSize;
+                cSize = ZSTD_HC_compressCCtx(hcctx, compressedBuffer, ZSTD_compressBound(frameSize), frame, frameSize, hcLevels[n]);
+                if (ZSTD_isError(cSize)) goto _output_error;
+                refSize = ZSTD_HC_compress(refBuffer, ZSTD_compressBound(frameSize), frame, frameSize, hcLevels[n]);   /* fresh context */
+                if (refSize != cSize) goto _output_error;
+                if (memcmp(compressedBuffer, refBuffer, cSize)) goto _output_error;
+                result = ZSTD_decompress(decodedBuffer, frameSize, compressedBuffer, cSize);
+                if (result != frameSize) goto _output_error;
+                if (memcmp(decodedBuffer, frame, frameSize)) goto _output_error;
+            }
+        }
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : HC parameters scaled to source size : ", testNb++);
+        {
+            const ZSTD_HC_parameters unknownSize = ZSTD_HC_getParams(20, 0);
+            const ZSTD_HC_parameters p200K = ZSTD_HC_getParams(20, 200 KB);
+            if ((p200K.windowLog > 18) || (p200K.contentLog > 19) || (p200K.hashLog > 19)) goto _output_error;
+            if (ZSTD_HC_estimateCCtxSize(p200K) * 16 > ZSTD_HC_estimateCCtxSize(unknownSize)) goto _output_error;
+            cSize = ZSTD_HC_compress_advanced(hcctx, compressedBuffer, ZSTD_compressBound(frameSize), CNBuffer, frameSize, unknownSize);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            result = ZSTD_decompress(decodedBuffer, frameSize, compressedBuffer, cSize);
+            if (result != frameSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, frameSize)) goto _output_error;
+        }
+        DISPLAYLEVEL(4, "OK \n");
+
+        ZSTD_HC_freeCCtx(hcctx);
+    }
+
+    /* long distance matching */
+    {
+        ZSTD_HC_CCtx* hcctx = ZSTD_HC_createCCtx();
+        const size_t sampleSize = COMPRESSIBLE_NOISE_LENGTH;
+        const size_t repeatSize = 3 MB;   /* repeated 7 MB later, far beyond level 6 window */
+        size_t regularSize;
+        if (!hcctx) goto _output_error;
+        RDG_genBuffer(CNBuffer, sampleSize, compressibility, 0., randState);
+        memcpy((char*)CNBuffer + sampleSize - repeatSize, CNBuffer, repeatSize);
+
+        DISPLAYLEVEL(4, "test%3i : invalid long distance window : ", testNb++);
+        if (!ZSTD_isError(ZSTD_HC_setLongDistance(hcctx, ZSTD_HC_LDM_WINDOWLOG_MAX+1))) goto _output_error;
+        if (!ZSTD_isError(ZSTD_HC_setLongDistance(hcctx, ZSTD_HC_LDM_WINDOWLOG_MIN-1))) goto _output_error;
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : long distance matching : ", testNb++);
+        regularSize = ZSTD_HC_compressCCtx(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 6);
+        if (ZSTD_isError(regularSize)) goto _output_error;
+        if (ZSTD_HC_setLongDistance(hcctx, 24)) goto _output_error;
+        cSize = ZSTD_HC_compressCCtx(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 6);
+        if (ZSTD_isError(cSize)) goto _output_error;
+        if (cSize + (repeatSize/4) > regularSize) goto _output_error;   /* repeated part must be almost free */
+        result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, cSize);
+        if (result != sampleSize) goto _output_error;
+        if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        DISPLAYLEVEL(4, "OK (%u < %u bytes) \n", (U32)cSize, (U32)regularSize);
+
+        ZSTD_HC_freeCCtx(hcctx);
+    }
+
+    /* Huffman table re-use */
+    {
+        U32 CTable[HUF_CTABLE_SIZE_U32(HUF_MAX_SYMBOL_VALUE)];
+        U32 DTable[HUF_DTABLE_SIZE_U32(HUF_MAX_TABLELOG)];
+        const size_t segSize = 4 KB;
+        size_t c1, c2;
+        unsigned repeat = 0, algoNb = 0;
+        RDG_genBuffer(CNBuffer, segSize, 0.5, 0., randState);   /* entropy compressible, whatever -P */
+
+        DISPLAYLEVEL(4, "test%3i : re-use Huffman table of previous block : ", testNb++);
+        c1 = HUF_compress4X_repeat(compressedBuffer, HUF_compressBound(segSize), CNBuffer, segSize, 255, 0, (HUF_CElt*)CTable, &repeat);
+        if (HUF_isError(c1) || (c1 <= 1) || (repeat != 0)) goto _output_error;
+        repeat = 1;   /* decoder now knows CTable */
+        c2 = HUF_compress4X_repeat((BYTE*)compressedBuffer + c1, HUF_compressBound(segSize), CNBuffer, segSize, 255, 0, (HUF_CElt*)CTable, &repeat);
+        if (HUF_isError(c2) || (c2 <= 1) || (repeat != 1)) goto _output_error;   /* same statistics : table must be re-used */
+        if (c2 >= c1) goto _output_error;   /* no table description */
+        result = HUF_decompress4X_hufOnly(DTable, &algoNb, decodedBuffer, segSize, compressedBuffer, c1);
+        if (result != segSize) goto _output_error;
+        if (memcmp(decodedBuffer, CNBuffer, segSize)) goto _output_error;
+        memset(decodedBuffer, 0, segSize);
+        result = HUF_decompress4X_usingDTable(decodedBuffer, segSize, (BYTE*)compressedBuffer + c1, c2, DTable, algoNb);
+        if (result != segSize) goto _output_error;
+        if (memcmp(decodedBuffer, CNBuffer, segSize)) goto _output_error;
+        DISPLAYLEVEL(4, "OK (%u < %u bytes) \n", (U32)c2, (U32)c1);
+
+        DISPLAYLEVEL(4, "test%3i : Huffman table of a previous frame is not re-used : ", testNb++);
+        {
+            BYTE* const newTableFrame = (BYTE*)compressedBuffer + c1 + c2;
+            const size_t f1Size = FUZ_writeLiteralsFrame(newTableFrame, compressedBuffer, c1, segSize, 0);
+            BYTE* const prevTableFrame = newTableFrame + f1Size;
+            const size_t f2Size = FUZ_writeLiteralsFrame(prevTableFrame, (BYTE*)compressedBuffer + c1, c2, segSize, 3);
+            ZSTD_DCtx* const dctx = ZSTD_createDCtx();
+            if (dctx==NULL) goto _output_error;
+            result = ZSTD_decompressDCtx(dctx, decodedBuffer, segSize, newTableFrame, f1Size);
+            if (result != segSize) goto _output_error;
+            result = ZSTD_decompressDCtx(dctx, decodedBuffer, segSize, prevTableFrame, f2Size);
+            if (result != ERROR(corruption_detected)) goto _output_error;
+            result = ZSTD_decompress(decodedBuffer, 2*segSize, newTableFrame, f1Size + f2Size);
+            if (result != ERROR(corruption_detected)) goto _output_error;
+            result = ZSTD_decompress(decodedBuffer, segSize, prevTableFrame, f2Size);
+            if (result != ERROR(corruption_detected)) goto _output_error;
+            ZSTD_freeDCtx(dctx);
+        }
+        DISPLAYLEVEL(4, "OK \n");
+    }
+
+    /* block size */
+    {
+        ZSTD_CCtx* cctx = ZSTD_createCCtx();
+        ZSTD_HC_CCtx* hcctx = ZSTD_HC_createCCtx();
+        ZSTD_DCtx* dctx = ZSTD_createDCtx();
+        const size_t sampleSize = 100 KB;
+        const size_t blockSize = 4 KB;
+        U32 n;
+        if (!cctx || !hcctx || !dctx) goto _output_error;
+        RDG_genBuffer(CNBuffer, sampleSize, compressibility, 0., randState);
+
+        DISPLAYLEVEL(4, "test%3i : invalid block sizes : ", testNb++);
+        if (ZSTD_setBlockSize(cctx, ZSTD_BLOCKSIZE_MAX+1) != ERROR(srcSize_wrong)) goto _output_error;
+        if (ZSTD_setBlockSize(cctx, ZSTD_BLOCKSIZE_MIN-1) != ERROR(srcSize_wrong)) goto _output_error;
+        if (ZSTD_HC_setBlockSize(hcctx, ZSTD_BLOCKSIZE_MAX+1) != ERROR(srcSize_wrong)) goto _output_error;
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : compress with %u bytes blocks : ", testNb++, (U32)blockSize);
+        if (ZSTD_setBlockSize(cctx, blockSize)) goto _output_error;
+        if (ZSTD_HC_setBlockSize(hcctx, blockSize)) goto _output_error;
+        for (n=0; n<2; n++)   /* fast, then HC */
+        {
+            size_t readPos = 0, toRead;
+            U32 nbBlocks = 0;
+            if (n==0)
+                cSize = ZSTD_compressCCtx(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize);
+            else
+                cSize = ZSTD_HC_compressCCtx(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), CNBuffer, sampleSize, 1);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            ZSTD_resetDCtx(dctx);
+            result = 0;
+            while ((toRead = ZSTD_nextSrcSizeToDecompress(dctx)) != 0)   /* one block at a time */
+            {
+                const size_t dSize = ZSTD_decompressContinue(dctx, (BYTE*)decodedBuffer + result, sampleSize - result, (const BYTE*)compressedBuffer + readPos, toRead);
+                if (ZSTD_isError(dSize)) goto _output_error;
+                if (dSize > blockSize) goto _output_error;
+                nbBlocks += (dSize > 0);
+                readPos += toRead;
+                result += dSize;
+            }
+            if (readPos != cSize) goto _output_error;
+            if (result != sampleSize) goto _output_error;
+            if (nbBlocks != (sampleSize + blockSize - 1) / blockSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, sampleSize)) goto _output_error;
+        }
+        DISPLAYLEVEL(4, "OK \n");
+
+        ZSTD_freeCCtx(cctx);
+        ZSTD_HC_freeCCtx(hcctx);
+        ZSTD_freeDCtx(dctx);
+    }
+
+    /* dictionary tests */
+    {
+        ZSTD_CCtx* cctx = ZSTD_createCCtx();
+        ZSTD_CCtx* preparedCCtx = ZSTD_createCCtx();
+        ZSTD_HC_CCtx* hcctx = ZSTD_HC_createCCtx();
+        ZSTD_DCtx* dctx = ZSTD_createDCtx();
+        ZSTD_DCtx* preparedDCtx = ZSTD_createDCtx();
+        const size_t dictSize = 64 KB;
+        const size_t sampleSize = 37 KB;
+        const BYTE* const sample = (const BYTE*)CNBuffer + dictSize;
+        BYTE* const dict = (BYTE*)malloc(dictSize);   /* separate buffer, so that dictionary is not contiguous with sample */
+        static const int hcLevels[] = { 1, 4, 6, 8, 13, 21 };   /* fast, greedy, lazy, lazy2, btlazy2, btopt */
+        size_t noDictSize;
+        U32 n;
+        if (!cctx || !preparedCCtx || !hcctx || !dctx || !preparedDCtx || !dict) goto _output_error;
+        RDG_genBuffer(CNBuffer, dictSize + 3*sampleSize, compressibility, 0., randState);   /* overwritten by rle test */
+        memcpy(dict, CNBuffer, dictSize);
+
+        DISPLAYLEVEL(4, "test%3i : compress with dictionary : ", testNb++);
+        noDictSize = ZSTD_compress(compressedBuffer, ZSTD_compressBound(sampleSize), sample, sampleSize);
+        if (ZSTD_isError(noDictSize)) goto _output_error;
+        cSize = ZSTD_compress_usingDict(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), sample, sampleSize, dict, dictSize);
+        if (ZSTD_isError(cSize)) goto _output_error;
+        if (cSize >= noDictSize) goto _output_error;
+        DISPLAYLEVEL(4, "OK (%u < %u bytes) \n", (U32)cSize, (U32)noDictSize);
+
+        DISPLAYLEVEL(4, "test%3i : decompress with dictionary : ", testNb++);
+        result = ZSTD_decompress_usingDict(dctx, decodedBuffer, sampleSize, compressedBuffer, cSize, dict, dictSize);
+        if (result != sampleSize) goto _output_error;
+        if (memcmp(decodedBuffer, sample, sampleSize)) goto _output_error;
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : decompress concatenated frames with dictionary : ", testNb++);
+        result = ZSTD_compress_usingDict(cctx, (BYTE*)compressedBuffer + cSize, ZSTD_compressBound(sampleSize), sample + sampleSize, sampleSize, dict, dictSize);
+        if (ZSTD_isError(result)) goto _output_error;
+        result = ZSTD_decompress_usingDict(dctx, decodedBuffer, 2*sampleSize, compressedBuffer, cSize + result, dict, dictSize);
+        if (result != 2*sampleSize) goto _output_error;
+        if (memcmp(decodedBuffer, sample, 2*sampleSize)) goto _output_error;
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : decompress without dictionary : ", testNb++);
+        result = ZSTD_decompress(decodedBuffer, sampleSize, compressedBuffer, cSize);
+        if (!ZSTD_isError(result) && !memcmp(decodedBuffer, sample, sampleSize)) goto _output_error;
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : compress & decompress with prepared contexts : ", testNb++);
+        result = ZSTD_compressBegin(preparedCCtx, decodedBuffer, COMPRESSIBLE_NOISE_LENGTH);
+        if (ZSTD_isError(result)) goto _output_error;
+        result = ZSTD_compress_insertDictionary(preparedCCtx, dict, dictSize);
+        if (ZSTD_isError(result)) goto _output_error;
+        result = ZSTD_resetDCtx(preparedDCtx);
+        if (ZSTD_isError(result)) goto _output_error;
+        result = ZSTD_decompress_insertDictionary(preparedDCtx, dict, dictSize);
+        if (ZSTD_isError(result)) goto _output_error;
+        for (n=0; n<3; n++)
+        {
+            const BYTE* const s = sample + n*sampleSize;
+            cSize = ZSTD_compress_usingPreparedCCtx(cctx, preparedCCtx, compressedBuffer, ZSTD_compressBound(sampleSize), s, sampleSize);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            result = ZSTD_decompress_usingPreparedDCtx(dctx, preparedDCtx, decodedBuffer, sampleSize, compressedBuffer, cSize);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, s, sampleSize)) goto _output_error;
+        }
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : streaming decompression with dictionary : ", testNb++);
+        cSize = ZSTD_compress_usingDict(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), sample, sampleSize, dict, dictSize);
+        if (ZSTD_isError(cSize)) goto _output_error;
+        result = ZSTD_resetDCtx(dctx);
+        if (ZSTD_isError(result)) goto _output_error;
+        result = ZSTD_decompress_insertDictionary(dctx, dict, dictSize);
+        if (ZSTD_isError(result)) goto _output_error;
+        {
+            const BYTE* ip = (const BYTE*)compressedBuffer;
+            BYTE* op = (BYTE*)decodedBuffer;
+            size_t toRead;
+            while ((toRead = ZSTD_nextSrcSizeToDecompress(dctx)) != 0)
+            {
+                result = ZSTD_decompressContinue(dctx, op, (BYTE*)decodedBuffer + sampleSize - op, ip, toRead);
+                if (ZSTD_isError(result)) goto _output_error;
+                ip += toRead;
+                op += result;
+            }
+            if ((size_t)(op - (BYTE*)decodedBuffer) != sampleSize) goto _output_error;
+        }
+        if (memcmp(decodedBuffer, sample, sampleSize)) goto _output_error;
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : HC compression with dictionary : ", testNb++);
+        for (n=0; n<sizeof(hcLevels)/sizeof(hcLevels[0]); n++)
+        {
+            cSize = ZSTD_HC_compress_usingDict(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), sample, sampleSize, dict, dictSize, hcLevels[n]);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            result = ZSTD_decompress_usingDict(dctx, decodedBuffer, sampleSize, compressedBuffer, cSize, dict, dictSize);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, sample, sampleSize)) goto _output_error;
+        }
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : compress & decompress with digested dictionaries : ", testNb++);
+        {
+            ZSTD_CDict* const cdict = ZSTD_createCDict(dict, dictSize);
+            ZSTD_HC_CDict* const hcCDict = ZSTD_HC_createCDict(dict, dictSize, 8);
+            ZSTD_DDict* const ddict = ZSTD_createDDict(dict, dictSize);
+            size_t refSize;
+            if (!cdict || !hcCDict || !ddict) goto _output_error;
+            refSize = ZSTD_compress_usingDict(cctx, decodedBuffer, ZSTD_compressBound(sampleSize), sample, sampleSize, dict, dictSize);
+            if (ZSTD_isError(refSize)) goto _output_error;
+            memset(dict, 0, dictSize);   /* digested dictionaries own a copy of dictionary content */
+            cSize = ZSTD_compress_usingCDict(cctx, compressedBuffer, ZSTD_compressBound(sampleSize), sample, sampleSize, cdict);
+            if (cSize != refSize) goto _output_error;
+            if (memcmp(compressedBuffer, decodedBuffer, cSize)) goto _output_error;
+            result = ZSTD_decompress_usingDDict(dctx, decodedBuffer, sampleSize, compressedBuffer, cSize, ddict);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, sample, sampleSize)) goto _output_error;
+            cSize = ZSTD_HC_compress_usingCDict(hcctx, compressedBuffer, ZSTD_compressBound(sampleSize), sample, sampleSize, hcCDict);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            result = ZSTD_decompress_usingDDict(dctx, decodedBuffer, sampleSize, compressedBuffer, cSize, ddict);
+            if (result != sampleSize) goto _output_error;
+            if (memcmp(decodedBuffer, sample, sampleSize)) goto _output_error;
+            memcpy(dict, CNBuffer, dictSize);
+            ZSTD_freeCDict(cdict);
+            ZSTD_HC_freeCDict(hcCDict);
+            ZSTD_freeDDict(ddict);
+        }
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : insert dictionary at wrong stage : ", testNb++);
+        result = ZSTD_compress_insertDictionary(preparedCCtx, dict, dictSize);   /* already loaded */
+        if (result != ERROR(stage_wrong)) goto _output_error;
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : train dictionary from samples : ", testNb++);
+        {
+            size_t samplesSizes[300];
+            size_t totalSize = 0;
+            DiB_params params;
+            memset(&params, 0, sizeof(params));
+            for (n=0; n<300; n++)
+            {
+                samplesSizes[n] = 500 + (FUZ_rand(&randState) & 1023);
+                totalSize += samplesSizes[n];
+            }
+            RDG_genBuffer(CNBuffer, totalSize, compressibility, 0., randState);
+            result = DiB_trainFromBuffer(dict, 16 KB, CNBuffer, samplesSizes, 300, params);
+            if (ZSTD_isError(result)) goto _output_error;
+            if (result > 16 KB) goto _output_error;
+            params.segmentSize = 200;
+            result = DiB_trainFromBuffer(dict, 16 KB, CNBuffer, samplesSizes, 300, params);
+            if (ZSTD_isError(result)) goto _output_error;
+            cSize = ZSTD_compress_usingDict(cctx, compressedBuffer, ZSTD_compressBound(samplesSizes[0]), CNBuffer, samplesSizes[0], dict, result);
+            if (ZSTD_isError(cSize)) goto _output_error;
+            result = ZSTD_decompress_usingDict(dctx, decodedBuffer, samplesSizes[0], compressedBuffer, cSize, dict, result);
+            if (result != samplesSizes[0]) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, samplesSizes[0])) goto _output_error;
+            result = DiB_trainFromBuffer(dict, 16 KB, CNBuffer, samplesSizes, 1, params);   /* not enough samples */
+            if (result != ERROR(srcSize_wrong)) goto _output_error;
+            result = DiB_trainFromBuffer(dict, 100, CNBuffer, samplesSizes, 300, params);   /* dictionary too small */
+            if (result != ERROR(dstSize_tooSmall)) goto _output_error;
+        }
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : per-context statistics : ", testNb++);
+        {
+            const size_t testSize = 1 MB;
+            ZSTD_stats cStats, dStats;
+            RDG_genBuffer(CNBuffer, testSize, compressibility, 0., randState);
+            if (ZSTD_getCCtxStats(cctx, &cStats) == ERROR(stats_unsupported))   /* library compiled without ZSTD_STATS */
+            {
+                if (ZSTD_resetDCtxStats(dctx) != ERROR(stats_unsupported)) goto _output_error;
+                if (ZSTD_HC_getCCtxStats(hcctx, &cStats) != ERROR(stats_unsupported)) goto _output_error;
+            }
+            else
+            {
+                U64 cHist = 0, dHist = 0;
+                if (ZSTD_resetCCtxStats(cctx) || ZSTD_resetDCtxStats(dctx) || ZSTD_HC_resetCCtxStats(hcctx)) goto _output_error;
+                cSize = ZSTD_compressCCtx(cctx, compressedBuffer, ZSTD_compressBound(testSize), CNBuffer, testSize);
+                if (ZSTD_isError(cSize)) goto _output_error;
+                result = ZSTD_decompressDCtx(dctx, decodedBuffer, testSize, compressedBuffer, cSize);
+                if (result != testSize) goto _output_error;
+                ZSTD_getCCtxStats(cctx, &cStats);
+                ZSTD_getDCtxStats(dctx, &dStats);
+                for (n=0; n<ZSTD_STATS_MLBUCKETS; n++) cHist += cStats.matchLengthHistogram[n], dHist += dStats.matchLengthHistogram[n];
+                if (cHist != cStats.nbSequences) goto _output_error;
+                if (dHist != dStats.nbSequences) goto _output_error;
+                if (dStats.nbSequences > cStats.nbSequences) goto _output_error;   /* sequences of blocks emitted raw are not decoded */
+                for (n=0; n<3; n++) if (cStats.nbBlocks[n] != dStats.nbBlocks[n]) goto _output_error;
+                if (cStats.nbBlocks[0] + cStats.nbBlocks[1] + cStats.nbBlocks[2] < testSize / ZSTD_BLOCKSIZE_MAX) goto _output_error;
+
+                cSize = ZSTD_HC_compressCCtx(hcctx, compressedBuffer, ZSTD_compressBound(testSize), CNBuffer, testSize, 5);
+                if (ZSTD_isError(cSize)) goto _output_error;
+                ZSTD_HC_getCCtxStats(hcctx, &cStats);
+                for (cHist=0, n=0; n<ZSTD_STATS_MLBUCKETS; n++) cHist += cStats.matchLengthHistogram[n];
+                if (cHist != cStats.nbSequences) goto _output_error;
+                if (cStats.matchLengthHistogram[0] + cStats.matchLengthHistogram[1]) goto _output_error;   /* matches are >= 4 bytes */
+
+                ZSTD_copyDCtx(dctx, preparedDCtx);   /* counters belong to dctx */
+                if (ZSTD_getDCtxStats(dctx, &cStats)) goto _output_error;
+                if (memcmp(&cStats, &dStats, sizeof(dStats))) goto _output_error;
+            }
+        }
+        DISPLAYLEVEL(4, "OK \n");
+
+        DISPLAYLEVEL(4, "test%3i : custom level tables : ", testNb++);
+        {
+            const size_t testSize = 200 KB;   /* table row 1 */
+            ZSTD_HC_levelTable table;
+            ZSTD_HC_parameters params;
+            size_t refSize = 0;
+            int level;
+            memcpy(table, ZSTD_HC_defaultParameters, sizeof(table));
+            table[1][1] = ZSTD_HC_defaultParameters[1][6];
+            table[1][3] = ZSTD_HC_defaultParameters[1][9];
+            RDG_genBuffer(CNBuffer, testSize, compressibility, 0., randState);
+            if (ZSTD_HC_setLevelTable(hcctx, &table)) goto _output_error;
+            for (level=1; level<=3; level+=2)   /* level 1 is no longer redirected towards ZSTD_compress() */
+            {
+                cSize = ZSTD_HC_compressCCtx(hcctx, compressedBuffer, ZSTD_compressBound(testSize), CNBuffer, testSize, level);
+                if (ZSTD_isError(cSize)) goto _output_error;
+                refSize = ZSTD_HC_compress_advanced(hcctx, decodedBuffer, ZSTD_compressBound(testSize), CNBuffer, testSize, table[1][level]);
+                if ((refSize != cSize) || memcmp(compressedBuffer, decodedBuffer, cSize)) goto _output_error;
+            }
+            if (ZSTD_HC_setLevelTable(hcctx, NULL)) goto _output_error;
+
+            if (ZSTD_HC_setGlobalLevelTable(&table)) goto _output_error;
+            if (ZSTD_HC_getGlobalLevelTable() != &table) goto _output_error;
+            cSize = ZSTD_HC_compress(compressedBuffer, ZSTD_compressBound(testSize), CNBuffer, testSize, 3);
+            if ((refSize != cSize) || memcmp(compressedBuffer, decodedBuffer, cSize)) goto _output_error;
+            params = ZSTD_HC_getParams(3, testSize);
+            ZSTD_HC_validateParams(&table[1][3], testSize);
+            if (memcmp(&params, &table[1][3], sizeof(params))) goto _output_error;
+            if (ZSTD_HC_setGlobalLevelTable(NULL)) goto _output_error;
+            if (ZSTD_HC_getGlobalLevelTable() != NULL) goto _output_error;
+
+            result = ZSTD_decompressDCtx(dctx, decodedBuffer, testSize, compressedBuffer, cSize);
+            if (result != testSize) goto _output_error;
+            if (memcmp(decodedBuffer, CNBuffer, testSize)) goto _output_error;
+        }
+        DISPLAYLEVEL(4, "OK \n");
+
+        free(dict);
+        ZSTD_freeCCtx(cctx);
+        ZSTD_freeCCtx(preparedCCtx);
+        ZSTD_HC_freeCCtx(hcctx);
+        ZSTD_freeDCtx(dctx);
+        ZSTD_freeDCtx(preparedDCtx);
+    }
+
 _end:
     free(CNBuffer);
     free(compressedBuffer);
@@ -266,10 +1604,12 @@ int fuzzerTests(U32 seed, U32 nbTests, unsigned startTest, double compressibilit
     U32 coreSeed = seed, lseed = 0;
     ZSTD_CCtx* ctx;
     ZSTD_HC_CCtx* hcctx;
+    ZSTD_DCtx* dctx;
 
     /* allocation */
     ctx = ZSTD_createCCtx();
     hcctx = ZSTD_HC_createCCtx();
+    dctx = ZSTD_createDCtx();
     cNoiseBuffer[0] = (BYTE*)malloc (srcBufferSize);
     cNoiseBuffer[1] = (BYTE*)malloc (srcBufferSize);
     cNoiseBuffer[2] = (BYTE*)malloc (srcBufferSize);
@@ -277,7 +1617,7 @@ int fuzzerTests(U32 seed, U32 nbTests, unsigned startTest, double compressibilit
     cNoiseBuffer[4] = (BYTE*)malloc (srcBufferSize);
     dstBuffer = (BYTE*)malloc (dstBufferSize);
     cBuffer   = (BYTE*)malloc (cBufferSize);
-    CHECK (!cNoiseBuffer[0] || !cNoiseBuffer[1] || !cNoiseBuffer[2] || !dstBuffer || !cBuffer || !ctx || !hcctx,
+    CHECK (!cNoiseBuffer[0] || !cNoiseBuffer[1] || !cNoiseBuffer[2] || !dstBuffer || !cBuffer || !ctx || !hcctx || !dctx,
            "Not enough memory, fuzzer tests cancelled");
 
     /* Create initial samples */
@@ -328,9 +1668,21 @@ int fuzzerTests(U32 seed, U32 nbTests, unsigned startTest, double compressibilit
         sampleStart = FUZ_rand(&lseed) % (srcBufferSize - sampleSize);
         crcOrig = XXH64(srcBuffer + sampleStart, sampleSize, 0);
 
+        /* block size : default most of the time */
+        {
+            const size_t blockSize = (FUZ_rand(&lseed) & 3) ? 0 : ZSTD_BLOCKSIZE_MIN + (FUZ_rand(&lseed) % (ZSTD_BLOCKSIZE_MAX - ZSTD_BLOCKSIZE_MIN + 1));
+            CHECK(ZSTD_isError(ZSTD_setBlockSize(ctx, blockSize)), "ZSTD_setBlockSize failed");
+            CHECK(ZSTD_isError(ZSTD_HC_setBlockSize(hcctx, blockSize)), "ZSTD_HC_setBlockSize failed");
+        }
+
+        /* long distance matching : sometimes */
+        {
+            const U32 ldmWindowLog = (FUZ_rand(&lseed) & 3) ? 0 : ZSTD_HC_LDM_WINDOWLOG_MIN + (FUZ_rand(&lseed) % (ZSTD_HC_LDM_WINDOWLOG_MAX - ZSTD_HC_LDM_WINDOWLOG_MIN + 1));
+            CHECK(ZSTD_isError(ZSTD_HC_setLongDistance(hcctx, ldmWindowLog)), "ZSTD_HC_setLongDistance failed");
+        }
+
         /* HC compression test */
-#define MAX(a,b) ((a)>(b)?(a):(b))
-        cLevelMod = MAX(1, 38 - (int)(MAX(9, sampleSizeLog) * 2));   /* use high compression levels with small samples, for speed */
+        cLevelMod = MAX(1, 40 - (int)(MAX(9, sampleSizeLog) * 2));   /* use high compression levels with small samples, for speed */
         cLevel = (FUZ_rand(&lseed) % cLevelMod) +1;
         cSize = ZSTD_HC_compressCCtx(hcctx, cBuffer, cBufferSize, srcBuffer + sampleStart, sampleSize, cLevel);
         CHECK(ZSTD_isError(cSize), "ZSTD_HC_compressCCtx failed");
@@ -429,12 +1781,44 @@ int fuzzerTests(U32 seed, U32 nbTests, unsigned startTest, double compressibilit
                 CHECK(endMark!=endCheck, "ZSTD_decompress on noisy src : dst buffer overflow");
             }
         }
+
+        /* fast compression test, random parameters */
+        {
+            const BYTE* const sampleBuffer = cNoiseBuffer[buffNb] + sampleStart;
+            ZSTD_parameters params;
+            params.hashLog = ZSTD_HASHLOG_MIN + (FUZ_rand(&lseed) % (ZSTD_HASHLOG_MAX - ZSTD_HASHLOG_MIN + 1));
+            params.searchLength = ZSTD_SEARCHLENGTH_MIN + (FUZ_rand(&lseed) % (ZSTD_SEARCHLENGTH_MAX - ZSTD_SEARCHLENGTH_MIN + 1));
+            params.acceleration = (FUZ_rand(&lseed) & 1) ? 1 + (FUZ_rand(&lseed) % ZSTD_ACCELERATION_MAX) : 1;
+            cSize = ZSTD_compress_advanced(ctx, cBuffer, cBufferSize, sampleBuffer, sampleSize, params);
+            CHECK(ZSTD_isError(cSize), "ZSTD_compress_advanced failed (hashLog %u, searchLength %u, acceleration %u)", params.hashLog, params.searchLength, params.acceleration);
+            dSize = ZSTD_decompress(dstBuffer, sampleSize, cBuffer, cSize);
+            CHECK(dSize != sampleSize, "ZSTD_decompress failed (%s) (srcSize : %u ; cSize : %u)", ZSTD_getErrorName(dSize), (U32)sampleSize, (U32)cSize);
+            crcDest = XXH64(dstBuffer, sampleSize, 0);
+            CHECK(crcOrig != crcDest, "fast compression result corrupted (pos %u / %u)", (U32)findDiff(sampleBuffer, dstBuffer, sampleSize), (U32)sampleSize);
+        }
+
+        /* dictionary round trip test */
+        {
+            const BYTE* const sampleBuffer = cNoiseBuffer[buffNb] + sampleStart;
+            const size_t dictSize = FUZ_rand(&lseed) % (128 KB);
+            const BYTE* const dict = cNoiseBuffer[buffNb] + (FUZ_rand(&lseed) % (srcBufferSize - dictSize));
+            if (FUZ_rand(&lseed) & 1)
+                cSize = ZSTD_compress_usingDict(ctx, cBuffer, cBufferSize, sampleBuffer, sampleSize, dict, dictSize);
+            else
+                cSize = ZSTD_HC_compress_usingDict(hcctx, cBuffer, cBufferSize, sampleBuffer, sampleSize, dict, dictSize, cLevel);
+            CHECK(ZSTD_isError(cSize), "compression with dictionary failed (%s)", ZSTD_getErrorName(cSize));
+            dSize = ZSTD_decompress_usingDict(dctx, dstBuffer, sampleSize, cBuffer, cSize, dict, dictSize);
+            CHECK(dSize != sampleSize, "ZSTD_decompress_usingDict failed (%s) (srcSize : %u ; cSize : %u)", ZSTD_getErrorName(dSize), (U32)sampleSize, (U32)cSize);
+            crcDest = XXH64(dstBuffer, sampleSize, 0);
+            CHECK(crcOrig != crcDest, "dictionary decompression result corrupted (pos %u / %u)", (U32)findDiff(sampleBuffer, dstBuffer, sampleSize), (U32)sampleSize);
+        }
     }
     DISPLAY("\rAll fuzzer tests completed   \n");
 
 _cleanup:
     ZSTD_freeCCtx(ctx);
     ZSTD_HC_freeCCtx(hcctx);
+    ZSTD_freeDCtx(dctx);
     free(cNoiseBuffer[0]);
     free(cNoiseBuffer[1]);
     free(cNoiseBuffer[2]);
@@ -61,6 +61,8 @@
 #  include <sys/time.h>   /* gettimeofday */
 #endif
 
+#include "threading.h"      /* pthread_mutex_t, pthread_cond_t */
+#include "pool.h"           /* POOL_create, POOL_add */
 #include "mem.h"
 #include "zstdhc_static.h"
 #include "zstd.h"
@@ -110,6 +112,7 @@ static const int g_maxNbVariations = 64;
 *  Macros
 **************************************/
 #define DISPLAY(...)  fprintf(stderr, __VA_ARGS__)
+#define DISPLAYPROGRESS(...)  if (g_nbThreads==1) { DISPLAY(__VA_ARGS__); }   /* progress lines would mix between workers */
 
 
 /**************************************
@@ -124,6 +127,10 @@ static U32 g_target = 0;
 static U32 g_noSeed = 0;
 static const ZSTD_HC_parameters* g_seedParams = ZSTD_HC_defaultParameters[0];
 static ZSTD_HC_parameters g_params = { 0, 0, 0, 0, 0, ZSTD_HC_greedy };
+static U32 g_nbThreads = 1;
+static U32 g_minCSpeed = 0;   /* bytes/ms, same unit as BMK_result_t ; 0 = no constraint */
+static U32 g_minDSpeed = 0;
+static size_t g_maxMem = 0;   /* bytes ; 0 = no constraint */
 
 void BMK_SetNbIterations(int nbLoops)
 {
@@ -131,6 +138,18 @@ void BMK_SetNbIterations(int nbLoops)
     DISPLAY("- %u iterations -\n", g_nbIterations);
 }
 
+void BMK_SetNbThreads(unsigned nbThreads)
+{
+    if (nbThreads < 1) nbThreads = 1;
+    if (nbThreads > POOL_maxThreads())
+    {
+        nbThreads = POOL_maxThreads();
+        DISPLAY("Warning : search limited to %u thread(s) \n", nbThreads);
+    }
+    g_nbThreads = nbThreads;
+    DISPLAY("- %u threads -\n", g_nbThreads);
+}
+
 
 /*********************************************************
 *  Private functions
@@ -250,8 +269,8 @@ U32 FUZ_rand(U32* src)
 *********************************************************/
 typedef struct {
     size_t cSize;
-    U32 cSpeed;
-    U32 dSpeed;
+    U32 cSpeed;   /* bytes/ms */
+    U32 dSpeed;   /* bytes/ms */
 } BMK_result_t;
 
 typedef struct
@@ -336,7 +355,7 @@ static size_t BMK_benchParam(BMK_result_t* resultPtr,
         U64 crcCheck = 0;
         const int startTime =BMK_GetMilliStart();
 
-        DISPLAY("\r%79s\r", "");
+        DISPLAYPROGRESS("\r%79s\r", "");
         for (loopNb = 1; loopNb <= g_nbIterations; loopNb++)
         {
             int nbLoops;
@@ -348,7 +367,7 @@ static size_t BMK_benchParam(BMK_result_t* resultPtr,
             if (totalTime > g_maxParamTime) break;
 
             /* Compression */
-            DISPLAY("\r%1u-%s : %9u ->", loopNb, name, (U32)srcSize);
+            DISPLAYPROGRESS("\r%1u-%s : %9u ->", loopNb, name, (U32)srcSize);
             memset(compressedBuffer, 0xE5, maxCompressedSize);
 
             nbLoops = 0;
@@ -371,9 +390,9 @@ static size_t BMK_benchParam(BMK_result_t* resultPtr,
                 cSize += blockTable[blockNb].cSize;
             if ((double)milliTime < fastestC*nbLoops) fastestC = (double)milliTime / nbLoops;
             ratio = (double)srcSize / (double)cSize;
-            DISPLAY("\r");
-            DISPLAY("%1u-%s : %9u ->", loopNb, name, (U32)srcSize);
-            DISPLAY(" %9u (%4.3f),%7.1f MB/s", (U32)cSize, ratio, (double)srcSize / fastestC / 1000.);
+            DISPLAYPROGRESS("\r");
+            DISPLAYPROGRESS("%1u-%s : %9u ->", loopNb, name, (U32)srcSize);
+            DISPLAYPROGRESS(" %9u (%4.3f),%7.1f MB/s", (U32)cSize, ratio, (double)srcSize / fastestC / 1000.);
             resultPtr->cSize = cSize;
             resultPtr->cSpeed = (U32)((double)srcSize / fastestC);
 
@@ -394,10 +413,10 @@ static size_t BMK_benchParam(BMK_result_t* resultPtr,
             milliTime = BMK_GetMilliSpan(milliTime);
 
             if ((double)milliTime < fastestD*nbLoops) fastestD = (double)milliTime / nbLoops;
-            DISPLAY("\r");
-            DISPLAY("%1u-%s : %9u -> ", loopNb, name, (U32)srcSize);
-            DISPLAY("%9u (%4.3f),%7.1f MB/s, ", (U32)cSize, ratio, (double)srcSize / fastestC / 1000.);
-            DISPLAY("%7.1f MB/s", (double)srcSize / fastestD / 1000.);
+            DISPLAYPROGRESS("\r");
+            DISPLAYPROGRESS("%1u-%s : %9u -> ", loopNb, name, (U32)srcSize);
+            DISPLAYPROGRESS("%9u (%4.3f),%7.1f MB/s, ", (U32)cSize, ratio, (double)srcSize / fastestC / 1000.);
+            DISPLAYPROGRESS("%7.1f MB/s", (double)srcSize / fastestD / 1000.);
             resultPtr->dSpeed = (U32)((double)srcSize / fastestD);
 
             /* CRC Checking */
@@ -422,9 +441,10 @@ static size_t BMK_benchParam(BMK_result_t* resultPtr,
     }
 
     /* End cleaning */
-    DISPLAY("\r");
+    DISPLAYPROGRESS("\r");
     free(compressedBuffer);
     free(resultBuffer);
+    free(blockTable);
     return 0;
 }
 
@@ -433,14 +453,20 @@ const char* g_stratName[] = { "ZSTD_HC_fast   ",
                               "ZSTD_HC_greedy ",
                               "ZSTD_HC_lazy   ",
                               "ZSTD_HC_lazy2  ",
-                              "ZSTD_HC_btlazy2" };
+                              "ZSTD_HC_btlazy2",
+                              "ZSTD_HC_btopt  " };
 
-static void BMK_printWinner(FILE* f, U32 cLevel, BMK_result_t result, ZSTD_HC_parameters params, size_t srcSize)
+static void BMK_printParams(FILE* f, ZSTD_HC_parameters params)
 {
-    DISPLAY("\r%79s\r", "");
     fprintf(f,"    {%3u,%3u,%3u,%3u,%3u, %s },  ",
             params.windowLog, params.contentLog, params.hashLog, params.searchLog, params.searchLength,
             g_stratName[(U32)(params.strategy)]);
+}
+
+static void BMK_printWinner(FILE* f, U32 cLevel, BMK_result_t result, ZSTD_HC_parameters params, size_t srcSize)
+{
+    DISPLAY("\r%79s\r", "");
+    BMK_printParams(f, params);
     fprintf(f,
             "/* level %2u */   /* R:%5.3f at %5.1f MB/s - %5.1f MB/s */\n",
             cLevel, (double)srcSize / result.cSize, (double)result.cSpeed / 1000., (double)result.dSpeed / 1000.);
@@ -454,17 +480,32 @@ typedef struct {
     ZSTD_HC_parameters params;
 } winnerInfo_t;
 
+/* BMK_printWinners2() :
+*  prints winners as one row of ZSTD_HC_defaultParameters, for the size class of benchmarked blocks.
+*  Levels without a winner (none met the constraints) repeat the previous level, so the table stays complete. */
 static void BMK_printWinners2(FILE* f, const winnerInfo_t* winners, size_t srcSize)
 {
-    int cLevel;
+    const int tableID = ((g_blockSize ? g_blockSize : srcSize) > 128 KB);
+    ZSTD_HC_parameters params = ZSTD_HC_defaultParameters[tableID][0];
+    U32 cLevel;
 
     fprintf(f, "\n /* Selected configurations : */ \n");
     fprintf(f, "#define ZSTD_HC_MAX_CLEVEL %2u \n", ZSTD_HC_MAX_CLEVEL);
-    fprintf(f, "static const ZSTD_HC_parameters ZSTD_HC_defaultParameters[ZSTD_HC_MAX_CLEVEL+1] = {\n");
+    fprintf(f, "{   /* for %s 128 KB */\n", tableID ? ">" : "<=");
     fprintf(f, "    /* W,  C,  H,  S,  L, strat */ \n");
 
     for (cLevel=0; cLevel <= ZSTD_HC_MAX_CLEVEL; cLevel++)
-        BMK_printWinner(f, cLevel, winners[cLevel].result, winners[cLevel].params, srcSize);
+    {
+        if (winners[cLevel].result.cSize)
+        {
+            params = winners[cLevel].params;
+            BMK_printWinner(f, cLevel, winners[cLevel].result, params, srcSize);
+            continue;
+        }
+        BMK_printParams(f, params);
+        fprintf(f, "/* level %2u - not tuned */\n", cLevel);
+    }
+    fprintf(f, "},\n");
 }
 
 
@@ -477,15 +518,31 @@ static void BMK_printWinners(FILE* f, const winnerInfo_t* winners, size_t srcSiz
 }
 
 
-static int BMK_seed(winnerInfo_t* winners, const ZSTD_HC_parameters params,
-              const void* srcBuffer, size_t srcSize,
-                    ZSTD_HC_CCtx* ctx)
+/* constraints : memory is checked before benchmarking, speeds after */
+static size_t BMK_cMemUsed(ZSTD_HC_parameters params)
+{
+    return (1 << params.windowLog) + ZSTD_HC_estimateCCtxSize(params);
+}
+
+static int BMK_memFits(ZSTD_HC_parameters params)
+{
+    return (!g_maxMem) || (BMK_cMemUsed(params) <= g_maxMem);
+}
+
+static int BMK_speedFits(BMK_result_t result)
+{
+    return (result.cSpeed >= g_minCSpeed) && (result.dSpeed >= g_minDSpeed);
+}
+
+
+static int BMK_updateWinners(winnerInfo_t* winners, const ZSTD_HC_parameters params,
+                             BMK_result_t testResult, size_t srcSize)
 {
-    BMK_result_t testResult;
     int better = 0;
     int cLevel;
 
-    BMK_benchParam(&testResult, srcBuffer, srcSize, ctx, params);
+    if (!testResult.cSize) return 0;   /* benchmark failed */
+    if (!BMK_speedFits(testResult)) return 0;
 
     for (cLevel = 1; cLevel <= ZSTD_HC_MAX_CLEVEL; cLevel++)
     {
@@ -513,10 +570,8 @@ static int BMK_seed(winnerInfo_t* winners, const ZSTD_HC_parameters params,
             double W_DMemUsed_note = W_ratioNote * ( 40 + 9*cLevel) - log((double)W_DMemUsed);
             double O_DMemUsed_note = O_ratioNote * ( 40 + 9*cLevel) - log((double)O_DMemUsed);
 
-            size_t W_CMemUsed = (1 << params.windowLog) + 4 * (1 << params.hashLog) +
-                                ((params.strategy==ZSTD_HC_fast) ? 0 : 4 * (1 << params.contentLog));
-            size_t O_CMemUsed = (1 << winners[cLevel].params.windowLog) + 4 * (1 << winners[cLevel].params.hashLog) +
-                                ((winners[cLevel].params.strategy==ZSTD_HC_fast) ? 0 :  4 * (1 << winners[cLevel].params.contentLog));
+            size_t W_CMemUsed = BMK_cMemUsed(params);
+            size_t O_CMemUsed = BMK_cMemUsed(winners[cLevel].params);
             double W_CMemUsed_note = W_ratioNote * ( 50 + 13*cLevel) - log((double)W_CMemUsed);
             double O_CMemUsed_note = O_ratioNote * ( 50 + 13*cLevel) - log((double)O_CMemUsed);
 
@@ -580,6 +635,79 @@ static int BMK_seed(winnerInfo_t* winners, const ZSTD_HC_parameters params,
 }
 
 
+/*********************************************************
+*  Parallel search
+*********************************************************/
+/* Candidates are generated by the main thread only (g_rand & g_alreadyTested are not shared),
+*  then benchmarked concurrently, one per worker, each with its own ZSTD_HC_CCtx.
+*  Winners are updated afterwards, in candidate order, so a single thread reproduces the sequential search. */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    U32 pending;
+} BMK_sync_t;
+
+typedef struct {
+    ZSTD_HC_CCtx* ctx;
+    ZSTD_HC_parameters params;
+    BMK_result_t result;
+    const void* srcBuffer;
+    size_t srcSize;
+} BMK_worker_t;
+
+static POOL_ctx* g_pool = NULL;
+static BMK_sync_t g_sync;
+static BMK_worker_t g_workers[POOL_MAX_THREADS];
+
+static void BMK_benchJob(void* opaque)
+{
+    BMK_worker_t* const worker = (BMK_worker_t*)opaque;
+
+    memset(&worker->result, 0, sizeof(worker->result));
+    BMK_benchParam(&worker->result, worker->srcBuffer, worker->srcSize, worker->ctx, worker->params);
+
+    pthread_mutex_lock(&g_sync.mutex);
+    if (!--g_sync.pending) pthread_cond_signal(&g_sync.cond);
+    pthread_mutex_unlock(&g_sync.mutex);
+}
+
+/* BMK_benchWorkers() :
+*  benchmarks g_workers[0..nbWorkers-1].params concurrently, and waits for all of them */
+static void BMK_benchWorkers(U32 nbWorkers, const void* srcBuffer, size_t srcSize)
+{
+    U32 u;
+
+    g_sync.pending = nbWorkers;
+    for (u=0; u<nbWorkers; u++)
+    {
+        g_workers[u].srcBuffer = srcBuffer;
+        g_workers[u].srcSize = srcSize;
+        POOL_add(g_pool, BMK_benchJob, g_workers+u);
+    }
+    pthread_mutex_lock(&g_sync.mutex);
+    while (g_sync.pending) pthread_cond_wait(&g_sync.cond, &g_sync.mutex);
+    pthread_mutex_unlock(&g_sync.mutex);
+}
+
+/* BMK_benchCandidates() :
+*  benchmarks up to g_nbThreads candidates concurrently, then updates winners.
+*  @result : nb of candidates which improved winners; they are moved to the front of candidates[] */
+static U32 BMK_benchCandidates(winnerInfo_t* winners, ZSTD_HC_parameters* candidates, U32 nbCandidates,
+                               const void* srcBuffer, size_t srcSize)
+{
+    U32 u, nbBetter = 0;
+
+    for (u=0; u<nbCandidates; u++) g_workers[u].params = candidates[u];
+    BMK_benchWorkers(nbCandidates, srcBuffer, srcSize);
+
+    for (u=0; u<nbCandidates; u++)
+        if (BMK_updateWinners(winners, g_workers[u].params, g_workers[u].result, srcSize))
+            candidates[nbBetter++] = g_workers[u].params;
+
+    return nbBetter;
+}
+
+
 /* nullified useless params, to ensure count stats */
 static ZSTD_HC_parameters* sanitizeParams(ZSTD_HC_parameters params)
 {
@@ -605,68 +733,83 @@ static BYTE g_alreadyTested[PARAMTABLESIZE] = {0};   /* init to zero */
 
 static void playAround(FILE* f, winnerInfo_t* winners,
                        ZSTD_HC_parameters params,
-                       const void* srcBuffer, size_t srcSize,
-                       ZSTD_HC_CCtx* ctx)
+                       const void* srcBuffer, size_t srcSize)
 {
     int nbVariations = 0;
     const int startTime = BMK_GetMilliStart();
 
     while (BMK_GetMilliSpan(startTime) < g_maxVariationTime)
     {
-        ZSTD_HC_parameters p = params;
-        U32 nbChanges = (FUZ_rand(&g_rand) & 3) + 1;
-        if (nbVariations++ > g_maxNbVariations) break;
+        ZSTD_HC_parameters candidates[POOL_MAX_THREADS];
+        U32 nbCandidates = 0;
+        U32 nbBetter, u;
 
-        for (; nbChanges; nbChanges--)
+        /* one candidate per worker */
+        while ((nbCandidates < g_nbThreads) && (nbVariations++ <= g_maxNbVariations))
         {
-            const U32 changeID = FUZ_rand(&g_rand) % 12;
-            switch(changeID)
+            ZSTD_HC_parameters p = params;
+            U32 nbChanges = (FUZ_rand(&g_rand) & 3) + 1;
+
+            for (; nbChanges; nbChanges--)
             {
-            case 0:
-                p.contentLog++; break;
-            case 1:
-                p.contentLog--; break;
-            case 2:
-                p.hashLog++; break;
-            case 3:
-                p.hashLog--; break;
-            case 4:
-                p.searchLog++; break;
-            case 5:
-                p.searchLog--; break;
-            case 6:
-                p.windowLog++; break;
-            case 7:
-                p.windowLog--; break;
-            case 8:
-                p.searchLength++; break;
-            case 9:
-                p.searchLength--; break;
-            case 10:
-                p.strategy = (ZSTD_HC_strategy)(((U32)p.strategy)+1); break;
-            case 11:
-                p.strategy = (ZSTD_HC_strategy)(((U32)p.strategy)-1); break;
+                const U32 changeID = FUZ_rand(&g_rand) % 12;
+                switch(changeID)
+                {
+                case 0:
+                    p.contentLog++; break;
+                case 1:
+                    p.contentLog--; break;
+                case 2:
+                    p.hashLog++; break;
+                case 3:
+                    p.hashLog--; break;
+                case 4:
+                    p.searchLog++; break;
+                case 5:
+                    p.searchLog--; break;
+                case 6:
+                    p.windowLog++; break;
+                case 7:
+                    p.windowLog--; break;
+                case 8:
+                    p.searchLength++; break;
+                case 9:
+                    p.searchLength--; break;
+                case 10:
+                    p.strategy = (ZSTD_HC_strategy)(((U32)p.strategy)+1); break;
+                case 11:
+                    p.strategy = (ZSTD_HC_strategy)(((U32)p.strategy)-1); break;
+                }
             }
-        }
 
-        /* validate new conf */
-        {
-            ZSTD_HC_parameters saved = p;
-            ZSTD_HC_validateParams(&p, g_blockSize ? g_blockSize : srcSize);
-            if (memcmp(&p, &saved, sizeof(p))) continue;  /* p was invalid */
-        }
+            /* validate new conf */
+            {
+                ZSTD_HC_parameters saved = p;
+                ZSTD_HC_validateParams(&p, g_blockSize ? g_blockSize : srcSize);
+                if (memcmp(&p, &saved, sizeof(p))) continue;  /* p was invalid */
+            }
 
-        /* exclude faster if already played params */
-        if (FUZ_rand(&g_rand) & ((1 << NB_TESTS_PLAYED(p))-1))
-            continue;
+            /* no need to bench what can't be selected */
+            if (!BMK_memFits(p)) continue;
+
+            /* exclude faster if already played params */
+            if (FUZ_rand(&g_rand) & ((1 << NB_TESTS_PLAYED(p))-1))
+                continue;
+
+            NB_TESTS_PLAYED(p)++;
+            candidates[nbCandidates++] = p;
+        }
+        if (!nbCandidates) break;
 
         /* test */
-        NB_TESTS_PLAYED(p)++;
-        if (!BMK_seed(winners, p, srcBuffer, srcSize, ctx)) continue;
+        nbBetter = BMK_benchCandidates(winners, candidates, nbCandidates, srcBuffer, srcSize);
 
         /* improvement found => search more */
-        BMK_printWinners(f, winners, srcSize);
-        playAround(f, winners, p, srcBuffer, srcSize, ctx);
+        for (u=0; u<nbBetter; u++)
+        {
+            BMK_printWinners(f, winners, srcSize);
+            playAround(f, winners, candidates[u], srcBuffer, srcSize);
+        }
     }
 
 }
@@ -674,8 +817,7 @@ static void playAround(FILE* f, winnerInfo_t* winners,
 
 static void BMK_selectRandomStart(
                        FILE* f, winnerInfo_t* winners,
-                       const void* srcBuffer, size_t srcSize,
-                       ZSTD_HC_CCtx* ctx)
+                       const void* srcBuffer, size_t srcSize)
 {
     U32 id = (FUZ_rand(&g_rand) % (ZSTD_HC_MAX_CLEVEL+1));
     if ((id==0) || (winners[id].params.windowLog==0))
@@ -687,32 +829,43 @@ static void BMK_selectRandomStart(
         p.searchLog  = FUZ_rand(&g_rand) % (ZSTD_HC_SEARCHLOG_MAX+1 - ZSTD_HC_SEARCHLOG_MIN) + ZSTD_HC_SEARCHLOG_MIN;
         p.windowLog  = FUZ_rand(&g_rand) % (ZSTD_HC_WINDOWLOG_MAX+1 - ZSTD_HC_WINDOWLOG_MIN) + ZSTD_HC_WINDOWLOG_MIN;
         p.searchLength=FUZ_rand(&g_rand) % (ZSTD_HC_SEARCHLENGTH_MAX+1 - ZSTD_HC_SEARCHLENGTH_MIN) + ZSTD_HC_SEARCHLENGTH_MIN;
-        p.strategy   = (ZSTD_HC_strategy) (FUZ_rand(&g_rand) % (ZSTD_HC_btlazy2+1));
-        playAround(f, winners, p, srcBuffer, srcSize, ctx);
+        p.strategy   = (ZSTD_HC_strategy) (FUZ_rand(&g_rand) % (ZSTD_HC_btopt+1));
+        playAround(f, winners, p, srcBuffer, srcSize);
     }
     else
-        playAround(f, winners, winners[id].params, srcBuffer, srcSize, ctx);
+        playAround(f, winners, winners[id].params, srcBuffer, srcSize);
 }
 
 
 static void BMK_benchMem(void* srcBuffer, size_t srcSize)
 {
-    ZSTD_HC_CCtx* ctx = ZSTD_HC_createCCtx();
     ZSTD_HC_parameters params;
     winnerInfo_t winners[ZSTD_HC_MAX_CLEVEL+1];
     int i;
+    U32 t;
     const char* rfName = "grillResults.txt";
     FILE* f;
     const size_t blockSize = g_blockSize ? g_blockSize : srcSize;
     const U32 srcLog = BMK_highbit((U32)(blockSize-1))+1;
 
+    /* workers */
+    g_pool = POOL_create(g_nbThreads, g_nbThreads);
+    if (!g_pool) { DISPLAY("error creating thread pool \n"); exit(1); }
+    pthread_mutex_init(&g_sync.mutex, NULL);
+    pthread_cond_init(&g_sync.cond, NULL);
+    for (t=0; t<g_nbThreads; t++)
+    {
+        g_workers[t].ctx = ZSTD_HC_createCCtx();
+        if (!g_workers[t].ctx) { DISPLAY("\nError: not enough memory!\n"); exit(1); }
+    }
+
     if (g_singleRun)
     {
         BMK_result_t testResult;
         ZSTD_HC_validateParams(&g_params, blockSize);
-        BMK_benchParam(&testResult, srcBuffer, srcSize, ctx, g_params);
+        BMK_benchParam(&testResult, srcBuffer, srcSize, g_workers[0].ctx, g_params);
         DISPLAY("\n");
-        return;
+        goto _cleanup;
     }
 
     /* init */
@@ -724,8 +877,7 @@ static void BMK_benchMem(void* srcBuffer, size_t srcSize)
         g_cSpeedTarget[1] = g_target * 1000;
     else
     {
-        /* baseline config for level 1 */
-        BMK_result_t testResult;
+        /* baseline config for level 1, measured under the same load as candidates */
         params.windowLog = 18;
         params.hashLog = 14;
         params.contentLog = 1;
@@ -733,8 +885,9 @@ static void BMK_benchMem(void* srcBuffer, size_t srcSize)
         params.searchLength = 7;
         params.strategy = ZSTD_HC_fast;
         ZSTD_HC_validateParams(&params, blockSize);
-        BMK_benchParam(&testResult, srcBuffer, srcSize, ctx, params);
-        g_cSpeedTarget[1] = (testResult.cSpeed * 15) >> 4;
+        for (t=0; t<g_nbThreads; t++) g_workers[t].params = params;
+        BMK_benchWorkers(g_nbThreads, srcBuffer, srcSize);
+        g_cSpeedTarget[1] = (g_workers[0].result.cSpeed * 15) >> 4;
     }
 
     /* establish speed objectives (relative to level 1) */
@@ -745,15 +898,22 @@ static void BMK_benchMem(void* srcBuffer, size_t srcSize)
     {
         const int tableID = (blockSize > 128 KB);
         const int maxSeeds = g_noSeed ? 1 : ZSTD_HC_MAX_CLEVEL;
+        ZSTD_HC_parameters candidates[POOL_MAX_THREADS];
+        U32 nbCandidates = 0;
         g_seedParams = ZSTD_HC_defaultParameters[tableID];
         for (i=1; i<=maxSeeds; i++)
         {
-            const U32 btPlus = (params.strategy == ZSTD_HC_btlazy2);
+            const U32 btPlus = (params.strategy >= ZSTD_HC_btlazy2);
             params = g_seedParams[i];
             params.windowLog = MIN(srcLog, params.windowLog);
             params.contentLog = MIN(params.windowLog+btPlus, params.contentLog);
             params.searchLog = MIN(params.contentLog, params.searchLog);
-            BMK_seed(winners, params, srcBuffer, srcSize, ctx);
+            if (BMK_memFits(params)) candidates[nbCandidates++] = params;
+            if ((nbCandidates == g_nbThreads) || (i == maxSeeds))
+            {
+                BMK_benchCandidates(winners, candidates, nbCandidates, srcBuffer, srcSize);
+                nbCandidates = 0;
+            }
         }
     }
     BMK_printWinners(f, winners, srcSize);
@@ -764,7 +924,7 @@ static void BMK_benchMem(void* srcBuffer, size_t srcSize)
         int mLength;
         do
         {
-            BMK_selectRandomStart(f, winners, srcBuffer, srcSize, ctx);
+            BMK_selectRandomStart(f, winners, srcBuffer, srcSize);
             mLength = BMK_GetMilliSpan(milliStart);
         } while (mLength < g_grillDuration);
     }
@@ -772,10 +932,13 @@ static void BMK_benchMem(void* srcBuffer, size_t srcSize)
     /* end summary */
     BMK_printWinners(f, winners, srcSize);
     DISPLAY("grillParams operations completed \n");
-
-    /* clean up*/
     fclose(f);
-    ZSTD_HC_freeCCtx(ctx);
+
+_cleanup:
+    POOL_free(g_pool);
+    for (t=0; t<g_nbThreads; t++) ZSTD_HC_freeCCtx(g_workers[t].ctx);
+    pthread_mutex_destroy(&g_sync.mutex);
+    pthread_cond_destroy(&g_sync.cond);
 }
 
 
@@ -883,6 +1046,15 @@ int usage_advanced(void)
     DISPLAY( "\nAdvanced options :\n");
     DISPLAY( " -i#    : iteration loops [1-9](default : %i)\n", NBLOOPS);
     DISPLAY( " -P#    : sample compressibility (default : %.1f%%)\n", COMPRESSIBILITY_DEFAULT * 100);
+    DISPLAY( " -T#    : target level 1 compression speed, in MB/s (default : measured)\n");
+    DISPLAY( " -B#    : cut input into blocks of size # (default : single block)\n");
+    DISPLAY( " -S#    : benchmark a single configuration (w#c#h#s#l#t#, or L# for a level)\n");
+    DISPLAY( " --no-seed      : do not start from the default level table\n");
+    DISPLAY( " --threads=#    : benchmark # candidates concurrently (default : 1, max : %u)\n", POOL_maxThreads());
+    DISPLAY( " --min-cspeed=# : only select configurations compressing at >= # MB/s\n");
+    DISPLAY( " --min-dspeed=# : only select configurations decompressing at >= # MB/s\n");
+    DISPLAY( " --max-mem=#    : only select configurations using <= # MB to compress\n");
+    DISPLAY( "Results are written into grillResults.txt, as a row of ZSTD_HC_defaultParameters (zstd --levels=grillResults.txt)\n");
     return 0;
 }
 
@@ -893,6 +1065,14 @@ int badusage(char* exename)
     return 1;
 }
 
+static U32 readU32FromChar(const char* argument)
+{
+    U32 result = 0;
+    while ((*argument >= '0') && (*argument <= '9'))
+        result *= 10, result += *argument++ - '0';
+    return result;
+}
+
 int main(int argc, char** argv)
 {
     int i,
@@ -914,6 +1094,10 @@ int main(int argc, char** argv)
         if(!argument) continue;   /* Protection if argument empty */
 
         if(!strcmp(argument,"--no-seed")) { g_noSeed = 1; continue; }
+        if(!strncmp(argument,"--threads=", 10)) { BMK_SetNbThreads(readU32FromChar(argument+10)); continue; }
+        if(!strncmp(argument,"--min-cspeed=", 13)) { g_minCSpeed = readU32FromChar(argument+13) * 1000; continue; }   /* MB/s -> bytes/ms */
+        if(!strncmp(argument,"--min-dspeed=", 13)) { g_minDSpeed = readU32FromChar(argument+13) * 1000; continue; }
+        if(!strncmp(argument,"--max-mem=", 10)) { g_maxMem = (size_t)readU32FromChar(argument+10) << 20; continue; }
 
         /* Decode command (note : aggregated commands are allowed) */
         if (argument[0]=='-')
@@ -0,0 +1,169 @@
+/*
+  pool.c - simple thread pool
+  Copyright (C) Yann Collet 2015
+
+  GPL v2 License
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along
+  with this program; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+  You can contact the author at :
+  - zstd source repository : https://github.com/Cyan4973/zstd
+  - Public forum : https://groups.google.com/forum/#!forum/lz4c
+*/
+
+/* *************************************
+*  Includes
+***************************************/
+#include <stdlib.h>     /* malloc, free */
+#include "pool.h"
+#include "threading.h"
+
+
+#ifdef ZSTD_MULTITHREAD
+
+/* *************************************
+*  Types
+***************************************/
+typedef struct
+{
+    POOL_function function;
+    void* opaque;
+} POOL_job;
+
+struct POOL_ctx_s
+{
+    pthread_t* threads;
+    unsigned nbThreads;
+    /* circular job queue : one slot is kept empty to distinguish full from empty */
+    POOL_job* queue;
+    size_t queueHead;
+    size_t queueTail;
+    size_t queueSize;
+    pthread_mutex_t queueMutex;
+    pthread_cond_t queuePushCond;   /* signaled when a slot becomes free */
+    pthread_cond_t queuePopCond;    /* signaled when a job becomes available */
+    int shutdown;
+};
+
+
+/* *************************************
+*  Functions
+***************************************/
+static void* POOL_thread(void* opaque)
+{
+    POOL_ctx* const ctx = (POOL_ctx*)opaque;
+    for ( ; ; )
+    {
+        POOL_job job;
+        pthread_mutex_lock(&ctx->queueMutex);
+        while ((ctx->queueHead == ctx->queueTail) && (!ctx->shutdown))
+            pthread_cond_wait(&ctx->queuePopCond, &ctx->queueMutex);
+        if (ctx->queueHead == ctx->queueTail)   /* empty and shutting down */
+        {
+            pthread_mutex_unlock(&ctx->queueMutex);
+            return opaque;
+        }
+        job = ctx->queue[ctx->queueHead];
+        ctx->queueHead = (ctx->queueHead + 1) % ctx->queueSize;
+        pthread_cond_signal(&ctx->queuePushCond);
+        pthread_mutex_unlock(&ctx->queueMutex);
+
+        job.function(job.opaque);
+    }
+}
+
+POOL_ctx* POOL_create(unsigned nbThreads, size_t queueSize)
+{
+    POOL_ctx* ctx;
+    unsigned n;
+
+    if (!nbThreads || !queueSize) return NULL;
+    if (nbThreads > POOL_MAX_THREADS) nbThreads = POOL_MAX_THREADS;
+    ctx = (POOL_ctx*)calloc(1, sizeof(*ctx));
+    if (!ctx) return NULL;
+    ctx->queueSize = queueSize + 1;
+    ctx->queue = (POOL_job*)malloc(ctx->queueSize * sizeof(POOL_job));
+    ctx->threads = (pthread_t*)malloc(nbThreads * sizeof(pthread_t));
+    if (!ctx->queue || !ctx->threads) { free(ctx->queue); free(ctx->threads); free(ctx); return NULL; }
+    pthread_mutex_init(&ctx->queueMutex, NULL);
+    pthread_cond_init(&ctx->queuePushCond, NULL);
+    pthread_cond_init(&ctx->queuePopCond, NULL);
+
+    for (n=0; n<nbThreads; n++)
+    {
+        if (pthread_create(&ctx->threads[n], NULL, &POOL_thread, ctx)) break;
+        ctx->nbThreads++;
+    }
+    if (!ctx->nbThreads) { POOL_free(ctx); return NULL; }
+    return ctx;
+}
+
+void POOL_free(POOL_ctx* ctx)
+{
+    unsigned n;
+    if (!ctx) return;
+    pthread_mutex_lock(&ctx->queueMutex);
+    ctx->shutdown = 1;
+    pthread_cond_broadcast(&ctx->queuePopCond);
+    pthread_mutex_unlock(&ctx->queueMutex);
+    for (n=0; n<ctx->nbThreads; n++)
+        pthread_join(ctx->threads[n], NULL);
+
+    pthread_mutex_destroy(&ctx->queueMutex);
+    pthread_cond_destroy(&ctx->queuePushCond);
+    pthread_cond_destroy(&ctx->queuePopCond);
+    free(ctx->queue);
+    free(ctx->threads);
+    free(ctx);
+}
+
+void POOL_add(POOL_ctx* ctx, POOL_function function, void* opaque)
+{
+    pthread_mutex_lock(&ctx->queueMutex);
+    while ((ctx->queueTail + 1) % ctx->queueSize == ctx->queueHead)   /* full */
+        pthread_cond_wait(&ctx->queuePushCond, &ctx->queueMutex);
+    ctx->queue[ctx->queueTail].function = function;
+    ctx->queue[ctx->queueTail].opaque = opaque;
+    ctx->queueTail = (ctx->queueTail + 1) % ctx->queueSize;
+    pthread_cond_signal(&ctx->queuePopCond);
+    pthread_mutex_unlock(&ctx->queueMutex);
+}
+
+unsigned POOL_maxThreads(void) { return POOL_MAX_THREADS; }
+
+#else  /* ZSTD_MULTITHREAD not defined */
+
+/* No multithreading support : jobs are executed synchronously */
+
+struct POOL_ctx_s { int dummy; };
+static POOL_ctx g_syncPool;
+
+POOL_ctx* POOL_create(unsigned nbThreads, size_t queueSize)
+{
+    (void)nbThreads; (void)queueSize;
+    return &g_syncPool;
+}
+
+void POOL_free(POOL_ctx* ctx) { (void)ctx; }
+
+void POOL_add(POOL_ctx* ctx, POOL_function function, void* opaque)
+{
+    (void)ctx;
+    function(opaque);
+}
+
+unsigned POOL_maxThreads(void) { return 1; }
+
+#endif  /* ZSTD_MULTITHREAD */
@@ -0,0 +1,75 @@
+/*
+  pool.h - simple thread pool
+  Copyright (C) Yann Collet 2015
+
+  GPL v2 License
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along
+  with this program; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+  You can contact the author at :
+  - zstd source repository : https://github.com/Cyan4973/zstd
+  - Public forum : https://groups.google.com/forum/#!forum/lz4c
+*/
+#ifndef POOL_H
+#define POOL_H
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+
+/* *************************************
+*  Includes
+***************************************/
+#include <stddef.h>   /* size_t */
+
+
+/* *************************************
+*  Types
+***************************************/
+typedef struct POOL_ctx_s POOL_ctx;
+typedef void (*POOL_function)(void* opaque);
+
+
+/* *************************************
+*  Functions
+***************************************/
+POOL_ctx* POOL_create(unsigned nbThreads, size_t queueSize);
+void      POOL_free(POOL_ctx* ctx);
+void      POOL_add(POOL_ctx* ctx, POOL_function function, void* opaque);
+unsigned  POOL_maxThreads(void);
+/**
+POOL_create() :
+    Create a pool of nbThreads workers, sharing a queue of up to queueSize pending jobs.
+    @result : NULL on failure.
+POOL_free() :
+    Wait for all queued jobs to complete, then release the pool.
+POOL_add() :
+    Queue function(opaque) for execution by a worker.
+    Blocks while the queue is full.
+    Jobs must synchronize their own completion (the pool does not report it).
+    When compiled without ZSTD_MULTITHREAD, function(opaque) runs immediately, within the calling thread.
+POOL_maxThreads() :
+    @result : 1 when compiled without ZSTD_MULTITHREAD, POOL_MAX_THREADS otherwise.
+*/
+
+#define POOL_MAX_THREADS 64
+
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,109 @@
+/*
+  threading.h - portable threading primitives
+  Copyright (C) Yann Collet 2015
+
+  GPL v2 License
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License along
+  with this program; if not, write to the Free Software Foundation, Inc.,
+  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+  You can contact the author at :
+  - zstd source repository : https://github.com/Cyan4973/zstd
+  - Public forum : https://groups.google.com/forum/#!forum/lz4c
+*/
+#ifndef THREADING_H_938743
+#define THREADING_H_938743
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* Multithreading is enabled by defining ZSTD_MULTITHREAD at compilation time.
+*  Otherwise, all primitives below are empty, and POOL_add() runs jobs synchronously */
+
+#if defined(ZSTD_MULTITHREAD) && defined(_WIN32)
+
+/* Windows (Vista+) : pthread names are mapped onto native primitives */
+#ifdef WINVER
+#  undef WINVER
+#endif
+#define WINVER       0x0600
+#ifdef _WIN32_WINNT
+#  undef _WIN32_WINNT
+#endif
+#define _WIN32_WINNT 0x0600
+
+#ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+/* mutex */
+#define pthread_mutex_t           CRITICAL_SECTION
+#define pthread_mutex_init(a,b)   (InitializeCriticalSection((a)), 0)
+#define pthread_mutex_destroy(a)  DeleteCriticalSection((a))
+#define pthread_mutex_lock(a)     EnterCriticalSection((a))
+#define pthread_mutex_unlock(a)   LeaveCriticalSection((a))
+
+/* condition variable */
+#define pthread_cond_t             CONDITION_VARIABLE
+#define pthread_cond_init(a, b)    (InitializeConditionVariable((a)), 0)
+#define pthread_cond_destroy(a)    /* No delete */
+#define pthread_cond_wait(a, b)    SleepConditionVariableCS((a), (b), INFINITE)
+#define pthread_cond_signal(a)     WakeConditionVariable((a))
+#define pthread_cond_broadcast(a)  WakeAllConditionVariable((a))
+
+/* pthread_create() and pthread_join() */
+typedef struct {
+    HANDLE handle;
+    void* (*start_routine)(void*);
+    void* arg;
+} pthread_t;
+
+int _pthread_create(pthread_t* thread, const void* unused,
+                   void* (*start_routine) (void*), void* arg);
+int _pthread_join(pthread_t* thread, void** value_ptr);
+#define pthread_create(a, b, c, d) _pthread_create((a), (b), (c), (d))
+#define pthread_join(a, b)         _pthread_join(&(a), (b))
+
+#elif defined(ZSTD_MULTITHREAD)   /* posix assumed ; need a better detection method */
+
+#include <pthread.h>
+
+#else  /* ZSTD_MULTITHREAD not defined */
+
+/* No multithreading support : primitives are no-op */
+#define pthread_mutex_t int
+#define pthread_mutex_init(a,b)   ((void)(a), 0)
+#define pthread_mutex_destroy(a)  ((void)(a))
+#define pthread_mutex_lock(a)     ((void)(a))
+#define pthread_mutex_unlock(a)   ((void)(a))
+
+#define pthread_cond_t int
+#define pthread_cond_init(a,b)    ((void)(a), 0)
+#define pthread_cond_destroy(a)   ((void)(a))
+#define pthread_cond_wait(a,b)    ((void)(a), (void)(b))
+#define pthread_cond_signal(a)    ((void)(a))
+#define pthread_cond_broadcast(a) ((void)(a))
+
+/* do not use pthread_t */
+
+#endif /* ZSTD_MULTITHREAD */
+
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* THREADING_H_938743 */
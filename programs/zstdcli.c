@@ -43,8 +43,10 @@
 #include <stdio.h>    /* fprintf, getchar */
 #include <stdlib.h>   /* exit, calloc, free */
 #include <string.h>   /* strcmp, strlen */
-#include "bench.h"    /* BMK_benchFiles, BMK_SetNbIterations */
+#include "bench.h"    /* BMK_benchFiles, BMK_SetNbIterations, BMK_SetOutputFormat */
 #include "fileio.h"
+#include "dibio.h"    /* DiB_trainFromFiles */
+#include "zstd_static.h"   /* ZSTD_MIN_CLEVEL */
 
 
 /**************************************
@@ -77,6 +79,8 @@
 #define ZSTD_EXTENSION ".zst"
 #define ZSTD_CAT "zstdcat"
 #define ZSTD_UNZSTD "unzstd"
+#define DICT_FILENAME_DEFAULT "dictionary"
+#define DICT_SIZE_DEFAULT (110 KB)
 
 #define KB *(1 <<10)
 #define MB *(1 <<20)
@@ -137,12 +141,27 @@ static int usage_advanced(const char* programName)
     DISPLAY( " -v     : verbose mode\n");
     DISPLAY( " -q     : suppress warnings; specify twice to suppress errors too\n");
     DISPLAY( " -c     : force write to standard output, even if it is the console\n");
+    DISPLAY( " -T#    : use # threads (default : 1) \n");
+    DISPLAY( "--fast=# : faster compression, lower ratio : level -# (1-%i) \n", -ZSTD_MIN_CLEVEL);
+    DISPLAY( "--seekable : compress into independent frames, with a seek table \n");
+    DISPLAY( "--check : add a checksum of content (XXH64), verified at decompression \n");
+    DISPLAY( "--content-size : record content size and window size into frame header \n");
+    DISPLAY( "--adapt : adjust compression level to output speed, starting from -# \n");
+    DISPLAY( "--levels=file : compression levels from file (ZSTD_HC_defaultParameters format, see paramgrill) \n");
+    DISPLAY( "Dictionary builder :\n");
+    DISPLAY( "--train  : create a dictionary from a set of training files \n");
+    DISPLAY( " -o file : dictionary file name (default : %s) \n", DICT_FILENAME_DEFAULT);
+    DISPLAY( "--maxdict=# : limit dictionary to specified size (default : %u) \n", DICT_SIZE_DEFAULT);
+    DISPLAY( "--segment=# : size of selected segments (default : automatic) \n");
     //DISPLAY( " -t     : test compressed file integrity\n");
     DISPLAY( "Benchmark arguments :\n");
     DISPLAY( " -b#    : benchmark file(s), using # compression level (default : 1) \n");
     DISPLAY( " -B#    : cut file into independent blocks of size # (default : no block)\n");
     DISPLAY( " -i#    : iteration loops [1-9](default : 3)\n");
     DISPLAY( " -r#    : test all compression levels from 1 to # (default : disabled)\n");
+    DISPLAY( "          (from -# to 1 with --fast=#) \n");
+    DISPLAY( " -T#    : run # benchmark threads concurrently, each with its own contexts \n");
+    DISPLAY( "--format=csv|json : also write results to stdout, in csv or json lines \n");
     return 0;
 }
 
@@ -154,6 +173,18 @@ static int badusage(const char* programName)
 }
 
 
+/* reads a decimal number, with optional K or M suffix (KB, MB) */
+static unsigned readU32FromChar(const char* s)
+{
+    unsigned result = 0;
+    while ((*s >='0') && (*s <='9'))
+        result *= 10, result += *s++ - '0';
+    if (*s=='K') result <<= 10;
+    if (*s=='M') result <<= 20;
+    return result;
+}
+
+
 static void waitEnter(void)
 {
     int unused;
@@ -170,10 +201,17 @@ int main(int argc, char** argv)
         decode=0,
         forceStdout=0,
         main_pause=0,
-        rangeBench = 1;
+        dictBuild=0,
+        nextArgumentIsOutFileName=0,
+        rangeBench = 0;
     unsigned fileNameStart = 0;
     unsigned nbFiles = 0;
-    unsigned cLevel = 1;
+    int cLevel = 1;
+    unsigned nbThreads = 1;
+    unsigned maxDictSize = DICT_SIZE_DEFAULT;
+    DiB_params dictParams;
+    const char** filenameTable = (const char**)malloc(argc * sizeof(const char*));   /* argc >= 1 */
+    unsigned filenameIdx = 0;
     const char* programName = argv[0];
     const char* inFileName = NULL;
     const char* outFileName = NULL;
@@ -181,6 +219,8 @@ int main(int argc, char** argv)
     const char extension[] = ZSTD_EXTENSION;
 
     displayOut = stderr;
+    if (filenameTable==NULL) { DISPLAY("not enough memory\n"); exit(1); }
+    memset(&dictParams, 0, sizeof(dictParams));
     /* Pick out basename component. Don't rely on stdlib because of conflicting behavior. */
     for (i = (int)strlen(programName); i > 0; i--)
     {
@@ -202,10 +242,23 @@ int main(int argc, char** argv)
 
         if(!argument) continue;   /* Protection if argument empty */
 
+        if (nextArgumentIsOutFileName) { nextArgumentIsOutFileName=0; outFileName=argument; continue; }
+
         /* long commands (--long-word) */
         if (!strcmp(argument, "--version")) { displayOut=stdout; DISPLAY(WELCOME_MESSAGE); return 0; }
         if (!strcmp(argument, "--help")) { displayOut=stdout; return usage_advanced(programName); }
         if (!strcmp(argument, "--verbose")) { displayLevel=4; continue; }
+        if (!strcmp(argument, "--seekable")) { FIO_setSeekable(1); continue; }
+        if (!strcmp(argument, "--check")) { FIO_setChecksum(1); continue; }
+        if (!strcmp(argument, "--content-size")) { FIO_setContentSize(1); continue; }
+        if (!strcmp(argument, "--adapt")) { FIO_setAdapt(1); continue; }
+        if (!strncmp(argument, "--levels=", 9)) { FIO_loadLevelTable(argument+9); continue; }
+        if (!strcmp(argument, "--train")) { dictBuild=1; continue; }
+        if (!strncmp(argument, "--maxdict=", 10)) { maxDictSize = readU32FromChar(argument+10); continue; }
+        if (!strncmp(argument, "--segment=", 10)) { dictParams.segmentSize = readU32FromChar(argument+10); continue; }
+        if (!strcmp(argument, "--format=csv")) { BMK_SetOutputFormat(BMK_format_csv); continue; }
+        if (!strcmp(argument, "--format=json")) { BMK_SetOutputFormat(BMK_format_json); continue; }
+        if (!strncmp(argument, "--fast=", 7)) { cLevel = -(int)readU32FromChar(argument+7); if (cLevel < ZSTD_MIN_CLEVEL) cLevel = ZSTD_MIN_CLEVEL; continue; }
 
         /* Decode commands (note : aggregated commands are allowed) */
         if (argument[0]=='-')
@@ -257,6 +310,9 @@ int main(int argc, char** argv)
                     /* Overwrite */
                 case 'f': FIO_overwriteMode(); argument++; break;
 
+                    /* destination file name (next argument) */
+                case 'o': nextArgumentIsOutFileName=1; argument++; break;
+
                     /* Verbose mode */
                 case 'v': displayLevel=4; argument++; break;
 
@@ -266,6 +322,15 @@ int main(int argc, char** argv)
                     /* keep source file (default anyway, so useless; only for xz/lzma compatibility) */
                 case 'k': argument++; break;
 
+                    /* Number of compression threads */
+                case 'T':
+                    nbThreads = 0;
+                    argument++;
+                    while ((*argument >='0') && (*argument <='9'))
+                        nbThreads *= 10, nbThreads += *argument++ - '0';
+                    FIO_setNbThreads(nbThreads);
+                    break;
+
                     /* Benchmark */
                 case 'b': bench=1; argument++; break;
 
@@ -296,7 +361,7 @@ int main(int argc, char** argv)
 
                     /* range bench (benchmark only) */
                 case 'r':
-                        rangeBench = -1;
+                        rangeBench = 1;
                         argument++;
                         break;
 
@@ -310,6 +375,9 @@ int main(int argc, char** argv)
             continue;
         }
 
+        /* all provided filenames, for dictionary builder */
+        filenameTable[filenameIdx++] = argument;
+
         /* first provided filename is input */
         if (!inFileName) { inFileName = argument; fileNameStart = i; nbFiles = argc-i; continue; }
 
@@ -325,6 +393,17 @@ int main(int argc, char** argv)
     /* Welcome message (if verbose) */
     DISPLAYLEVEL(3, WELCOME_MESSAGE);
 
+    /* Check if dictionary builder is selected */
+    if (dictBuild)
+    {
+        if (filenameIdx==0) return badusage(programName);
+        dictParams.compressionLevel = cLevel;
+        DiB_setNotificationLevel(displayLevel);
+        DiB_setNbThreads(nbThreads);
+        DiB_trainFromFiles(outFileName ? outFileName : DICT_FILENAME_DEFAULT, maxDictSize, filenameTable, filenameIdx, dictParams);
+        goto _end;
+    }
+
     /* No input filename ==> use stdin */
     if(!inFileName) { inFileName=stdinmark; }
 
@@ -332,7 +411,14 @@ int main(int argc, char** argv)
     if (!strcmp(inFileName, stdinmark) && IS_CONSOLE(stdin) ) return badusage(programName);
 
     /* Check if benchmark is selected */
-    if (bench) { BMK_benchFiles(argv+fileNameStart, nbFiles, cLevel*rangeBench); goto _end; }
+    if (bench)
+    {
+        int cLevelLast = cLevel;
+        if (rangeBench) { if (cLevel > 1) cLevel = 1; else cLevelLast = 1; }
+        if (nbThreads != 1) BMK_SetNbThreads(nbThreads);
+        BMK_benchFiles(argv+fileNameStart, nbFiles, cLevel, cLevelLast);
+        goto _end;
+    }
 
     /* No output filename ==> try to select one automatically (when possible) */
     while (!outFileName)
@@ -382,5 +468,6 @@ int main(int argc, char** argv)
 _end:
     if (main_pause) waitEnter();
     free(dynNameSpace);
+    free((void*)filenameTable);
     return 0;
 }